@@ -1,8 +1,40 @@
-
+#include <map>
 #include "stdafx.h"
 
-// [] = DCAM4AllocMemory(cameraHandle, nFrames)
+// [Reused] = DCAM4AllocMemory(cameraHandle, nFrames, reuse)
 // Allocate memory for 'cameraHandle' to capture 'nFrames'.
+// If 'reuse' is true, the buffer allocated by the last call is kept when it
+// is still attached (the capture status is READY) and the image size, row
+// and frame bytes, pixel type and 'nFrames' have not changed; otherwise it
+// is released and a new buffer is allocated.  Releasing and allocating
+// hundreds of MB of driver memory is slow, so repeated captures with the
+// same settings start sooner.  'Reused' is true if the buffer was kept.
+
+// The buffer geometry allocated last for each camera.
+struct buffer_geometry
+{
+	double width, height, rowbytes, framebytes, pixeltype;
+	int32 nFrames;
+};
+
+static std::map<HDCAM, buffer_geometry> g_buffers;
+
+static bool get_geometry(HDCAM handle, int32 nFrames, buffer_geometry& geometry)
+{
+	geometry.nFrames = nFrames;
+	return !failed(dcamprop_getvalue(handle, DCAM_IDPROP_IMAGE_WIDTH, &geometry.width))
+		&& !failed(dcamprop_getvalue(handle, DCAM_IDPROP_IMAGE_HEIGHT, &geometry.height))
+		&& !failed(dcamprop_getvalue(handle, DCAM_IDPROP_IMAGE_ROWBYTES, &geometry.rowbytes))
+		&& !failed(dcamprop_getvalue(handle, DCAM_IDPROP_IMAGE_FRAMEBYTES, &geometry.framebytes))
+		&& !failed(dcamprop_getvalue(handle, DCAM_IDPROP_IMAGE_PIXELTYPE, &geometry.pixeltype));
+}
+
+static bool same_geometry(const buffer_geometry& a, const buffer_geometry& b)
+{
+	return a.width == b.width && a.height == b.height && a.rowbytes == b.rowbytes
+		&& a.framebytes == b.framebytes && a.pixeltype == b.pixeltype && a.nFrames == b.nFrames;
+}
+
 void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
 {
 	/*!
@@ -20,16 +52,40 @@ void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
 	mHandle = (unsigned long*)mxGetUint64s(prhs[0]);
 	handle = (HDCAM)mHandle[0];
 	nFrames = (int32)mxGetScalar(prhs[1]);
+	bool reuse = nrhs > 2 && mxGetScalar(prhs[2]) != 0;
+	if (nlhs > 0)
+		plhs[0] = mxCreateLogicalScalar(false);
 
-	// Call the dcam function.
+	// Keep the current buffer if nothing has changed.
 	DCAMERR error;
+	buffer_geometry geometry;
+	bool known = get_geometry(handle, nFrames, geometry);
+	if (reuse)
+	{
+		std::map<HDCAM, buffer_geometry>::iterator it = g_buffers.find(handle);
+		int32 status = DCAMCAP_STATUS_ERROR;
+		error = dcamcap_status(handle, &status);
+		if (known && it != g_buffers.end() && !failed(error)
+			&& status == DCAMCAP_STATUS_READY && same_geometry(it->second, geometry))
+		{
+			if (nlhs > 0)
+				mxGetLogicals(plhs[0])[0] = true;
+			return;
+		}
+		if (!failed(error) && status == DCAMCAP_STATUS_READY)
+			dcambuf_release(handle);
+	}
+	g_buffers.erase(handle);
+
+	// Call the dcam function.
 	error = dcambuf_alloc(handle, nFrames);
 	if (failed(error))
 	{
-		mexPrintf("Error = 0x%08lX\ndcambuf_alloc() failed.\n", error);
+		mexPrintf("Error = 0x%08X\ndcambuf_alloc() failed.\n", error);
+		return;
 	}
+	if (known)
+		g_buffers[handle] = geometry;
 
 	return;
 }
-
-
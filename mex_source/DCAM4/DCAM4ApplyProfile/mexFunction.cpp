@@ -0,0 +1,230 @@
+#include <vector>
+#include <map>
+#include <algorithm>	// before stdafx.h, which defines min and max
+#include "stdafx.h"
+
+// [Values, Changed] = DCAM4ApplyProfile(cameraHandle, propertyIDs, values)
+// DCAM4ApplyProfile(cameraHandle, 'clear')
+// Set a group of properties (a profile) in one call and read them back.
+// 'propertyIDs' and 'values' are vectors of the same length.  The values
+// requested and read back by the last call are kept per camera, and a
+// property is only set if its requested value changed or its value read back
+// has changed since (e.g. because DCAM4SetProperty or another property
+// changed it).  A property that was not in an earlier profile is set if it
+// differs from the value of the camera.
+// The properties are set in an order the camera accepts: sensor mode,
+// readout speed, pixel type, bit depth and binning first, then the subarray
+// (with SUBARRAY MODE off while the position and size change), then the
+// remaining properties and finally the exposure time, whose range depends on
+// the others.
+// 'Values' are the values read back after the profile was applied and
+// 'Changed' is true for the properties that were set.  'clear' forgets the
+// values kept for the camera (e.g. when it is closed).
+
+struct profile_value
+{
+	double requested, readback;
+};
+
+static std::map<HDCAM, std::map<int32, profile_value> > g_profiles;
+
+struct profile_entry
+{
+	int32 id;
+	double value, readback;
+	bool set, changed, readOK;
+	int priority;
+};
+
+static bool is_subarray(int32 id)
+{
+	return id == DCAM_IDPROP_SUBARRAYHPOS || id == DCAM_IDPROP_SUBARRAYHSIZE
+		|| id == DCAM_IDPROP_SUBARRAYVPOS || id == DCAM_IDPROP_SUBARRAYVSIZE;
+}
+
+static int set_priority(int32 id)
+{
+	switch (id)
+	{
+	case DCAM_IDPROP_SENSORMODE:
+	case DCAM_IDPROP_READOUTSPEED:
+	case DCAM_IDPROP_IMAGE_PIXELTYPE:
+	case DCAM_IDPROP_BITSPERCHANNEL:
+	case DCAM_IDPROP_BINNING:
+	case DCAM_IDPROP_BINNING_INDEPENDENT:
+	case DCAM_IDPROP_BINNING_HORZ:
+	case DCAM_IDPROP_BINNING_VERT:
+		return 0;
+	case DCAM_IDPROP_SUBARRAYHPOS:
+	case DCAM_IDPROP_SUBARRAYHSIZE:
+	case DCAM_IDPROP_SUBARRAYVPOS:
+	case DCAM_IDPROP_SUBARRAYVSIZE:
+	case DCAM_IDPROP_SUBARRAYMODE:
+		return 1;
+	case DCAM_IDPROP_EXPOSURETIME:
+		return 3;
+	default:
+		return 2;
+	}
+}
+
+static void set_value(HDCAM handle, profile_entry& entry)
+{
+	DCAMERR error = dcamprop_setvalue(handle, entry.id, entry.value);
+	if (failed(error))
+		mexPrintf("Error = 0x%08X\ndcamprop_setvalue() failed for property 0x%08X.\n", error, entry.id);
+	entry.changed = true;
+}
+
+// Sets the entries marked 'set', which are sorted by priority.
+static void apply_entries(HDCAM handle, std::vector<profile_entry*>& entries)
+{
+	// The subarray position and size are changed with SUBARRAY MODE off,
+	// then the mode is set to the requested or the previous value.
+	bool subarray = false;
+	profile_entry* mode = NULL;
+	for (size_t ii = 0; ii < entries.size(); ii++)
+	{
+		subarray = subarray || (entries[ii]->set && is_subarray(entries[ii]->id));
+		if (entries[ii]->id == DCAM_IDPROP_SUBARRAYMODE)
+			mode = entries[ii];
+	}
+	double previousMode = DCAMPROP_MODE__OFF;
+	if (subarray && mode == NULL)
+		dcamprop_getvalue(handle, DCAM_IDPROP_SUBARRAYMODE, &previousMode);
+
+	bool subarrayDone = false;
+	for (size_t ii = 0; ii < entries.size(); ii++)
+	{
+		profile_entry& entry = *entries[ii];
+		if (entry.priority != 1 || !subarray)
+		{
+			if (entry.set)
+				set_value(handle, entry);
+			continue;
+		}
+		if (subarrayDone)
+			continue;
+
+		dcamprop_setvalue(handle, DCAM_IDPROP_SUBARRAYMODE, DCAMPROP_MODE__OFF);
+		for (size_t jj = ii; jj < entries.size() && entries[jj]->priority == 1; jj++)
+			if (entries[jj]->set && is_subarray(entries[jj]->id))
+				set_value(handle, *entries[jj]);
+		if (mode != NULL)
+			set_value(handle, *mode);
+		else if (previousMode != DCAMPROP_MODE__OFF)
+			dcamprop_setvalue(handle, DCAM_IDPROP_SUBARRAYMODE, previousMode);
+		subarrayDone = true;
+	}
+}
+
+static void read_entries(HDCAM handle, std::vector<profile_entry>& entries)
+{
+	for (size_t ii = 0; ii < entries.size(); ii++)
+	{
+		DCAMERR error = dcamprop_getvalue(handle, entries[ii].id, &entries[ii].readback);
+		entries[ii].readOK = !failed(error);
+		if (!entries[ii].readOK)
+			mexPrintf("Error = 0x%08X\ndcamprop_getvalue() failed for property 0x%08X.\n", error, entries[ii].id);
+	}
+}
+
+void mexFunction(int nlhs, mxArray* plhs[], int	nrhs, const	mxArray* prhs[])
+{
+	// Grab the inputs from MATLAB.
+	if (nrhs < 2)
+		mexErrMsgTxt("Proper Usage: [Values,Changed]=DCAM4ApplyProfile(cameraHandle,propertyIDs,values)");
+	unsigned long* mHandle;
+	HDCAM handle;
+	mHandle = (unsigned long*)mxGetUint64s(prhs[0]);
+	handle = (HDCAM)mHandle[0];
+	if (mxIsChar(prhs[1]))
+	{
+		char command[8];
+		mxGetString(prhs[1], command, sizeof(command));
+		if (strcmp(command, "clear") != 0)
+			mexErrMsgTxt("Unknown command; use 'clear'.");
+		g_profiles.erase(handle);
+		return;
+	}
+	if (nrhs != 3 || !mxIsDouble(prhs[1]) || !mxIsDouble(prhs[2])
+		|| mxGetNumberOfElements(prhs[1]) != mxGetNumberOfElements(prhs[2]))
+		mexErrMsgTxt("propertyIDs and values must be double vectors of the same length.");
+	size_t nProps = mxGetNumberOfElements(prhs[1]);
+	const double* ids = mxGetPr(prhs[1]);
+	const double* values = mxGetPr(prhs[2]);
+
+	// Compare the profile to the values kept from the last call.
+	std::map<int32, profile_value>& cache = g_profiles[handle];
+	std::vector<profile_entry> entries(nProps);
+	for (size_t ii = 0; ii < nProps; ii++)
+	{
+		profile_entry& entry = entries[ii];
+		entry.id = (int32)ids[ii];
+		entry.value = values[ii];
+		entry.priority = set_priority(entry.id);
+		entry.readback = 0;
+		entry.changed = entry.readOK = false;
+		std::map<int32, profile_value>::const_iterator it = cache.find(entry.id);
+		if (it != cache.end())
+		{
+			entry.set = it->second.requested != entry.value;
+			continue;
+		}
+		// Properties not seen before are compared to the camera.
+		double current;
+		entry.set = failed(dcamprop_getvalue(handle, entry.id, &current)) || current != entry.value;
+	}
+	std::vector<profile_entry*> ordered(nProps);
+	for (size_t ii = 0; ii < nProps; ii++)
+		ordered[ii] = &entries[ii];
+	std::stable_sort(ordered.begin(), ordered.end(),
+		[](const profile_entry* a, const profile_entry* b) { return a->priority < b->priority; });
+
+	apply_entries(handle, ordered);
+	read_entries(handle, entries);
+
+	// A skipped property whose value changed since the last call is set
+	// again.
+	bool stale = false;
+	for (size_t ii = 0; ii < nProps; ii++)
+	{
+		profile_entry& entry = entries[ii];
+		std::map<int32, profile_value>::const_iterator it = cache.find(entry.id);
+		entry.set = !entry.changed && entry.readOK && it != cache.end()
+			&& it->second.readback != entry.readback;
+		stale = stale || entry.set;
+	}
+	if (stale)
+	{
+		apply_entries(handle, ordered);
+		read_entries(handle, entries);
+	}
+
+	for (size_t ii = 0; ii < nProps; ii++)
+	{
+		if (entries[ii].readOK)
+		{
+			profile_value& kept = cache[entries[ii].id];
+			kept.requested = entries[ii].value;
+			kept.readback = entries[ii].readback;
+		}
+		else
+			cache.erase(entries[ii].id);
+	}
+
+	// Prepare the outputs.
+	plhs[0] = mxCreateDoubleMatrix(mxGetM(prhs[1]), mxGetN(prhs[1]), mxREAL);
+	double* readback = mxGetPr(plhs[0]);
+	for (size_t ii = 0; ii < nProps; ii++)
+		readback[ii] = entries[ii].readback;
+	if (nlhs > 1)
+	{
+		plhs[1] = mxCreateLogicalMatrix(mxGetM(prhs[1]), mxGetN(prhs[1]));
+		mxLogical* changed = mxGetLogicals(plhs[1]);
+		for (size_t ii = 0; ii < nProps; ii++)
+			changed[ii] = entries[ii].changed;
+	}
+
+	return;
+}
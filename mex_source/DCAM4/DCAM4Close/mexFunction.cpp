@@ -15,7 +15,7 @@ void mexFunction(int nlhs, mxArray* plhs[], int	nrhs, const	mxArray* prhs[])
 	error = dcamdev_close(handle);
 	if (failed(error))
 	{
-		mexPrintf("Error = 0x%08lX\ndcam_devclose() failed.\n", error);
+		mexPrintf("Error = 0x%08X\ndcam_devclose() failed.\n", error);
 	}
 
 	return;
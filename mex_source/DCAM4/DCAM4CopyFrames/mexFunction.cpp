@@ -1,7 +1,12 @@
+#include <vector>
 #include "stdafx.h"
+#include "unpack.h"
+#include "reduce.h"
+#include "framestats.h"
+#include "helper.h"
 #include "time.h"
 
-// [Frames] = DCAM4CopyFrames(cameraHandle, nFrames, timeout, eventMask)
+// [Frames, Stats] = DCAM4CopyFrames(cameraHandle, nFrames, timeout, eventMask, rois, binning, stats, saturation)
 // Copy the 'nFrames' of data collected by 'cameraHandle' during a capture. 
 // The input 'timeout' is given in milliseconds and is applied in multiple
 // places in this function.  The input 'eventMask' is one of the DCAM
@@ -9,6 +14,14 @@
 // documentation).  'eventMask' is given as an integer corresponding to the 
 // hexadecimal values defined in dcamapi4.h (e.g., DCAMWAIT_CAPEVENT_CYCLEEND
 // can be selected by inputing eventMask = 4)
+// Packed 12-bit frames (DCAM_IDPROP_IMAGE_PIXELTYPE MONO12 or MONO12P) are
+// unpacked to 16-bit pixels.  The optional 'rois' (N x 4 [Xstart Xend Ystart
+// Yend]) and 'binning' crop and bin each frame during the copy; each roi is
+// then returned as a width/binning x height/binning x nFrames array (uint32
+// sums when binning > 1), in a cell array if there are several rois.
+// If 'Stats' is requested, the statistics named in 'stats' are computed for
+// each full frame from the capture buffer (see DCAM4FrameStats).
+// Failures raise an error rather than returning partial frames.
 void mexFunction(int nlhs, mxArray* plhs[], int	nrhs, const	mxArray* prhs[])
 {
 	// Grab the inputs from MATLAB.
@@ -39,69 +52,124 @@ void mexFunction(int nlhs, mxArray* plhs[], int	nrhs, const	mxArray* prhs[])
 	memset(&pFrame, 0, sizeof(pFrame));
 	pFrame.size = sizeof(pFrame);
 
+	// The rois are checked before the wait handle is opened, as a bad roi
+	// raises an error.
+	int32 width, height;
+	DCAMERR error = get_image_size(handle, width, height);
+	if (failed(error))
+		close_wait_and_error(NULL, "DCAM4CopyFrames:dcamError",
+			"Error = 0x%08X\ndcamprop_getvalue() of the image size failed.", error);
+	reduce_args args;
+	bool reduced = get_reduce_args(nrhs > 4 ? prhs[4] : NULL, nrhs > 5 ? prhs[5] : NULL,
+		width, height, args);
+
 	// Create the HDCAMWAIT handle.
-	DCAMERR error;
 	error = dcamwait_open(&waitopen);
 	if (failed(error))
-	{
-		mexPrintf("Error = 0x%08lX\ndcamwait_open() failed.\n", error);
-		return;
-	}
+		close_wait_and_error(NULL, "DCAM4CopyFrames:dcamError",
+			"Error = 0x%08X\ndcamwait_open() failed.", error);
+	HDCAMWAIT hwait = waitopen.hwait;
 
 	// Wait for the capture to finish and then force stop it.
-	error = dcamwait_start((HDCAMWAIT)waitopen.hwait, &waitstart);
+	error = dcamwait_start(hwait, &waitstart);
 	if (failed(error))
-	{
-		mexPrintf("Error = 0x%08lX\ndcamwait_start() failed.\n", error);
-		return;
-	}
+		close_wait_and_error(hwait, "DCAM4CopyFrames:dcamError",
+			"Error = 0x%08X\ndcamwait_start() failed.", error);
 	dcamcap_stop(handle);
 
 	// Prepare the DCAMBUF_FRAME and initialize the output for MATLAB.
 	error = dcambuf_lockframe(handle, &pFrame);
 	if (failed(error))
+		close_wait_and_error(hwait, "DCAM4CopyFrames:dcamError",
+			"Error = 0x%08X\ndcambuf_lockframe() failed.", error);
+	int32 pixeltype = get_pixeltype(handle);
+	if (pixeltype != DCAM_PIXELTYPE_MONO16 && pixeltype != DCAM_PIXELTYPE_MONO12
+		&& pixeltype != DCAM_PIXELTYPE_MONO12P)
+		close_wait_and_error(hwait, "DCAM4CopyFrames:pixelType",
+			"Pixel type 0x%08X is not supported.", pixeltype);
+	std::vector<unsigned short> scratch;
+	unsigned short* imagePointer = NULL;
+	size_t imagePixels = 0;
+	if (reduced)
+	{
+		plhs[0] = create_reduce_output(args, nFrames);
+	}
+	else
+	{
+		mwSize outsize[1];
+		outsize[0] = (long long)pFrame.width * (long long)pFrame.height * nFrames;
+		// Every frame is copied over the output, so it is not zeroed first;
+		// the frames after a failed copy are zeroed below.
+		plhs[0] = mxCreateUninitNumericArray(1, outsize, mxUINT16_CLASS, mxREAL);
+		imagePointer = (unsigned short*)mxGetData(plhs[0]);
+		imagePixels = outsize[0];
+	}
+
+	unsigned int statsMask = 0;
+	unsigned short saturation = 0;
+	std::vector<frame_stats> stats;
+	std::vector<unsigned short> statsRow;
+	if (nlhs > 1)
 	{
-		mexPrintf("Error = 0x%08lX\ndcambuf_lockframe() failed.\n", error);
-		return;
+		statsMask = get_stats_mask(nrhs > 6 ? prhs[6] : NULL);
+		saturation = get_saturation(handle, nrhs > 7 ? prhs[7] : NULL, pixeltype);
+		stats.resize(nFrames);
 	}
-	mwSize outsize[1];
-	outsize[0] = (long long)pFrame.width * (long long)pFrame.height * nFrames;
-	plhs[0] = mxCreateNumericArray(1, outsize, mxUINT16_CLASS, mxREAL);
 
 	// Copy the image data to our output array.
-	unsigned short* imagePointer;
-	imagePointer = (unsigned short*)mxGetData(plhs[0]);
 	for (int ff = 0; ff < nFrames; ff++)
 	{
+		// Statistics of the full frame.
+		if (nlhs > 1)
+		{
+			error = framestats(handle, ff, pixeltype, saturation, statsMask, stats[ff], statsRow);
+			if (failed(error))
+				close_wait_and_error(hwait, "DCAM4CopyFrames:dcamError",
+					"Error = 0x%08X\ndcambuf_lockframe() failed on frame %i.", error, ff+1);
+		}
+
+		// Crop and bin the frame while copying it.
+		if (reduced)
+		{
+			// The reduced output is created zeroed, so the frames after a
+			// failure need no clearing.
+			error = reduceframe(handle, ff, pixeltype, args, ff, scratch);
+			if (failed(error))
+				close_wait_and_error(hwait, "DCAM4CopyFrames:dcamError",
+					"Error = 0x%08X\ndcambuf_lockframe() failed on frame %i.", error, ff+1);
+			continue;
+		}
+
 		// Copy the image to our desired output in MATLAB.
 		pFrame.iFrame = ff;
 		pFrame.buf = imagePointer;
-		error = dcambuf_copyframe(handle, &pFrame);
+		error = copyframe_uint16(handle, pFrame, pixeltype);
 		if (failed(error))
 		{
-			mexPrintf("Error = 0x%08lX\ndcambuf_copyframe() failed on frame %i.\n", error, ff+1);
-			return;
+			memset(imagePointer, 0, (imagePixels - (size_t)ff * pFrame.width * pFrame.height) * sizeof(unsigned short));
+			close_wait_and_error(hwait, "DCAM4CopyFrames:dcamError",
+				"Error = 0x%08X\ndcambuf_copyframe() failed on frame %i.", error, ff+1);
 		}
 
 		// Update the pointer for our MATLAB output.
-		// NOTE: char is one byte, hence the use of char here (we just need a type
-		//       that's 1 byte long).
-		imagePointer = (unsigned short*)((char*)imagePointer 
-			+ (long long)pFrame.rowbytes*(long long)pFrame.height);
+		imagePointer += (long long)pFrame.width*(long long)pFrame.height;
 	}
 
+	if (nlhs > 1)
+		plhs[1] = create_stats_output(stats, statsMask);
+
 	// Release the capturing buffer allocated by DCAM4AllocMemory().
 	error = dcambuf_release(handle);
 	if (failed(error))
 	{
-		mexPrintf("Error = 0x%08lX\ndcambuf_release() failed.\n", error);
+		mexPrintf("Error = 0x%08X\ndcambuf_release() failed.\n", error);
 	}
 
 	// Close the wait handles.
-	error = dcamwait_close((HDCAMWAIT)waitopen.hwait);
+	error = dcamwait_close(hwait);
 	if (failed(error))
 	{
-		mexPrintf("Error = 0x%08lX\ndcamwait_close() failed.\n", error);
+		mexPrintf("Error = 0x%08X\ndcamwait_close() failed.\n", error);
 	}
 
 	return;
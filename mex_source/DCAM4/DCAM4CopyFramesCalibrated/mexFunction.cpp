@@ -0,0 +1,288 @@
+#include <vector>
+#include <map>
+#include "stdafx.h"
+#include "unpack.h"
+#include "calibrate.h"
+#include "helper.h"
+
+// DCAM4CopyFramesCalibrated(cameraHandle, 'set', offset, gain, variance)
+// DCAM4CopyFramesCalibrated(cameraHandle, 'clear')
+// [Frames, Variance] = DCAM4CopyFramesCalibrated(cameraHandle, nFrames, timeout)
+// Copy the 'nFrames' of a capture as photoelectrons, (raw - offset) ./ gain,
+// in single precision.  The conversion is applied while the frames are read
+// from the capture buffer, so no second pass over the data is needed.
+// 'set' stores the offset (ADU), gain (ADU/e-) and optional read noise
+// variance (ADU^2) maps of the camera.  The maps are either the size of the
+// sensor or of the current subarray, whose position and binning are stored
+// with the maps; the maps are cropped to the subarray of each capture, which
+// must lie within them, and the cropped maps are kept until the subarray
+// changes.  Failures raise an error.  The optional output 'Variance' is the
+// variance map of the frames in e-^2 (empty without a variance map).  The
+// maps stay in memory (mexLock) until they are cleared for all cameras.
+
+struct calibration
+{
+	int32 width, height;				// size of the given maps
+	int32 hpos, vpos, binning;			// subarray of the given maps
+	std::vector<float> offset, gain, variance;
+	int32 left, top, roiwidth, roiheight;	// subarray of the maps below
+	std::vector<float> invgain, bias, variance_e;
+};
+
+static std::map<HDCAM, calibration> g_calibrations;
+
+static void Cleanup(void)
+{
+	g_calibrations.clear();
+}
+
+static void copy_map(const mxArray* in, size_t count, std::vector<float>& out)
+{
+	if (mxGetNumberOfElements(in) != count || !(mxIsSingle(in) || mxIsDouble(in)))
+		mexErrMsgTxt("offset, gain and variance must be SINGLE or DOUBLE maps of the same size.");
+	out.resize(count);
+	if (mxIsSingle(in))
+		memcpy(&out[0], mxGetData(in), count * sizeof(float));
+	else
+		for (size_t ii = 0; ii < count; ii++)
+			out[ii] = (float)mxGetPr(in)[ii];
+}
+
+// Reads the position and binning of the current subarray.
+static void get_subarray(HDCAM handle, int32& hpos, int32& vpos, int32& binning)
+{
+	double h, v, b;
+	if (failed(dcamprop_getvalue(handle, DCAM_IDPROP_SUBARRAYHPOS, &h))
+		|| failed(dcamprop_getvalue(handle, DCAM_IDPROP_SUBARRAYVPOS, &v))
+		|| failed(dcamprop_getvalue(handle, DCAM_IDPROP_BINNING, &b)))
+		mexErrMsgTxt("the subarray of the camera could not be read.");
+	hpos = (int32)h;
+	vpos = (int32)v;
+	binning = (int32)b;
+}
+
+static void set_calibration(HDCAM handle, int nrhs, const mxArray* prhs[])
+{
+	if (nrhs < 4 || nrhs > 5)
+		mexErrMsgTxt("Proper Usage: DCAM4CopyFramesCalibrated(cameraHandle,'set',offset,gain,variance)");
+	if (mxGetNumberOfDimensions(prhs[2]) != 2)
+		mexErrMsgTxt("offset must be a 2D map.");
+
+	calibration cal;
+	cal.width = (int32)mxGetM(prhs[2]);
+	cal.height = (int32)mxGetN(prhs[2]);
+	size_t count = (size_t)cal.width * cal.height;
+	copy_map(prhs[2], count, cal.offset);
+	copy_map(prhs[3], count, cal.gain);
+	if (nrhs > 4 && !mxIsEmpty(prhs[4]))
+		copy_map(prhs[4], count, cal.variance);
+	cal.left = cal.top = cal.roiwidth = cal.roiheight = 0;
+
+	// Maps of the current frame size belong to the current subarray; any
+	// other maps must be of the whole, unbinned sensor.
+	int32 width, height;
+	if (failed(get_image_size(handle, width, height)))
+		mexErrMsgTxt("the image size of the camera could not be read.");
+	cal.hpos = cal.vpos = 0;
+	cal.binning = 1;
+	if (cal.width == width && cal.height == height)
+		get_subarray(handle, cal.hpos, cal.vpos, cal.binning);
+
+	if (g_calibrations.empty())
+	{
+		mexLock();
+		mexAtExit(Cleanup);
+	}
+	g_calibrations[handle] = cal;
+}
+
+// Makes the invgain, bias and variance maps for the width x height frames
+// of the current subarray.
+static void select_roi(HDCAM handle, calibration& cal, int32 width, int32 height)
+{
+	int32 hpos, vpos, binning;
+	get_subarray(handle, hpos, vpos, binning);
+	if (binning != cal.binning)
+		mexErrMsgTxt("the binning of the camera differs from that of the calibration maps.");
+	int32 left = (hpos - cal.hpos) / binning;
+	int32 top = (vpos - cal.vpos) / binning;
+	if (hpos < cal.hpos || vpos < cal.vpos || left + width > cal.width || top + height > cal.height)
+		mexErrMsgTxt("the calibration maps don't cover the frames (maps must be of the sensor or of a subarray containing the frames).");
+	if (cal.roiwidth == width && cal.roiheight == height && cal.left == left && cal.top == top)
+		return;
+
+	size_t count = (size_t)width * height;
+	cal.invgain.resize(count);
+	cal.bias.resize(count);
+	for (int32 yy = 0; yy < height; yy++)
+	{
+		size_t src = (size_t)(top + yy) * cal.width + left;
+		size_t dst = (size_t)yy * width;
+		calibration_maps(&cal.offset[src], &cal.gain[src], &cal.invgain[dst], &cal.bias[dst], width);
+	}
+	cal.variance_e.clear();
+	if (!cal.variance.empty())
+	{
+		cal.variance_e.resize(count);
+		for (int32 yy = 0; yy < height; yy++)
+			for (int32 xx = 0; xx < width; xx++)
+			{
+				size_t ii = (size_t)yy * width + xx;
+				float invgain = cal.invgain[ii];
+				cal.variance_e[ii] = cal.variance[(size_t)(top + yy) * cal.width + left + xx] * invgain * invgain;
+			}
+	}
+	cal.left = left;
+	cal.top = top;
+	cal.roiwidth = width;
+	cal.roiheight = height;
+}
+
+void mexFunction(int nlhs, mxArray* plhs[], int	nrhs, const	mxArray* prhs[])
+{
+	if (nrhs < 2)
+		mexErrMsgTxt("Proper Usage: [Frames,Variance]=DCAM4CopyFramesCalibrated(cameraHandle,nFrames,timeout)");
+
+	// Grab the inputs from MATLAB.
+	unsigned long* mHandle;
+	HDCAM handle;
+	mHandle = (unsigned long*)mxGetUint64s(prhs[0]);
+	handle = (HDCAM)mHandle[0];
+
+	if (mxIsChar(prhs[1]))
+	{
+		char command[8];
+		mxGetString(prhs[1], command, sizeof(command));
+		if (strcmp(command, "set") == 0)
+			set_calibration(handle, nrhs, prhs);
+		else if (strcmp(command, "clear") == 0)
+		{
+			g_calibrations.erase(handle);
+			if (g_calibrations.empty() && mexIsLocked())
+				mexUnlock();
+		}
+		else
+			mexErrMsgTxt("Unknown command; use 'set' or 'clear'.");
+		return;
+	}
+
+	if (nrhs != 3)
+		mexErrMsgTxt("Proper Usage: [Frames,Variance]=DCAM4CopyFramesCalibrated(cameraHandle,nFrames,timeout)");
+	std::map<HDCAM, calibration>::iterator it = g_calibrations.find(handle);
+	if (it == g_calibrations.end())
+		mexErrMsgTxt("No calibration maps; call DCAM4CopyFramesCalibrated(cameraHandle,'set',offset,gain) first.");
+	calibration& cal = it->second;
+	int32 nFrames = (int32)mxGetScalar(prhs[1]);
+	int32 timeout = (int32)mxGetScalar(prhs[2]);
+
+	// The maps are cropped before the wait handle is opened, as maps that
+	// don't cover the frames raise an error.
+	int32 width, height;
+	DCAMERR error = get_image_size(handle, width, height);
+	if (failed(error))
+		close_wait_and_error(NULL, "DCAM4CopyFramesCalibrated:dcamError",
+			"Error = 0x%08X\ndcamprop_getvalue() of the image size failed.", error);
+	select_roi(handle, cal, width, height);
+
+	// Prepare some of the DCAM structures.
+	DCAMWAIT_OPEN waitopen;
+	DCAMWAIT_START waitstart;
+	DCAMBUF_FRAME pFrame;
+	memset(&waitopen, 0, sizeof(waitopen));
+	waitopen.size = sizeof(waitopen);
+	waitopen.hdcam = handle;
+	memset(&waitstart, 0, sizeof(waitstart));
+	waitstart.size = sizeof(waitstart);
+	waitstart.eventmask = DCAMWAIT_CAPEVENT_CYCLEEND;
+	waitstart.timeout = timeout;
+	memset(&pFrame, 0, sizeof(pFrame));
+	pFrame.size = sizeof(pFrame);
+
+	// Create the HDCAMWAIT handle.
+	error = dcamwait_open(&waitopen);
+	if (failed(error))
+		close_wait_and_error(NULL, "DCAM4CopyFramesCalibrated:dcamError",
+			"Error = 0x%08X\ndcamwait_open() failed.", error);
+	HDCAMWAIT hwait = waitopen.hwait;
+
+	// Wait for the capture to finish and then force stop it.
+	error = dcamwait_start(hwait, &waitstart);
+	if (failed(error))
+		close_wait_and_error(hwait, "DCAM4CopyFramesCalibrated:dcamError",
+			"Error = 0x%08X\ndcamwait_start() failed.", error);
+	dcamcap_stop(handle);
+
+	// Prepare the DCAMBUF_FRAME and initialize the output for MATLAB.
+	error = dcambuf_lockframe(handle, &pFrame);
+	if (failed(error))
+		close_wait_and_error(hwait, "DCAM4CopyFramesCalibrated:dcamError",
+			"Error = 0x%08X\ndcambuf_lockframe() failed.", error);
+	int32 pixeltype = get_pixeltype(handle);
+	if (pixeltype != DCAM_PIXELTYPE_MONO16 && pixeltype != DCAM_PIXELTYPE_MONO12
+		&& pixeltype != DCAM_PIXELTYPE_MONO12P)
+		close_wait_and_error(hwait, "DCAM4CopyFramesCalibrated:pixelType",
+			"Pixel type 0x%08X is not supported.", pixeltype);
+	if (pFrame.width != width || pFrame.height != height)
+		close_wait_and_error(hwait, "DCAM4CopyFramesCalibrated:frameSize",
+			"The captured frames are %i x %i rather than %i x %i.", pFrame.width, pFrame.height, width, height);
+	mwSize outsize[1];
+	outsize[0] = (long long)width * (long long)height * nFrames;
+	plhs[0] = mxCreateNumericArray(1, outsize, mxSINGLE_CLASS, mxREAL);
+	float* imagePointer = (float*)mxGetData(plhs[0]);
+
+	// Convert each row as it is read from the capture buffer.
+	std::vector<unsigned short> row(width);
+	for (int ff = 0; ff < nFrames; ff++)
+	{
+		pFrame.iFrame = ff;
+		error = dcambuf_lockframe(handle, &pFrame);
+		if (failed(error))
+			close_wait_and_error(hwait, "DCAM4CopyFramesCalibrated:dcamError",
+				"Error = 0x%08X\ndcambuf_lockframe() failed on frame %i.", error, ff+1);
+		const unsigned char* src = (const unsigned char*)pFrame.buf;
+		for (int32 yy = 0; yy < height; yy++, src += pFrame.rowbytes)
+		{
+			const unsigned short* pixels = (const unsigned short*)src;
+			if (pixeltype != DCAM_PIXELTYPE_MONO16)
+			{
+				if (pixeltype == DCAM_PIXELTYPE_MONO12)
+					unpack_mono12(src, &row[0], width);
+				else
+					unpack_mono12p(src, &row[0], width);
+				pixels = &row[0];
+			}
+			size_t offset = (size_t)yy * width;
+			calibrate_row(pixels, &cal.invgain[offset], &cal.bias[offset], imagePointer + offset, width);
+		}
+
+		// Update the pointer for our MATLAB output.
+		imagePointer += (long long)width*(long long)height;
+	}
+
+	if (nlhs > 1)
+	{
+		if (cal.variance_e.empty())
+			plhs[1] = mxCreateNumericMatrix(0, 0, mxSINGLE_CLASS, mxREAL);
+		else
+		{
+			plhs[1] = mxCreateNumericMatrix(width, height, mxSINGLE_CLASS, mxREAL);
+			memcpy(mxGetData(plhs[1]), &cal.variance_e[0], cal.variance_e.size() * sizeof(float));
+		}
+	}
+
+	// Release the capturing buffer allocated by DCAM4AllocMemory().
+	error = dcambuf_release(handle);
+	if (failed(error))
+	{
+		mexPrintf("Error = 0x%08X\ndcambuf_release() failed.\n", error);
+	}
+
+	// Close the wait handles.
+	error = dcamwait_close(hwait);
+	if (failed(error))
+	{
+		mexPrintf("Error = 0x%08X\ndcamwait_close() failed.\n", error);
+	}
+
+	return;
+}
@@ -47,7 +47,7 @@ void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
 	error = dcamwait_open(&waitopen);
 	if (failed(error))
 	{
-		mexPrintf("Error = 0x%08lX\ndcamwait_open() failed.\n", error);
+		mexPrintf("Error = 0x%08X\ndcamwait_open() failed.\n", error);
 		return;
 	}
 	// wait image
@@ -60,7 +60,7 @@ void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
 	error = dcamwait_start(hwait, &waitstart);
 	if (failed(error))
 	{
-		mexPrintf("Error = 0x%08lX\ndcamwait_start() failed.\n", error);
+		mexPrintf("Error = 0x%08X\ndcamwait_start() failed.\n", error);
 		return;
 	}
 
@@ -76,7 +76,7 @@ void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
 	error = dcamcap_transferinfo(handle, &transferInfo);
 	if (failed(error))
 	{
-		mexPrintf("Error = 0x%08lX\ndcamcap_transferinfo() failed.\n", error);
+		mexPrintf("Error = 0x%08X\ndcamcap_transferinfo() failed.\n", error);
 		return;
 	}
 
@@ -102,7 +102,7 @@ void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
 	error = dcambuf_copyframe(handle, &pFrame);
 	if (failed(error))
 	{
-		mexPrintf("Error = 0x%08lX\ndcambuf_copyframe() failed.\n", error);
+		mexPrintf("Error = 0x%08X\ndcambuf_copyframe() failed.\n", error);
 		return;
 	}
 		
@@ -110,7 +110,7 @@ void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
 	dcamwait_close(hwait);
 	if (failed(error))
 	{
-		mexPrintf("Error = 0x%08lX\ndcamwait_close() failed.\n", error);
+		mexPrintf("Error = 0x%08X\ndcamwait_close() failed.\n", error);
 	}
 	return;
 }
\ No newline at end of file
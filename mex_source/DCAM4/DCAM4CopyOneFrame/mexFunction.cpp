@@ -1,8 +1,17 @@
 
+#include <vector>
 #include "stdafx.h"
+#include "unpack.h"
+#include "reduce.h"
+#include "helper.h"
 
-// [Frames] = DCAM4CopyOneFrame(cameraHandle, timeout)
-// Copy the most recently transfered frame of data.
+// [Frames] = DCAM4CopyOneFrame(cameraHandle, iFrame, timeout, rois, binning)
+// Copy the most recently transfered frame of data.  Packed 12-bit frames
+// are unpacked to 16-bit pixels.
+// The optional 'rois' (N x 4 [Xstart Xend Ystart Yend]) and 'binning' crop
+// and bin the frame during the copy.  Each roi is then returned as a
+// width/binning x height/binning array (uint32 sums when binning > 1), in a
+// cell array if there are several rois.  Failures raise an error.
 void mexFunction(int nlhs, mxArray* plhs[], int	nrhs, const	mxArray* prhs[])
 {
 	// Grab the inputs from MATLAB.
@@ -18,18 +27,26 @@ void mexFunction(int nlhs, mxArray* plhs[], int	nrhs, const	mxArray* prhs[])
 	timeout = (int32)mxGetScalar(prhs[2]);
 	
 
+	// The rois are checked before the wait handle is opened, as a bad roi
+	// raises an error.
+	int32 width, height;
+	DCAMERR error = get_image_size(handle, width, height);
+	if (failed(error))
+		close_wait_and_error(NULL, "DCAM4CopyOneFrame:dcamError",
+			"Error = 0x%08X\ndcamprop_getvalue() of the image size failed.", error);
+	reduce_args args;
+	bool reduced = get_reduce_args(nrhs > 3 ? prhs[3] : NULL, nrhs > 4 ? prhs[4] : NULL,
+		width, height, args);
+
 	// open wait handle.
-	DCAMERR error;
 	DCAMWAIT_OPEN waitopen;
 	memset(&waitopen, 0, sizeof(waitopen));
 	waitopen.size = sizeof(waitopen);
 	waitopen.hdcam = handle;
 	error = dcamwait_open(&waitopen);
 	if (failed(error))
-	{
-		mexPrintf("Error = 0x%08lX\ndcamwait_open() failed.\n", error);
-		return;
-	}
+		close_wait_and_error(NULL, "DCAM4CopyOneFrame:dcamError",
+			"Error = 0x%08X\ndcamwait_open() failed.", error);
 
 	// wait image
 	HDCAMWAIT hwait = waitopen.hwait;
@@ -40,10 +57,8 @@ void mexFunction(int nlhs, mxArray* plhs[], int	nrhs, const	mxArray* prhs[])
 	waitstart.timeout = timeout;
 	error = dcamwait_start(hwait, &waitstart);
 	if (failed(error))
-	{
-		mexPrintf("Error = 0x%08lX\ndcamwait_start() failed.\n", error);
-		return;
-	}
+		close_wait_and_error(hwait, "DCAM4CopyOneFrame:dcamError",
+			"Error = 0x%08X\ndcamwait_start() failed.", error);
 
 	// Determine the frame index of the most recently transfered image.
 	DCAMCAP_TRANSFERINFO transferInfo;
@@ -51,10 +66,8 @@ void mexFunction(int nlhs, mxArray* plhs[], int	nrhs, const	mxArray* prhs[])
 	transferInfo.size = sizeof(transferInfo);
 	error = dcamcap_transferinfo(handle, &transferInfo);
 	if (failed(error))
-	{
-		mexPrintf("Error = 0x%08lX\ndcamcap_transferinfo() failed.\n", error);
-		return;
-	}
+		close_wait_and_error(hwait, "DCAM4CopyOneFrame:dcamError",
+			"Error = 0x%08X\ndcamcap_transferinfo() failed.", error);
 
 	// Prepare the DCAMBUF_FRAME and initialize the output for MATLAB.
 	if (iFrame > transferInfo.nNewestFrameIndex) 
@@ -63,6 +76,7 @@ void mexFunction(int nlhs, mxArray* plhs[], int	nrhs, const	mxArray* prhs[])
 		outsize[0] = 1;
 		plhs[0] = mxCreateNumericArray(1, outsize, mxINT32_CLASS, mxREAL);
 		*mxGetInt32s(plhs[0]) = 0;
+		dcamwait_close(hwait);
 		return;
 	}
 	DCAMBUF_FRAME pFrame;
@@ -71,29 +85,40 @@ void mexFunction(int nlhs, mxArray* plhs[], int	nrhs, const	mxArray* prhs[])
 	pFrame.iFrame = iFrame;
 	error = dcambuf_lockframe(handle, &pFrame);
 	if (failed(error))
+		close_wait_and_error(hwait, "DCAM4CopyOneFrame:dcamError",
+			"Error = 0x%08X\ndcambuf_lockframe() failed.", error);
+
+	int32 pixeltype = get_pixeltype(handle);
+	if (pixeltype != DCAM_PIXELTYPE_MONO16 && pixeltype != DCAM_PIXELTYPE_MONO12
+		&& pixeltype != DCAM_PIXELTYPE_MONO12P)
+		close_wait_and_error(hwait, "DCAM4CopyOneFrame:pixelType",
+			"Pixel type 0x%08X is not supported.", pixeltype);
+	if (reduced)
 	{
-		mexPrintf("Error = 0x%08lX\ndcambuf_lockframe() failed.\n", error);
-		return;
+		// Crop and bin the frame while copying it.
+		std::vector<unsigned short> scratch;
+		plhs[0] = create_reduce_output(args, 1);
+		error = reduceframe(handle, pFrame.iFrame, pixeltype, args, 0, scratch);
 	}
-
-	mwSize outsize[1];
-	outsize[0] = (long long)pFrame.width * (long long)pFrame.height;
-	plhs[0] = mxCreateNumericArray(1, outsize, mxUINT16_CLASS, mxREAL);
-
-	// Copy the image data to our output array.
-	pFrame.buf = (unsigned short*)mxGetData(plhs[0]);
-	error = dcambuf_copyframe(handle, &pFrame);
-	if (failed(error))
+	else
 	{
-		mexPrintf("Error = 0x%08lX\ndcambuf_copyframe() failed.\n", error);
-		return;
+		mwSize outsize[1];
+		outsize[0] = (long long)pFrame.width * (long long)pFrame.height;
+		plhs[0] = mxCreateNumericArray(1, outsize, mxUINT16_CLASS, mxREAL);
+
+		// Copy the image data to our output array.
+		pFrame.buf = (unsigned short*)mxGetData(plhs[0]);
+		error = copyframe_uint16(handle, pFrame, pixeltype);
 	}
+	if (failed(error))
+		close_wait_and_error(hwait, "DCAM4CopyOneFrame:dcamError",
+			"Error = 0x%08X\ndcambuf_copyframe() failed.", error);
 
 	// close wait handle
-	dcamwait_close(hwait);
+	error = dcamwait_close(hwait);
 	if (failed(error))
 	{
-		mexPrintf("Error = 0x%08lX\ndcamwait_close() failed.\n", error);
+		mexPrintf("Error = 0x%08X\ndcamwait_close() failed.\n", error);
 	}
 
 	return;
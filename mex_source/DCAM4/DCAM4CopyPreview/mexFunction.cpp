@@ -0,0 +1,243 @@
+#include <vector>
+#include "stdafx.h"
+#include "unpack.h"
+
+#define HISTOGRAM_BINS	65536
+
+// [Display, Stats] = DCAM4CopyPreview(cameraHandle, timeout, binning, percentiles, topK, lut)
+// Copy the most recently transfered frame as a live-view image.  The frame
+// is averaged over 'binning' x 'binning' bins (default 1) and returned as a
+// uint8 image with the display range [lut(1) lut(2)] mapped to 0-255.  If
+// 'lut' is empty the range is set by the first and last of 'percentiles'
+// (default [0 100], i.e. min and max).  'Stats' holds the Min, Max,
+// Percentiles and the sum of the 'topK' (default 5) brightest pixels
+// (TopKSum) of the full-resolution frame, all taken from one histogram
+// filled in the same pass as the binning.
+// The newest frame is copied after the next frame ready event, or at once
+// if 'timeout' is 0 (e.g. after DCAM4EventCounter 'wait' has seen the
+// frame).  'Display' and 'Stats' are empty if no frame could be copied.
+void mexFunction(int nlhs, mxArray* plhs[], int	nrhs, const	mxArray* prhs[])
+{
+	if (nrhs < 2 || nrhs > 6)
+		mexErrMsgTxt("Proper Usage: [Display,Stats]=DCAM4CopyPreview(cameraHandle,timeout,binning,percentiles,topK,lut)");
+
+	// Grab the inputs from MATLAB.
+	unsigned long* mHandle;
+	HDCAM handle;
+	mHandle = (unsigned long*)mxGetUint64s(prhs[0]);
+	handle = (HDCAM)mHandle[0];
+	int32 timeout = (int32)mxGetScalar(prhs[1]);
+	int32 binning = 1;
+	if (nrhs > 2 && !mxIsEmpty(prhs[2]))
+		binning = (int32)mxGetScalar(prhs[2]);
+	if (binning < 1)
+		mexErrMsgTxt("binning must be a positive integer.");
+	std::vector<double> percentiles;
+	if (nrhs > 3 && !mxIsEmpty(prhs[3]))
+	{
+		if (!mxIsDouble(prhs[3]))
+			mexErrMsgTxt("percentiles must be type DOUBLE.");
+		const double* p = mxGetPr(prhs[3]);
+		percentiles.assign(p, p + mxGetNumberOfElements(prhs[3]));
+	}
+	else
+	{
+		percentiles.push_back(0);
+		percentiles.push_back(100);
+	}
+	double topK = 5;
+	if (nrhs > 4 && !mxIsEmpty(prhs[4]))
+		topK = mxGetScalar(prhs[4]);
+	bool fixedLut = nrhs > 5 && !mxIsEmpty(prhs[5]);
+	if (fixedLut && mxGetNumberOfElements(prhs[5]) != 2)
+		mexErrMsgTxt("lut must be empty or [min max].");
+
+	// The outputs are replaced once a frame has been copied.
+	plhs[0] = mxCreateNumericMatrix(0, 0, mxUINT8_CLASS, mxREAL);
+	if (nlhs > 1)
+		plhs[1] = mxCreateDoubleMatrix(0, 0, mxREAL);
+
+	DCAMERR error;
+	if (timeout > 0)
+	{
+		// open wait handle.
+		DCAMWAIT_OPEN waitopen;
+		memset(&waitopen, 0, sizeof(waitopen));
+		waitopen.size = sizeof(waitopen);
+		waitopen.hdcam = handle;
+		error = dcamwait_open(&waitopen);
+		if (failed(error))
+		{
+			mexPrintf("Error = 0x%08X\ndcamwait_open() failed.\n", error);
+			return;
+		}
+
+		// wait image
+		HDCAMWAIT hwait = waitopen.hwait;
+		DCAMWAIT_START waitstart;
+		memset(&waitstart, 0, sizeof(waitstart));
+		waitstart.size = sizeof(waitstart);
+		waitstart.eventmask = DCAMWAIT_CAPEVENT_FRAMEREADY;
+		waitstart.timeout = timeout;
+		error = dcamwait_start(hwait, &waitstart);
+		dcamwait_close(hwait);
+		if (failed(error))
+		{
+			if (error != DCAMERR_TIMEOUT)
+				mexPrintf("Error = 0x%08X\ndcamwait_start() failed.\n", error);
+			return;
+		}
+	}
+
+	// Determine the frame index of the most recently transfered image.
+	DCAMCAP_TRANSFERINFO transferInfo;
+	memset(&transferInfo, 0, sizeof(transferInfo));
+	transferInfo.size = sizeof(transferInfo);
+	error = dcamcap_transferinfo(handle, &transferInfo);
+	if (failed(error))
+	{
+		mexPrintf("Error = 0x%08X\ndcamcap_transferinfo() failed.\n", error);
+		return;
+	}
+
+	// Lock the frame; the preview is computed straight from the capture buffer.
+	DCAMBUF_FRAME pFrame;
+	memset(&pFrame, 0, sizeof(pFrame));
+	pFrame.size = sizeof(pFrame);
+	pFrame.iFrame = transferInfo.nNewestFrameIndex;
+	error = dcambuf_lockframe(handle, &pFrame);
+	if (failed(error))
+	{
+		mexPrintf("Error = 0x%08X\ndcambuf_lockframe() failed.\n", error);
+		return;
+	}
+	int32 pixeltype = get_pixeltype(handle);
+	if (pixeltype != DCAM_PIXELTYPE_MONO16 && pixeltype != DCAM_PIXELTYPE_MONO12
+		&& pixeltype != DCAM_PIXELTYPE_MONO12P)
+	{
+		mexPrintf("Pixel type 0x%08X is not supported.\n", pixeltype);
+		return;
+	}
+
+	// One pass over the frame fills the histogram and the bin sums.  Pixels
+	// beyond the last whole bin are counted in the histogram only.
+	int32 width = pFrame.width;
+	int32 height = pFrame.height;
+	int32 outWidth = width / binning;
+	int32 outHeight = height / binning;
+	if (outWidth < 1 || outHeight < 1)
+		mexErrMsgTxt("binning is larger than the frame.");
+	std::vector<unsigned int> histogram(HISTOGRAM_BINS, 0);
+	std::vector<unsigned int> sums((size_t)outWidth * outHeight, 0);
+	std::vector<unsigned short> unpacked(width);
+	for (int32 yy = 0; yy < height; yy++)
+	{
+		const unsigned short* row;
+		const unsigned char* src = (const unsigned char*)pFrame.buf + (size_t)yy * pFrame.rowbytes;
+		if (pixeltype == DCAM_PIXELTYPE_MONO16)
+			row = (const unsigned short*)src;
+		else
+		{
+			if (pixeltype == DCAM_PIXELTYPE_MONO12)
+				unpack_mono12(src, &unpacked[0], width);
+			else
+				unpack_mono12p(src, &unpacked[0], width);
+			row = &unpacked[0];
+		}
+		for (int32 xx = 0; xx < width; xx++)
+			histogram[row[xx]]++;
+		if (yy / binning >= outHeight)
+			continue;
+		unsigned int* sum = &sums[(size_t)(yy / binning) * outWidth];
+		if (binning == 1)
+		{
+			for (int32 xx = 0; xx < outWidth; xx++)
+				sum[xx] = row[xx];
+			continue;
+		}
+		for (int32 xx = 0; xx < outWidth; xx++)
+		{
+			unsigned int s = 0;
+			for (int32 kk = 0; kk < binning; kk++)
+				s += row[xx * binning + kk];
+			sum[xx] += s;
+		}
+	}
+
+	// Statistics from the histogram.
+	double nPixels = (double)width * height;
+	int32 minValue = 0, maxValue = HISTOGRAM_BINS - 1;
+	while (minValue < HISTOGRAM_BINS - 1 && histogram[minValue] == 0)
+		minValue++;
+	while (maxValue > 0 && histogram[maxValue] == 0)
+		maxValue--;
+	std::vector<double> values(percentiles.size());
+	for (size_t ii = 0; ii < percentiles.size(); ii++)
+	{
+		// nearest rank: the smallest value with at least p% of the pixels at or below it
+		double rank = ceil(percentiles[ii] / 100 * nPixels);
+		if (rank < 1)
+			rank = 1;
+		double count = 0;
+		int32 vv = minValue;
+		for (; vv < maxValue; vv++)
+		{
+			count += histogram[vv];
+			if (count >= rank)
+				break;
+		}
+		values[ii] = vv;
+	}
+	double topKSum = 0, remaining = topK < nPixels ? topK : nPixels;
+	for (int32 vv = maxValue; vv >= 0 && remaining > 0; vv--)
+	{
+		double n = histogram[vv] < remaining ? histogram[vv] : remaining;
+		topKSum += n * vv;
+		remaining -= n;
+	}
+
+	// Display range and the 8-bit image of the bin means.
+	double lo, hi;
+	if (fixedLut)
+	{
+		lo = mxGetPr(prhs[5])[0];
+		hi = mxGetPr(prhs[5])[1];
+	}
+	else
+	{
+		lo = values.front();
+		hi = values.back();
+	}
+	if (hi <= lo)
+		hi = lo + 1;
+	double scale = 255.0 / (hi - lo) / ((double)binning * binning);
+	double offset = lo * binning * binning;
+	mwSize outsize[2];
+	outsize[0] = outWidth;
+	outsize[1] = outHeight;
+	mxDestroyArray(plhs[0]);
+	plhs[0] = mxCreateNumericArray(2, outsize, mxUINT8_CLASS, mxREAL);
+	unsigned char* display = (unsigned char*)mxGetData(plhs[0]);
+	for (size_t ii = 0; ii < sums.size(); ii++)
+	{
+		double v = (sums[ii] - offset) * scale;
+		display[ii] = (unsigned char)(v <= 0 ? 0 : v >= 255 ? 255 : v + 0.5);
+	}
+
+	if (nlhs > 1)
+	{
+		const char* fields[] = { "Min", "Max", "Percentiles", "TopKSum", "Binning" };
+		mxDestroyArray(plhs[1]);
+		plhs[1] = mxCreateStructMatrix(1, 1, 5, fields);
+		mxSetFieldByNumber(plhs[1], 0, 0, mxCreateDoubleScalar(minValue));
+		mxSetFieldByNumber(plhs[1], 0, 1, mxCreateDoubleScalar(maxValue));
+		mxArray* p = mxCreateDoubleMatrix(1, values.size(), mxREAL);
+		for (size_t ii = 0; ii < values.size(); ii++)
+			mxGetPr(p)[ii] = values[ii];
+		mxSetFieldByNumber(plhs[1], 0, 2, p);
+		mxSetFieldByNumber(plhs[1], 0, 3, mxCreateDoubleScalar(topKSum));
+		mxSetFieldByNumber(plhs[1], 0, 4, mxCreateDoubleScalar(binning));
+	}
+
+	return;
+}
@@ -0,0 +1,258 @@
+#include <map>
+#include <memory>
+#include <chrono>
+#include <thread>		// before stdafx.h, which defines min and max
+#include <mutex>
+#include <condition_variable>
+#include "stdafx.h"
+#include "threadctl.h"
+
+// DCAM4EventCounter(cameraHandle, 'start', timeout, threadOptions)
+// [Events] = DCAM4EventCounter(cameraHandle, 'status')
+// [Events] = DCAM4EventCounter(cameraHandle, 'wait', nFrames, timeout)
+// DCAM4EventCounter(cameraHandle, 'stop'), DCAM4EventCounter(cameraHandle, 'clear')
+// Count the capture events of a camera on a background thread, so that
+// acquisition loops don't have to poll DCAM4Status.  'start' is called
+// right after DCAM4StartCapture(); the thread then waits for frame ready,
+// cycle end and stopped events until the capture is no longer busy.  The
+// thread re-checks the capture status after 'timeout' ms (default 100)
+// without events.  'threadOptions' (see threadctl.h) sets the affinity and
+// priority of the thread.
+// 'Events' is a snapshot of the counters since 'start':
+//	Frames		frames transfered in this capture
+//	FrameReady	frame ready events
+//	CycleEnd	cycle end events (the end of a snap capture)
+//	Stopped		stopped events
+//	Overrun		waits that reported lost frames
+//	Busy		true while the capture is running
+// 'status' returns immediately.  'wait' sleeps until at least 'nFrames'
+// frames were transfered, the capture stopped or 'timeout' ms (default
+// infinite) passed, and then returns the snapshot.  The counters stay in
+// memory (mexLock) until they are cleared for all cameras.
+
+struct event_counter
+{
+	HDCAM handle;
+	HDCAMWAIT hwait;
+	int32 timeout;
+	thread_policy policy;
+
+	std::mutex lock;
+	std::condition_variable changed;
+	double frames, frameReady, cycleEnd, stopped, overrun;
+	bool busy, stop;
+
+	std::thread waiter;
+};
+
+static std::map<HDCAM, std::unique_ptr<event_counter> > g_counters;
+
+static bool capture_busy(HDCAM handle)
+{
+	int32 status = DCAMCAP_STATUS_ERROR;
+	if (failed(dcamcap_status(handle, &status)))
+		return false;
+	return status == DCAMCAP_STATUS_BUSY;
+}
+
+// Counts the events of one capture.
+static void count_events(event_counter* ec)
+{
+	DCAMWAIT_START waitstart;
+	memset(&waitstart, 0, sizeof(waitstart));
+	waitstart.size = sizeof(waitstart);
+	waitstart.eventmask = DCAMWAIT_CAPEVENT_FRAMEREADY | DCAMWAIT_CAPEVENT_CYCLEEND
+		| DCAMWAIT_CAPEVENT_STOPPED;
+	waitstart.timeout = ec->timeout;
+	DCAMCAP_TRANSFERINFO transferInfo;
+	memset(&transferInfo, 0, sizeof(transferInfo));
+	transferInfo.size = sizeof(transferInfo);
+
+	apply_thread_policy(ec->policy);
+	for (;;)
+	{
+		waitstart.eventhappened = 0;
+		DCAMERR err = dcamwait_start(ec->hwait, &waitstart);
+		int32 events = failed(err) ? 0 : waitstart.eventhappened;
+		bool lost = err == DCAMERR_LOSTFRAME || err == DCAMERR_MISSINGFRAME_TROUBLE;
+		bool newFrames = !failed(dcamcap_transferinfo(ec->handle, &transferInfo));
+
+		// The capture status only changes at the end of a cycle, when the
+		// capture is stopped or when the wait fails.
+		bool busy = true;
+		if (failed(err) || (events & (DCAMWAIT_CAPEVENT_CYCLEEND | DCAMWAIT_CAPEVENT_STOPPED)))
+			busy = capture_busy(ec->handle);
+
+		// Don't spin if the wait keeps failing while the camera is busy.
+		if (busy && failed(err) && err != DCAMERR_TIMEOUT && !lost)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+		std::lock_guard<std::mutex> lk(ec->lock);
+		if (newFrames && transferInfo.nFrameCount > ec->frames)
+			ec->frames = transferInfo.nFrameCount;
+		if (events & DCAMWAIT_CAPEVENT_FRAMEREADY)
+			ec->frameReady++;
+		if (events & DCAMWAIT_CAPEVENT_CYCLEEND)
+			ec->cycleEnd++;
+		if (events & DCAMWAIT_CAPEVENT_STOPPED)
+			ec->stopped++;
+		if (lost)
+			ec->overrun++;
+		ec->busy = busy && !ec->stop;
+		ec->changed.notify_all();
+		if (!ec->busy)
+			return;
+	}
+}
+
+static void stop_counter(event_counter* ec)
+{
+	{
+		std::lock_guard<std::mutex> lk(ec->lock);
+		ec->stop = true;
+	}
+	if (ec->hwait != NULL)
+		dcamwait_abort(ec->hwait);
+	if (ec->waiter.joinable())
+		ec->waiter.join();
+	if (ec->hwait != NULL)
+		dcamwait_close(ec->hwait);
+	ec->hwait = NULL;
+	std::lock_guard<std::mutex> lk(ec->lock);
+	ec->busy = false;
+	ec->changed.notify_all();
+}
+
+static void clear_counter(HDCAM handle)
+{
+	std::map<HDCAM, std::unique_ptr<event_counter> >::iterator it = g_counters.find(handle);
+	if (it == g_counters.end())
+		return;
+	stop_counter(it->second.get());
+	g_counters.erase(it);
+}
+
+static void Cleanup(void)
+{
+	while (!g_counters.empty())
+		clear_counter(g_counters.begin()->first);
+}
+
+static void start_counter(HDCAM handle, int nrhs, const mxArray* prhs[])
+{
+	int32 timeout = nrhs > 2 && !mxIsEmpty(prhs[2]) ? (int32)mxGetScalar(prhs[2]) : 100;
+	thread_policy policy;
+	get_thread_policy(nrhs > 3 ? prhs[3] : NULL, policy);
+
+	clear_counter(handle);
+	std::unique_ptr<event_counter> ec(new event_counter);
+	ec->handle = handle;
+	ec->hwait = NULL;
+	ec->timeout = timeout;
+	ec->policy = policy;
+	ec->frames = ec->frameReady = ec->cycleEnd = ec->stopped = ec->overrun = 0;
+	ec->stop = false;
+	// A short capture may be over before the waiter runs.
+	ec->busy = capture_busy(handle);
+	DCAMCAP_TRANSFERINFO transferInfo;
+	memset(&transferInfo, 0, sizeof(transferInfo));
+	transferInfo.size = sizeof(transferInfo);
+	if (!failed(dcamcap_transferinfo(handle, &transferInfo)))
+		ec->frames = transferInfo.nFrameCount;
+
+	if (g_counters.empty())
+	{
+		mexLock();
+		mexAtExit(Cleanup);
+	}
+	event_counter* p = ec.get();
+	g_counters[handle] = std::move(ec);
+	if (!p->busy)
+		return;
+
+	DCAMWAIT_OPEN waitopen;
+	memset(&waitopen, 0, sizeof(waitopen));
+	waitopen.size = sizeof(waitopen);
+	waitopen.hdcam = handle;
+	DCAMERR error = dcamwait_open(&waitopen);
+	if (failed(error))
+	{
+		mexPrintf("Error = 0x%08X\ndcamwait_open() failed.\n", error);
+		p->busy = false;
+		return;
+	}
+	p->hwait = waitopen.hwait;
+	p->waiter = std::thread(count_events, p);
+}
+
+// Returns the counters; call with ec->lock held.
+static mxArray* create_events_output(const event_counter* ec)
+{
+	const char* fields[] = { "Frames", "FrameReady", "CycleEnd", "Stopped", "Overrun", "Busy" };
+	mxArray* out = mxCreateStructMatrix(1, 1, 6, fields);
+	mxSetFieldByNumber(out, 0, 0, mxCreateDoubleScalar(ec->frames));
+	mxSetFieldByNumber(out, 0, 1, mxCreateDoubleScalar(ec->frameReady));
+	mxSetFieldByNumber(out, 0, 2, mxCreateDoubleScalar(ec->cycleEnd));
+	mxSetFieldByNumber(out, 0, 3, mxCreateDoubleScalar(ec->stopped));
+	mxSetFieldByNumber(out, 0, 4, mxCreateDoubleScalar(ec->overrun));
+	mxSetFieldByNumber(out, 0, 5, mxCreateLogicalScalar(ec->busy));
+	return out;
+}
+
+void mexFunction(int nlhs, mxArray* plhs[], int	nrhs, const	mxArray* prhs[])
+{
+	if (nrhs < 2 || !mxIsChar(prhs[1]))
+		mexErrMsgTxt("Proper Usage: DCAM4EventCounter(cameraHandle,command,...); command is 'start', 'status', 'wait', 'stop' or 'clear'.");
+
+	// Grab the inputs from MATLAB.
+	unsigned long* mHandle;
+	HDCAM handle;
+	mHandle = (unsigned long*)mxGetUint64s(prhs[0]);
+	handle = (HDCAM)mHandle[0];
+	char command[8];
+	mxGetString(prhs[1], command, sizeof(command));
+
+	if (strcmp(command, "start") == 0)
+	{
+		start_counter(handle, nrhs, prhs);
+		return;
+	}
+	if (strcmp(command, "clear") == 0)
+	{
+		clear_counter(handle);
+		if (g_counters.empty() && mexIsLocked())
+			mexUnlock();
+		return;
+	}
+
+	std::map<HDCAM, std::unique_ptr<event_counter> >::iterator it = g_counters.find(handle);
+	if (it == g_counters.end())
+		mexErrMsgTxt("No event counter for this camera; call DCAM4EventCounter(cameraHandle,'start') first.");
+	event_counter* ec = it->second.get();
+
+	if (strcmp(command, "status") == 0)
+	{
+		std::lock_guard<std::mutex> lk(ec->lock);
+		plhs[0] = create_events_output(ec);
+	}
+	else if (strcmp(command, "wait") == 0)
+	{
+		if (nrhs < 3)
+			mexErrMsgTxt("Proper Usage: [Events]=DCAM4EventCounter(cameraHandle,'wait',nFrames,timeout)");
+		double nFrames = mxGetScalar(prhs[2]);
+		double timeout = nrhs > 3 && !mxIsEmpty(prhs[3]) ? mxGetScalar(prhs[3]) : -1;
+		std::unique_lock<std::mutex> lk(ec->lock);
+		auto ready = [ec, nFrames] { return ec->frames >= nFrames || !ec->busy; };
+		if (timeout < 0)
+			ec->changed.wait(lk, ready);
+		else
+			ec->changed.wait_for(lk, std::chrono::milliseconds((long long)timeout), ready);
+		plhs[0] = create_events_output(ec);
+	}
+	else if (strcmp(command, "stop") == 0)
+		stop_counter(ec);
+	else
+		mexErrMsgTxt("Unknown command; use 'start', 'status', 'wait', 'stop' or 'clear'.");
+
+	return;
+}
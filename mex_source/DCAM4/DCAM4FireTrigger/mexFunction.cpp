@@ -19,7 +19,7 @@ void mexFunction(int nlhs, mxArray* plhs[], int	nrhs, const	mxArray* prhs[])
 	error = dcamcap_firetrigger(handle);
 	if (failed(error))
 	{
-		mexPrintf("Error = 0x%08lX\ndcamcap_firetrigger failed.\n", error);
+		mexPrintf("Error = 0x%08X\ndcamcap_firetrigger failed.\n", error);
 	}
 	
 	/*
@@ -38,13 +38,13 @@ void mexFunction(int nlhs, mxArray* plhs[], int	nrhs, const	mxArray* prhs[])
 	error = dcamwait_open(&waitopen);
 	if (failed(error))
 	{
-		mexPrintf("Error = 0x%08lX\ndcamwait_open() failed.\n", error);
+		mexPrintf("Error = 0x%08X\ndcamwait_open() failed.\n", error);
 		return;
 	}
 	error = dcamwait_start((HDCAMWAIT)waitopen.hwait, &waitstart);
 	if (failed(error))
 	{
-		mexPrintf("Error = 0x%08lX\ndcamwait_start() failed.\n", error);
+		mexPrintf("Error = 0x%08X\ndcamwait_start() failed.\n", error);
 		return;
 	}
 
@@ -52,7 +52,7 @@ void mexFunction(int nlhs, mxArray* plhs[], int	nrhs, const	mxArray* prhs[])
 	error = dcamwait_close((HDCAMWAIT)waitopen.hwait);
 	if (failed(error))
 	{
-		mexPrintf("Error = 0x%08lX\ndcamwait_close() failed.\n", error);
+		mexPrintf("Error = 0x%08X\ndcamwait_close() failed.\n", error);
 	}
 	*/
 	return;
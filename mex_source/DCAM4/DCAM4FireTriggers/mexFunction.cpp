@@ -0,0 +1,152 @@
+#include <chrono>
+#include <thread>
+#include "stdafx.h"
+#include "unpack.h"
+#include "helper.h"
+
+// [Frames, Period] = DCAM4FireTriggers(cameraHandle, nTriggers, timeout, copyFrames)
+// Fire 'nTriggers' software triggers and wait for the frame of each one.
+// The capture must already be running with a software trigger source.
+// Consecutive triggers are fired no faster than the minimum trigger interval
+// of the camera (DCAM_IDPROP_TIMING_MINTRIGGERINTERVAL); the wait between
+// them is timed in this function rather than with MATLAB pause().
+// The input 'timeout' is given in milliseconds and applies to each frame.
+// If 'copyFrames' is true, each frame is copied as soon as it is ready and
+// 'Frames' is a width*height*nTriggers uint16 vector as in DCAM4CopyFrames,
+// otherwise 'Frames' is empty and the frames stay in the capture buffer.
+// 'Period' is the mean time (seconds) between the triggers that were fired.
+// A failed trigger, wait or copy raises an error rather than returning the
+// frames of the triggers that did not complete.
+void mexFunction(int nlhs, mxArray* plhs[], int	nrhs, const	mxArray* prhs[])
+{
+	if (nrhs < 3)
+		mexErrMsgTxt("Proper Usage: [Frames,Period]=DCAM4FireTriggers(cameraHandle,nTriggers,timeout,copyFrames)");
+
+	// Grab the inputs from MATLAB.
+	unsigned long* mHandle;
+	HDCAM handle;
+	mHandle = (unsigned long*)mxGetUint64s(prhs[0]);
+	handle = (HDCAM)mHandle[0];
+	int32 nTriggers = (int32)mxGetScalar(prhs[1]);
+	int32 timeout = (int32)mxGetScalar(prhs[2]);
+	bool copyFrames = nrhs > 3 && mxGetScalar(prhs[3]) != 0;
+	plhs[0] = mxCreateNumericMatrix(0, 0, mxUINT16_CLASS, mxREAL);
+	if (nlhs > 1)
+		plhs[1] = mxCreateDoubleScalar(0);
+	if (nTriggers < 1)
+		return;
+
+	// Minimum time between two triggers.
+	DCAMERR error;
+	double minInterval = 0;
+	error = dcamprop_getvalue(handle, DCAM_IDPROP_TIMING_MINTRIGGERINTERVAL, &minInterval);
+	if (failed(error))
+		minInterval = 0;
+
+	int32 pixeltype = 0;
+	int32 width = 0, height = 0;
+	unsigned short* imagePointer = NULL;
+	size_t framePixels = 0;
+	if (copyFrames)
+	{
+		// No frame has been captured before the first trigger, so the frame
+		// size comes from the image properties.
+		error = get_image_size(handle, width, height);
+		if (failed(error))
+			mexErrMsgIdAndTxt("DCAM4FireTriggers:dcamError",
+				"Error = 0x%08X\ndcamprop_getvalue() of the image size failed.", error);
+		pixeltype = get_pixeltype(handle);
+		if (pixeltype != DCAM_PIXELTYPE_MONO16 && pixeltype != DCAM_PIXELTYPE_MONO12
+			&& pixeltype != DCAM_PIXELTYPE_MONO12P)
+			mexErrMsgIdAndTxt("DCAM4FireTriggers:pixelType",
+				"Pixel type 0x%08X is not supported.", pixeltype);
+		framePixels = (size_t)width * height;
+		mxDestroyArray(plhs[0]);
+		mwSize outsize[1];
+		outsize[0] = framePixels * nTriggers;
+		plhs[0] = mxCreateNumericArray(1, outsize, mxUINT16_CLASS, mxREAL);
+		imagePointer = (unsigned short*)mxGetData(plhs[0]);
+	}
+
+	// open wait handle, kept for all of the triggers.
+	DCAMWAIT_OPEN waitopen;
+	memset(&waitopen, 0, sizeof(waitopen));
+	waitopen.size = sizeof(waitopen);
+	waitopen.hdcam = handle;
+	error = dcamwait_open(&waitopen);
+	if (failed(error))
+		mexErrMsgIdAndTxt("DCAM4FireTriggers:dcamError", "Error = 0x%08X\ndcamwait_open() failed.", error);
+	HDCAMWAIT hwait = waitopen.hwait;
+	DCAMWAIT_START waitstart;
+	memset(&waitstart, 0, sizeof(waitstart));
+	waitstart.size = sizeof(waitstart);
+	waitstart.eventmask = DCAMWAIT_CAPEVENT_FRAMEREADY;
+	waitstart.timeout = timeout;
+
+	typedef std::chrono::steady_clock steady;
+	const steady::duration interval = std::chrono::duration_cast<steady::duration>(
+		std::chrono::duration<double>(minInterval));
+	steady::time_point firstFire, lastFire;
+	int32 nFired = 0;
+	for (int32 ii = 0; ii < nTriggers; ii++)
+	{
+		// Hold the next trigger until the minimum interval has passed.  The
+		// remaining time is usually below the resolution of sleep_for(), so
+		// only yield while waiting.
+		if (ii > 0)
+		{
+			while (steady::now() - lastFire < interval)
+				std::this_thread::yield();
+		}
+
+		lastFire = steady::now();
+		error = dcamcap_firetrigger(handle);
+		if (failed(error))
+			close_wait_and_error(hwait, "DCAM4FireTriggers:dcamError",
+				"Error = 0x%08X\ndcamcap_firetrigger() failed on trigger %i.", error, ii+1);
+		if (ii == 0)
+			firstFire = lastFire;
+		nFired++;
+
+		// wait image
+		error = dcamwait_start(hwait, &waitstart);
+		if (failed(error))
+			close_wait_and_error(hwait, "DCAM4FireTriggers:dcamError",
+				"Error = 0x%08X\ndcamwait_start() failed on trigger %i.", error, ii+1);
+		if (!copyFrames)
+			continue;
+
+		// Copy the frame that has just been transfered.
+		DCAMCAP_TRANSFERINFO transferInfo;
+		memset(&transferInfo, 0, sizeof(transferInfo));
+		transferInfo.size = sizeof(transferInfo);
+		error = dcamcap_transferinfo(handle, &transferInfo);
+		if (failed(error))
+			close_wait_and_error(hwait, "DCAM4FireTriggers:dcamError",
+				"Error = 0x%08X\ndcamcap_transferinfo() failed on trigger %i.", error, ii+1);
+		DCAMBUF_FRAME pFrame;
+		memset(&pFrame, 0, sizeof(pFrame));
+		pFrame.size = sizeof(pFrame);
+		pFrame.iFrame = transferInfo.nNewestFrameIndex;
+		error = dcambuf_lockframe(handle, &pFrame);
+		if (!failed(error) && (pFrame.width != width || pFrame.height != height))
+			error = DCAMERR_INVALIDPARAM;
+		if (!failed(error))
+		{
+			pFrame.buf = imagePointer + (size_t)ii * framePixels;
+			error = copyframe_uint16(handle, pFrame, pixeltype);
+		}
+		if (failed(error))
+			close_wait_and_error(hwait, "DCAM4FireTriggers:dcamError",
+				"Error = 0x%08X\ndcambuf_copyframe() failed on frame %i.", error, ii+1);
+	}
+	dcamwait_close(hwait);
+
+	if (nlhs > 1 && nFired > 1)
+	{
+		std::chrono::duration<double> elapsed = lastFire - firstFire;
+		mxGetPr(plhs[1])[0] = elapsed.count() / (nFired - 1);
+	}
+
+	return;
+}
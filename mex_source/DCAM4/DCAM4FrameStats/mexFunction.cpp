@@ -0,0 +1,103 @@
+#include <vector>
+#include "stdafx.h"
+#include "unpack.h"
+#include "framestats.h"
+#include "helper.h"
+
+// [Stats] = DCAM4FrameStats(cameraHandle, timeout, frames, stats, saturation)
+// Compute statistics of frames in the capture buffer without copying the
+// images to MATLAB.  'frames' lists the (1-based) frames of the buffer; if
+// it is empty the function waits up to 'timeout' milliseconds for a new
+// frame and uses the most recently transfered one.  'stats' is a name or a
+// cell array of names from Sum, Max, CentroidX, CentroidY, Brenner,
+// Variance and Saturated (default all).  'saturation' is the level counted
+// by Saturated (default the maximum value of DCAM_IDPROP_BITSPERCHANNEL).
+// 'Stats' has a 1 x numel(frames) field for each statistic.  Failures
+// raise an error.
+void mexFunction(int nlhs, mxArray* plhs[], int	nrhs, const	mxArray* prhs[])
+{
+	if (nrhs < 2 || nrhs > 5)
+		mexErrMsgTxt("Proper Usage: [Stats]=DCAM4FrameStats(cameraHandle,timeout,frames,stats,saturation)");
+
+	// Grab the inputs from MATLAB.
+	unsigned long* mHandle;
+	HDCAM handle;
+	mHandle = (unsigned long*)mxGetUint64s(prhs[0]);
+	handle = (HDCAM)mHandle[0];
+	int32 timeout = (int32)mxGetScalar(prhs[1]);
+	std::vector<int32> frames;
+	if (nrhs > 2 && !mxIsEmpty(prhs[2]))
+	{
+		if (!mxIsDouble(prhs[2]))
+			mexErrMsgTxt("frames must be type DOUBLE.");
+		const double* f = mxGetPr(prhs[2]);
+		for (size_t ii = 0; ii < mxGetNumberOfElements(prhs[2]); ii++)
+		{
+			if (f[ii] < 1)
+				mexErrMsgTxt("frames must be positive.");
+			frames.push_back((int32)f[ii] - 1);
+		}
+	}
+	unsigned int mask = get_stats_mask(nrhs > 3 ? prhs[3] : NULL);
+
+	DCAMERR error;
+	if (frames.empty())
+	{
+		// open wait handle.
+		DCAMWAIT_OPEN waitopen;
+		memset(&waitopen, 0, sizeof(waitopen));
+		waitopen.size = sizeof(waitopen);
+		waitopen.hdcam = handle;
+		error = dcamwait_open(&waitopen);
+		if (failed(error))
+			close_wait_and_error(NULL, "DCAM4FrameStats:dcamError",
+				"Error = 0x%08X\ndcamwait_open() failed.", error);
+
+		// wait image
+		HDCAMWAIT hwait = waitopen.hwait;
+		DCAMWAIT_START waitstart;
+		memset(&waitstart, 0, sizeof(waitstart));
+		waitstart.size = sizeof(waitstart);
+		waitstart.eventmask = DCAMWAIT_CAPEVENT_FRAMEREADY;
+		waitstart.timeout = timeout;
+		error = dcamwait_start(hwait, &waitstart);
+		if (failed(error))
+			close_wait_and_error(hwait, "DCAM4FrameStats:dcamError",
+				"Error = 0x%08X\ndcamwait_start() failed.", error);
+		dcamwait_close(hwait);
+
+		// Determine the frame index of the most recently transfered image.
+		DCAMCAP_TRANSFERINFO transferInfo;
+		memset(&transferInfo, 0, sizeof(transferInfo));
+		transferInfo.size = sizeof(transferInfo);
+		error = dcamcap_transferinfo(handle, &transferInfo);
+		if (failed(error))
+			close_wait_and_error(NULL, "DCAM4FrameStats:dcamError",
+				"Error = 0x%08X\ndcamcap_transferinfo() failed.", error);
+		if (transferInfo.nNewestFrameIndex < 0)
+			close_wait_and_error(NULL, "DCAM4FrameStats:noFrame",
+				"No frame has been transferred.");
+		frames.push_back(transferInfo.nNewestFrameIndex);
+	}
+
+	int32 pixeltype = get_pixeltype(handle);
+	if (pixeltype != DCAM_PIXELTYPE_MONO16 && pixeltype != DCAM_PIXELTYPE_MONO12
+		&& pixeltype != DCAM_PIXELTYPE_MONO12P)
+		close_wait_and_error(NULL, "DCAM4FrameStats:pixelType",
+			"Pixel type 0x%08X is not supported.", pixeltype);
+	unsigned short saturation = get_saturation(handle, nrhs > 4 ? prhs[4] : NULL, pixeltype);
+
+	// Compute the statistics straight from the capture buffer.
+	std::vector<frame_stats> stats(frames.size());
+	std::vector<unsigned short> row;
+	for (size_t ff = 0; ff < frames.size(); ff++)
+	{
+		error = framestats(handle, frames[ff], pixeltype, saturation, mask, stats[ff], row);
+		if (failed(error))
+			close_wait_and_error(NULL, "DCAM4FrameStats:dcamError",
+				"Error = 0x%08X\ndcambuf_lockframe() failed on frame %i.", error, frames[ff] + 1);
+	}
+	plhs[0] = create_stats_output(stats, mask);
+
+	return;
+}
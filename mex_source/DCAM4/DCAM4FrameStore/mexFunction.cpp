@@ -0,0 +1,427 @@
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>		// before stdafx.h, which defines min and max
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <new>
+#include "stdafx.h"
+#include "unpack.h"
+#include "framecodec.h"
+#include "threadctl.h"
+#include "bufferpool.h"
+
+// DCAM4FrameStore(cameraHandle, 'start', nFrames, bufferFrames, timeout, nThreads, threadOptions)
+// [Stored, Bytes, Running, Error, Jitter] = DCAM4FrameStore(cameraHandle, 'status')
+// Frames = DCAM4FrameStore(cameraHandle, 'read', first, count)
+// DCAM4FrameStore(cameraHandle, 'stop'), DCAM4FrameStore(cameraHandle, 'clear')
+// Pool = DCAM4FrameStore(cameraHandle, 'pool'), DCAM4FrameStore(cameraHandle, 'release')
+// Store a long sequence compressed in memory.  'start' is called after
+// DCAM4AllocMemory(cameraHandle, bufferFrames) and before the capture is
+// started in sequence mode (DCAM4StartCapture(cameraHandle, -1)).  A reader
+// thread then copies each new frame out of the 'bufferFrames' ring buffer
+// and 'nThreads' workers (default all cores but one) compress it losslessly
+// (see framecodec.h), until 'nFrames' frames are stored and the capture is
+// stopped.  If the ring buffer is overwritten before a frame is copied, the
+// store stops and 'Error' says so; this is checked after every copy, as the
+// reader may have waited for a staging frame, and the overwritten frame is
+// not stored.
+// 'threadOptions' (see threadctl.h) places the threads: the reader gets the
+// affinity and priority, the workers only the affinity, and LockMemory locks
+// the staging frames in RAM.  'Jitter' reports the intervals between the
+// waits of the reader (see create_jitter_output()).
+// 'read' decompresses the stored frames first to first+count-1 (1-based,
+// default all) into a uint16 width x height x count array; frames can be
+// read while the sequence is still running.  The stores stay in memory
+// (mexLock) until they are cleared for all cameras.
+// The staging frames come from a pool of pre-faulted buffers that is kept
+// for the next sequence (see bufferpool.h); 'pool' returns its statistics
+// and 'release' frees the buffers that no store is using.
+
+struct frame_store
+{
+	HDCAM handle;
+	HDCAMWAIT hwait;
+	int32 width, height, pixeltype;
+	int32 nFrames, bufferFrames, timeout;
+
+	std::mutex lock;
+	std::condition_variable changed;	// queue, free buffers or state changed
+	std::deque<std::pair<int32, pool_array<unsigned short> > > queue;
+	std::vector<pool_array<unsigned short> > free;	// staging frames (see bufferpool.h)
+	std::vector<std::vector<unsigned char> > frames;
+	std::vector<char> stored;
+	int32 nQueued, nStored;
+	size_t bytes;
+	bool stop, reading;
+	std::string error;
+
+	thread_policy policy;
+	thread_jitter jitter;
+
+	std::thread reader;
+	std::vector<std::thread> workers;
+};
+
+static std::map<HDCAM, std::unique_ptr<frame_store> > g_stores;
+
+// Copies the new frames of the ring buffer to the work queue.
+static void read_frames(frame_store* fs)
+{
+	DCAMWAIT_START waitstart;
+	memset(&waitstart, 0, sizeof(waitstart));
+	waitstart.size = sizeof(waitstart);
+	waitstart.eventmask = DCAMWAIT_CAPEVENT_FRAMEREADY;
+	waitstart.timeout = fs->timeout;
+	DCAMCAP_TRANSFERINFO transferInfo;
+	memset(&transferInfo, 0, sizeof(transferInfo));
+	transferInfo.size = sizeof(transferInfo);
+	DCAMBUF_FRAME frame;
+	memset(&frame, 0, sizeof(frame));
+	frame.size = sizeof(frame);
+	frame.width = fs->width;
+	frame.height = fs->height;
+
+	jitter_reset(fs->jitter, apply_thread_policy(fs->policy));
+	std::string error;
+	int32 captured = 0;
+	bool stopped = false;
+	while (captured < fs->nFrames && error.empty() && !stopped)
+	{
+		DCAMERR err = dcamwait_start(fs->hwait, &waitstart);
+		jitter_tick(fs->jitter);
+		if (failed(err))
+		{
+			if (err != DCAMERR_ABORT)
+				error = "dcamwait_start() failed.";
+			break;
+		}
+		err = dcamcap_transferinfo(fs->handle, &transferInfo);
+		if (failed(err))
+		{
+			error = "dcamcap_transferinfo() failed.";
+			break;
+		}
+		if (transferInfo.nFrameCount - captured >= fs->bufferFrames)
+		{
+			error = "the camera buffer was overwritten before the frames were stored; use a larger buffer.";
+			break;
+		}
+
+		for (; captured < transferInfo.nFrameCount && captured < fs->nFrames; captured++)
+		{
+			pool_array<unsigned short> buf;
+			{
+				std::unique_lock<std::mutex> lk(fs->lock);
+				fs->changed.wait(lk, [fs] { return fs->stop || !fs->free.empty(); });
+				stopped = fs->stop;
+				if (stopped)
+					break;
+				buf.swap(fs->free.back());
+				fs->free.pop_back();
+			}
+			frame.iFrame = captured % fs->bufferFrames;
+			frame.buf = &buf[0];
+			if (failed(copyframe_uint16(fs->handle, frame, fs->pixeltype)))
+			{
+				error = "dcambuf_copyframe() failed.";
+				break;
+			}
+			// The frame may have been overwritten during the copy or while
+			// the reader waited for a staging frame.
+			if (failed(dcamcap_transferinfo(fs->handle, &transferInfo)))
+			{
+				error = "dcamcap_transferinfo() failed.";
+				break;
+			}
+			if (transferInfo.nFrameCount - captured >= fs->bufferFrames)
+			{
+				error = "the camera buffer was overwritten before the frames were stored; use a larger buffer.";
+				break;
+			}
+			std::lock_guard<std::mutex> lk(fs->lock);
+			fs->queue.push_back(std::make_pair(captured, pool_array<unsigned short>()));
+			fs->queue.back().second.swap(buf);
+			fs->nQueued++;
+			fs->changed.notify_all();
+		}
+	}
+	if (captured >= fs->nFrames)
+		dcamcap_stop(fs->handle);
+
+	std::lock_guard<std::mutex> lk(fs->lock);
+	fs->error = error;
+	fs->reading = false;
+	fs->changed.notify_all();
+}
+
+// Compresses queued frames until the reader is done and the queue is empty.
+static void compress_frames(frame_store* fs)
+{
+	thread_policy affinity = fs->policy;
+	affinity.priority = THREAD_PRIORITY_LEVEL_NORMAL;
+	apply_thread_policy(affinity);
+	std::vector<unsigned char> coded;
+	for (;;)
+	{
+		std::pair<int32, pool_array<unsigned short> > item;
+		{
+			std::unique_lock<std::mutex> lk(fs->lock);
+			fs->changed.wait(lk, [fs] { return !fs->queue.empty() || !fs->reading; });
+			if (fs->queue.empty())
+				return;
+			item.first = fs->queue.front().first;
+			item.second.swap(fs->queue.front().second);
+			fs->queue.pop_front();
+		}
+		encode_frame(&item.second[0], fs->width, fs->height, coded);
+		std::vector<unsigned char> frame(coded.begin(), coded.end());
+
+		std::lock_guard<std::mutex> lk(fs->lock);
+		fs->frames[item.first].swap(frame);
+		fs->stored[item.first] = 1;
+		fs->nStored++;
+		fs->bytes += fs->frames[item.first].size();
+		fs->free.push_back(pool_array<unsigned short>());
+		fs->free.back().swap(item.second);
+		fs->changed.notify_all();
+	}
+}
+
+static void stop_store(frame_store* fs)
+{
+	{
+		std::lock_guard<std::mutex> lk(fs->lock);
+		fs->stop = true;
+		fs->changed.notify_all();
+	}
+	if (fs->hwait != NULL)
+		dcamwait_abort(fs->hwait);
+	if (fs->reader.joinable())
+		fs->reader.join();
+	for (size_t ii = 0; ii < fs->workers.size(); ii++)
+		if (fs->workers[ii].joinable())
+			fs->workers[ii].join();
+	fs->workers.clear();
+	if (fs->hwait != NULL)
+		dcamwait_close(fs->hwait);
+	fs->hwait = NULL;
+}
+
+static void clear_store(HDCAM handle)
+{
+	std::map<HDCAM, std::unique_ptr<frame_store> >::iterator it = g_stores.find(handle);
+	if (it == g_stores.end())
+		return;
+	frame_store* fs = it->second.get();
+	stop_store(fs);
+	// All of the staging frames are back in the free list.
+	for (size_t ii = 0; ii < fs->free.size(); ii++)
+		unlock_buffer(fs->policy, &fs->free[ii][0], fs->free[ii].size() * sizeof(unsigned short));
+	g_stores.erase(it);
+}
+
+static void Cleanup(void)
+{
+	while (!g_stores.empty())
+		clear_store(g_stores.begin()->first);
+}
+
+static void start_store(HDCAM handle, int nrhs, const mxArray* prhs[])
+{
+	if (nrhs < 5 || nrhs > 7)
+		mexErrMsgTxt("Proper Usage: DCAM4FrameStore(cameraHandle,'start',nFrames,bufferFrames,timeout,nThreads,threadOptions)");
+	int32 nFrames = (int32)mxGetScalar(prhs[2]);
+	int32 bufferFrames = (int32)mxGetScalar(prhs[3]);
+	int32 nThreads = (int32)std::thread::hardware_concurrency() - 1;
+	if (nrhs > 5 && !mxIsEmpty(prhs[5]))
+		nThreads = (int32)mxGetScalar(prhs[5]);
+	if (nFrames < 1 || bufferFrames < 2)
+		mexErrMsgTxt("nFrames must be positive and bufferFrames at least 2.");
+	if (nThreads < 1)
+		nThreads = 1;
+	thread_policy policy;
+	get_thread_policy(nrhs > 6 ? prhs[6] : NULL, policy);
+
+	double width, height;
+	if (failed(dcamprop_getvalue(handle, DCAM_IDPROP_IMAGE_WIDTH, &width))
+		|| failed(dcamprop_getvalue(handle, DCAM_IDPROP_IMAGE_HEIGHT, &height)))
+		mexErrMsgTxt("the image size could not be read.");
+	int32 pixeltype = get_pixeltype(handle);
+	if (pixeltype != DCAM_PIXELTYPE_MONO16 && pixeltype != DCAM_PIXELTYPE_MONO12
+		&& pixeltype != DCAM_PIXELTYPE_MONO12P)
+		mexErrMsgTxt("the pixel type of the camera is not supported.");
+
+	clear_store(handle);
+	std::unique_ptr<frame_store> fs(new frame_store);
+	fs->handle = handle;
+	fs->width = (int32)width;
+	fs->height = (int32)height;
+	fs->pixeltype = pixeltype;
+	fs->nFrames = nFrames;
+	fs->bufferFrames = bufferFrames;
+	fs->timeout = (int32)mxGetScalar(prhs[4]);
+	fs->frames.resize(nFrames);
+	fs->stored.assign(nFrames, 0);
+	fs->nQueued = fs->nStored = 0;
+	fs->bytes = 0;
+	fs->stop = false;
+	fs->reading = true;
+	// Two staging frames per worker let the reader run ahead of them.
+	fs->free.resize(2 * nThreads);
+	fs->policy = policy;
+	jitter_reset(fs->jitter, false);
+	try
+	{
+		for (size_t ii = 0; ii < fs->free.size(); ii++)
+			fs->free[ii].resize((size_t)fs->width * fs->height);
+	}
+	catch (const std::bad_alloc&)
+	{
+		mexErrMsgTxt("the staging frames could not be allocated.");
+	}
+	for (size_t ii = 0; ii < fs->free.size(); ii++)
+	{
+		if (!lock_buffer(policy, &fs->free[ii][0], fs->free[ii].size() * sizeof(unsigned short)))
+		{
+			mexPrintf("The staging frames could not be locked in memory.\n");
+			policy.lockMemory = false;
+		}
+	}
+
+	DCAMWAIT_OPEN waitopen;
+	memset(&waitopen, 0, sizeof(waitopen));
+	waitopen.size = sizeof(waitopen);
+	waitopen.hdcam = handle;
+	DCAMERR error = dcamwait_open(&waitopen);
+	if (failed(error))
+	{
+		for (size_t ii = 0; ii < fs->free.size(); ii++)
+			unlock_buffer(policy, &fs->free[ii][0], fs->free[ii].size() * sizeof(unsigned short));
+		mexErrMsgIdAndTxt("DCAM4FrameStore:dcamError", "Error = 0x%08X\ndcamwait_open() failed.", error);
+	}
+	fs->hwait = waitopen.hwait;
+
+	if (g_stores.empty())
+	{
+		mexLock();
+		mexAtExit(Cleanup);
+	}
+	frame_store* p = fs.get();
+	g_stores[handle] = std::move(fs);
+	for (int32 ii = 0; ii < nThreads; ii++)
+		p->workers.push_back(std::thread(compress_frames, p));
+	p->reader = std::thread(read_frames, p);
+}
+
+static void read_store(frame_store* fs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
+{
+	int32 first = nrhs > 2 && !mxIsEmpty(prhs[2]) ? (int32)mxGetScalar(prhs[2]) : 1;
+	int32 count = nrhs > 3 && !mxIsEmpty(prhs[3]) ? (int32)mxGetScalar(prhs[3]) : fs->nFrames - first + 1;
+	if (first < 1 || count < 0 || first - 1 + count > fs->nFrames)
+		mexErrMsgTxt("the frames are outside the sequence.");
+	bool stored = true;
+	{
+		std::lock_guard<std::mutex> lk(fs->lock);
+		for (int32 ff = first - 1; ff < first - 1 + count; ff++)
+			stored = stored && fs->stored[ff];
+	}
+	if (!stored)
+		mexErrMsgTxt("the frames have not been stored yet.");
+
+	mwSize outsize[3];
+	outsize[0] = fs->width;
+	outsize[1] = fs->height;
+	outsize[2] = count;
+	// Every frame is decoded into the output, so it is not zeroed first.
+	plhs[0] = mxCreateUninitNumericArray(3, outsize, mxUINT16_CLASS, mxREAL);
+	unsigned short* out = (unsigned short*)mxGetData(plhs[0]);
+	size_t framePixels = (size_t)fs->width * fs->height;
+
+	// Stored frames don't change, so they are decoded without the lock.
+	int32 nThreads = (int32)std::thread::hardware_concurrency();
+	if (nThreads > count)
+		nThreads = count;
+	std::vector<char> ok(count, 1);
+	std::vector<std::thread> threads;
+	for (int32 tt = 0; tt < nThreads; tt++)
+		threads.push_back(std::thread([=, &ok] {
+			for (int32 ii = tt; ii < count; ii += nThreads)
+			{
+				const std::vector<unsigned char>& coded = fs->frames[first - 1 + ii];
+				ok[ii] = decode_frame(&coded[0], coded.size(), fs->width, fs->height, out + ii * framePixels);
+			}
+		}));
+	for (size_t tt = 0; tt < threads.size(); tt++)
+		threads[tt].join();
+	for (int32 ii = 0; ii < count; ii++)
+		if (!ok[ii])
+			mexErrMsgTxt("a stored frame could not be decompressed.");
+}
+
+void mexFunction(int nlhs, mxArray* plhs[], int	nrhs, const	mxArray* prhs[])
+{
+	if (nrhs < 2 || !mxIsChar(prhs[1]))
+		mexErrMsgTxt("Proper Usage: DCAM4FrameStore(cameraHandle,command,...); command is 'start', 'status', 'read', 'stop', 'clear', 'pool' or 'release'.");
+
+	// Grab the inputs from MATLAB.
+	unsigned long* mHandle;
+	HDCAM handle;
+	mHandle = (unsigned long*)mxGetUint64s(prhs[0]);
+	handle = (HDCAM)mHandle[0];
+	char command[8];
+	mxGetString(prhs[1], command, sizeof(command));
+
+	if (strcmp(command, "start") == 0)
+	{
+		start_store(handle, nrhs, prhs);
+		return;
+	}
+	if (strcmp(command, "clear") == 0)
+	{
+		clear_store(handle);
+		if (g_stores.empty() && mexIsLocked())
+			mexUnlock();
+		return;
+	}
+	if (strcmp(command, "pool") == 0)
+	{
+		plhs[0] = create_pool_output();
+		return;
+	}
+	if (strcmp(command, "release") == 0)
+	{
+		pool_release();
+		return;
+	}
+
+	std::map<HDCAM, std::unique_ptr<frame_store> >::iterator it = g_stores.find(handle);
+	if (it == g_stores.end())
+		mexErrMsgTxt("No frame store for this camera; call DCAM4FrameStore(cameraHandle,'start',...) first.");
+	frame_store* fs = it->second.get();
+
+	if (strcmp(command, "status") == 0)
+	{
+		std::lock_guard<std::mutex> lk(fs->lock);
+		plhs[0] = mxCreateDoubleScalar(fs->nStored);
+		if (nlhs > 1)
+			plhs[1] = mxCreateDoubleScalar((double)fs->bytes);
+		if (nlhs > 2)
+			plhs[2] = mxCreateLogicalScalar(fs->reading || fs->nStored < fs->nQueued);
+		if (nlhs > 3)
+			plhs[3] = mxCreateString(fs->error.c_str());
+		if (nlhs > 4)
+			plhs[4] = create_jitter_output(fs->jitter);
+	}
+	else if (strcmp(command, "read") == 0)
+		read_store(fs, plhs, nrhs, prhs);
+	else if (strcmp(command, "stop") == 0)
+		stop_store(fs);
+	else
+		mexErrMsgTxt("Unknown command; use 'start', 'status', 'read', 'stop', 'clear', 'pool' or 'release'.");
+
+	return;
+}
@@ -13,7 +13,7 @@ void mexFunction(int nlhs, mxArray* plhs[],	int	nrhs, const	mxArray* prhs[])
 	error = dcamapi_init(&apiinit);
 	if (failed(error))
 	{
-		mexPrintf("Error = 0x%08lX\ndcamapi_init() failed.\n", error);
+		mexPrintf("Error = 0x%08X\ndcamapi_init() failed.\n", error);
 	}
 
 	// Loop through the detected cameras and request info.
@@ -33,7 +33,7 @@ void mexFunction(int nlhs, mxArray* plhs[],	int	nrhs, const	mxArray* prhs[])
 			error = dcamdev_getstring((HDCAM)ii, &param);
 			if (failed(error))
 			{
-				mexPrintf("Error = 0x%08lX\ndcamdev_getstring() failed.\n", error);
+				mexPrintf("Error = 0x%08X\ndcamdev_getstring() failed.\n", error);
 			}
 
 			// Print the device info.
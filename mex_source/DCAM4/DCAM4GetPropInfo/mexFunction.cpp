@@ -111,7 +111,7 @@ void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
 	error = dcamprop_getattr(handle, &basepropattr);
 	if (failed(error))
 	{
-		mexPrintf("Error = 0x%08lX\ndcamprop_getattr() failed.\n", error);
+		mexPrintf("Error = 0x%08X\ndcamprop_getattr() failed.\n", error);
 		return;
 	}
 	dcam_get_propinfo(basepropattr, &prop);
@@ -120,7 +120,7 @@ void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
 	error = dcamprop_getname(handle, iProp, text, sizeof(text));
 	if (failed(error))
 	{
-		mexPrintf("Error = 0x%08lX\ndcamprop_getattr() failed.\n", error);
+		mexPrintf("Error = 0x%08X\ndcamprop_getattr() failed.\n", error);
 		return;
 	}
 	prop.name = text;
@@ -0,0 +1,358 @@
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include "stdafx.h"
+
+// [Properties, Cached] = DCAM4GetPropMetadata(cameraHandle, cacheDir, refresh)
+// Get the attributes and current values of all of the properties supported
+// by the camera in one call.  The names, types, units, ranges and mode texts
+// (as returned by DCAM4GetPropInfo and DCAM4GetPropValueText) only depend on
+// the camera model and firmware, so they are kept in a small binary file in
+// 'cacheDir' named after DCAM_IDSTR_MODEL, DCAM_IDSTR_CAMERAID and
+// DCAM_IDSTR_CAMERAVERSION.  When that file exists, only the values of the
+// readable properties are read from the camera.  The file is written when it
+// doesn't exist, or when 'refresh' is true; an empty 'cacheDir' disables the
+// cache.
+// 'Properties' is a struct array with the fields idprop, name, type, unit,
+// range, writable and readable (as DCAM4GetPropInfo), text (a cell array
+// with the text of each mode value, indexed by value, for MODE properties)
+// and value (NaN for properties that can't be read).  'Cached' is true if
+// the attributes were loaded from the cache.
+
+#define CACHE_MAGIC		0x31434D44	// "DMC1"
+
+struct prop_metadata
+{
+	int32 id;
+	int32 attribute;
+	int32 iUnit;
+	double valuemin, valuemax, valuestep;
+	std::string name;
+	int32 firstText;				// value of text[0]
+	std::vector<std::string> text;	// MODE properties only
+};
+
+static std::string get_devstring(HDCAM handle, int32 iString)
+{
+	char text[256];
+	DCAMDEV_STRING param;
+	memset(&param, 0, sizeof(param));
+	param.size = sizeof(param);
+	param.iString = iString;
+	param.text = text;
+	param.textbytes = sizeof(text);
+	if (failed(dcamdev_getstring(handle, &param)))
+		return "";
+	return text;
+}
+
+// Text of a property value, "" if there is none.
+static std::string get_valuetext(HDCAM handle, int32 iProp, double value)
+{
+	char text[64];
+	DCAMPROP_VALUETEXT pvt;
+	memset(&pvt, 0, sizeof(pvt));
+	pvt.cbSize = sizeof(pvt);
+	pvt.iProp = iProp;
+	pvt.value = value;
+	pvt.text = text;
+	pvt.textbytes = sizeof(text);
+	if (failed(dcamprop_getvaluetext(handle, &pvt)))
+		return "";
+	return text;
+}
+
+// Enumerates the supported properties and their attributes.
+static bool query_metadata(HDCAM handle, std::vector<prop_metadata>& props)
+{
+	props.clear();
+	int32 iProp = 0;
+	while (!failed(dcamprop_getnextid(handle, &iProp, DCAMPROP_OPTION_SUPPORT)) && iProp != 0)
+	{
+		DCAMPROP_ATTR propattr;
+		memset(&propattr, 0, sizeof(propattr));
+		propattr.cbSize = sizeof(propattr);
+		propattr.iProp = iProp;
+		DCAMERR error = dcamprop_getattr(handle, &propattr);
+		if (failed(error))
+		{
+			mexPrintf("Error = 0x%08X\ndcamprop_getattr() failed.\n", error);
+			return false;
+		}
+		char name[64];
+		error = dcamprop_getname(handle, iProp, name, sizeof(name));
+		if (failed(error))
+		{
+			mexPrintf("Error = 0x%08X\ndcamprop_getname() failed.\n", error);
+			return false;
+		}
+
+		prop_metadata prop;
+		prop.id = iProp;
+		prop.attribute = propattr.attribute;
+		prop.iUnit = propattr.iUnit;
+		prop.valuemin = propattr.valuemin;
+		prop.valuemax = propattr.valuemax;
+		prop.valuestep = propattr.valuestep;
+		prop.name = name;
+		prop.firstText = 0;
+		if ((propattr.attribute & DCAMPROP_TYPE_MASK) == DCAMPROP_TYPE_MODE)
+		{
+			// Modes without a range are OFF/ON (1 and 2), as in DCAM4Camera.
+			int32 first = 1, last = 2;
+			if (propattr.attribute & DCAMPROP_ATTR_HASRANGE)
+			{
+				first = (int32)propattr.valuemin;
+				last = (int32)propattr.valuemax;
+			}
+			prop.firstText = first;
+			for (int32 value = first; value <= last; value++)
+				prop.text.push_back(get_valuetext(handle, iProp, value));
+		}
+		props.push_back(prop);
+	}
+	return true;
+}
+
+// File name of the cache for this camera; "" if the camera is unknown.
+static std::string cache_path(HDCAM handle, const std::string& cacheDir, std::string& key)
+{
+	key = get_devstring(handle, DCAM_IDSTR_MODEL) + "_"
+		+ get_devstring(handle, DCAM_IDSTR_CAMERAID) + "_"
+		+ get_devstring(handle, DCAM_IDSTR_CAMERAVERSION);
+	if (key == "__")
+		return "";
+	std::string file = "DCAM4Props_" + key + ".bin";
+	for (size_t ii = 0; ii < file.size(); ii++)
+	{
+		char c = file[ii];
+		if (!isalnum((unsigned char)c) && c != '.' && c != '_' && c != '-')
+			file[ii] = '_';
+	}
+	char last = cacheDir[cacheDir.size() - 1];
+	if (last == '/' || last == '\\')
+		return cacheDir + file;
+	return cacheDir + "/" + file;
+}
+
+static void write_int(FILE* fp, int32 value)
+{
+	fwrite(&value, sizeof(value), 1, fp);
+}
+
+static void write_double(FILE* fp, double value)
+{
+	fwrite(&value, sizeof(value), 1, fp);
+}
+
+static void write_string(FILE* fp, const std::string& text)
+{
+	write_int(fp, (int32)text.size());
+	fwrite(text.data(), 1, text.size(), fp);
+}
+
+static bool read_int(FILE* fp, int32& value)
+{
+	return fread(&value, sizeof(value), 1, fp) == 1;
+}
+
+static bool read_double(FILE* fp, double& value)
+{
+	return fread(&value, sizeof(value), 1, fp) == 1;
+}
+
+static bool read_string(FILE* fp, std::string& text)
+{
+	int32 length;
+	if (!read_int(fp, length) || length < 0 || length > 4096)
+		return false;
+	text.resize(length);
+	return length == 0 || fread(&text[0], 1, length, fp) == (size_t)length;
+}
+
+static bool save_cache(const std::string& path, const std::string& key,
+	const std::vector<prop_metadata>& props)
+{
+	// Write to a temporary file, so that a camera opened at the same time
+	// never reads a partial cache.
+	std::string temp = path + ".tmp";
+	FILE* fp = fopen(temp.c_str(), "wb");
+	if (fp == NULL)
+		return false;
+	write_int(fp, CACHE_MAGIC);
+	write_string(fp, key);
+	write_int(fp, (int32)props.size());
+	for (size_t ii = 0; ii < props.size(); ii++)
+	{
+		const prop_metadata& prop = props[ii];
+		write_int(fp, prop.id);
+		write_int(fp, prop.attribute);
+		write_int(fp, prop.iUnit);
+		write_double(fp, prop.valuemin);
+		write_double(fp, prop.valuemax);
+		write_double(fp, prop.valuestep);
+		write_string(fp, prop.name);
+		write_int(fp, prop.firstText);
+		write_int(fp, (int32)prop.text.size());
+		for (size_t jj = 0; jj < prop.text.size(); jj++)
+			write_string(fp, prop.text[jj]);
+	}
+	bool ok = ferror(fp) == 0;
+	ok = fclose(fp) == 0 && ok;
+	remove(path.c_str());
+	if (!ok || rename(temp.c_str(), path.c_str()) != 0)
+	{
+		remove(temp.c_str());
+		return false;
+	}
+	return true;
+}
+
+static bool load_cache(const std::string& path, const std::string& key,
+	std::vector<prop_metadata>& props)
+{
+	FILE* fp = fopen(path.c_str(), "rb");
+	if (fp == NULL)
+		return false;
+	int32 magic = 0, nProps = 0;
+	std::string fileKey;
+	bool ok = read_int(fp, magic) && magic == CACHE_MAGIC
+		&& read_string(fp, fileKey) && fileKey == key
+		&& read_int(fp, nProps) && nProps > 0 && nProps < 65536;
+	props.clear();
+	for (int32 ii = 0; ok && ii < nProps; ii++)
+	{
+		prop_metadata prop;
+		int32 nText = 0;
+		ok = read_int(fp, prop.id) && read_int(fp, prop.attribute) && read_int(fp, prop.iUnit)
+			&& read_double(fp, prop.valuemin) && read_double(fp, prop.valuemax)
+			&& read_double(fp, prop.valuestep) && read_string(fp, prop.name)
+			&& read_int(fp, prop.firstText) && read_int(fp, nText) && nText >= 0 && nText < 65536;
+		prop.text.resize(ok ? nText : 0);
+		for (int32 jj = 0; ok && jj < nText; jj++)
+			ok = read_string(fp, prop.text[jj]);
+		props.push_back(prop);
+	}
+	fclose(fp);
+	if (!ok)
+		props.clear();
+	return ok;
+}
+
+static const char* unit_name(int32 iUnit)
+{
+	switch (iUnit)
+	{
+	case DCAMPROP_UNIT_SECOND:				return "SECOND";
+	case DCAMPROP_UNIT_CELSIUS:				return "CELSIUS";
+	case DCAMPROP_UNIT_KELVIN:				return "KELVIN";
+	case DCAMPROP_UNIT_METERPERSECOND:		return "METERPERSECOND";
+	case DCAMPROP_UNIT_PERSECOND:			return "PERSECOND";
+	case DCAMPROP_UNIT_DEGREE:				return "DEGREE";
+	case DCAMPROP_UNIT_MICROMETER:			return "MICROMETER";
+	default:								return "NONE";
+	}
+}
+
+static const char* type_name(int32 attribute)
+{
+	switch (attribute & DCAMPROP_TYPE_MASK)
+	{
+	case DCAMPROP_TYPE_MODE:	return "MODE";
+	case DCAMPROP_TYPE_LONG:	return "LONG";
+	case DCAMPROP_TYPE_REAL:	return "REAL";
+	default:					return "NONE";
+	}
+}
+
+static mxArray* create_int32(int value)
+{
+	mxArray* out = mxCreateNumericMatrix(1, 1, mxINT32_CLASS, mxREAL);
+	*mxGetInt32s(out) = value;
+	return out;
+}
+
+void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
+{
+	if (nrhs < 1)
+		mexErrMsgTxt("Proper Usage: [Properties,Cached]=DCAM4GetPropMetadata(cameraHandle,cacheDir,refresh)");
+
+	// Grab the inputs from MATLAB.
+	unsigned long* mHandle;
+	HDCAM handle;
+	mHandle = (unsigned long*)mxGetUint64s(prhs[0]);
+	handle = (HDCAM)mHandle[0];
+	std::string cacheDir;
+	if (nrhs > 1 && mxIsChar(prhs[1]) && !mxIsEmpty(prhs[1]))
+	{
+		char* dir = mxArrayToString(prhs[1]);
+		cacheDir = dir;
+		mxFree(dir);
+	}
+	bool refresh = nrhs > 2 && mxGetScalar(prhs[2]) != 0;
+
+	// Load the attributes from the cache, or query and save them.
+	std::vector<prop_metadata> props;
+	std::string key, path;
+	if (!cacheDir.empty())
+		path = cache_path(handle, cacheDir, key);
+	bool cached = !refresh && !path.empty() && load_cache(path, key, props);
+	if (!cached)
+	{
+		if (!query_metadata(handle, props))
+			props.clear();
+		else if (!path.empty() && !save_cache(path, key, props))
+			mexPrintf("Property cache %s could not be written.\n", path.c_str());
+	}
+
+	// Prepare the outputs with the current values.
+	const char* field_names[] = { "idprop", "name", "type", "unit", "range",
+		"writable", "readable", "text", "value" };
+	plhs[0] = mxCreateStructMatrix(1, props.size(), 9, field_names);
+	for (size_t ii = 0; ii < props.size(); ii++)
+	{
+		const prop_metadata& prop = props[ii];
+		mxSetFieldByNumber(plhs[0], ii, 0, create_int32(prop.id));
+		mxSetFieldByNumber(plhs[0], ii, 1, mxCreateString(prop.name.c_str()));
+		mxSetFieldByNumber(plhs[0], ii, 2, mxCreateString(type_name(prop.attribute)));
+		mxSetFieldByNumber(plhs[0], ii, 3, mxCreateString(unit_name(prop.iUnit)));
+
+		mxArray* range = mxCreateDoubleMatrix(1, 3, mxREAL);
+		double* rangePointer = mxGetPr(range);
+		bool hasRange = (prop.attribute & DCAMPROP_ATTR_HASRANGE) != 0;
+		rangePointer[0] = hasRange ? prop.valuemin : -1.0;
+		rangePointer[1] = hasRange ? prop.valuemax : -1.0;
+		rangePointer[2] = (prop.attribute & DCAMPROP_ATTR_HASSTEP) ? prop.valuestep : -1.0;
+		mxSetFieldByNumber(plhs[0], ii, 4, range);
+
+		bool readable = (prop.attribute & DCAMPROP_ATTR_READABLE) != 0;
+		mxSetFieldByNumber(plhs[0], ii, 5, create_int32((prop.attribute & DCAMPROP_ATTR_WRITABLE) ? 1 : 0));
+		mxSetFieldByNumber(plhs[0], ii, 6, create_int32(readable ? 1 : 0));
+
+		// text{value} is the text of a mode value; lower values are empty.
+		mxArray* text = mxCreateCellMatrix(1, prop.text.empty() ? 0 : prop.firstText + prop.text.size() - 1);
+		for (size_t jj = 0; jj < prop.text.size(); jj++)
+		{
+			int32 index = prop.firstText + (int32)jj - 1;
+			if (index >= 0)
+				mxSetCell(text, index, mxCreateString(prop.text[jj].c_str()));
+		}
+		mxSetFieldByNumber(plhs[0], ii, 7, text);
+
+		double value = mxGetNaN();
+		if (readable)
+		{
+			DCAMERR error = dcamprop_getvalue(handle, prop.id, &value);
+			if (failed(error))
+			{
+				mexPrintf("Error = 0x%08X\ndcamprop_getvalue() failed for property 0x%08X.\n", error, prop.id);
+				value = mxGetNaN();
+			}
+		}
+		mxSetFieldByNumber(plhs[0], ii, 8, mxCreateDoubleScalar(value));
+	}
+	if (nlhs > 1)
+		plhs[1] = mxCreateLogicalScalar(cached);
+
+	return;
+}
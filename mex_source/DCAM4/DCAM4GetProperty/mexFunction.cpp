@@ -24,7 +24,7 @@ void mexFunction(int nlhs, mxArray* plhs[],	int	nrhs, const	mxArray* prhs[])
 	error = dcamprop_getvalue(handle, propertyID, propertyValue);
 	if (failed(error))
 	{
-		mexPrintf("Error = 0x%08lX\ndcamprop_getvalue() failed.\n", error);
+		mexPrintf("Error = 0x%08X\ndcamprop_getvalue() failed.\n", error);
 	}
 
 	return;
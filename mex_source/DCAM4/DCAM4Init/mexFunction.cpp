@@ -12,7 +12,7 @@ void mexFunction(int nlhs, mxArray *plhs[],	int	nrhs, const	mxArray	*prhs[])
 	error = dcamapi_init(&apiinit);
 	if (failed(error))
 	{
-		mexPrintf("Error = 0x%08lX\ndcamapi_init() failed.\n", error);
+		mexPrintf("Error = 0x%08X\ndcamapi_init() failed.\n", error);
 	}
 
 	// Grab some outputs to return to MATLAB.
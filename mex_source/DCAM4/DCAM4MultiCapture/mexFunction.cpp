@@ -0,0 +1,515 @@
+#include <vector>
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>		// before stdafx.h, which defines min and max
+#include <mutex>
+#include <chrono>
+#include "stdafx.h"
+#include "unpack.h"
+#include "threadctl.h"
+
+// DCAM4MultiCapture(cameraHandles, 'start', bufferFrames, timeout, matchBy, tolerance, maxSets, threadOptions)
+// [Frames, Timestamps, Framestamps] = DCAM4MultiCapture(cameraHandles, 'read', maxSets)
+// [Matched, Unmatched, Pending, Error] = DCAM4MultiCapture(cameraHandles, 'status')
+// DCAM4MultiCapture(cameraHandles, 'stop'), DCAM4MultiCapture(cameraHandles, 'clear')
+// Acquire from several cameras at once and pair their frames.  'cameraHandles'
+// is a uint64 vector with one handle per camera.  'start' is called after
+// DCAM4AllocMemory(cameraHandle, bufferFrames) for each camera and before the
+// captures are started in sequence mode (DCAM4StartCapture(cameraHandle, -1)).
+// One thread per camera then copies each new frame out of its ring buffer,
+// so the cameras don't wait for each other or for MATLAB.  'threadOptions'
+// (see threadctl.h) gives these threads their affinity and priority.
+// A capture belongs to exactly the cameras it was started with, in that
+// order; starting another capture with any of them clears the old one.
+// Frames are matched by 'matchBy':
+//	'framestamp'	the frame count since the first frame of each camera
+//					(default; cameras started together or hardware triggered)
+//	'timestamp'		the DCAM timestamp, within 'tolerance' seconds
+//					(default 1e-3; free running cameras)
+// A frame that can no longer be matched is dropped and counted in
+// 'Unmatched' (1 x nCameras).  Up to 'maxSets' (default bufferFrames) matched
+// sets are kept until they are read; older sets are then dropped as well.
+// 'read' returns up to 'maxSets' (default all) of the matched sets, oldest
+// first: 'Frames' is a cell array with a uint16 width x height x nSets array
+// per camera, 'Timestamps' (s) and 'Framestamps' are nSets x nCameras.
+// 'Pending' is the number of sets that can be read.  A frame of a camera is
+// checked against its ring buffer after it is copied; if it was overwritten
+// the camera's thread stops and 'Error' says so.  The captures stay in
+// memory (mexLock) until they are cleared.
+
+struct camera_frame
+{
+	double timestamp;
+	int32 framestamp;
+	std::vector<unsigned short> pixels;
+};
+
+struct capture_camera
+{
+	HDCAM handle;
+	HDCAMWAIT hwait;
+	int32 width, height, pixeltype;
+	int32 firstFramestamp;			// -1 until the first frame
+	std::deque<camera_frame> pending;
+	std::vector<std::vector<unsigned short> > free;
+	double unmatched;
+	std::thread reader;
+};
+
+struct multi_capture
+{
+	std::vector<std::unique_ptr<capture_camera> > cameras;
+	int32 bufferFrames, timeout, maxSets;
+	bool byTimestamp;
+	double tolerance;
+	thread_policy policy;
+
+	std::mutex lock;
+	std::deque<std::vector<camera_frame> > sets;
+	double matched;
+	bool stop;
+	std::string error;
+};
+
+// Captures by the handles of all of their cameras.
+typedef std::map<std::vector<HDCAM>, std::unique_ptr<multi_capture> > capture_map;
+static capture_map g_captures;
+
+static double frame_key(const multi_capture* mc, const capture_camera* cam, const camera_frame& frame)
+{
+	if (mc->byTimestamp)
+		return frame.timestamp;
+	return (double)(frame.framestamp - cam->firstFramestamp);
+}
+
+static void recycle(capture_camera* cam, camera_frame& frame)
+{
+	cam->free.push_back(std::vector<unsigned short>());
+	cam->free.back().swap(frame.pixels);
+}
+
+// Pairs the oldest pending frames of all cameras; call with mc->lock held.
+static void match_frames(multi_capture* mc)
+{
+	size_t nCameras = mc->cameras.size();
+	double tolerance = mc->byTimestamp ? mc->tolerance : 0;
+	for (;;)
+	{
+		double lo = 0, hi = 0;
+		for (size_t cc = 0; cc < nCameras; cc++)
+		{
+			capture_camera* cam = mc->cameras[cc].get();
+			if (cam->pending.empty())
+				return;
+			double key = frame_key(mc, cam, cam->pending.front());
+			if (cc == 0 || key < lo)
+				lo = key;
+			if (cc == 0 || key > hi)
+				hi = key;
+		}
+
+		if (hi - lo <= tolerance)
+		{
+			if ((int32)mc->sets.size() >= mc->maxSets)
+			{
+				for (size_t cc = 0; cc < nCameras; cc++)
+					recycle(mc->cameras[cc].get(), mc->sets.front()[cc]);
+				mc->sets.pop_front();
+			}
+			mc->sets.push_back(std::vector<camera_frame>(nCameras));
+			for (size_t cc = 0; cc < nCameras; cc++)
+			{
+				capture_camera* cam = mc->cameras[cc].get();
+				camera_frame& frame = mc->sets.back()[cc];
+				frame.timestamp = cam->pending.front().timestamp;
+				frame.framestamp = cam->pending.front().framestamp;
+				frame.pixels.swap(cam->pending.front().pixels);
+				cam->pending.pop_front();
+			}
+			mc->matched++;
+			continue;
+		}
+
+		// Every later frame of the camera with the newest frame is newer
+		// still, so frames older than that by more than the tolerance can
+		// never be matched.
+		for (size_t cc = 0; cc < nCameras; cc++)
+		{
+			capture_camera* cam = mc->cameras[cc].get();
+			if (frame_key(mc, cam, cam->pending.front()) < hi - tolerance)
+			{
+				recycle(cam, cam->pending.front());
+				cam->pending.pop_front();
+				cam->unmatched++;
+			}
+		}
+	}
+}
+
+// Copies the new frames of one camera's ring buffer and matches them.
+static void read_camera(multi_capture* mc, capture_camera* cam)
+{
+	DCAMWAIT_START waitstart;
+	memset(&waitstart, 0, sizeof(waitstart));
+	waitstart.size = sizeof(waitstart);
+	waitstart.eventmask = DCAMWAIT_CAPEVENT_FRAMEREADY;
+	waitstart.timeout = mc->timeout;
+	DCAMCAP_TRANSFERINFO transferInfo;
+	memset(&transferInfo, 0, sizeof(transferInfo));
+	transferInfo.size = sizeof(transferInfo);
+	DCAMBUF_FRAME frame;
+	memset(&frame, 0, sizeof(frame));
+	frame.size = sizeof(frame);
+	size_t framePixels = (size_t)cam->width * cam->height;
+
+	apply_thread_policy(mc->policy);
+	std::string error;
+	int32 captured = 0;
+	for (;;)
+	{
+		{
+			std::lock_guard<std::mutex> lk(mc->lock);
+			if (mc->stop)
+				break;
+		}
+		DCAMERR err = dcamwait_start(cam->hwait, &waitstart);
+		if (err == DCAMERR_TIMEOUT)
+			continue;
+		if (failed(err))
+		{
+			if (err != DCAMERR_ABORT)
+				error = "dcamwait_start() failed.";
+			break;
+		}
+		err = dcamcap_transferinfo(cam->handle, &transferInfo);
+		if (failed(err))
+		{
+			error = "dcamcap_transferinfo() failed.";
+			break;
+		}
+		if (transferInfo.nFrameCount - captured >= mc->bufferFrames)
+		{
+			error = "the camera buffer was overwritten before the frames were copied; use a larger buffer.";
+			break;
+		}
+
+		for (; captured < transferInfo.nFrameCount; captured++)
+		{
+			camera_frame item;
+			{
+				std::lock_guard<std::mutex> lk(mc->lock);
+				if (!cam->free.empty())
+				{
+					item.pixels.swap(cam->free.back());
+					cam->free.pop_back();
+				}
+			}
+			item.pixels.resize(framePixels);
+
+			// lockframe() gives the stamps of the frame, copyframe_uint16()
+			// then copies it from the same buffer.
+			frame.iFrame = captured % mc->bufferFrames;
+			frame.buf = NULL;
+			frame.rowbytes = 0;
+			err = dcambuf_lockframe(cam->handle, &frame);
+			if (!failed(err))
+			{
+				item.timestamp = frame.timestamp.sec + frame.timestamp.microsec * 1e-6;
+				item.framestamp = frame.framestamp;
+				frame.buf = &item.pixels[0];
+				err = copyframe_uint16(cam->handle, frame, cam->pixeltype);
+			}
+			if (failed(err))
+			{
+				error = "dcambuf_copyframe() failed.";
+				break;
+			}
+			// The frame may have been overwritten during the copy.
+			err = dcamcap_transferinfo(cam->handle, &transferInfo);
+			if (failed(err))
+			{
+				error = "dcamcap_transferinfo() failed.";
+				break;
+			}
+			if (transferInfo.nFrameCount - captured >= mc->bufferFrames)
+			{
+				error = "the camera buffer was overwritten before the frames were copied; use a larger buffer.";
+				break;
+			}
+
+			std::lock_guard<std::mutex> lk(mc->lock);
+			if (cam->firstFramestamp < 0)
+				cam->firstFramestamp = item.framestamp;
+			cam->pending.push_back(camera_frame());
+			cam->pending.back().timestamp = item.timestamp;
+			cam->pending.back().framestamp = item.framestamp;
+			cam->pending.back().pixels.swap(item.pixels);
+			// A camera that runs ahead of a stalled one keeps at most a
+			// buffer of frames.
+			if ((int32)cam->pending.size() > mc->bufferFrames)
+			{
+				recycle(cam, cam->pending.front());
+				cam->pending.pop_front();
+				cam->unmatched++;
+			}
+			match_frames(mc);
+		}
+		if (!error.empty())
+			break;
+	}
+
+	std::lock_guard<std::mutex> lk(mc->lock);
+	if (!error.empty() && mc->error.empty())
+		mc->error = error;
+}
+
+static void stop_capture(multi_capture* mc)
+{
+	{
+		std::lock_guard<std::mutex> lk(mc->lock);
+		mc->stop = true;
+	}
+	for (size_t cc = 0; cc < mc->cameras.size(); cc++)
+		if (mc->cameras[cc]->hwait != NULL)
+			dcamwait_abort(mc->cameras[cc]->hwait);
+	for (size_t cc = 0; cc < mc->cameras.size(); cc++)
+	{
+		capture_camera* cam = mc->cameras[cc].get();
+		if (cam->reader.joinable())
+			cam->reader.join();
+		if (cam->hwait != NULL)
+			dcamwait_close(cam->hwait);
+		cam->hwait = NULL;
+	}
+}
+
+static void clear_capture(const std::vector<HDCAM>& handles)
+{
+	capture_map::iterator it = g_captures.find(handles);
+	if (it == g_captures.end())
+		return;
+	stop_capture(it->second.get());
+	g_captures.erase(it);
+}
+
+// Clears the captures that use any of the cameras, which can only be in one.
+static void clear_overlapping(const std::vector<HDCAM>& handles)
+{
+	std::vector<std::vector<HDCAM> > overlapping;
+	for (capture_map::iterator it = g_captures.begin(); it != g_captures.end(); ++it)
+		for (size_t cc = 0; cc < handles.size(); cc++)
+			if (std::find(it->first.begin(), it->first.end(), handles[cc]) != it->first.end())
+			{
+				overlapping.push_back(it->first);
+				break;
+			}
+	for (size_t ii = 0; ii < overlapping.size(); ii++)
+		clear_capture(overlapping[ii]);
+}
+
+static void Cleanup(void)
+{
+	while (!g_captures.empty())
+		clear_capture(g_captures.begin()->first);
+}
+
+static void start_capture(const std::vector<HDCAM>& handles, int nrhs, const mxArray* prhs[])
+{
+	if (nrhs < 4 || nrhs > 8)
+		mexErrMsgTxt("Proper Usage: DCAM4MultiCapture(cameraHandles,'start',bufferFrames,timeout,matchBy,tolerance,maxSets,threadOptions)");
+	int32 bufferFrames = (int32)mxGetScalar(prhs[2]);
+	if (bufferFrames < 2)
+		mexErrMsgTxt("bufferFrames must be at least 2.");
+	bool byTimestamp = false;
+	if (nrhs > 4 && !mxIsEmpty(prhs[4]))
+	{
+		char matchBy[16];
+		mxGetString(prhs[4], matchBy, sizeof(matchBy));
+		if (strcmp(matchBy, "timestamp") == 0)
+			byTimestamp = true;
+		else if (strcmp(matchBy, "framestamp") != 0)
+			mexErrMsgTxt("matchBy must be 'framestamp' or 'timestamp'.");
+	}
+	double tolerance = nrhs > 5 && !mxIsEmpty(prhs[5]) ? mxGetScalar(prhs[5]) : 1e-3;
+	int32 maxSets = nrhs > 6 && !mxIsEmpty(prhs[6]) ? (int32)mxGetScalar(prhs[6]) : bufferFrames;
+	if (maxSets < 1)
+		maxSets = 1;
+	thread_policy policy;
+	get_thread_policy(nrhs > 7 ? prhs[7] : NULL, policy);
+
+	clear_overlapping(handles);
+	std::unique_ptr<multi_capture> mc(new multi_capture);
+	mc->bufferFrames = bufferFrames;
+	mc->timeout = (int32)mxGetScalar(prhs[3]);
+	mc->maxSets = maxSets;
+	mc->byTimestamp = byTimestamp;
+	mc->tolerance = tolerance;
+	mc->policy = policy;
+	mc->matched = 0;
+	mc->stop = false;
+	for (size_t cc = 0; cc < handles.size(); cc++)
+	{
+		HDCAM handle = handles[cc];
+		double width, height;
+		if (failed(dcamprop_getvalue(handle, DCAM_IDPROP_IMAGE_WIDTH, &width))
+			|| failed(dcamprop_getvalue(handle, DCAM_IDPROP_IMAGE_HEIGHT, &height)))
+			mexErrMsgTxt("the image size could not be read.");
+		int32 pixeltype = get_pixeltype(handle);
+		if (pixeltype != DCAM_PIXELTYPE_MONO16 && pixeltype != DCAM_PIXELTYPE_MONO12
+			&& pixeltype != DCAM_PIXELTYPE_MONO12P)
+			mexErrMsgTxt("the pixel type of the camera is not supported.");
+
+		std::unique_ptr<capture_camera> cam(new capture_camera);
+		cam->handle = handle;
+		cam->hwait = NULL;
+		cam->width = (int32)width;
+		cam->height = (int32)height;
+		cam->pixeltype = pixeltype;
+		cam->firstFramestamp = -1;
+		cam->unmatched = 0;
+		mc->cameras.push_back(std::move(cam));
+	}
+
+	for (size_t cc = 0; cc < mc->cameras.size(); cc++)
+	{
+		DCAMWAIT_OPEN waitopen;
+		memset(&waitopen, 0, sizeof(waitopen));
+		waitopen.size = sizeof(waitopen);
+		waitopen.hdcam = mc->cameras[cc]->handle;
+		DCAMERR error = dcamwait_open(&waitopen);
+		if (failed(error))
+		{
+			stop_capture(mc.get());
+			mexErrMsgIdAndTxt("DCAM4MultiCapture:dcamError", "Error = 0x%08X\ndcamwait_open() failed.", error);
+		}
+		mc->cameras[cc]->hwait = waitopen.hwait;
+	}
+
+	if (g_captures.empty())
+	{
+		mexLock();
+		mexAtExit(Cleanup);
+	}
+	multi_capture* p = mc.get();
+	g_captures[handles] = std::move(mc);
+	for (size_t cc = 0; cc < p->cameras.size(); cc++)
+		p->cameras[cc]->reader = std::thread(read_camera, p, p->cameras[cc].get());
+}
+
+static void read_capture(multi_capture* mc, int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
+{
+	size_t nCameras = mc->cameras.size();
+	std::deque<std::vector<camera_frame> > sets;
+	{
+		std::lock_guard<std::mutex> lk(mc->lock);
+		size_t count = mc->sets.size();
+		if (nrhs > 2 && !mxIsEmpty(prhs[2]) && mxGetScalar(prhs[2]) < count)
+			count = mxGetScalar(prhs[2]) > 0 ? (size_t)mxGetScalar(prhs[2]) : 0;
+		for (size_t ss = 0; ss < count; ss++)
+		{
+			sets.push_back(std::vector<camera_frame>());
+			sets.back().swap(mc->sets.front());
+			mc->sets.pop_front();
+		}
+	}
+
+	// The sets now belong to this call, so they are copied without the lock.
+	size_t count = sets.size();
+	plhs[0] = mxCreateCellMatrix(1, nCameras);
+	for (size_t cc = 0; cc < nCameras; cc++)
+	{
+		capture_camera* cam = mc->cameras[cc].get();
+		size_t framePixels = (size_t)cam->width * cam->height;
+		mwSize outsize[3];
+		outsize[0] = cam->width;
+		outsize[1] = cam->height;
+		outsize[2] = count;
+		mxArray* frames = mxCreateNumericArray(3, outsize, mxUINT16_CLASS, mxREAL);
+		unsigned short* out = (unsigned short*)mxGetData(frames);
+		for (size_t ss = 0; ss < count; ss++)
+			memcpy(out + ss * framePixels, &sets[ss][cc].pixels[0], framePixels * sizeof(unsigned short));
+		mxSetCell(plhs[0], cc, frames);
+	}
+	if (nlhs > 1)
+	{
+		plhs[1] = mxCreateDoubleMatrix(count, nCameras, mxREAL);
+		double* stamps = mxGetPr(plhs[1]);
+		for (size_t cc = 0; cc < nCameras; cc++)
+			for (size_t ss = 0; ss < count; ss++)
+				stamps[cc * count + ss] = sets[ss][cc].timestamp;
+	}
+	if (nlhs > 2)
+	{
+		plhs[2] = mxCreateDoubleMatrix(count, nCameras, mxREAL);
+		double* stamps = mxGetPr(plhs[2]);
+		for (size_t cc = 0; cc < nCameras; cc++)
+			for (size_t ss = 0; ss < count; ss++)
+				stamps[cc * count + ss] = sets[ss][cc].framestamp;
+	}
+
+	std::lock_guard<std::mutex> lk(mc->lock);
+	for (size_t ss = 0; ss < count; ss++)
+		for (size_t cc = 0; cc < nCameras; cc++)
+			recycle(mc->cameras[cc].get(), sets[ss][cc]);
+}
+
+void mexFunction(int nlhs, mxArray* plhs[], int	nrhs, const	mxArray* prhs[])
+{
+	if (nrhs < 2 || !mxIsChar(prhs[1]))
+		mexErrMsgTxt("Proper Usage: DCAM4MultiCapture(cameraHandles,command,...); command is 'start', 'status', 'read', 'stop' or 'clear'.");
+
+	// Grab the inputs from MATLAB.
+	if (!mxIsUint64(prhs[0]) || mxIsEmpty(prhs[0]))
+		mexErrMsgTxt("cameraHandles must be a uint64 vector of camera handles.");
+	unsigned long long* mHandles = (unsigned long long*)mxGetUint64s(prhs[0]);
+	std::vector<HDCAM> handles;
+	for (size_t cc = 0; cc < mxGetNumberOfElements(prhs[0]); cc++)
+		handles.push_back((HDCAM)mHandles[cc]);
+	char command[8];
+	mxGetString(prhs[1], command, sizeof(command));
+
+	if (strcmp(command, "start") == 0)
+	{
+		start_capture(handles, nrhs, prhs);
+		return;
+	}
+	if (strcmp(command, "clear") == 0)
+	{
+		clear_capture(handles);
+		if (g_captures.empty() && mexIsLocked())
+			mexUnlock();
+		return;
+	}
+
+	capture_map::iterator it = g_captures.find(handles);
+	if (it == g_captures.end())
+		mexErrMsgTxt("No capture for these cameras; call DCAM4MultiCapture(cameraHandles,'start',...) first.");
+	multi_capture* mc = it->second.get();
+
+	if (strcmp(command, "status") == 0)
+	{
+		std::lock_guard<std::mutex> lk(mc->lock);
+		plhs[0] = mxCreateDoubleScalar(mc->matched);
+		if (nlhs > 1)
+		{
+			plhs[1] = mxCreateDoubleMatrix(1, mc->cameras.size(), mxREAL);
+			for (size_t cc = 0; cc < mc->cameras.size(); cc++)
+				mxGetPr(plhs[1])[cc] = mc->cameras[cc]->unmatched;
+		}
+		if (nlhs > 2)
+			plhs[2] = mxCreateDoubleScalar((double)mc->sets.size());
+		if (nlhs > 3)
+			plhs[3] = mxCreateString(mc->error.c_str());
+	}
+	else if (strcmp(command, "read") == 0)
+		read_capture(mc, nlhs, plhs, nrhs, prhs);
+	else if (strcmp(command, "stop") == 0)
+		stop_capture(mc);
+	else
+		mexErrMsgTxt("Unknown command; use 'start', 'status', 'read', 'stop' or 'clear'.");
+
+	return;
+}
@@ -22,7 +22,7 @@ void mexFunction(int nlhs, mxArray* plhs[], int	nrhs, const	mxArray* prhs[])
 	error = dcamdev_open(&devopen);
 	if (failed(error))
 	{
-		mexPrintf("Error = 0x%08lX\ndcam_devopen() failed.\n", error);
+		mexPrintf("Error = 0x%08X\ndcam_devopen() failed.\n", error);
 	}
 
 	// Grab some outputs to return to MATLAB.
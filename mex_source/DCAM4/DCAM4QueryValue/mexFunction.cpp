@@ -31,7 +31,7 @@ void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
 	error = dcamprop_queryvalue(handle, iProp, propertyValue, DCAMPROP_OPTION_NEXT);
 	if (failed(error))
 	{
-		mexPrintf("Error = 0x%08lX\ndcamprop_queryvalue() failed.\n", error);
+		mexPrintf("Error = 0x%08X\ndcamprop_queryvalue() failed.\n", error);
 	}
 
 	return;
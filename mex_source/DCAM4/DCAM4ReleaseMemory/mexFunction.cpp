@@ -15,7 +15,7 @@ void mexFunction(int nlhs, mxArray* plhs[], int	nrhs, const	mxArray* prhs[])
 	error = dcambuf_release(handle);
 	if (failed(error))
 	{
-		mexPrintf("Error = 0x%08lX\ndcambuf_release() failed.\n", error);
+		mexPrintf("Error = 0x%08X\ndcambuf_release() failed.\n", error);
 	}
 
 	return;
@@ -0,0 +1,607 @@
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>		// before stdafx.h, which defines min and max
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <new>
+#include <stdio.h>
+#include "stdafx.h"
+#include "unpack.h"
+#include "threadctl.h"
+#include "bufferpool.h"
+
+// DCAM4ScanCube(cameraHandle, 'start', nFrames, bundleFrames, bufferFrames, timeout, fileName, threadOptions)
+// [Slab, First] = DCAM4ScanCube(cameraHandle, 'read', timeout)
+// [Frames, Slabs, Running, Error, Jitter] = DCAM4ScanCube(cameraHandle, 'status')
+// DCAM4ScanCube(cameraHandle, 'stop'), DCAM4ScanCube(cameraHandle, 'clear')
+// Pool = DCAM4ScanCube(cameraHandle, 'pool'), DCAM4ScanCube(cameraHandle, 'release')
+// Assemble the frames of a hyperspectral line scan into a datacube.  Each
+// frame (width = wavelength, height = y) is one scan position; the frames
+// of a bundle of 'bundleFrames' positions are written into a slab laid out
+// as [y, x_scan, wave] (height x bundleFrames x width) while they arrive,
+// with a blocked transpose straight from the capture buffer.  'start' may
+// be called before or after DCAM4StartCapture(); a reader thread then
+// assembles frames until 'nFrames' frames are done or the capture stops.
+// Until the capture is busy or its first frame has arrived, the reader
+// waits for it to begin rather than taking the idle camera as stopped.
+// The last slab holds the remaining frames.  If the 'bufferFrames' ring
+// buffer is overwritten before a frame is assembled, the reader stops and
+// 'Error' says so.  'timeout' (ms) applies to each wait for a frame.
+// Without 'fileName', the completed slabs are kept until 'read' returns
+// them: 'read' waits up to 'timeout' ms (default infinite) for the next
+// slab and returns it with the 1-based index of its first frame; 'Slab' is
+// empty and 'First' 0 if there is none.  With 'fileName', a writer thread
+// stores the slabs in that file as one uint16 cube of height x nFrames x
+// width (column-major, no header), and 'read' returns an empty 'Slab' with
+// the 'First' of the next slab written that was not returned yet.
+// 'threadOptions' (see threadctl.h) places the threads: the reader gets the
+// affinity and priority, the writer only the affinity, and LockMemory locks
+// the slabs in RAM.  'Jitter' reports the intervals between the waits of
+// the reader (see create_jitter_output()).  The assemblers stay in memory
+// (mexLock) until they are cleared for all cameras.
+// The slabs come from a pool of pre-faulted buffers that is kept for the
+// next scan (see bufferpool.h); 'pool' returns its statistics and 'release'
+// frees the slabs that no assembler is using.
+
+// Tile of the transpose; 64 x 64 16-bit pixels stay in the L1 cache.
+#define TILE 64
+
+struct cube_slab
+{
+	int32 first, count;
+	pool_array<unsigned short> pixels;
+};
+
+struct scan_cube
+{
+	HDCAM handle;
+	HDCAMWAIT hwait;
+	int32 width, height, pixeltype;
+	int32 nFrames, bundleFrames, bufferFrames, timeout;
+	FILE* file;
+
+	std::mutex lock;
+	std::condition_variable changed;	// slabs or state changed
+	std::deque<cube_slab> ready;
+	std::vector<pool_array<unsigned short> > free;
+	int32 nAssembled, nSlabs, nWritten, nReported;
+	bool stop, reading, writing;
+	std::string error;
+
+	thread_policy policy;
+	thread_jitter jitter;
+	std::vector<unsigned short*> locked;	// slabs locked in RAM
+
+	std::thread reader;
+	std::thread writer;
+};
+
+static std::map<HDCAM, std::unique_ptr<scan_cube> > g_cubes;
+
+// Writes rows y0 to y0+rows-1 of a frame into scan position 'pos' of a
+// slab; 'src' points to row y0 and rows are 'stride' pixels apart.
+static void transpose_rows(const unsigned short* src, size_t stride, int32 y0, int32 rows,
+	int32 width, int32 height, int32 bundleFrames, int32 pos, unsigned short* slab)
+{
+	size_t plane = (size_t)height * bundleFrames;
+	for (int32 w0 = 0; w0 < width; w0 += TILE)
+	{
+		int32 w1 = w0 + TILE < width ? w0 + TILE : width;
+		for (int32 ww = w0; ww < w1; ww++)
+		{
+			unsigned short* dst = slab + plane * ww + (size_t)height * pos + y0;
+			const unsigned short* col = src + ww;
+			for (int32 yy = 0; yy < rows; yy++)
+				dst[yy] = col[yy * stride];
+		}
+	}
+}
+
+// Transposes frame 'iFrame' of the capture buffer into a slab.  16-bit
+// frames are read in place; packed frames are unpacked one tile of rows at
+// a time into 'rows'.
+static DCAMERR assemble_frame(scan_cube* sc, int32 iFrame, int32 pos, unsigned short* slab,
+	std::vector<unsigned short>& rows)
+{
+	DCAMBUF_FRAME locked;
+	memset(&locked, 0, sizeof(locked));
+	locked.size = sizeof(locked);
+	locked.iFrame = iFrame;
+	DCAMERR err = dcambuf_lockframe(sc->handle, &locked);
+	if (failed(err))
+		return err;
+
+	const unsigned char* src = (const unsigned char*)locked.buf;
+	for (int32 y0 = 0; y0 < sc->height; y0 += TILE)
+	{
+		int32 nRows = y0 + TILE < sc->height ? TILE : sc->height - y0;
+		const unsigned char* row = src + (size_t)y0 * locked.rowbytes;
+		if (sc->pixeltype == DCAM_PIXELTYPE_MONO16)
+		{
+			transpose_rows((const unsigned short*)row, locked.rowbytes / sizeof(unsigned short),
+				y0, nRows, sc->width, sc->height, sc->bundleFrames, pos, slab);
+			continue;
+		}
+		for (int32 yy = 0; yy < nRows; yy++)
+		{
+			if (sc->pixeltype == DCAM_PIXELTYPE_MONO12)
+				unpack_mono12(row, &rows[(size_t)yy * sc->width], sc->width);
+			else
+				unpack_mono12p(row, &rows[(size_t)yy * sc->width], sc->width);
+			row += locked.rowbytes;
+		}
+		transpose_rows(&rows[0], sc->width, y0, nRows, sc->width, sc->height,
+			sc->bundleFrames, pos, slab);
+	}
+	return DCAMERR_SUCCESS;
+}
+
+// Packs the 'count' scan positions of a partial slab, so that it is
+// height x count x width.
+static void pack_slab(scan_cube* sc, cube_slab& slab)
+{
+	size_t column = (size_t)sc->height * slab.count;
+	size_t plane = (size_t)sc->height * sc->bundleFrames;
+	for (int32 ww = 1; ww < sc->width; ww++)
+		memmove(&slab.pixels[column * ww], &slab.pixels[plane * ww], column * sizeof(unsigned short));
+}
+
+static bool capture_busy(HDCAM handle)
+{
+	int32 status = DCAMCAP_STATUS_ERROR;
+	if (failed(dcamcap_status(handle, &status)))
+		return false;
+	return status == DCAMCAP_STATUS_BUSY;
+}
+
+// Assembles the new frames of the capture buffer into slabs.
+static void read_frames(scan_cube* sc)
+{
+	DCAMWAIT_START waitstart;
+	memset(&waitstart, 0, sizeof(waitstart));
+	waitstart.size = sizeof(waitstart);
+	waitstart.eventmask = DCAMWAIT_CAPEVENT_FRAMEREADY | DCAMWAIT_CAPEVENT_STOPPED;
+	waitstart.timeout = sc->timeout;
+	DCAMCAP_TRANSFERINFO transferInfo;
+	memset(&transferInfo, 0, sizeof(transferInfo));
+	transferInfo.size = sizeof(transferInfo);
+
+	size_t slabPixels = (size_t)sc->height * sc->bundleFrames * sc->width;
+	std::vector<unsigned short> rows;
+	if (sc->pixeltype != DCAM_PIXELTYPE_MONO16)
+		rows.resize((size_t)TILE * sc->width);
+	cube_slab slab;
+	slab.first = 0;
+	slab.count = 0;
+
+	jitter_reset(sc->jitter, apply_thread_policy(sc->policy));
+	std::string error;
+	int32 assembled = 0;
+	bool done = false, started = false;
+	while (!done && error.empty())
+	{
+		jitter_tick(sc->jitter);
+		// The capture may have stopped after the last transfer info.
+		bool busy = capture_busy(sc->handle);
+		DCAMERR err = dcamcap_transferinfo(sc->handle, &transferInfo);
+		if (failed(err))
+		{
+			// There may be no transfer info before the capture starts.
+			if (started || busy)
+			{
+				error = "dcamcap_transferinfo() failed.";
+				break;
+			}
+			transferInfo.nFrameCount = 0;
+		}
+		started = started || busy || transferInfo.nFrameCount > 0;
+		bool stopped = started && !busy;
+		// A snap capture fills the buffer exactly once.
+		if (transferInfo.nFrameCount - assembled > sc->bufferFrames)
+		{
+			error = "the camera buffer was overwritten before the frames were assembled; use a larger buffer.";
+			break;
+		}
+
+		for (; assembled < transferInfo.nFrameCount && assembled < sc->nFrames; assembled++)
+		{
+			if (slab.count == 0)
+			{
+				std::lock_guard<std::mutex> lk(sc->lock);
+				if (sc->stop)
+					break;
+				if (!sc->free.empty())
+				{
+					slab.pixels.swap(sc->free.back());
+					sc->free.pop_back();
+				}
+				slab.first = assembled;
+			}
+			// The buffer is allocated outside the lock.
+			if (slab.pixels.empty())
+			{
+				try
+				{
+					slab.pixels.resize(slabPixels);
+				}
+				catch (const std::bad_alloc&)
+				{
+					error = "a slab could not be allocated.";
+					break;
+				}
+				if (lock_buffer(sc->policy, &slab.pixels[0], slabPixels * sizeof(unsigned short))
+					&& sc->policy.lockMemory)
+				{
+					std::lock_guard<std::mutex> lk(sc->lock);
+					sc->locked.push_back(&slab.pixels[0]);
+				}
+			}
+			if (failed(assemble_frame(sc, assembled % sc->bufferFrames, slab.count, &slab.pixels[0], rows)))
+			{
+				error = "dcambuf_lockframe() failed.";
+				break;
+			}
+			slab.count++;
+
+			bool last = assembled + 1 == sc->nFrames;
+			std::lock_guard<std::mutex> lk(sc->lock);
+			sc->nAssembled = assembled + 1;
+			if (slab.count == sc->bundleFrames || last)
+			{
+				if (slab.count < sc->bundleFrames)
+					pack_slab(sc, slab);
+				sc->ready.push_back(cube_slab());
+				sc->ready.back().first = slab.first;
+				sc->ready.back().count = slab.count;
+				sc->ready.back().pixels.swap(slab.pixels);
+				sc->nSlabs++;
+				slab.count = 0;
+			}
+			sc->changed.notify_all();
+		}
+		if (!error.empty())
+			break;
+
+		{
+			std::lock_guard<std::mutex> lk(sc->lock);
+			done = sc->stop;
+		}
+		if (done || assembled >= sc->nFrames || stopped)
+			break;
+
+		err = dcamwait_start(sc->hwait, &waitstart);
+		if (failed(err) && err != DCAMERR_TIMEOUT)
+		{
+			if (err == DCAMERR_ABORT)
+				break;
+			if (started)
+			{
+				error = "dcamwait_start() failed.";
+				break;
+			}
+			// The wait may fail until the capture starts.
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+	}
+
+	// The frames of a scan that ended early form the last slab.
+	std::lock_guard<std::mutex> lk(sc->lock);
+	if (slab.count > 0 && !sc->stop)
+	{
+		if (slab.count < sc->bundleFrames)
+			pack_slab(sc, slab);
+		sc->ready.push_back(cube_slab());
+		sc->ready.back().first = slab.first;
+		sc->ready.back().count = slab.count;
+		sc->ready.back().pixels.swap(slab.pixels);
+		sc->nSlabs++;
+	}
+	else if (!slab.pixels.empty())
+	{
+		// Keep a locked slab until the assembler is cleared.
+		sc->free.push_back(pool_array<unsigned short>());
+		sc->free.back().swap(slab.pixels);
+	}
+	sc->error = error;
+	sc->reading = false;
+	sc->changed.notify_all();
+}
+
+static bool seek_file(FILE* fp, long long offset)
+{
+#ifdef _MSC_VER
+	return _fseeki64(fp, offset, SEEK_SET) == 0;
+#else
+	return fseeko(fp, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+// Writes the completed slabs into the cube file.
+static void write_slabs(scan_cube* sc)
+{
+	thread_policy affinity = sc->policy;
+	affinity.priority = THREAD_PRIORITY_LEVEL_NORMAL;
+	apply_thread_policy(affinity);
+	long long column = (long long)sc->height * sizeof(unsigned short);
+	for (;;)
+	{
+		cube_slab slab;
+		{
+			std::unique_lock<std::mutex> lk(sc->lock);
+			sc->changed.wait(lk, [sc] { return !sc->ready.empty() || !sc->reading || sc->stop; });
+			if (sc->ready.empty() || sc->stop)
+				break;
+			slab.first = sc->ready.front().first;
+			slab.count = sc->ready.front().count;
+			slab.pixels.swap(sc->ready.front().pixels);
+			sc->ready.pop_front();
+		}
+
+		// Each wavelength of the slab is a contiguous run of the cube.
+		bool ok = true;
+		for (int32 ww = 0; ok && ww < sc->width; ww++)
+		{
+			long long offset = column * ((long long)sc->nFrames * ww + slab.first);
+			size_t pixels = (size_t)sc->height * slab.count;
+			ok = seek_file(sc->file, offset)
+				&& fwrite(&slab.pixels[pixels * ww], sizeof(unsigned short), pixels, sc->file) == pixels;
+		}
+
+		std::lock_guard<std::mutex> lk(sc->lock);
+		sc->free.push_back(pool_array<unsigned short>());
+		sc->free.back().swap(slab.pixels);
+		sc->nWritten++;
+		if (!ok)
+		{
+			if (sc->error.empty())
+				sc->error = "the datacube could not be written.";
+			sc->stop = true;
+		}
+		sc->changed.notify_all();
+	}
+	// The file stays open until the assembler is stopped or cleared.
+	fflush(sc->file);
+	std::lock_guard<std::mutex> lk(sc->lock);
+	sc->writing = false;
+	sc->changed.notify_all();
+}
+
+static void stop_cube(scan_cube* sc)
+{
+	{
+		std::lock_guard<std::mutex> lk(sc->lock);
+		sc->stop = true;
+		sc->changed.notify_all();
+	}
+	if (sc->hwait != NULL)
+		dcamwait_abort(sc->hwait);
+	if (sc->reader.joinable())
+		sc->reader.join();
+	if (sc->writer.joinable())
+		sc->writer.join();
+	if (sc->hwait != NULL)
+		dcamwait_close(sc->hwait);
+	sc->hwait = NULL;
+	if (sc->file != NULL)
+		fclose(sc->file);
+	sc->file = NULL;
+}
+
+static void clear_cube(HDCAM handle)
+{
+	std::map<HDCAM, std::unique_ptr<scan_cube> >::iterator it = g_cubes.find(handle);
+	if (it == g_cubes.end())
+		return;
+	scan_cube* sc = it->second.get();
+	stop_cube(sc);
+	size_t slabBytes = (size_t)sc->height * sc->bundleFrames * sc->width * sizeof(unsigned short);
+	for (size_t ii = 0; ii < sc->locked.size(); ii++)
+		unlock_buffer(sc->policy, sc->locked[ii], slabBytes);
+	g_cubes.erase(it);
+}
+
+static void Cleanup(void)
+{
+	while (!g_cubes.empty())
+		clear_cube(g_cubes.begin()->first);
+}
+
+static void start_cube(HDCAM handle, int nrhs, const mxArray* prhs[])
+{
+	if (nrhs < 6 || nrhs > 8)
+		mexErrMsgTxt("Proper Usage: DCAM4ScanCube(cameraHandle,'start',nFrames,bundleFrames,bufferFrames,timeout,fileName,threadOptions)");
+	int32 nFrames = (int32)mxGetScalar(prhs[2]);
+	int32 bundleFrames = (int32)mxGetScalar(prhs[3]);
+	int32 bufferFrames = (int32)mxGetScalar(prhs[4]);
+	if (nFrames < 1 || bundleFrames < 1 || bufferFrames < 1)
+		mexErrMsgTxt("nFrames, bundleFrames and bufferFrames must be positive.");
+	if (bundleFrames > nFrames)
+		bundleFrames = nFrames;
+	thread_policy policy;
+	get_thread_policy(nrhs > 7 ? prhs[7] : NULL, policy);
+
+	double width, height;
+	if (failed(dcamprop_getvalue(handle, DCAM_IDPROP_IMAGE_WIDTH, &width))
+		|| failed(dcamprop_getvalue(handle, DCAM_IDPROP_IMAGE_HEIGHT, &height)))
+		mexErrMsgTxt("the image size could not be read.");
+	int32 pixeltype = get_pixeltype(handle);
+	if (pixeltype != DCAM_PIXELTYPE_MONO16 && pixeltype != DCAM_PIXELTYPE_MONO12
+		&& pixeltype != DCAM_PIXELTYPE_MONO12P)
+		mexErrMsgTxt("the pixel type of the camera is not supported.");
+
+	clear_cube(handle);
+	FILE* file = NULL;
+	if (nrhs > 6 && mxIsChar(prhs[6]) && !mxIsEmpty(prhs[6]))
+	{
+		char* fileName = mxArrayToString(prhs[6]);
+		file = fopen(fileName, "wb");
+		mxFree(fileName);
+		if (file == NULL)
+			mexErrMsgTxt("the datacube file could not be opened.");
+	}
+
+	std::unique_ptr<scan_cube> sc(new scan_cube);
+	sc->handle = handle;
+	sc->hwait = NULL;
+	sc->width = (int32)width;
+	sc->height = (int32)height;
+	sc->pixeltype = pixeltype;
+	sc->nFrames = nFrames;
+	sc->bundleFrames = bundleFrames;
+	sc->bufferFrames = bufferFrames;
+	sc->timeout = (int32)mxGetScalar(prhs[5]);
+	sc->file = file;
+	sc->nAssembled = sc->nSlabs = sc->nWritten = sc->nReported = 0;
+	sc->stop = false;
+	sc->reading = true;
+	sc->writing = file != NULL;
+	sc->policy = policy;
+	jitter_reset(sc->jitter, false);
+
+	DCAMWAIT_OPEN waitopen;
+	memset(&waitopen, 0, sizeof(waitopen));
+	waitopen.size = sizeof(waitopen);
+	waitopen.hdcam = handle;
+	DCAMERR error = dcamwait_open(&waitopen);
+	if (failed(error))
+	{
+		if (file != NULL)
+			fclose(file);
+		mexErrMsgIdAndTxt("DCAM4ScanCube:dcamError", "Error = 0x%08X\ndcamwait_open() failed.", error);
+	}
+	sc->hwait = waitopen.hwait;
+
+	if (g_cubes.empty())
+	{
+		mexLock();
+		mexAtExit(Cleanup);
+	}
+	scan_cube* p = sc.get();
+	g_cubes[handle] = std::move(sc);
+	if (p->file != NULL)
+		p->writer = std::thread(write_slabs, p);
+	p->reader = std::thread(read_frames, p);
+}
+
+static void read_cube(scan_cube* sc, int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
+{
+	double timeout = nrhs > 2 && !mxIsEmpty(prhs[2]) ? mxGetScalar(prhs[2]) : -1;
+	std::unique_lock<std::mutex> lk(sc->lock);
+	int32 first = 0;
+	if (sc->file != NULL)
+	{
+		// Wait for the next slab written to the file.
+		auto written = [sc] { return sc->nWritten > sc->nReported || !sc->writing; };
+		if (timeout < 0)
+			sc->changed.wait(lk, written);
+		else
+			sc->changed.wait_for(lk, std::chrono::milliseconds((long long)timeout), written);
+		if (sc->nWritten > sc->nReported)
+			first = sc->nReported++ * sc->bundleFrames + 1;
+		plhs[0] = mxCreateNumericMatrix(0, 0, mxUINT16_CLASS, mxREAL);
+		if (nlhs > 1)
+			plhs[1] = mxCreateDoubleScalar(first);
+		return;
+	}
+
+	auto ready = [sc] { return !sc->ready.empty() || !sc->reading; };
+	if (timeout < 0)
+		sc->changed.wait(lk, ready);
+	else
+		sc->changed.wait_for(lk, std::chrono::milliseconds((long long)timeout), ready);
+	if (sc->ready.empty())
+	{
+		plhs[0] = mxCreateNumericMatrix(0, 0, mxUINT16_CLASS, mxREAL);
+		if (nlhs > 1)
+			plhs[1] = mxCreateDoubleScalar(0);
+		return;
+	}
+	cube_slab slab;
+	slab.first = sc->ready.front().first;
+	slab.count = sc->ready.front().count;
+	slab.pixels.swap(sc->ready.front().pixels);
+	sc->ready.pop_front();
+	lk.unlock();
+
+	mwSize outsize[3];
+	outsize[0] = sc->height;
+	outsize[1] = slab.count;
+	outsize[2] = sc->width;
+	plhs[0] = mxCreateUninitNumericArray(3, outsize, mxUINT16_CLASS, mxREAL);
+	memcpy(mxGetData(plhs[0]), &slab.pixels[0],
+		(size_t)sc->height * slab.count * sc->width * sizeof(unsigned short));
+	if (nlhs > 1)
+		plhs[1] = mxCreateDoubleScalar(slab.first + 1);
+
+	lk.lock();
+	sc->free.push_back(pool_array<unsigned short>());
+	sc->free.back().swap(slab.pixels);
+}
+
+void mexFunction(int nlhs, mxArray* plhs[], int	nrhs, const	mxArray* prhs[])
+{
+	if (nrhs < 2 || !mxIsChar(prhs[1]))
+		mexErrMsgTxt("Proper Usage: DCAM4ScanCube(cameraHandle,command,...); command is 'start', 'read', 'status', 'stop', 'clear', 'pool' or 'release'.");
+
+	// Grab the inputs from MATLAB.
+	unsigned long* mHandle;
+	HDCAM handle;
+	mHandle = (unsigned long*)mxGetUint64s(prhs[0]);
+	handle = (HDCAM)mHandle[0];
+	char command[8];
+	mxGetString(prhs[1], command, sizeof(command));
+
+	if (strcmp(command, "start") == 0)
+	{
+		start_cube(handle, nrhs, prhs);
+		return;
+	}
+	if (strcmp(command, "clear") == 0)
+	{
+		clear_cube(handle);
+		if (g_cubes.empty() && mexIsLocked())
+			mexUnlock();
+		return;
+	}
+	if (strcmp(command, "pool") == 0)
+	{
+		plhs[0] = create_pool_output();
+		return;
+	}
+	if (strcmp(command, "release") == 0)
+	{
+		pool_release();
+		return;
+	}
+
+	std::map<HDCAM, std::unique_ptr<scan_cube> >::iterator it = g_cubes.find(handle);
+	if (it == g_cubes.end())
+		mexErrMsgTxt("No scan cube for this camera; call DCAM4ScanCube(cameraHandle,'start',...) first.");
+	scan_cube* sc = it->second.get();
+
+	if (strcmp(command, "read") == 0)
+		read_cube(sc, nlhs, plhs, nrhs, prhs);
+	else if (strcmp(command, "status") == 0)
+	{
+		std::lock_guard<std::mutex> lk(sc->lock);
+		plhs[0] = mxCreateDoubleScalar(sc->nAssembled);
+		if (nlhs > 1)
+			plhs[1] = mxCreateDoubleScalar(sc->nSlabs);
+		if (nlhs > 2)
+			plhs[2] = mxCreateLogicalScalar(sc->reading || sc->writing);
+		if (nlhs > 3)
+			plhs[3] = mxCreateString(sc->error.c_str());
+		if (nlhs > 4)
+			plhs[4] = create_jitter_output(sc->jitter);
+	}
+	else if (strcmp(command, "stop") == 0)
+		stop_cube(sc);
+	else
+		mexErrMsgTxt("Unknown command; use 'start', 'read', 'status', 'stop', 'clear', 'pool' or 'release'.");
+
+	return;
+}
@@ -21,7 +21,7 @@ void mexFunction(int nlhs, mxArray* plhs[], int	nrhs, const	mxArray* prhs[])
 	error = dcamprop_setvalue(handle, propertyID, propertyValue);
 	if (failed(error))
 	{
-		mexPrintf("Error = 0x%08lX\ndcamprop_setvalue() failed.\n", error);
+		mexPrintf("Error = 0x%08X\ndcamprop_setvalue() failed.\n", error);
 	}
 
 	return;
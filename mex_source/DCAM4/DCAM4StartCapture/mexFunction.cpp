@@ -18,7 +18,7 @@ void mexFunction(int nlhs, mxArray* plhs[], int	nrhs, const	mxArray* prhs[])
 	error = dcamcap_start(handle, mode);
 	if (failed(error))
 	{
-		mexPrintf("Error = 0x%08lX\ndcamcap_start() failed.\n", error);
+		mexPrintf("Error = 0x%08X\ndcamcap_start() failed.\n", error);
 	}
 
 	return;
@@ -21,7 +21,7 @@ void mexFunction(int nlhs, mxArray* plhs[],	int	nrhs, const	mxArray* prhs[])
 	error = dcamcap_status((HDCAM)handle, pStatus);
 	if (failed(error))
 	{
-		mexPrintf("Error = 0x%08lX\ndcamcap_status() failed.\n", error);
+		mexPrintf("Error = 0x%08X\ndcamcap_status() failed.\n", error);
 	}
 
 	return;
@@ -15,7 +15,7 @@ void mexFunction(int nlhs, mxArray* plhs[], int	nrhs, const	mxArray* prhs[])
 	error = dcamcap_stop(handle);
 	if (failed(error))
 	{
-		mexPrintf("Error = 0x%08lX\ndcamcap_stop() failed.\n", error);
+		mexPrintf("Error = 0x%08X\ndcamcap_stop() failed.\n", error);
 	}
 
 	return;
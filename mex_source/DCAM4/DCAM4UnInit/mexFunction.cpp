@@ -9,7 +9,7 @@ void mexFunction(int nlhs, mxArray* plhs[], int	nrhs, const	mxArray* prhs[])
 	error = dcamapi_uninit();
 	if (failed(error))
 	{
-		mexPrintf("Error = 0x%08lX\ndcamapi_uninit() failed.\n", error);
+		mexPrintf("Error = 0x%08X\ndcamapi_uninit() failed.\n", error);
 	}
 
 	return;
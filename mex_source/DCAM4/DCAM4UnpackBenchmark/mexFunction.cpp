@@ -0,0 +1,81 @@
+#include <chrono>	// before stdafx.h, which defines min and max
+#include <vector>
+#include "stdafx.h"
+#include "unpack.h"
+
+// [Results] = DCAM4UnpackBenchmark(width, height, nFrames)
+// Time the copy of a synthetic 'width' by 'height' frame 'nFrames' times
+// as plain 16-bit data (memcpy) and as MONO12 and MONO12P data unpacked by
+// the scalar and AVX2 kernels used by the DCAM4Copy* functions.  'Results'
+// has the time per frame (s) of each copy, whether AVX2 is available and
+// the number of pixels where the AVX2 and scalar kernels disagree.
+
+typedef void (*unpack_fn)(const unsigned char* src, unsigned short* dst, int32 count);
+
+static double time_unpack(unpack_fn unpack, const std::vector<unsigned char>& packed,
+	std::vector<unsigned short>& out, int32 width, int32 height, int32 rowbytes, int32 nFrames)
+{
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	for (int32 ff = 0; ff < nFrames; ff++)
+		for (int32 yy = 0; yy < height; yy++)
+			unpack(&packed[(size_t)yy * rowbytes], &out[(size_t)yy * width], width);
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() / nFrames;
+}
+
+void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
+{
+	if (nrhs != 3)
+		mexErrMsgTxt("Proper Usage: [Results]=DCAM4UnpackBenchmark(width,height,nFrames)");
+	int32 width = (int32)mxGetScalar(prhs[0]);
+	int32 height = (int32)mxGetScalar(prhs[1]);
+	int32 nFrames = (int32)mxGetScalar(prhs[2]);
+	if (width < 2 || height < 1 || nFrames < 1)
+		mexErrMsgTxt("width must be at least 2, height and nFrames at least 1.");
+
+	// Synthetic frames: 16-bit pixels and a packed frame with 12-bit rows.
+	size_t pixels = (size_t)width * height;
+	int32 rowbytes = (width * 3 + 1) / 2;
+	std::vector<unsigned short> frame16(pixels);
+	std::vector<unsigned char> packed((size_t)rowbytes * height);
+	for (size_t ii = 0; ii < pixels; ii++)
+		frame16[ii] = (unsigned short)((ii * 2654435761u) >> 20);
+	for (size_t ii = 0; ii < packed.size(); ii++)
+		packed[ii] = (unsigned char)((ii * 2246822519u) >> 24);
+	std::vector<unsigned short> out(pixels), ref(pixels);
+
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	for (int32 ff = 0; ff < nFrames; ff++)
+		memcpy(&out[0], &frame16[0], pixels * sizeof(unsigned short));
+	double copy16 = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() / nFrames;
+
+	bool avx2 = cpu_has_avx2();
+	double mono12[2] = { 0, 0 }, mono12p[2] = { 0, 0 };
+	double mismatch = 0;
+	mono12[0] = time_unpack(unpack_mono12_scalar, packed, ref, width, height, rowbytes, nFrames);
+	if (avx2)
+	{
+		mono12[1] = time_unpack(unpack_mono12_avx2, packed, out, width, height, rowbytes, nFrames);
+		for (size_t ii = 0; ii < pixels; ii++)
+			mismatch += out[ii] != ref[ii];
+	}
+	mono12p[0] = time_unpack(unpack_mono12p_scalar, packed, ref, width, height, rowbytes, nFrames);
+	if (avx2)
+	{
+		mono12p[1] = time_unpack(unpack_mono12p_avx2, packed, out, width, height, rowbytes, nFrames);
+		for (size_t ii = 0; ii < pixels; ii++)
+			mismatch += out[ii] != ref[ii];
+	}
+
+	const char* fields[] = { "Copy16", "Mono12Scalar", "Mono12AVX2", "Mono12PScalar",
+		"Mono12PAVX2", "AVX2", "Mismatch" };
+	plhs[0] = mxCreateStructMatrix(1, 1, 7, fields);
+	mxSetFieldByNumber(plhs[0], 0, 0, mxCreateDoubleScalar(copy16));
+	mxSetFieldByNumber(plhs[0], 0, 1, mxCreateDoubleScalar(mono12[0]));
+	mxSetFieldByNumber(plhs[0], 0, 2, avx2 ? mxCreateDoubleScalar(mono12[1]) : mxCreateDoubleMatrix(0, 0, mxREAL));
+	mxSetFieldByNumber(plhs[0], 0, 3, mxCreateDoubleScalar(mono12p[0]));
+	mxSetFieldByNumber(plhs[0], 0, 4, avx2 ? mxCreateDoubleScalar(mono12p[1]) : mxCreateDoubleMatrix(0, 0, mxREAL));
+	mxSetFieldByNumber(plhs[0], 0, 5, mxCreateLogicalScalar(avx2));
+	mxSetFieldByNumber(plhs[0], 0, 6, mxCreateDoubleScalar(mismatch));
+
+	return;
+}
@@ -0,0 +1,63 @@
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define FMA_TARGET
+#else
+#define FMA_TARGET __attribute__((target("avx2,fma")))
+#endif
+#include "stdafx.h"
+#include "unpack.h"
+#include "calibrate.h"
+
+void calibration_maps(const float* offset, const float* gain, float* invgain, float* bias, size_t count)
+{
+	for (size_t ii = 0; ii < count; ii++)
+	{
+		invgain[ii] = gain[ii] > 0 ? 1.0f / gain[ii] : 0.0f;
+		bias[ii] = -offset[ii] * invgain[ii];
+	}
+}
+
+bool cpu_has_fma()
+{
+	static int has = -1;
+	if (has < 0)
+	{
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 1);
+		has = cpu_has_avx2() && (info[2] & (1 << 12)) != 0;
+#else
+		has = cpu_has_avx2() && __builtin_cpu_supports("fma") ? 1 : 0;
+#endif
+	}
+	return has == 1;
+}
+
+void calibrate_row_scalar(const unsigned short* src, const float* invgain, const float* bias, float* dst, int32 count)
+{
+	for (int32 ii = 0; ii < count; ii++)
+		dst[ii] = src[ii] * invgain[ii] + bias[ii];
+}
+
+FMA_TARGET void calibrate_row_fma(const unsigned short* src, const float* invgain, const float* bias, float* dst, int32 count)
+{
+	int32 ii = 0;
+	for (; ii + 16 <= count; ii += 16)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i*)(src + ii));
+		__m256 lo = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(v)));
+		__m256 hi = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(v, 1)));
+		_mm256_storeu_ps(dst + ii, _mm256_fmadd_ps(lo, _mm256_loadu_ps(invgain + ii), _mm256_loadu_ps(bias + ii)));
+		_mm256_storeu_ps(dst + ii + 8, _mm256_fmadd_ps(hi, _mm256_loadu_ps(invgain + ii + 8), _mm256_loadu_ps(bias + ii + 8)));
+	}
+	calibrate_row_scalar(src + ii, invgain + ii, bias + ii, dst + ii, count - ii);
+}
+
+void calibrate_row(const unsigned short* src, const float* invgain, const float* bias, float* dst, int32 count)
+{
+	if (cpu_has_fma())
+		calibrate_row_fma(src, invgain, bias, dst, count);
+	else
+		calibrate_row_scalar(src, invgain, bias, dst, count);
+}
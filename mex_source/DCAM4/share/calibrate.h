@@ -0,0 +1,17 @@
+#pragma once
+// Conversion of 16-bit pixels to photoelectrons with per-pixel sCMOS
+// offset and gain maps:  e = (raw - offset) / gain.  The maps are kept as
+// invgain = 1/gain and bias = -offset/gain, so each pixel takes one
+// multiply-add,  e = raw * invgain + bias.
+// The AVX2/FMA kernel is used when the CPU supports it.
+
+//set invgain and bias from count offset (ADU) and gain (ADU/e-) values
+void calibration_maps(const float* offset, const float* gain, float* invgain, float* bias, size_t count);
+
+//convert count pixels from src to dst
+void calibrate_row(const unsigned short* src, const float* invgain, const float* bias, float* dst, int32 count);
+
+//the kernels behind calibrate_row()
+bool cpu_has_fma();
+void calibrate_row_scalar(const unsigned short* src, const float* invgain, const float* bias, float* dst, int32 count);
+void calibrate_row_fma(const unsigned short* src, const float* invgain, const float* bias, float* dst, int32 count);
@@ -0,0 +1,106 @@
+#include <vector>
+#include "stdafx.h"
+#include "framecodec.h"
+
+// Residuals wrap around modulo 2^16, so every difference fits in 16 bits.
+// The sign mask is formed in unsigned arithmetic, as shifting a negative
+// value is undefined.
+static inline unsigned short zigzag(unsigned short d)
+{
+	unsigned int u = d;
+	return (unsigned short)((u << 1) ^ (0u - (u >> 15)));
+}
+
+static inline unsigned short unzigzag(unsigned short z)
+{
+	unsigned int u = z;
+	return (unsigned short)((u >> 1) ^ (0u - (u & 1u)));
+}
+
+void encode_frame(const unsigned short* src, int32 width, int32 height, std::vector<unsigned char>& out)
+{
+	size_t count = (size_t)width * height;
+	size_t blocks = (count + CODEC_BLOCK - 1) / CODEC_BLOCK;
+	std::vector<unsigned short> res(blocks * CODEC_BLOCK, 0);
+	for (int32 yy = 0; yy < height; yy++)
+	{
+		const unsigned short* row = src + (size_t)yy * width;
+		unsigned short* r = &res[(size_t)yy * width];
+		r[0] = zigzag((unsigned short)(row[0] - (yy > 0 ? row[-width] : 0)));
+		for (int32 xx = 1; xx < width; xx++)
+			r[xx] = zigzag((unsigned short)(row[xx] - row[xx - 1]));
+	}
+
+	out.resize(blocks * (1 + 4 * 16));
+	unsigned char* dst = &out[0];
+	for (size_t bb = 0; bb < blocks; bb++)
+	{
+		const unsigned short* r = &res[bb * CODEC_BLOCK];
+		unsigned int bits = 0;
+		for (int kk = 0; kk < CODEC_BLOCK; kk++)
+			bits |= r[kk];
+		int width_b = 0;
+		while (bits >> width_b)
+			width_b++;
+		*dst++ = (unsigned char)width_b;
+
+		// 32 values of b bits are exactly 4*b bytes.
+		unsigned long long acc = 0;
+		int nacc = 0;
+		for (int kk = 0; kk < CODEC_BLOCK; kk++)
+		{
+			acc |= (unsigned long long)r[kk] << nacc;
+			nacc += width_b;
+			while (nacc >= 8)
+			{
+				*dst++ = (unsigned char)acc;
+				acc >>= 8;
+				nacc -= 8;
+			}
+		}
+	}
+	out.resize(dst - &out[0]);
+}
+
+bool decode_frame(const unsigned char* src, size_t size, int32 width, int32 height, unsigned short* dst)
+{
+	size_t count = (size_t)width * height;
+	size_t blocks = (count + CODEC_BLOCK - 1) / CODEC_BLOCK;
+	const unsigned char* end = src + size;
+	unsigned short r[CODEC_BLOCK];
+	for (size_t bb = 0; bb < blocks; bb++)
+	{
+		if (src >= end)
+			return false;
+		int width_b = *src++;
+		if (width_b > 16 || end - src < 4 * width_b)
+			return false;
+		unsigned long long acc = 0;
+		int nacc = 0;
+		unsigned int mask = (1u << width_b) - 1;
+		for (int kk = 0; kk < CODEC_BLOCK; kk++)
+		{
+			while (nacc < width_b)
+			{
+				acc |= (unsigned long long)*src++ << nacc;
+				nacc += 8;
+			}
+			r[kk] = (unsigned short)(acc & mask);
+			acc >>= width_b;
+			nacc -= width_b;
+		}
+		size_t n = count - bb * CODEC_BLOCK < CODEC_BLOCK ? count - bb * CODEC_BLOCK : CODEC_BLOCK;
+		for (size_t kk = 0; kk < n; kk++)
+			dst[bb * CODEC_BLOCK + kk] = r[kk];
+	}
+
+	// Undo the prediction.
+	for (int32 yy = 0; yy < height; yy++)
+	{
+		unsigned short* row = dst + (size_t)yy * width;
+		row[0] = (unsigned short)(unzigzag(row[0]) + (yy > 0 ? row[-width] : 0));
+		for (int32 xx = 1; xx < width; xx++)
+			row[xx] = (unsigned short)(unzigzag(row[xx]) + row[xx - 1]);
+	}
+	return true;
+}
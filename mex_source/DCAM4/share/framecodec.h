@@ -0,0 +1,17 @@
+#pragma once
+// Lossless compression of 16-bit frames.  Each pixel is predicted from its
+// left neighbour (the first pixel of a row from the pixel above) and the
+// residuals, zigzag coded to small unsigned values, are bit-packed in
+// blocks of 32: one byte with the bit width b of the block, then 4*b bytes.
+// Smooth or sparse frames (background plus a few emitters) need only a few
+// bits per pixel.  Frames are coded independently, so any frame can be
+// decoded on its own.  Include after stdafx.h and <vector>.
+
+#define CODEC_BLOCK	32
+
+//compress a width x height frame; out is resized to the coded size
+void encode_frame(const unsigned short* src, int32 width, int32 height, std::vector<unsigned char>& out);
+
+//decompress a frame coded by encode_frame() to width*height pixels
+//result is false if the data is too short
+bool decode_frame(const unsigned char* src, size_t size, int32 width, int32 height, unsigned short* dst);
@@ -0,0 +1,244 @@
+#include <vector>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define AVX2_TARGET
+#else
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#include "stdafx.h"
+#include "unpack.h"
+#include "framestats.h"
+
+static const char* stats_names[] = { "Sum", "Max", "CentroidX", "CentroidY", "Brenner", "Variance", "Saturated" };
+#define STATS_COUNT	7
+
+unsigned int get_stats_mask(const mxArray* names)
+{
+	if (names == NULL || mxIsEmpty(names))
+		return STATS_ALL;
+
+	unsigned int mask = 0;
+	size_t n = mxIsCell(names) ? mxGetNumberOfElements(names) : 1;
+	for (size_t ii = 0; ii < n; ii++)
+	{
+		const mxArray* name = mxIsCell(names) ? mxGetCell(names, ii) : names;
+		char buf[32];
+		if (name == NULL || !mxIsChar(name) || mxGetString(name, buf, sizeof(buf)))
+			mexErrMsgTxt("stats must be a name or a cell array of names.");
+		int kk = 0;
+		for (; kk < STATS_COUNT; kk++)
+			if (strcmp(buf, stats_names[kk]) == 0)
+				break;
+		if (kk == STATS_COUNT)
+			mexErrMsgTxt("stats names are Sum, Max, CentroidX, CentroidY, Brenner, Variance and Saturated.");
+		mask |= 1u << kk;
+	}
+	return mask;
+}
+
+unsigned short get_saturation(HDCAM hdcam, const mxArray* level, int32 pixeltype)
+{
+	if (level != NULL && !mxIsEmpty(level))
+	{
+		double v = mxGetScalar(level);
+		return (unsigned short)(v < 0 ? 0 : v > 65535 ? 65535 : v);
+	}
+
+	double bits;
+	if (!failed(dcamprop_getvalue(hdcam, DCAM_IDPROP_BITSPERCHANNEL, &bits)) && bits >= 1 && bits <= 16)
+		return (unsigned short)((1 << (int)bits) - 1);
+	return pixeltype == DCAM_PIXELTYPE_MONO16 ? 65535 : 4095;
+}
+
+void rowstats_scalar(const unsigned short* row, int32 width, unsigned short saturation, bool brenner, row_stats& rs)
+{
+	for (int32 xx = 0; xx < width; xx++)
+	{
+		unsigned int v = row[xx];
+		rs.sum += v;
+		rs.sumsq += (unsigned long long)v * v;
+		rs.sumx += (unsigned long long)xx * v;
+		if (v > rs.max)
+			rs.max = v;
+		if (v >= saturation)
+			rs.saturated++;
+	}
+	if (brenner)
+		for (int32 xx = 0; xx + 2 < width; xx++)
+		{
+			int d = (int)row[xx + 2] - (int)row[xx];
+			rs.brenner += (unsigned long long)(d * (long long)d);
+		}
+}
+
+// Adds the eight 32-bit lanes of v to the four 64-bit lanes of acc.
+AVX2_TARGET static inline __m256i add_epu32_epi64(__m256i acc, __m256i v)
+{
+	acc = _mm256_add_epi64(acc, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(v)));
+	return _mm256_add_epi64(acc, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(v, 1)));
+}
+
+AVX2_TARGET static inline unsigned long long hsum_epi64(__m256i v)
+{
+	unsigned long long lanes[4];
+	_mm256_storeu_si256((__m256i*)lanes, v);
+	return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+// Each iteration takes 16 pixels, widened to two vectors of 32-bit lanes.
+// Products of two 16-bit values (v*v, x*v, d*d) fit in 32 bits and are
+// summed in 64-bit lanes.  The 16-bit saturation counters can't overflow
+// for rows narrower than 2^20 pixels.
+AVX2_TARGET void rowstats_avx2(const unsigned short* row, int32 width, unsigned short saturation, bool brenner, row_stats& rs)
+{
+	const __m256i sat = _mm256_set1_epi16((short)saturation);
+	const __m256i eight = _mm256_set1_epi32(8);
+	__m256i xlo = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	__m256i xhi = _mm256_add_epi32(xlo, eight);
+	__m256i vmax = _mm256_setzero_si256();
+	__m256i nsat = _mm256_setzero_si256();
+	__m256i sum = _mm256_setzero_si256();
+	__m256i sumsq = _mm256_setzero_si256();
+	__m256i sumx = _mm256_setzero_si256();
+	int32 ii = 0;
+	for (; ii + 16 <= width; ii += 16)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i*)(row + ii));
+		vmax = _mm256_max_epu16(vmax, v);
+		nsat = _mm256_sub_epi16(nsat, _mm256_cmpeq_epi16(_mm256_max_epu16(v, sat), v));
+		__m256i lo = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(v));
+		__m256i hi = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(v, 1));
+		sum = add_epu32_epi64(sum, _mm256_add_epi32(lo, hi));
+		sumsq = add_epu32_epi64(sumsq, _mm256_mullo_epi32(lo, lo));
+		sumsq = add_epu32_epi64(sumsq, _mm256_mullo_epi32(hi, hi));
+		sumx = add_epu32_epi64(sumx, _mm256_mullo_epi32(lo, xlo));
+		sumx = add_epu32_epi64(sumx, _mm256_mullo_epi32(hi, xhi));
+		xlo = _mm256_add_epi32(xhi, eight);
+		xhi = _mm256_add_epi32(xlo, eight);
+	}
+
+	unsigned short lanes[16];
+	_mm256_storeu_si256((__m256i*)lanes, vmax);
+	for (int kk = 0; kk < 16; kk++)
+		if (lanes[kk] > rs.max)
+			rs.max = lanes[kk];
+	_mm256_storeu_si256((__m256i*)lanes, nsat);
+	for (int kk = 0; kk < 16; kk++)
+		rs.saturated += lanes[kk];
+	rs.sum += hsum_epi64(sum);
+	rs.sumsq += hsum_epi64(sumsq);
+	rs.sumx += hsum_epi64(sumx);
+
+	// The remaining pixels; their x is offset by ii.
+	row_stats tail = { 0, 0, 0, 0, 0, 0 };
+	rowstats_scalar(row + ii, width - ii, saturation, false, tail);
+	rs.sum += tail.sum;
+	rs.sumsq += tail.sumsq;
+	rs.sumx += tail.sumx + (unsigned long long)ii * tail.sum;
+	rs.saturated += tail.saturated;
+	if (tail.max > rs.max)
+		rs.max = tail.max;
+
+	if (!brenner)
+		return;
+	__m256i br = _mm256_setzero_si256();
+	ii = 0;
+	for (; ii + 18 <= width; ii += 8)
+	{
+		__m256i a = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(row + ii)));
+		__m256i b = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(row + ii + 2)));
+		__m256i d = _mm256_sub_epi32(b, a);
+		br = add_epu32_epi64(br, _mm256_mullo_epi32(d, d));
+	}
+	rs.brenner += hsum_epi64(br);
+	for (; ii + 2 < width; ii++)
+	{
+		int d = (int)row[ii + 2] - (int)row[ii];
+		rs.brenner += (unsigned long long)(d * (long long)d);
+	}
+}
+
+DCAMERR framestats(HDCAM hdcam, int32 iFrame, int32 pixeltype, unsigned short saturation,
+	unsigned int mask, frame_stats& stats, std::vector<unsigned short>& row)
+{
+	DCAMBUF_FRAME frame;
+	memset(&frame, 0, sizeof(frame));
+	frame.size = sizeof(frame);
+	frame.iFrame = iFrame;
+	DCAMERR err = dcambuf_lockframe(hdcam, &frame);
+	if (failed(err))
+		return err;
+	if (pixeltype != DCAM_PIXELTYPE_MONO16 && pixeltype != DCAM_PIXELTYPE_MONO12
+		&& pixeltype != DCAM_PIXELTYPE_MONO12P)
+		return DCAMERR_INVALIDPARAM;
+
+	bool brenner = (mask & STATS_BRENNER) != 0;
+	bool avx2 = cpu_has_avx2();
+	unsigned long long sum = 0, sumsq = 0, sumx = 0, sumy = 0, br = 0, saturated = 0;
+	unsigned int max = 0;
+	row.resize(frame.width);
+	const unsigned char* src = (const unsigned char*)frame.buf;
+	for (int32 yy = 0; yy < frame.height; yy++, src += frame.rowbytes)
+	{
+		const unsigned short* pixels = (const unsigned short*)src;
+		if (pixeltype == DCAM_PIXELTYPE_MONO12)
+			unpack_mono12(src, &row[0], frame.width);
+		else if (pixeltype == DCAM_PIXELTYPE_MONO12P)
+			unpack_mono12p(src, &row[0], frame.width);
+		if (pixeltype != DCAM_PIXELTYPE_MONO16)
+			pixels = &row[0];
+
+		row_stats rs = { 0, 0, 0, 0, 0, 0 };
+		if (avx2)
+			rowstats_avx2(pixels, frame.width, saturation, brenner, rs);
+		else
+			rowstats_scalar(pixels, frame.width, saturation, brenner, rs);
+		sum += rs.sum;
+		sumsq += rs.sumsq;
+		sumx += rs.sumx;
+		sumy += (unsigned long long)yy * rs.sum;
+		br += rs.brenner;
+		saturated += rs.saturated;
+		if (rs.max > max)
+			max = rs.max;
+	}
+
+	double n = (double)frame.width * frame.height;
+	double mean = sum / n;
+	stats.sum = (double)sum;
+	stats.max = max;
+	stats.centroidx = sum ? (double)sumx / sum + 1 : 0;
+	stats.centroidy = sum ? (double)sumy / sum + 1 : 0;
+	stats.brenner = frame.width > 2 ? br / ((double)(frame.width - 2) * frame.height) : 0;
+	stats.variance = sumsq / n - mean * mean;
+	stats.saturated = (double)saturated;
+	return DCAMERR_SUCCESS;
+}
+
+mxArray* create_stats_output(const std::vector<frame_stats>& stats, unsigned int mask)
+{
+	const char* fields[STATS_COUNT];
+	int nfields = 0;
+	for (int kk = 0; kk < STATS_COUNT; kk++)
+		if (mask & (1u << kk))
+			fields[nfields++] = stats_names[kk];
+	mxArray* out = mxCreateStructMatrix(1, 1, nfields, fields);
+
+	int field = 0;
+	for (int kk = 0; kk < STATS_COUNT; kk++)
+	{
+		if (!(mask & (1u << kk)))
+			continue;
+		mxArray* values = mxCreateDoubleMatrix(1, stats.size(), mxREAL);
+		double* v = mxGetPr(values);
+		for (size_t ff = 0; ff < stats.size(); ff++)
+		{
+			const frame_stats& st = stats[ff];
+			const double all[STATS_COUNT] = { st.sum, st.max, st.centroidx, st.centroidy,
+				st.brenner, st.variance, st.saturated };
+			v[ff] = all[kk];
+		}
+		mxSetFieldByNumber(out, 0, field++, values);
+	}
+	return out;
+}
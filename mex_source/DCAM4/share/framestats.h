@@ -0,0 +1,55 @@
+#pragma once
+// Per-frame statistics computed straight from the capture buffer, so that
+// feedback loops (focus, drift) can run on a few numbers per frame instead
+// of on the images.  Include after stdafx.h and <vector>.
+//   Sum:		total counts
+//   Max:		maximum pixel value
+//   CentroidX, CentroidY:	intensity-weighted centroid (1-based pixels)
+//   Brenner:	Brenner sharpness, mean of (I(x+2,y) - I(x,y))^2
+//   Variance:	variance of the pixel values
+//   Saturated:	number of pixels at or above the saturation level
+// The AVX2 row kernel is used when the CPU supports it.
+
+#define STATS_SUM		0x01
+#define STATS_MAX		0x02
+#define STATS_CENTROIDX	0x04
+#define STATS_CENTROIDY	0x08
+#define STATS_BRENNER	0x10
+#define STATS_VARIANCE	0x20
+#define STATS_SATURATED	0x40
+#define STATS_ALL		0x7F
+
+struct row_stats
+{
+	unsigned long long sum, sumsq, sumx, brenner;
+	unsigned int max, saturated;
+};
+
+struct frame_stats
+{
+	double sum, max, centroidx, centroidy, brenner, variance, saturated;
+};
+
+//parse the optional list of statistics
+//names:				char or cell array of the names above, or empty for all
+//result is a mask of STATS_* flags
+unsigned int get_stats_mask(const mxArray* names);
+
+//get the saturation level
+//level:				given level, or empty to use DCAM_IDPROP_BITSPERCHANNEL
+//pixeltype:			result of get_pixeltype(), used if the property can't be read
+unsigned short get_saturation(HDCAM hdcam, const mxArray* level, int32 pixeltype);
+
+//compute the statistics of frame iFrame of the capture buffer
+//pixeltype:			result of get_pixeltype()
+//mask:				STATS_* flags; the Brenner sum is skipped if not requested
+//row:				reused buffer for unpacked 12-bit rows
+DCAMERR framestats(HDCAM hdcam, int32 iFrame, int32 pixeltype, unsigned short saturation,
+	unsigned int mask, frame_stats& stats, std::vector<unsigned short>& row);
+
+//create a 1 x 1 struct with a 1 x N field for each requested statistic
+mxArray* create_stats_output(const std::vector<frame_stats>& stats, unsigned int mask);
+
+//the kernels behind framestats(), adding one row to rs
+void rowstats_scalar(const unsigned short* row, int32 width, unsigned short saturation, bool brenner, row_stats& rs);
+void rowstats_avx2(const unsigned short* row, int32 width, unsigned short saturation, bool brenner, row_stats& rs);
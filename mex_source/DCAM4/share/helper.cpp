@@ -1,5 +1,33 @@
+#include <stdarg.h>
 #include "stdafx.h"
 #include "helper.h"
+
+DCAMERR get_image_size(HDCAM hdcam, int32& width, int32& height)
+{
+	double v;
+	DCAMERR err = dcamprop_getvalue(hdcam, DCAM_IDPROP_IMAGE_WIDTH, &v);
+	if (failed(err))
+		return err;
+	width = (int32)v;
+	err = dcamprop_getvalue(hdcam, DCAM_IDPROP_IMAGE_HEIGHT, &v);
+	if (failed(err))
+		return err;
+	height = (int32)v;
+	return DCAMERR_SUCCESS;
+}
+
+void close_wait_and_error(HDCAMWAIT hwait, const char* id, const char* format, ...)
+{
+	char message[256];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(message, sizeof(message), format, args);
+	va_end(args);
+	if (hwait != NULL)
+		dcamwait_close(hwait);
+	mexErrMsgIdAndTxt(id, "%s", message);
+}
+
 BOOL get_framebundle_information(HDCAM hdcam, int32& number_of_bundle, int32& width, int32& height, int32& rowbytes, int32& totalframebytes, int32& framestepbytes)
 {
 	DCAMERR err;
@@ -8,7 +36,7 @@ BOOL get_framebundle_information(HDCAM hdcam, int32& number_of_bundle, int32& wi
 	err = dcamprop_getvalue(hdcam, DCAM_IDPROP_FRAMEBUNDLE_MODE, &v);
 	if (failed(err))
 	{
-		mexPrintf("Error = 0x%08lX\ndcamprop_getvalue() DCAM_IDPROP_FRAMEBUNDLE_MODE failed.\n", err);
+		mexPrintf("Error = 0x%08X\ndcamprop_getvalue() DCAM_IDPROP_FRAMEBUNDLE_MODE failed.\n", err);
 		return FALSE;
 	}
 
@@ -21,7 +49,7 @@ BOOL get_framebundle_information(HDCAM hdcam, int32& number_of_bundle, int32& wi
 	err = dcamprop_getvalue(hdcam, DCAM_IDPROP_FRAMEBUNDLE_NUMBER, &v);
 	if (failed(err))
 	{
-		mexPrintf("Error = 0x%08lX\ndcamprop_getvalue() DCAM_IDPROP_FRAMEBUNDLE_NUMBER failed.\n", err);
+		mexPrintf("Error = 0x%08X\ndcamprop_getvalue() DCAM_IDPROP_FRAMEBUNDLE_NUMBER failed.\n", err);
 		return FALSE;
 	}
 
@@ -31,7 +59,7 @@ BOOL get_framebundle_information(HDCAM hdcam, int32& number_of_bundle, int32& wi
 	err = dcamprop_getvalue(hdcam, DCAM_IDPROP_IMAGE_WIDTH, &v);
 	if (failed(err))
 	{
-		mexPrintf("Error = 0x%08lX\ndcamprop_getvalue() DCAM_IDPROP_IMAGE_WIDTH failed.\n", err);
+		mexPrintf("Error = 0x%08X\ndcamprop_getvalue() DCAM_IDPROP_IMAGE_WIDTH failed.\n", err);
 		return FALSE;
 	}
 
@@ -41,7 +69,7 @@ BOOL get_framebundle_information(HDCAM hdcam, int32& number_of_bundle, int32& wi
 	err = dcamprop_getvalue(hdcam, DCAM_IDPROP_IMAGE_HEIGHT, &v);
 	if (failed(err))
 	{
-		mexPrintf("Error = 0x%08lX\ndcamprop_getvalue() DCAM_IDPROP_IMAGE_HEIGHT failed.\n", err);
+		mexPrintf("Error = 0x%08X\ndcamprop_getvalue() DCAM_IDPROP_IMAGE_HEIGHT failed.\n", err);
 		return FALSE;
 	}
 
@@ -51,7 +79,7 @@ BOOL get_framebundle_information(HDCAM hdcam, int32& number_of_bundle, int32& wi
 	err = dcamprop_getvalue(hdcam, DCAM_IDPROP_FRAMEBUNDLE_ROWBYTES, &v);
 	if (failed(err))
 	{
-		mexPrintf("Error = 0x%08lX\ndcamprop_getvalue() DCAM_IDPROP_FRAMEBUNDLE_ROWBYTES failed.\n", err);
+		mexPrintf("Error = 0x%08X\ndcamprop_getvalue() DCAM_IDPROP_FRAMEBUNDLE_ROWBYTES failed.\n", err);
 		return FALSE;
 	}
 
@@ -61,7 +89,7 @@ BOOL get_framebundle_information(HDCAM hdcam, int32& number_of_bundle, int32& wi
 	err = dcamprop_getvalue(hdcam, DCAM_IDPROP_IMAGE_FRAMEBYTES, &v);
 	if (failed(err))
 	{
-		mexPrintf("Error = 0x%08lX\ndcamprop_getvalue() DCAM_IDPROP_IMAGE_FRAMEBYTES failed.\n", err);
+		mexPrintf("Error = 0x%08X\ndcamprop_getvalue() DCAM_IDPROP_IMAGE_FRAMEBYTES failed.\n", err);
 		return FALSE;
 	}
 
@@ -71,7 +99,7 @@ BOOL get_framebundle_information(HDCAM hdcam, int32& number_of_bundle, int32& wi
 	err = dcamprop_getvalue(hdcam, DCAM_IDPROP_FRAMEBUNDLE_FRAMESTEPBYTES, &v);
 	if (failed(err))
 	{
-		mexPrintf("Error = 0x%08lX\ndcamprop_getvalue() DCAM_IDPROP_FRAMEBUNDLE_FRAMESTEPBYTES failed.\n", err);
+		mexPrintf("Error = 0x%08X\ndcamprop_getvalue() DCAM_IDPROP_FRAMEBUNDLE_FRAMESTEPBYTES failed.\n", err);
 		return FALSE;
 	}
 
@@ -1 +1,9 @@
 BOOL get_framebundle_information(HDCAM hdcam, int32& number_of_bundle, int32& width, int32& height, int32& rowbytes, int32& totalframebytes, int32& framestepbytes);
+
+//read the frame size from DCAM_IDPROP_IMAGE_WIDTH and DCAM_IDPROP_IMAGE_HEIGHT,
+//which unlike dcambuf_lockframe() does not need a captured frame
+DCAMERR get_image_size(HDCAM hdcam, int32& width, int32& height);
+
+//close 'hwait' (unless it is NULL) and raise the MATLAB error 'id', so that
+//a failed copy neither leaks the wait handle nor returns without its output
+void close_wait_and_error(HDCAMWAIT hwait, const char* id, const char* format, ...);
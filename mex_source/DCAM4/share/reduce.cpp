@@ -0,0 +1,162 @@
+#include <vector>
+#include "stdafx.h"
+#include "unpack.h"
+#include "reduce.h"
+
+bool get_reduce_args(const mxArray* rois, const mxArray* binning, int32 width, int32 height, reduce_args& args)
+{
+	args.width = width;
+	args.height = height;
+	args.binning = 1;
+	args.rois.clear();
+
+	if (binning != NULL && !mxIsEmpty(binning))
+	{
+		if (!mxIsNumeric(binning) || mxGetNumberOfElements(binning) != 1 || mxGetScalar(binning) < 1
+			|| mxGetScalar(binning) != floor(mxGetScalar(binning)))
+			mexErrMsgTxt("binning must be a positive integer.");
+		args.binning = (int32)mxGetScalar(binning);
+	}
+
+	if (rois != NULL && !mxIsEmpty(rois))
+	{
+		if (!mxIsDouble(rois) || mxGetN(rois) != 4)
+			mexErrMsgTxt("rois must be an N x 4 DOUBLE array of [Xstart Xend Ystart Yend].");
+		size_t n = mxGetM(rois);
+		const double* r = mxGetPr(rois);
+		for (size_t ii = 0; ii < n; ii++)
+		{
+			reduce_roi roi;
+			roi.left = (int32)r[ii] - 1;
+			roi.width = (int32)r[ii + n] - roi.left;
+			roi.top = (int32)r[ii + 2 * n] - 1;
+			roi.height = (int32)r[ii + 3 * n] - roi.top;
+			roi.out = NULL;
+			if (roi.left < 0 || roi.top < 0 || roi.width < 1 || roi.height < 1
+				|| roi.left + roi.width > width || roi.top + roi.height > height)
+				mexErrMsgTxt("rois must lie inside the frame.");
+			args.rois.push_back(roi);
+		}
+	}
+	else if (args.binning > 1)
+	{
+		reduce_roi roi = { 0, 0, width, height, NULL };
+		args.rois.push_back(roi);
+	}
+
+	for (size_t ii = 0; ii < args.rois.size(); ii++)
+		if (args.rois[ii].width % args.binning || args.rois[ii].height % args.binning)
+			mexErrMsgTxt("roi sizes must be multiples of binning.");
+
+	return !args.rois.empty();
+}
+
+mxArray* create_reduce_output(reduce_args& args, int32 nFrames)
+{
+	mxClassID classid = args.binning > 1 ? mxUINT32_CLASS : mxUINT16_CLASS;
+	mxArray* cell = NULL;
+	mxArray* out = NULL;
+	if (args.rois.size() > 1)
+		cell = mxCreateCellMatrix(1, args.rois.size());
+	for (size_t ii = 0; ii < args.rois.size(); ii++)
+	{
+		mwSize outsize[3];
+		outsize[0] = args.rois[ii].width / args.binning;
+		outsize[1] = args.rois[ii].height / args.binning;
+		outsize[2] = nFrames;
+		out = mxCreateNumericArray(3, outsize, classid, mxREAL);
+		args.rois[ii].out = (char*)mxGetData(out);
+		if (cell != NULL)
+			mxSetCell(cell, ii, out);
+	}
+	return cell != NULL ? cell : out;
+}
+
+// Sums BINNING x BINNING bins of a roi.  The rows of a bin are first added
+// into a full-width accumulator, so both inner loops run over contiguous
+// memory and vectorize.
+template <int BINNING>
+static void bin_roi(const unsigned short* src, size_t stride, int32 width, int32 height,
+	int32 binning, unsigned int* acc, unsigned int* dst)
+{
+	const int32 bb = BINNING > 0 ? BINNING : binning;
+	const int32 outwidth = width / bb;
+	for (int32 yy = 0; yy < height; yy += bb, dst += outwidth)
+	{
+		const unsigned short* row = src + yy * stride;
+		for (int32 xx = 0; xx < width; xx++)
+			acc[xx] = row[xx];
+		for (int32 rr = 1; rr < bb; rr++)
+		{
+			row += stride;
+			for (int32 xx = 0; xx < width; xx++)
+				acc[xx] += row[xx];
+		}
+		for (int32 xx = 0; xx < outwidth; xx++)
+		{
+			unsigned int sum = 0;
+			for (int32 kk = 0; kk < bb; kk++)
+				sum += acc[xx * bb + kk];
+			dst[xx] = sum;
+		}
+	}
+}
+
+static void reduce(const unsigned short* src, size_t stride, const reduce_args& args, int32 ff)
+{
+	std::vector<unsigned int> acc;
+	for (size_t ii = 0; ii < args.rois.size(); ii++)
+	{
+		const reduce_roi& roi = args.rois[ii];
+		const unsigned short* top = src + roi.top * stride + roi.left;
+		size_t outpixels = (size_t)(roi.width / args.binning) * (roi.height / args.binning);
+		if (args.binning == 1)
+		{
+			unsigned short* dst = (unsigned short*)roi.out + ff * outpixels;
+			for (int32 yy = 0; yy < roi.height; yy++)
+				memcpy(dst + (size_t)yy * roi.width, top + yy * stride, roi.width * sizeof(unsigned short));
+			continue;
+		}
+		unsigned int* dst = (unsigned int*)roi.out + ff * outpixels;
+		acc.resize(roi.width);
+		switch (args.binning)
+		{
+		case 2:
+			bin_roi<2>(top, stride, roi.width, roi.height, 2, &acc[0], dst);
+			break;
+		case 4:
+			bin_roi<4>(top, stride, roi.width, roi.height, 4, &acc[0], dst);
+			break;
+		default:
+			bin_roi<0>(top, stride, roi.width, roi.height, args.binning, &acc[0], dst);
+		}
+	}
+}
+
+DCAMERR reduceframe(HDCAM hdcam, int32 iFrame, int32 pixeltype, const reduce_args& args, int32 ff, std::vector<unsigned short>& scratch)
+{
+	DCAMBUF_FRAME frame;
+	memset(&frame, 0, sizeof(frame));
+	frame.size = sizeof(frame);
+	frame.iFrame = iFrame;
+
+	// 16-bit frames are reduced straight from the capture buffer.
+	if (pixeltype == DCAM_PIXELTYPE_MONO16)
+	{
+		DCAMERR err = dcambuf_lockframe(hdcam, &frame);
+		if (failed(err))
+			return err;
+		reduce((const unsigned short*)frame.buf, frame.rowbytes / sizeof(unsigned short), args, ff);
+		return DCAMERR_SUCCESS;
+	}
+
+	scratch.resize((size_t)args.width * args.height);
+	frame.width = args.width;
+	frame.height = args.height;
+	frame.buf = &scratch[0];
+	DCAMERR err = copyframe_uint16(hdcam, frame, pixeltype);
+	if (failed(err))
+		return err;
+	reduce(&scratch[0], args.width, args, ff);
+	return DCAMERR_SUCCESS;
+}
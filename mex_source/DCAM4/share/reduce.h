@@ -0,0 +1,35 @@
+#pragma once
+// Software ROI crop and binning applied while frames are copied out of the
+// capture buffer, so only the reduced data reaches MATLAB.  Include after
+// stdafx.h and <vector>.
+
+struct reduce_roi
+{
+	int32 left, top, width, height;		// 0-based, in pixels of the frame
+	char* out;							// output data of this roi
+};
+
+struct reduce_args
+{
+	int32 width, height;				// frame size
+	int32 binning;
+	std::vector<reduce_roi> rois;
+};
+
+//parse the optional rois and binning inputs of the DCAM4Copy* functions
+//rois:				N x 4 [Xstart Xend Ystart Yend] (1-based, inclusive), or
+//					empty for the whole frame
+//binning:			binning factor, or empty for 1
+//width, height:		frame size
+//result is false if neither input reduces the frame
+bool get_reduce_args(const mxArray* rois, const mxArray* binning, int32 width, int32 height, reduce_args& args);
+
+//create the output for nFrames frames: for each roi a uint16 (binning 1) or
+//uint32 (summed bins) array of width/binning x height/binning x nFrames,
+//returned in a cell array if there is more than one roi
+mxArray* create_reduce_output(reduce_args& args, int32 nFrames);
+
+//copy frame iFrame of the capture buffer to frame ff of the output
+//pixeltype:			result of get_pixeltype()
+//scratch:			reused buffer for unpacked 12-bit frames
+DCAMERR reduceframe(HDCAM hdcam, int32 iFrame, int32 pixeltype, const reduce_args& args, int32 ff, std::vector<unsigned short>& scratch);
@@ -0,0 +1,169 @@
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define AVX2_TARGET
+#else
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#include "stdafx.h"
+#include "unpack.h"
+
+int32 get_pixeltype(HDCAM hdcam)
+{
+	double v;
+	DCAMERR err = dcamprop_getvalue(hdcam, DCAM_IDPROP_IMAGE_PIXELTYPE, &v);
+	if (failed(err))
+	{
+		mexPrintf("Error = 0x%08X\ndcamprop_getvalue() DCAM_IDPROP_IMAGE_PIXELTYPE failed.\n", err);
+		return DCAM_PIXELTYPE_NONE;
+	}
+	return (int32)v;
+}
+
+DCAMERR copyframe_uint16(HDCAM hdcam, DCAMBUF_FRAME& frame, int32 pixeltype)
+{
+	unsigned short* dst = (unsigned short*)frame.buf;
+
+	if (pixeltype == DCAM_PIXELTYPE_MONO16)
+	{
+		frame.rowbytes = frame.width * (int32)sizeof(unsigned short);
+		return dcambuf_copyframe(hdcam, &frame);
+	}
+	if (pixeltype != DCAM_PIXELTYPE_MONO12 && pixeltype != DCAM_PIXELTYPE_MONO12P)
+		return DCAMERR_INVALIDPARAM;
+
+	// Packed frames are unpacked straight from the capture buffer.
+	DCAMBUF_FRAME locked;
+	memset(&locked, 0, sizeof(locked));
+	locked.size = sizeof(locked);
+	locked.iFrame = frame.iFrame;
+	DCAMERR err = dcambuf_lockframe(hdcam, &locked);
+	if (failed(err))
+		return err;
+
+	const unsigned char* src = (const unsigned char*)locked.buf;
+	for (int32 yy = 0; yy < frame.height; yy++)
+	{
+		if (pixeltype == DCAM_PIXELTYPE_MONO12)
+			unpack_mono12(src, dst, frame.width);
+		else
+			unpack_mono12p(src, dst, frame.width);
+		src += locked.rowbytes;
+		dst += frame.width;
+	}
+	return DCAMERR_SUCCESS;
+}
+
+bool cpu_has_avx2()
+{
+	static int has = -1;
+	if (has < 0)
+	{
+#ifdef _MSC_VER
+		int info[4];
+		has = 0;
+		__cpuid(info, 0);
+		if (info[0] >= 7)
+		{
+			// AVX2 also needs the OS to save the YMM registers.
+			__cpuid(info, 1);
+			if ((info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6)
+			{
+				__cpuidex(info, 7, 0);
+				has = (info[1] & (1 << 5)) != 0;
+			}
+		}
+#else
+		has = __builtin_cpu_supports("avx2") ? 1 : 0;
+#endif
+	}
+	return has == 1;
+}
+
+void unpack_mono12_scalar(const unsigned char* src, unsigned short* dst, int32 count)
+{
+	int32 ii;
+	for (ii = 0; ii + 1 < count; ii += 2, src += 3)
+	{
+		dst[ii] = (unsigned short)(src[0] << 4 | (src[1] & 0xF));
+		dst[ii + 1] = (unsigned short)(src[2] << 4 | src[1] >> 4);
+	}
+	if (ii < count)
+		dst[ii] = (unsigned short)(src[0] << 4 | (src[1] & 0xF));
+}
+
+void unpack_mono12p_scalar(const unsigned char* src, unsigned short* dst, int32 count)
+{
+	int32 ii;
+	for (ii = 0; ii + 1 < count; ii += 2, src += 3)
+	{
+		dst[ii] = (unsigned short)((src[1] & 0xF) << 8 | src[0]);
+		dst[ii + 1] = (unsigned short)(src[2] << 4 | src[1] >> 4);
+	}
+	if (ii < count)
+		dst[ii] = (unsigned short)((src[1] & 0xF) << 8 | src[0]);
+}
+
+// Each iteration unpacks 16 pixels: bytes 0-11 go to the low lane and bytes
+// 12-23 to the high lane, where a byte shuffle puts the two bytes holding
+// each pixel into its 16-bit word.  Both 16-byte loads stay inside the
+// source as long as 20 pixels remain.
+#define AVX2_PIXELS	16
+#define AVX2_MARGIN	20
+
+AVX2_TARGET void unpack_mono12_avx2(const unsigned char* src, unsigned short* dst, int32 count)
+{
+	const __m256i shuffle = _mm256_setr_epi8(
+		1, 0, 1, 2, 4, 3, 4, 5, 7, 6, 7, 8, 10, 9, 10, 11,
+		1, 0, 1, 2, 4, 3, 4, 5, 7, 6, 7, 8, 10, 9, 10, 11);
+	const __m256i hi = _mm256_set1_epi16(0x0FF0);
+	const __m256i lo = _mm256_set1_epi16(0x000F);
+	int32 ii = 0;
+	for (; ii + AVX2_MARGIN <= count; ii += AVX2_PIXELS, src += 24)
+	{
+		__m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(
+			_mm_loadu_si128((const __m128i*)src)), _mm_loadu_si128((const __m128i*)(src + 12)), 1);
+		v = _mm256_shuffle_epi8(v, shuffle);
+		// even words hold B0:B1, odd words B2:B1
+		__m256i even = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi16(v, 4), hi), _mm256_and_si256(v, lo));
+		__m256i odd = _mm256_srli_epi16(v, 4);
+		_mm256_storeu_si256((__m256i*)(dst + ii), _mm256_blend_epi16(even, odd, 0xAA));
+	}
+	unpack_mono12_scalar(src, dst + ii, count - ii);
+}
+
+AVX2_TARGET void unpack_mono12p_avx2(const unsigned char* src, unsigned short* dst, int32 count)
+{
+	const __m256i shuffle = _mm256_setr_epi8(
+		0, 1, 1, 2, 3, 4, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11,
+		0, 1, 1, 2, 3, 4, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11);
+	const __m256i mask = _mm256_set1_epi16(0x0FFF);
+	int32 ii = 0;
+	for (; ii + AVX2_MARGIN <= count; ii += AVX2_PIXELS, src += 24)
+	{
+		__m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(
+			_mm_loadu_si128((const __m128i*)src)), _mm_loadu_si128((const __m128i*)(src + 12)), 1);
+		v = _mm256_shuffle_epi8(v, shuffle);
+		// even words hold B1:B0, odd words B2:B1
+		__m256i even = _mm256_and_si256(v, mask);
+		__m256i odd = _mm256_srli_epi16(v, 4);
+		_mm256_storeu_si256((__m256i*)(dst + ii), _mm256_blend_epi16(even, odd, 0xAA));
+	}
+	unpack_mono12p_scalar(src, dst + ii, count - ii);
+}
+
+void unpack_mono12(const unsigned char* src, unsigned short* dst, int32 count)
+{
+	if (cpu_has_avx2())
+		unpack_mono12_avx2(src, dst, count);
+	else
+		unpack_mono12_scalar(src, dst, count);
+}
+
+void unpack_mono12p(const unsigned char* src, unsigned short* dst, int32 count)
+{
+	if (cpu_has_avx2())
+		unpack_mono12p_avx2(src, dst, count);
+	else
+		unpack_mono12p_scalar(src, dst, count);
+}
@@ -0,0 +1,30 @@
+#pragma once
+// Copy of 16-bit and packed 12-bit (DCAM_PIXELTYPE_MONO12, _MONO12P) frames
+// to 16-bit pixels.  Two packed pixels P0, P1 occupy three bytes B0 B1 B2:
+//   MONO12:  P0 = B0 << 4 | (B1 & 0xF),  P1 = B2 << 4 | B1 >> 4
+//   MONO12P: P0 = (B1 & 0xF) << 8 | B0,  P1 = B2 << 4 | B1 >> 4
+// The AVX2 kernels are used when the CPU supports them.
+
+//get the pixel type (DCAM_PIXELTYPE) of the captured images
+//hdcam:				DCAM handle
+//result is DCAM_PIXELTYPE_NONE if the property can't be read
+int32 get_pixeltype(HDCAM hdcam);
+
+//copy one frame of the capture buffer as 16-bit pixels
+//hdcam:				DCAM handle
+//frame:				iFrame, width and height of the frame; buf receives
+//					width*height pixels
+//pixeltype:			result of get_pixeltype()
+//result is DCAMERR_INVALIDPARAM for other pixel types
+DCAMERR copyframe_uint16(HDCAM hdcam, DCAMBUF_FRAME& frame, int32 pixeltype);
+
+//unpack count pixels (count even) from src to dst
+void unpack_mono12(const unsigned char* src, unsigned short* dst, int32 count);
+void unpack_mono12p(const unsigned char* src, unsigned short* dst, int32 count);
+
+//the kernels behind unpack_mono12*(), exposed for DCAM4UnpackBenchmark
+bool cpu_has_avx2();
+void unpack_mono12_scalar(const unsigned char* src, unsigned short* dst, int32 count);
+void unpack_mono12p_scalar(const unsigned char* src, unsigned short* dst, int32 count);
+void unpack_mono12_avx2(const unsigned char* src, unsigned short* dst, int32 count);
+void unpack_mono12p_avx2(const unsigned char* src, unsigned short* dst, int32 count);
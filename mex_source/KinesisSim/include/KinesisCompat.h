@@ -0,0 +1,33 @@
+// KinesisCompat.h : the small part of <windows.h> used by the Kinesis mex
+// sources, so they can be compiled with -DLINUX against the KinesisSim
+// stand-in library instead of the Thorlabs DLLs.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef uint8_t BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef uint32_t UINT32;
+typedef int32_t INT32;
+typedef unsigned long long ULONGLONG;
+
+#ifndef __cdecl
+#define __cdecl
+#endif
+
+inline void Sleep(DWORD milliseconds)
+{
+	usleep((useconds_t)milliseconds * 1000);
+}
+
+inline ULONGLONG GetTickCount64(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ULONGLONG)ts.tv_sec * 1000 + (ULONGLONG)(ts.tv_nsec / 1000000);
+}
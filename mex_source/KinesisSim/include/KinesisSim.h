@@ -0,0 +1,101 @@
+// KinesisSim.h : software stand-in for the Thorlabs Kinesis C-API.
+//
+// Declares the device-manager (TLI_*) functions and types shared by every
+// Thorlabs.MotionControl.*.h stand-in header, plus the KSIM_* functions used
+// to configure the simulated devices.  See ../README.txt.
+
+#pragma once
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include "KinesisCompat.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Error codes returned by the simulated devices (same values as the
+// Thorlabs.MotionControl.C_API error code table).
+#define KSIM_OK						0x00
+#define KSIM_FT_DEVICENOTFOUND		0x02
+#define KSIM_FT_DEVICENOTOPENED		0x03
+#define KSIM_FT_INVALIDPARAMETER	0x06
+#define KSIM_TL_ALREADY_OPEN		0x20
+#define KSIM_TL_INVALID_OPERATION	0x24
+#define KSIM_TL_INVALID_POSITION	0x26
+#define KSIM_TL_INVALID_CHANNEL		0x2B
+
+// Device families understood by the simulator.
+#define KSIM_PIEZO			1	// TPZ001 / KPZ101 (PCC_*)
+#define KSIM_STRAINGAUGE	2	// TSG001 / KSG101 (SG_*)
+#define KSIM_STEPPER		3	// BSC10x / BSC20x (SBC_*)
+#define KSIM_LASERDIODE		4	// TLD001 (LD_*)
+
+typedef enum MOT_MotorTypes
+{
+	MOT_NotMotor = 0,
+	MOT_DCMotor = 1,
+	MOT_StepperMotor = 2,
+	MOT_BrushlessMotor = 3,
+	MOT_CustomMotor = 100,
+} MOT_MotorTypes;
+
+typedef enum MOT_TravelDirection
+{
+	MOT_TravelDirectionDisabled = 0x00,
+	MOT_Forwards = 0x01,
+	MOT_Reverse = 0x02,
+} MOT_TravelDirection;
+
+typedef struct TLI_DeviceInfo
+{
+	DWORD typeID;
+	char description[65];
+	char serialNo[9];
+	DWORD PID;
+	bool isKnownType;
+	MOT_MotorTypes motorType;
+	bool isPiezoDevice;
+	bool isLaser;
+	bool isCustomType;
+	bool isRack;
+	short maxChannels;
+} TLI_DeviceInfo;
+
+// Message types/ids delivered through the *_GetNextMessage and
+// *_WaitForMessage queues.
+#define KSIM_MSG_GENERICDEVICE		0
+#define KSIM_MSG_GENERICPIEZO		1
+#define KSIM_MSG_GENERICMOTOR		2
+#define KSIM_MSG_MOTOR_HOMED		0
+#define KSIM_MSG_MOTOR_MOVED		1
+#define KSIM_MSG_MOTOR_STOPPED		2
+#define KSIM_MSG_PIEZO_SETTLED		0
+#define KSIM_MSG_DEVICE_SETTINGSUPDATED	0
+
+// Device manager.
+short __cdecl TLI_BuildDeviceList(void);
+short __cdecl TLI_GetDeviceListSize(void);
+short __cdecl TLI_GetDeviceListExt(char *receiveBuffer, DWORD sizeOfBuffer);
+short __cdecl TLI_GetDeviceInfo(char const * serialNo, TLI_DeviceInfo *info);
+
+// Simulator control.  Devices are normally described by the environment
+// variables KINESIS_SIM_DEVICES, KINESIS_SIM_LINKS and KINESIS_SIM_LATENCY_US
+// which are read by TLI_BuildDeviceList(); the functions below do the same
+// programmatically.
+void __cdecl KSIM_Reset(void);
+short __cdecl KSIM_AddDevice(char const * serialNo, int kind);
+short __cdecl KSIM_LinkStrainGauge(char const * strainGaugeSerialNo, char const * piezoSerialNo);
+void __cdecl KSIM_SetLatency(double meanMicroseconds, double jitterMicroseconds);
+short __cdecl KSIM_SetPiezoDynamics(char const * serialNo, double travelMicrons,
+	double openLoopHz, double openLoopDamping, double closedLoopHz, double closedLoopDamping);
+short __cdecl KSIM_SetStrainGaugeNoise(char const * serialNo, double rmsCounts);
+short __cdecl KSIM_SetStepperVelocity(char const * serialNo, short channel, double microstepsPerSecond);
+short __cdecl KSIM_GetPiezoActual(char const * serialNo, double *positionMicrons, double *velocityMicronsPerSecond);
+short __cdecl KSIM_GetCallStats(char const * serialNo, ULONGLONG *calls, double *busyMicroseconds);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,45 @@
+// Thorlabs.MotionControl.Benchtop.StepperMotor.h : KinesisSim stand-in for the
+// BSC10x/BSC20x benchtop stepper motor controller API.  Channels are 1 based
+// and positions are in microsteps.
+
+#pragma once
+
+#include "KinesisSim.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+short __cdecl SBC_Open(char const * serialNo);
+void __cdecl SBC_Close(char const * serialNo);
+void __cdecl SBC_Identify(char const * serialNo, short channel);
+bool __cdecl SBC_StartPolling(char const * serialNo, short channel, int milliseconds);
+int __cdecl SBC_PollingDuration(char const * serialNo, short channel);
+void __cdecl SBC_StopPolling(char const * serialNo, short channel);
+short __cdecl SBC_EnableChannel(char const * serialNo, short channel);
+short __cdecl SBC_DisableChannel(char const * serialNo, short channel);
+short __cdecl SBC_RequestStatusBits(char const * serialNo, short channel);
+DWORD __cdecl SBC_GetStatusBits(char const * serialNo, short channel);
+short __cdecl SBC_RequestPosition(char const * serialNo, short channel);
+int __cdecl SBC_GetPosition(char const * serialNo, short channel);
+
+short __cdecl SBC_Home(char const * serialNo, short channel);
+short __cdecl SBC_MoveToPosition(char const * serialNo, short channel, int index);
+short __cdecl SBC_MoveRelative(char const * serialNo, short channel, int displacement);
+short __cdecl SBC_MoveJog(char const * serialNo, short channel, MOT_TravelDirection jogDirection);
+short __cdecl SBC_StopImmediate(char const * serialNo, short channel);
+short __cdecl SBC_StopProfiled(char const * serialNo, short channel);
+short __cdecl SBC_RequestJogParams(char const * serialNo, short channel);
+short __cdecl SBC_SetJogStepSize(char const * serialNo, short channel, unsigned int stepSize);
+unsigned int __cdecl SBC_GetJogStepSize(char const * serialNo, short channel);
+short __cdecl SBC_SetVelParams(char const * serialNo, short channel, int acceleration, int maxVelocity);
+short __cdecl SBC_GetVelParams(char const * serialNo, short channel, int * acceleration, int * maxVelocity);
+
+bool __cdecl SBC_GetNextMessage(char const * serialNo, short channel, WORD * messageType, WORD * messageID, DWORD *messageData);
+bool __cdecl SBC_WaitForMessage(char const * serialNo, short channel, WORD * messageType, WORD * messageID, DWORD *messageData);
+int __cdecl SBC_MessageQueueSize(char const * serialNo, short channel);
+void __cdecl SBC_ClearMessageQueue(char const * serialNo, short channel);
+
+#ifdef __cplusplus
+}
+#endif
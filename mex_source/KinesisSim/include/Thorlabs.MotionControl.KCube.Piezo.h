@@ -0,0 +1,7 @@
+// Thorlabs.MotionControl.KCube.Piezo.h : KinesisSim stand-in for the KPZ101
+// K-Cube piezo controller API.  The K-Cube uses the same PCC_* functions as
+// the T-Cube; the simulator serves both from one device table.
+
+#pragma once
+
+#include "Thorlabs.MotionControl.TCube.Piezo.h"
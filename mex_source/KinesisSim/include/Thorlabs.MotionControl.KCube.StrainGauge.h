@@ -0,0 +1,7 @@
+// Thorlabs.MotionControl.KCube.StrainGauge.h : KinesisSim stand-in for the
+// KSG101 K-Cube strain gauge reader API.  The K-Cube uses the same SG_*
+// functions as the T-Cube; the simulator serves both from one device table.
+
+#pragma once
+
+#include "Thorlabs.MotionControl.TCube.StrainGauge.h"
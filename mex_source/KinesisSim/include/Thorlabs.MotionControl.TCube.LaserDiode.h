@@ -0,0 +1,40 @@
+// Thorlabs.MotionControl.TCube.LaserDiode.h : KinesisSim stand-in for the
+// TLD001 T-Cube laser diode driver API.
+
+#pragma once
+
+#include "KinesisSim.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+short __cdecl LD_Open(char const * serialNo);
+void __cdecl LD_Close(char const * serialNo);
+void __cdecl LD_Identify(char const * serialNo);
+bool __cdecl LD_StartPolling(char const * serialNo, int milliseconds);
+int __cdecl LD_PollingDuration(char const * serialNo);
+void __cdecl LD_StopPolling(char const * serialNo);
+short __cdecl LD_Enable(char const * serialNo);
+short __cdecl LD_Disable(char const * serialNo);
+short __cdecl LD_RequestStatus(char const * serialNo);
+DWORD __cdecl LD_GetStatusBits(char const * serialNo);
+
+short __cdecl LD_EnableOutput(char const * serialNo);
+short __cdecl LD_DisableOutput(char const * serialNo);
+short __cdecl LD_SetLaserSetPoint(char const * serialNo, WORD laserDiodeCurrent);
+WORD __cdecl LD_GetLaserSetPoint(char const * serialNo);
+short __cdecl LD_GetLaserDiodeCurrentReading(char const * serialNo);
+short __cdecl LD_SetOpenLoopMode(char const * serialNo);
+short __cdecl LD_SetClosedLoopMode(char const * serialNo);
+short __cdecl LD_SetWACalibFactor(char const * serialNo, float calibFactor);
+float __cdecl LD_GetWACalibFactor(char const * serialNo);
+
+bool __cdecl LD_GetNextMessage(char const * serialNo, WORD * messageType, WORD * messageID, DWORD *messageData);
+bool __cdecl LD_WaitForMessage(char const * serialNo, WORD * messageType, WORD * messageID, DWORD *messageData);
+int __cdecl LD_MessageQueueSize(char const * serialNo);
+void __cdecl LD_ClearMessageQueue(char const * serialNo);
+
+#ifdef __cplusplus
+}
+#endif
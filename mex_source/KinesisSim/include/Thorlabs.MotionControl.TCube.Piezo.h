@@ -0,0 +1,49 @@
+// Thorlabs.MotionControl.TCube.Piezo.h : KinesisSim stand-in for the TPZ001
+// T-Cube piezo controller API.  Only the functions used by the MIC mex files
+// and classes are provided.
+
+#pragma once
+
+#include "KinesisSim.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum PZ_ControlModeTypes
+{
+	PZ_Undefined = 0,
+	PZ_OpenLoop = 1,
+	PZ_CloseLoop = 2,
+	PZ_OpenLoopSmooth = 3,
+	PZ_CloseLoopSmooth = 4,
+} PZ_ControlModeTypes;
+
+short __cdecl PCC_Open(char const * serialNo);
+void __cdecl PCC_Close(char const * serialNo);
+void __cdecl PCC_Identify(char const * serialNo);
+bool __cdecl PCC_StartPolling(char const * serialNo, int milliseconds);
+int __cdecl PCC_PollingDuration(char const * serialNo);
+void __cdecl PCC_StopPolling(char const * serialNo);
+short __cdecl PCC_Enable(char const * serialNo);
+short __cdecl PCC_Disable(char const * serialNo);
+short __cdecl PCC_RequestStatus(char const * serialNo);
+DWORD __cdecl PCC_GetStatusBits(char const * serialNo);
+
+short __cdecl PCC_SetPositionControlMode(char const * serialNo, PZ_ControlModeTypes mode);
+PZ_ControlModeTypes __cdecl PCC_GetPositionControlMode(char const * serialNo);
+short __cdecl PCC_SetPosition(char const * serialNo, WORD position);
+WORD __cdecl PCC_GetPosition(char const * serialNo);
+short __cdecl PCC_SetOutputVoltage(char const * serialNo, short volts);
+short __cdecl PCC_GetOutputVoltage(char const * serialNo);
+short __cdecl PCC_SetMaxOutputVoltage(char const * serialNo, short maxVoltage);
+short __cdecl PCC_GetMaxOutputVoltage(char const * serialNo);
+
+bool __cdecl PCC_GetNextMessage(char const * serialNo, WORD * messageType, WORD * messageID, DWORD *messageData);
+bool __cdecl PCC_WaitForMessage(char const * serialNo, WORD * messageType, WORD * messageID, DWORD *messageData);
+int __cdecl PCC_MessageQueueSize(char const * serialNo);
+void __cdecl PCC_ClearMessageQueue(char const * serialNo);
+
+#ifdef __cplusplus
+}
+#endif
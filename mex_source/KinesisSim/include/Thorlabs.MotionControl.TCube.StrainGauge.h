@@ -0,0 +1,34 @@
+// Thorlabs.MotionControl.TCube.StrainGauge.h : KinesisSim stand-in for the
+// TSG001 T-Cube strain gauge reader API.  A simulated strain gauge reads the
+// position of the piezo it is linked to (see KSIM_LinkStrainGauge).
+
+#pragma once
+
+#include "KinesisSim.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+short __cdecl SG_Open(char const * serialNo);
+void __cdecl SG_Close(char const * serialNo);
+void __cdecl SG_Identify(char const * serialNo);
+bool __cdecl SG_StartPolling(char const * serialNo, int milliseconds);
+int __cdecl SG_PollingDuration(char const * serialNo);
+void __cdecl SG_StopPolling(char const * serialNo);
+short __cdecl SG_RequestStatus(char const * serialNo);
+DWORD __cdecl SG_GetStatusBits(char const * serialNo);
+
+short __cdecl SG_GetReading(char const * serialNo, bool clipReading);
+int __cdecl SG_GetReadingExt(char const * serialNo, bool clipReading, bool *overrange);
+short __cdecl SG_SetZero(char const * serialNo);
+WORD __cdecl SG_GetMaximumTravel(char const * serialNo);
+
+bool __cdecl SG_GetNextMessage(char const * serialNo, WORD * messageType, WORD * messageID, DWORD *messageData);
+bool __cdecl SG_WaitForMessage(char const * serialNo, WORD * messageType, WORD * messageID, DWORD *messageData);
+int __cdecl SG_MessageQueueSize(char const * serialNo);
+void __cdecl SG_ClearMessageQueue(char const * serialNo);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,1242 @@
+// KinesisSim.cpp : software stand-in for the Thorlabs Kinesis C-API.
+//
+// Implements the subset of the TCube/KCube Piezo, TCube/KCube StrainGauge,
+// Benchtop StepperMotor and TCube LaserDiode functions used by the MIC mex
+// files, so they can be built and exercised without hardware.
+//
+// All devices live in one table protected by a single mutex.  A background
+// thread ticks every millisecond: it finishes stepper moves and strain gauge
+// zeroing, posts the corresponding messages and refreshes the cached status
+// of devices that are being polled.  As with the real library, the *_Get*
+// functions return the cached status; *_Request* refreshes it immediately.
+// Each set/request call is delayed by a configurable USB round trip.
+//
+// Piezo stages follow an analytic second-order step response between
+// commands (separate open and closed loop natural frequency and damping), so
+// the position seen by a linked strain gauge depends on when it is read.
+
+#define NOMINMAX
+#include "KinesisSim.h"
+#include "Thorlabs.MotionControl.TCube.Piezo.h"
+#include "Thorlabs.MotionControl.TCube.StrainGauge.h"
+#include "Thorlabs.MotionControl.Benchtop.StepperMotor.h"
+#include "Thorlabs.MotionControl.TCube.LaserDiode.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// Status bits reported by the simulated devices.
+const DWORD STATUS_PIEZO_CONNECTED = 0x00000001;
+const DWORD STATUS_PIEZO_CLOSEDLOOP = 0x00000400;
+const DWORD STATUS_SG_CONNECTED = 0x00000001;
+const DWORD STATUS_SG_ZEROING = 0x00000020;
+const DWORD STATUS_MOT_MOVING_FWD = 0x00000010;
+const DWORD STATUS_MOT_MOVING_REV = 0x00000020;
+const DWORD STATUS_MOT_HOMING = 0x00000200;
+const DWORD STATUS_MOT_HOMED = 0x00000400;
+const DWORD STATUS_LD_OUTPUT_ON = 0x00000001;
+const DWORD STATUS_LD_CLOSEDLOOP = 0x00000004;
+const DWORD STATUS_ENABLED = 0x80000000;
+
+const double PIEZO_FULLSCALE = 65535.0;	// PCC_SetPosition counts over the full travel
+const double SG_FULLSCALE = 32767.0;	// SG reading counts over the full travel
+const double SG_ZERO_SECONDS = 0.5;		// time taken by SG_SetZero
+const int STEPPER_CHANNELS = 3;
+
+struct Message
+{
+	WORD type;
+	WORD id;
+	DWORD data;
+};
+
+// One channel of a device.  Single channel devices use channel 0 only.
+struct Channel
+{
+	int pollMs = 0;
+	double lastPoll = 0;
+	std::deque<Message> queue;
+
+	// Stepper motion.
+	bool enabled = true;
+	bool homed = false;
+	bool homing = false;
+	bool moving = false;
+	double position = 0;
+	double moveFrom = 0;
+	double moveTo = 0;
+	double moveStart = 0;
+	double moveEnd = 0;
+	unsigned int jogStep = 409600;		// 0.5 mm at 819200 microsteps/mm
+	int maxVelocity = 1638400;			// microsteps/s
+	int acceleration = 4506;
+
+	// Last polled or requested values.
+	DWORD cachedStatus = 0;
+	int cachedPosition = 0;
+};
+
+struct Device
+{
+	std::string serial;
+	int kind = 0;
+	bool open = false;
+	bool enabled = true;
+	std::vector<Channel> channels;
+
+	// Piezo: target and the state at the time of the last command.
+	PZ_ControlModeTypes mode = PZ_OpenLoop;
+	double travel = 20.0;				// microns
+	double openHz = 900.0;
+	double openZeta = 0.08;
+	double closedHz = 60.0;
+	double closedZeta = 0.85;
+	double target = 0;
+	double x0 = 0;
+	double v0 = 0;
+	double t0 = 0;
+	short maxVoltage = 750;				// 0.1 V units
+	WORD cachedPiezoPosition = 0;
+
+	// Strain gauge.
+	std::string piezo;
+	double noise = 2.0;					// rms counts
+	double electricalOffset = 0;
+	double zero = 0;
+	double zeroUntil = -1;
+	int cachedReading = 0;
+	bool cachedOverrange = false;
+	std::mt19937 rng;
+
+	// Laser diode.
+	WORD setPoint = 0;
+	bool output = false;
+	bool closedLoop = false;
+	float calibFactor = 1.0f;
+
+	// Call statistics.
+	ULONGLONG calls = 0;
+	double busyMicroseconds = 0;
+};
+
+std::mutex g_mutex;
+std::condition_variable g_messages;
+std::map<std::string, std::unique_ptr<Device>> g_devices;
+std::vector<std::string> g_order;
+bool g_configured = false;
+double g_latencyMean = 0;
+double g_latencyJitter = 0;
+std::mt19937 g_latencyRng(12345);
+
+double Now()
+{
+	static const Clock::time_point start = Clock::now();
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+//*******************************************************************************************
+// Piezo dynamics.
+
+void PiezoDynamics(Device const & dev, double & wn, double & zeta)
+{
+	bool closed = dev.mode == PZ_CloseLoop || dev.mode == PZ_CloseLoopSmooth;
+	wn = 2 * 3.14159265358979 * (closed ? dev.closedHz : dev.openHz);
+	zeta = closed ? dev.closedZeta : dev.openZeta;
+}
+
+// Position (microns) and velocity of a piezo at time t.
+void PiezoState(Device const & dev, double t, double & x, double & v)
+{
+	double wn, zeta;
+	PiezoDynamics(dev, wn, zeta);
+	double dt = t - dev.t0;
+	double e0 = dev.x0 - dev.target;
+	double e, de;
+	if (dt <= 0) {
+		e = e0;
+		de = dev.v0;
+	}
+	else if (zeta < 1) {
+		double wd = wn * sqrt(1 - zeta * zeta);
+		double a = e0;
+		double b = (dev.v0 + zeta * wn * e0) / wd;
+		double decay = exp(-zeta * wn * dt);
+		double c = cos(wd * dt), s = sin(wd * dt);
+		e = decay * (a * c + b * s);
+		de = decay * ((-zeta * wn * a + wd * b) * c + (-zeta * wn * b - wd * a) * s);
+	}
+	else if (zeta == 1) {
+		double b = dev.v0 + wn * e0;
+		double decay = exp(-wn * dt);
+		e = (e0 + b * dt) * decay;
+		de = (b - wn * (e0 + b * dt)) * decay;
+	}
+	else {
+		double r = wn * sqrt(zeta * zeta - 1);
+		double r1 = -zeta * wn + r, r2 = -zeta * wn - r;
+		double a = (dev.v0 - r2 * e0) / (r1 - r2);
+		double b = e0 - a;
+		e = a * exp(r1 * dt) + b * exp(r2 * dt);
+		de = a * r1 * exp(r1 * dt) + b * r2 * exp(r2 * dt);
+	}
+	x = dev.target + e;
+	v = de;
+}
+
+// Starts a new step response from the current state.
+void PiezoCommand(Device & dev, double t, double target)
+{
+	double x, v;
+	PiezoState(dev, t, x, v);
+	dev.x0 = x;
+	dev.v0 = v;
+	dev.t0 = t;
+	dev.target = std::max(0.0, std::min(dev.travel, target));
+}
+
+void PiezoRefresh(Device & dev, double t)
+{
+	double x, v;
+	PiezoState(dev, t, x, v);
+	double counts = std::max(0.0, std::min(PIEZO_FULLSCALE, x / dev.travel * PIEZO_FULLSCALE));
+	dev.cachedPiezoPosition = (WORD)(counts + 0.5);
+	DWORD status = STATUS_PIEZO_CONNECTED;
+	if (dev.mode == PZ_CloseLoop || dev.mode == PZ_CloseLoopSmooth)
+		status |= STATUS_PIEZO_CLOSEDLOOP;
+	if (dev.enabled)
+		status |= STATUS_ENABLED;
+	dev.channels[0].cachedStatus = status;
+}
+
+//*******************************************************************************************
+// Strain gauge.
+
+// Reading before zeroing and noise, in counts.
+double StrainGaugeRaw(Device & dev, double t)
+{
+	double x = 0, v = 0, travel = 20.0;
+	auto it = g_devices.find(dev.piezo);
+	if (it != g_devices.end()) {
+		PiezoState(*it->second, t, x, v);
+		travel = it->second->travel;
+	}
+	return x / travel * SG_FULLSCALE + dev.electricalOffset;
+}
+
+void StrainGaugeRefresh(Device & dev, double t)
+{
+	double reading = StrainGaugeRaw(dev, t) - dev.zero;
+	if (dev.noise > 0)
+		reading += std::normal_distribution<double>(0.0, dev.noise)(dev.rng);
+	dev.cachedOverrange = fabs(reading) > SG_FULLSCALE;
+	dev.cachedReading = (int)floor(reading + 0.5);
+	DWORD status = STATUS_SG_CONNECTED;
+	if (dev.zeroUntil >= 0)
+		status |= STATUS_SG_ZEROING;
+	if (dev.enabled)
+		status |= STATUS_ENABLED;
+	dev.channels[0].cachedStatus = status;
+}
+
+//*******************************************************************************************
+// Stepper.
+
+double StepperPosition(Channel const & ch, double t)
+{
+	if (!ch.moving)
+		return ch.position;
+	if (t >= ch.moveEnd)
+		return ch.moveTo;
+	double f = (t - ch.moveStart) / (ch.moveEnd - ch.moveStart);
+	return ch.moveFrom + f * (ch.moveTo - ch.moveFrom);
+}
+
+void StepperMove(Channel & ch, double t, double to, bool homing)
+{
+	double from = StepperPosition(ch, t);
+	ch.position = from;
+	ch.moveFrom = from;
+	ch.moveTo = to;
+	ch.moveStart = t;
+	ch.moveEnd = t + fabs(to - from) / std::max(1, ch.maxVelocity);
+	ch.moving = true;
+	ch.homing = homing;
+}
+
+void StepperStop(Channel & ch, double t)
+{
+	if (!ch.moving)
+		return;
+	ch.position = StepperPosition(ch, t);
+	ch.moving = false;
+	ch.homing = false;
+	ch.queue.push_back({ KSIM_MSG_GENERICMOTOR, KSIM_MSG_MOTOR_STOPPED, (DWORD)(int)floor(ch.position + 0.5) });
+}
+
+void StepperRefresh(Channel & ch, double t)
+{
+	double pos = StepperPosition(ch, t);
+	ch.cachedPosition = (int)floor(pos + 0.5);
+	DWORD status = 0;
+	if (ch.moving && ch.moveTo >= ch.moveFrom)
+		status |= STATUS_MOT_MOVING_FWD;
+	if (ch.moving && ch.moveTo < ch.moveFrom)
+		status |= STATUS_MOT_MOVING_REV;
+	if (ch.homing)
+		status |= STATUS_MOT_HOMING;
+	if (ch.homed)
+		status |= STATUS_MOT_HOMED;
+	if (ch.enabled)
+		status |= STATUS_ENABLED;
+	ch.cachedStatus = status;
+}
+
+//*******************************************************************************************
+// Laser diode.
+
+void LaserDiodeRefresh(Device & dev)
+{
+	DWORD status = 0;
+	if (dev.output)
+		status |= STATUS_LD_OUTPUT_ON;
+	if (dev.closedLoop)
+		status |= STATUS_LD_CLOSEDLOOP;
+	if (dev.enabled)
+		status |= STATUS_ENABLED;
+	dev.channels[0].cachedStatus = status;
+}
+
+//*******************************************************************************************
+// Device table.
+
+void Refresh(Device & dev, size_t channel, double t)
+{
+	switch (dev.kind) {
+	case KSIM_PIEZO: PiezoRefresh(dev, t); break;
+	case KSIM_STRAINGAUGE: StrainGaugeRefresh(dev, t); break;
+	case KSIM_STEPPER: StepperRefresh(dev.channels[channel], t); break;
+	case KSIM_LASERDIODE: LaserDiodeRefresh(dev); break;
+	}
+	dev.channels[channel].lastPoll = t;
+}
+
+// Advances one device to time t.  Returns true if a message was posted.
+bool Tick(Device & dev, double t)
+{
+	bool posted = false;
+	if (dev.kind == KSIM_STRAINGAUGE && dev.zeroUntil >= 0 && t >= dev.zeroUntil) {
+		dev.zero = StrainGaugeRaw(dev, t);
+		dev.zeroUntil = -1;
+		dev.channels[0].queue.push_back({ KSIM_MSG_GENERICDEVICE, KSIM_MSG_DEVICE_SETTINGSUPDATED, 0 });
+		posted = true;
+	}
+	for (size_t c = 0; c < dev.channels.size(); c++) {
+		Channel & ch = dev.channels[c];
+		if (dev.kind == KSIM_STEPPER && ch.moving && t >= ch.moveEnd) {
+			ch.position = ch.moveTo;
+			ch.moving = false;
+			if (ch.homing) {
+				ch.homing = false;
+				ch.homed = true;
+				ch.queue.push_back({ KSIM_MSG_GENERICMOTOR, KSIM_MSG_MOTOR_HOMED, 0 });
+			}
+			else {
+				ch.queue.push_back({ KSIM_MSG_GENERICMOTOR, KSIM_MSG_MOTOR_MOVED, (DWORD)(int)floor(ch.position + 0.5) });
+			}
+			posted = true;
+		}
+		if (dev.open && ch.pollMs > 0 && (t - ch.lastPoll) * 1000 >= ch.pollMs)
+			Refresh(dev, c, t);
+	}
+	return posted;
+}
+
+class Simulation
+{
+public:
+	Simulation() : mStop(false) {}
+	~Simulation()
+	{
+		mStop = true;
+		if (mThread.joinable())
+			mThread.join();
+	}
+	void Start()
+	{
+		if (!mThread.joinable())
+			mThread = std::thread(&Simulation::Run, this);
+	}
+
+private:
+	void Run()
+	{
+		Clock::time_point next = Clock::now();
+		while (!mStop) {
+			next += std::chrono::milliseconds(1);
+			bool posted = false;
+			{
+				std::lock_guard<std::mutex> lock(g_mutex);
+				double t = Now();
+				for (auto & d : g_devices)
+					posted |= Tick(*d.second, t);
+			}
+			if (posted)
+				g_messages.notify_all();
+			std::this_thread::sleep_until(next);
+		}
+	}
+
+	std::atomic<bool> mStop;
+	std::thread mThread;
+};
+
+Simulation g_simulation;
+
+int KindFromPrefix(std::string const & serial)
+{
+	int prefix = atoi(serial.substr(0, 2).c_str());
+	switch (prefix) {
+	case 29: case 71: case 81: return KSIM_PIEZO;
+	case 59: case 84: return KSIM_STRAINGAUGE;
+	case 40: case 70: return KSIM_STEPPER;
+	case 64: return KSIM_LASERDIODE;
+	}
+	return 0;
+}
+
+int KindFromName(std::string const & name)
+{
+	if (name == "PCC" || name == "PIEZO") return KSIM_PIEZO;
+	if (name == "SG" || name == "STRAINGAUGE") return KSIM_STRAINGAUGE;
+	if (name == "SBC" || name == "STEPPER") return KSIM_STEPPER;
+	if (name == "LD" || name == "LASERDIODE") return KSIM_LASERDIODE;
+	return 0;
+}
+
+// Caller holds g_mutex.
+short AddDevice(std::string const & serial, int kind)
+{
+	if (serial.empty() || serial.size() > 8 || kind < KSIM_PIEZO || kind > KSIM_LASERDIODE)
+		return KSIM_FT_INVALIDPARAMETER;
+	if (g_devices.count(serial))
+		return KSIM_OK;
+	std::unique_ptr<Device> dev(new Device);
+	dev->serial = serial;
+	dev->kind = kind;
+	dev->channels.resize(kind == KSIM_STEPPER ? STEPPER_CHANNELS : 1);
+	dev->rng.seed((unsigned)std::hash<std::string>()(serial));
+	if (kind == KSIM_STRAINGAUGE) {
+		std::uniform_real_distribution<double> offset(-400.0, 400.0);
+		dev->electricalOffset = offset(dev->rng);
+	}
+	g_devices[serial] = std::move(dev);
+	g_order.push_back(serial);
+	g_configured = true;
+	g_simulation.Start();
+	return KSIM_OK;
+}
+
+// Pairs the n-th strain gauge with the n-th piezo when no link was given.
+void LinkUnpaired()
+{
+	std::vector<Device *> piezos, gauges;
+	for (auto const & s : g_order) {
+		Device * dev = g_devices[s].get();
+		if (dev->kind == KSIM_PIEZO)
+			piezos.push_back(dev);
+		if (dev->kind == KSIM_STRAINGAUGE)
+			gauges.push_back(dev);
+	}
+	for (size_t i = 0; i < gauges.size() && i < piezos.size(); i++)
+		if (gauges[i]->piezo.empty())
+			gauges[i]->piezo = piezos[i]->serial;
+}
+
+std::vector<std::string> Split(std::string const & s, char const * separators)
+{
+	std::vector<std::string> out;
+	size_t start = 0;
+	while (start <= s.size()) {
+		size_t end = s.find_first_of(separators, start);
+		if (end == std::string::npos)
+			end = s.size();
+		if (end > start)
+			out.push_back(s.substr(start, end - start));
+		start = end + 1;
+	}
+	return out;
+}
+
+// Caller holds g_mutex.
+void Configure()
+{
+	char const * devices = getenv("KINESIS_SIM_DEVICES");
+	if (devices) {
+		for (auto const & entry : Split(devices, ",; ")) {
+			std::vector<std::string> parts = Split(entry, ":");
+			int kind = parts.size() > 1 ? KindFromName(parts[1]) : KindFromPrefix(parts[0]);
+			AddDevice(parts[0], kind);
+		}
+	}
+	else if (!g_configured) {
+		// The NanoMax stage, its stepper and a laser diode, as used in the
+		// examples of mic.NanoMax and mic.lightsource.TCubeLaserDiode.
+		char const * defaults[][2] = {
+			{ "81850186", "84850145" }, { "81850193", "84850146" }, { "81850176", "84850203" } };
+		for (auto const & pair : defaults) {
+			AddDevice(pair[0], KSIM_PIEZO);
+			AddDevice(pair[1], KSIM_STRAINGAUGE);
+			g_devices[pair[1]]->piezo = pair[0];
+		}
+		AddDevice("70850323", KSIM_STEPPER);
+		AddDevice("64864827", KSIM_LASERDIODE);
+	}
+
+	char const * links = getenv("KINESIS_SIM_LINKS");
+	if (links) {
+		for (auto const & entry : Split(links, ",; ")) {
+			std::vector<std::string> parts = Split(entry, "=");
+			if (parts.size() == 2 && g_devices.count(parts[0]))
+				g_devices[parts[0]]->piezo = parts[1];
+		}
+	}
+	LinkUnpaired();
+
+	char const * latency = getenv("KINESIS_SIM_LATENCY_US");
+	if (latency) {
+		std::vector<std::string> parts = Split(latency, ":");
+		g_latencyMean = parts.size() > 0 ? atof(parts[0].c_str()) : 0;
+		g_latencyJitter = parts.size() > 1 ? atof(parts[1].c_str()) : 0;
+	}
+}
+
+// Caller holds g_mutex.
+Device * Find(char const * serialNo, int kind)
+{
+	if (!serialNo)
+		return NULL;
+	auto it = g_devices.find(serialNo);
+	if (it == g_devices.end() || it->second->kind != kind)
+		return NULL;
+	return it->second.get();
+}
+
+double Latency()
+{
+	std::lock_guard<std::mutex> lock(g_mutex);
+	if (g_latencyMean <= 0)
+		return 0;
+	std::uniform_real_distribution<double> jitter(-g_latencyJitter, g_latencyJitter);
+	return std::max(0.0, g_latencyMean + jitter(g_latencyRng));
+}
+
+// Runs f on an open device under the lock.  Calls that talk to the device
+// (io) are first delayed by the simulated USB round trip.
+template <typename R, typename F>
+R WithDevice(char const * serialNo, int kind, bool io, R notOpen, F f)
+{
+	double us = io ? Latency() : 0;
+	if (us > 0)
+		std::this_thread::sleep_for(std::chrono::duration<double, std::micro>(us));
+	std::lock_guard<std::mutex> lock(g_mutex);
+	Device * dev = Find(serialNo, kind);
+	if (!dev || !dev->open)
+		return notOpen;
+	dev->calls++;
+	dev->busyMicroseconds += us;
+	return f(*dev, Now());
+}
+
+bool ValidChannel(Device const & dev, short channel)
+{
+	return channel >= 1 && channel <= (short)dev.channels.size();
+}
+
+short Open(char const * serialNo, int kind)
+{
+	std::lock_guard<std::mutex> lock(g_mutex);
+	Device * dev = Find(serialNo, kind);
+	if (!dev)
+		return KSIM_FT_DEVICENOTFOUND;
+	dev->open = true;
+	double t = Now();
+	for (size_t c = 0; c < dev->channels.size(); c++)
+		Refresh(*dev, c, t);
+	return KSIM_OK;
+}
+
+void Close(char const * serialNo, int kind)
+{
+	{
+		std::lock_guard<std::mutex> lock(g_mutex);
+		Device * dev = Find(serialNo, kind);
+		if (!dev)
+			return;
+		dev->open = false;
+		for (auto & ch : dev->channels) {
+			ch.pollMs = 0;
+			ch.queue.clear();
+		}
+	}
+	g_messages.notify_all();
+}
+
+bool StartPolling(char const * serialNo, int kind, short channel, int milliseconds)
+{
+	return WithDevice(serialNo, kind, false, false, [&](Device & dev, double t) {
+		if (!ValidChannel(dev, channel) || milliseconds <= 0)
+			return false;
+		dev.channels[channel - 1].pollMs = milliseconds;
+		Refresh(dev, channel - 1, t);
+		return true;
+	});
+}
+
+int PollingDuration(char const * serialNo, int kind, short channel)
+{
+	return WithDevice(serialNo, kind, false, 0, [&](Device & dev, double) {
+		return ValidChannel(dev, channel) ? dev.channels[channel - 1].pollMs : 0;
+	});
+}
+
+void StopPolling(char const * serialNo, int kind, short channel)
+{
+	WithDevice(serialNo, kind, false, 0, [&](Device & dev, double) {
+		if (ValidChannel(dev, channel))
+			dev.channels[channel - 1].pollMs = 0;
+		return 0;
+	});
+}
+
+short Request(char const * serialNo, int kind, short channel)
+{
+	return WithDevice(serialNo, kind, true, (short)KSIM_FT_DEVICENOTOPENED, [&](Device & dev, double t) {
+		if (!ValidChannel(dev, channel))
+			return (short)KSIM_TL_INVALID_CHANNEL;
+		Refresh(dev, channel - 1, t);
+		return (short)KSIM_OK;
+	});
+}
+
+DWORD StatusBits(char const * serialNo, int kind, short channel)
+{
+	return WithDevice(serialNo, kind, false, (DWORD)0, [&](Device & dev, double) {
+		return ValidChannel(dev, channel) ? dev.channels[channel - 1].cachedStatus : (DWORD)0;
+	});
+}
+
+short SetEnabled(char const * serialNo, int kind, bool enabled)
+{
+	return WithDevice(serialNo, kind, true, (short)KSIM_FT_DEVICENOTOPENED, [&](Device & dev, double) {
+		dev.enabled = enabled;
+		return (short)KSIM_OK;
+	});
+}
+
+bool NextMessage(char const * serialNo, int kind, short channel, bool wait,
+	WORD * messageType, WORD * messageID, DWORD * messageData)
+{
+	std::unique_lock<std::mutex> lock(g_mutex);
+	Device * dev = Find(serialNo, kind);
+	if (!dev || !dev->open || !ValidChannel(*dev, channel))
+		return false;
+	if (wait) {
+		std::string serial = dev->serial;
+		g_messages.wait(lock, [&]() {
+			dev = Find(serial.c_str(), kind);
+			return !dev || !dev->open || !dev->channels[channel - 1].queue.empty();
+		});
+		if (!dev || !dev->open)
+			return false;
+	}
+	std::deque<Message> & queue = dev->channels[channel - 1].queue;
+	if (queue.empty())
+		return false;
+	Message m = queue.front();
+	queue.pop_front();
+	if (messageType) *messageType = m.type;
+	if (messageID) *messageID = m.id;
+	if (messageData) *messageData = m.data;
+	return true;
+}
+
+int MessageQueueSize(char const * serialNo, int kind, short channel)
+{
+	return WithDevice(serialNo, kind, false, -1, [&](Device & dev, double) {
+		return ValidChannel(dev, channel) ? (int)dev.channels[channel - 1].queue.size() : -1;
+	});
+}
+
+void ClearMessageQueue(char const * serialNo, int kind, short channel)
+{
+	WithDevice(serialNo, kind, false, 0, [&](Device & dev, double) {
+		if (ValidChannel(dev, channel))
+			dev.channels[channel - 1].queue.clear();
+		return 0;
+	});
+}
+
+// Starts a move of one channel; target is computed from the channel state.
+template <typename F>
+short StepperCommand(char const * serialNo, short channel, bool homing, F target)
+{
+	return WithDevice(serialNo, KSIM_STEPPER, true, (short)KSIM_FT_DEVICENOTOPENED, [&](Device & dev, double t) {
+		if (!ValidChannel(dev, channel))
+			return (short)KSIM_TL_INVALID_CHANNEL;
+		Channel & ch = dev.channels[channel - 1];
+		if (!ch.enabled)
+			return (short)KSIM_TL_INVALID_OPERATION;
+		StepperMove(ch, t, target(ch, t), homing);
+		return (short)KSIM_OK;
+	});
+}
+
+short StepperHalt(char const * serialNo, short channel)
+{
+	short err = WithDevice(serialNo, KSIM_STEPPER, true, (short)KSIM_FT_DEVICENOTOPENED, [&](Device & dev, double t) {
+		if (!ValidChannel(dev, channel))
+			return (short)KSIM_TL_INVALID_CHANNEL;
+		StepperStop(dev.channels[channel - 1], t);
+		return (short)KSIM_OK;
+	});
+	g_messages.notify_all();
+	return err;
+}
+
+// Applies f to an open laser diode and returns KSIM_OK.
+template <typename F>
+short LaserDiodeCommand(char const * serialNo, F f)
+{
+	return WithDevice(serialNo, KSIM_LASERDIODE, true, (short)KSIM_FT_DEVICENOTOPENED, [&](Device & dev, double) {
+		f(dev);
+		LaserDiodeRefresh(dev);
+		return (short)KSIM_OK;
+	});
+}
+
+} // namespace
+
+extern "C" {
+
+//*******************************************************************************************
+// Device manager.
+
+short __cdecl TLI_BuildDeviceList(void)
+{
+	std::lock_guard<std::mutex> lock(g_mutex);
+	Configure();
+	return 0;
+}
+
+short __cdecl TLI_GetDeviceListSize(void)
+{
+	std::lock_guard<std::mutex> lock(g_mutex);
+	return (short)g_order.size();
+}
+
+short __cdecl TLI_GetDeviceListExt(char *receiveBuffer, DWORD sizeOfBuffer)
+{
+	std::lock_guard<std::mutex> lock(g_mutex);
+	std::string list;
+	for (auto const & s : g_order)
+		list += s + ",";
+	if (!receiveBuffer || list.size() + 1 > sizeOfBuffer)
+		return KSIM_FT_INVALIDPARAMETER;
+	memcpy(receiveBuffer, list.c_str(), list.size() + 1);
+	return KSIM_OK;
+}
+
+short __cdecl TLI_GetDeviceInfo(char const * serialNo, TLI_DeviceInfo *info)
+{
+	static char const * descriptions[] = { "", "Piezo Driver T-Cube", "Strain Gauge Reader T-Cube",
+		"Benchtop Stepper Motor Controller", "Laser Diode Driver T-Cube" };
+	std::lock_guard<std::mutex> lock(g_mutex);
+	if (!serialNo || !info)
+		return 0;
+	auto it = g_devices.find(serialNo);
+	if (it == g_devices.end())
+		return 0;
+	Device const & dev = *it->second;
+	memset(info, 0, sizeof(*info));
+	info->typeID = (DWORD)atoi(dev.serial.substr(0, 2).c_str());
+	snprintf(info->description, sizeof(info->description), "%s (simulated)", descriptions[dev.kind]);
+	strncpy(info->serialNo, dev.serial.c_str(), 8);
+	info->isKnownType = true;
+	info->motorType = dev.kind == KSIM_STEPPER ? MOT_StepperMotor : MOT_NotMotor;
+	info->isPiezoDevice = dev.kind == KSIM_PIEZO || dev.kind == KSIM_STRAINGAUGE;
+	info->isLaser = dev.kind == KSIM_LASERDIODE;
+	info->maxChannels = (short)dev.channels.size();
+	return 1;
+}
+
+//*******************************************************************************************
+// Simulator control.
+
+void __cdecl KSIM_Reset(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(g_mutex);
+		g_devices.clear();
+		g_order.clear();
+		g_configured = false;
+		g_latencyMean = 0;
+		g_latencyJitter = 0;
+	}
+	g_messages.notify_all();
+}
+
+short __cdecl KSIM_AddDevice(char const * serialNo, int kind)
+{
+	std::lock_guard<std::mutex> lock(g_mutex);
+	return serialNo ? AddDevice(serialNo, kind) : (short)KSIM_FT_INVALIDPARAMETER;
+}
+
+short __cdecl KSIM_LinkStrainGauge(char const * strainGaugeSerialNo, char const * piezoSerialNo)
+{
+	std::lock_guard<std::mutex> lock(g_mutex);
+	Device * sg = Find(strainGaugeSerialNo, KSIM_STRAINGAUGE);
+	if (!sg || !Find(piezoSerialNo, KSIM_PIEZO))
+		return KSIM_FT_DEVICENOTFOUND;
+	sg->piezo = piezoSerialNo;
+	return KSIM_OK;
+}
+
+void __cdecl KSIM_SetLatency(double meanMicroseconds, double jitterMicroseconds)
+{
+	std::lock_guard<std::mutex> lock(g_mutex);
+	g_latencyMean = std::max(0.0, meanMicroseconds);
+	g_latencyJitter = std::max(0.0, jitterMicroseconds);
+}
+
+short __cdecl KSIM_SetPiezoDynamics(char const * serialNo, double travelMicrons,
+	double openLoopHz, double openLoopDamping, double closedLoopHz, double closedLoopDamping)
+{
+	std::lock_guard<std::mutex> lock(g_mutex);
+	Device * dev = Find(serialNo, KSIM_PIEZO);
+	if (!dev)
+		return KSIM_FT_DEVICENOTFOUND;
+	if (travelMicrons <= 0 || openLoopHz <= 0 || closedLoopHz <= 0 || openLoopDamping < 0 || closedLoopDamping < 0)
+		return KSIM_FT_INVALIDPARAMETER;
+	PiezoCommand(*dev, Now(), dev->target);
+	dev->travel = travelMicrons;
+	dev->openHz = openLoopHz;
+	dev->openZeta = openLoopDamping;
+	dev->closedHz = closedLoopHz;
+	dev->closedZeta = closedLoopDamping;
+	return KSIM_OK;
+}
+
+short __cdecl KSIM_SetStrainGaugeNoise(char const * serialNo, double rmsCounts)
+{
+	std::lock_guard<std::mutex> lock(g_mutex);
+	Device * dev = Find(serialNo, KSIM_STRAINGAUGE);
+	if (!dev)
+		return KSIM_FT_DEVICENOTFOUND;
+	dev->noise = std::max(0.0, rmsCounts);
+	return KSIM_OK;
+}
+
+short __cdecl KSIM_SetStepperVelocity(char const * serialNo, short channel, double microstepsPerSecond)
+{
+	std::lock_guard<std::mutex> lock(g_mutex);
+	Device * dev = Find(serialNo, KSIM_STEPPER);
+	if (!dev)
+		return KSIM_FT_DEVICENOTFOUND;
+	if (!ValidChannel(*dev, channel) || microstepsPerSecond <= 0)
+		return KSIM_FT_INVALIDPARAMETER;
+	dev->channels[channel - 1].maxVelocity = (int)microstepsPerSecond;
+	return KSIM_OK;
+}
+
+short __cdecl KSIM_GetPiezoActual(char const * serialNo, double *positionMicrons, double *velocityMicronsPerSecond)
+{
+	std::lock_guard<std::mutex> lock(g_mutex);
+	Device * dev = Find(serialNo, KSIM_PIEZO);
+	if (!dev)
+		return KSIM_FT_DEVICENOTFOUND;
+	double x, v;
+	PiezoState(*dev, Now(), x, v);
+	if (positionMicrons) *positionMicrons = x;
+	if (velocityMicronsPerSecond) *velocityMicronsPerSecond = v;
+	return KSIM_OK;
+}
+
+short __cdecl KSIM_GetCallStats(char const * serialNo, ULONGLONG *calls, double *busyMicroseconds)
+{
+	std::lock_guard<std::mutex> lock(g_mutex);
+	auto it = serialNo ? g_devices.find(serialNo) : g_devices.end();
+	if (it == g_devices.end())
+		return KSIM_FT_DEVICENOTFOUND;
+	if (calls) *calls = it->second->calls;
+	if (busyMicroseconds) *busyMicroseconds = it->second->busyMicroseconds;
+	return KSIM_OK;
+}
+
+//*******************************************************************************************
+// Piezo (PCC_*).
+
+short __cdecl PCC_Open(char const * serialNo) { return Open(serialNo, KSIM_PIEZO); }
+void __cdecl PCC_Close(char const * serialNo) { Close(serialNo, KSIM_PIEZO); }
+void __cdecl PCC_Identify(char const * serialNo) { Request(serialNo, KSIM_PIEZO, 1); }
+bool __cdecl PCC_StartPolling(char const * serialNo, int milliseconds) { return StartPolling(serialNo, KSIM_PIEZO, 1, milliseconds); }
+int __cdecl PCC_PollingDuration(char const * serialNo) { return PollingDuration(serialNo, KSIM_PIEZO, 1); }
+void __cdecl PCC_StopPolling(char const * serialNo) { StopPolling(serialNo, KSIM_PIEZO, 1); }
+short __cdecl PCC_Enable(char const * serialNo) { return SetEnabled(serialNo, KSIM_PIEZO, true); }
+short __cdecl PCC_Disable(char const * serialNo) { return SetEnabled(serialNo, KSIM_PIEZO, false); }
+short __cdecl PCC_RequestStatus(char const * serialNo) { return Request(serialNo, KSIM_PIEZO, 1); }
+DWORD __cdecl PCC_GetStatusBits(char const * serialNo) { return StatusBits(serialNo, KSIM_PIEZO, 1); }
+
+short __cdecl PCC_SetPositionControlMode(char const * serialNo, PZ_ControlModeTypes mode)
+{
+	return WithDevice(serialNo, KSIM_PIEZO, true, (short)KSIM_FT_DEVICENOTOPENED, [&](Device & dev, double t) {
+		if (mode < PZ_OpenLoop || mode > PZ_CloseLoopSmooth)
+			return (short)KSIM_FT_INVALIDPARAMETER;
+		PiezoCommand(dev, t, dev.target);
+		dev.mode = mode;
+		return (short)KSIM_OK;
+	});
+}
+
+PZ_ControlModeTypes __cdecl PCC_GetPositionControlMode(char const * serialNo)
+{
+	return WithDevice(serialNo, KSIM_PIEZO, false, PZ_Undefined, [&](Device & dev, double) {
+		return dev.mode;
+	});
+}
+
+short __cdecl PCC_SetPosition(char const * serialNo, WORD position)
+{
+	return WithDevice(serialNo, KSIM_PIEZO, true, (short)KSIM_FT_DEVICENOTOPENED, [&](Device & dev, double t) {
+		if (!dev.enabled)
+			return (short)KSIM_TL_INVALID_OPERATION;
+		PiezoCommand(dev, t, position / PIEZO_FULLSCALE * dev.travel);
+		return (short)KSIM_OK;
+	});
+}
+
+WORD __cdecl PCC_GetPosition(char const * serialNo)
+{
+	return WithDevice(serialNo, KSIM_PIEZO, false, (WORD)0, [&](Device & dev, double) {
+		return dev.cachedPiezoPosition;
+	});
+}
+
+short __cdecl PCC_SetOutputVoltage(char const * serialNo, short volts)
+{
+	return WithDevice(serialNo, KSIM_PIEZO, true, (short)KSIM_FT_DEVICENOTOPENED, [&](Device & dev, double t) {
+		if (!dev.enabled)
+			return (short)KSIM_TL_INVALID_OPERATION;
+		if (volts < 0)
+			return (short)KSIM_FT_INVALIDPARAMETER;
+		PiezoCommand(dev, t, volts / SG_FULLSCALE * dev.travel);
+		return (short)KSIM_OK;
+	});
+}
+
+short __cdecl PCC_GetOutputVoltage(char const * serialNo)
+{
+	return WithDevice(serialNo, KSIM_PIEZO, false, (short)0, [&](Device & dev, double) {
+		return (short)floor(dev.target / dev.travel * SG_FULLSCALE + 0.5);
+	});
+}
+
+short __cdecl PCC_SetMaxOutputVoltage(char const * serialNo, short maxVoltage)
+{
+	return WithDevice(serialNo, KSIM_PIEZO, true, (short)KSIM_FT_DEVICENOTOPENED, [&](Device & dev, double) {
+		if (maxVoltage != 750 && maxVoltage != 1000 && maxVoltage != 1500)
+			return (short)KSIM_FT_INVALIDPARAMETER;
+		dev.maxVoltage = maxVoltage;
+		return (short)KSIM_OK;
+	});
+}
+
+short __cdecl PCC_GetMaxOutputVoltage(char const * serialNo)
+{
+	return WithDevice(serialNo, KSIM_PIEZO, false, (short)0, [&](Device & dev, double) {
+		return dev.maxVoltage;
+	});
+}
+
+bool __cdecl PCC_GetNextMessage(char const * serialNo, WORD * messageType, WORD * messageID, DWORD *messageData)
+{
+	return NextMessage(serialNo, KSIM_PIEZO, 1, false, messageType, messageID, messageData);
+}
+
+bool __cdecl PCC_WaitForMessage(char const * serialNo, WORD * messageType, WORD * messageID, DWORD *messageData)
+{
+	return NextMessage(serialNo, KSIM_PIEZO, 1, true, messageType, messageID, messageData);
+}
+
+int __cdecl PCC_MessageQueueSize(char const * serialNo) { return MessageQueueSize(serialNo, KSIM_PIEZO, 1); }
+void __cdecl PCC_ClearMessageQueue(char const * serialNo) { ClearMessageQueue(serialNo, KSIM_PIEZO, 1); }
+
+//*******************************************************************************************
+// Strain gauge (SG_*).
+
+short __cdecl SG_Open(char const * serialNo) { return Open(serialNo, KSIM_STRAINGAUGE); }
+void __cdecl SG_Close(char const * serialNo) { Close(serialNo, KSIM_STRAINGAUGE); }
+void __cdecl SG_Identify(char const * serialNo) { Request(serialNo, KSIM_STRAINGAUGE, 1); }
+bool __cdecl SG_StartPolling(char const * serialNo, int milliseconds) { return StartPolling(serialNo, KSIM_STRAINGAUGE, 1, milliseconds); }
+int __cdecl SG_PollingDuration(char const * serialNo) { return PollingDuration(serialNo, KSIM_STRAINGAUGE, 1); }
+void __cdecl SG_StopPolling(char const * serialNo) { StopPolling(serialNo, KSIM_STRAINGAUGE, 1); }
+short __cdecl SG_RequestStatus(char const * serialNo) { return Request(serialNo, KSIM_STRAINGAUGE, 1); }
+DWORD __cdecl SG_GetStatusBits(char const * serialNo) { return StatusBits(serialNo, KSIM_STRAINGAUGE, 1); }
+
+short __cdecl SG_GetReading(char const * serialNo, bool clipReading)
+{
+	return (short)SG_GetReadingExt(serialNo, clipReading, NULL);
+}
+
+int __cdecl SG_GetReadingExt(char const * serialNo, bool clipReading, bool *overrange)
+{
+	return WithDevice(serialNo, KSIM_STRAINGAUGE, false, 0, [&](Device & dev, double) {
+		if (overrange)
+			*overrange = dev.cachedOverrange;
+		int reading = dev.cachedReading;
+		if (clipReading)
+			reading = std::max(-(int)SG_FULLSCALE, std::min((int)SG_FULLSCALE, reading));
+		return reading;
+	});
+}
+
+short __cdecl SG_SetZero(char const * serialNo)
+{
+	return WithDevice(serialNo, KSIM_STRAINGAUGE, true, (short)KSIM_FT_DEVICENOTOPENED, [&](Device & dev, double t) {
+		dev.zeroUntil = t + SG_ZERO_SECONDS;
+		Refresh(dev, 0, t);
+		return (short)KSIM_OK;
+	});
+}
+
+WORD __cdecl SG_GetMaximumTravel(char const * serialNo)
+{
+	return WithDevice(serialNo, KSIM_STRAINGAUGE, false, (WORD)0, [&](Device & dev, double) {
+		auto it = g_devices.find(dev.piezo);
+		double travel = it != g_devices.end() ? it->second->travel : 20.0;
+		return (WORD)floor(travel * 10 + 0.5);	// 100 nm units
+	});
+}
+
+bool __cdecl SG_GetNextMessage(char const * serialNo, WORD * messageType, WORD * messageID, DWORD *messageData)
+{
+	return NextMessage(serialNo, KSIM_STRAINGAUGE, 1, false, messageType, messageID, messageData);
+}
+
+bool __cdecl SG_WaitForMessage(char const * serialNo, WORD * messageType, WORD * messageID, DWORD *messageData)
+{
+	return NextMessage(serialNo, KSIM_STRAINGAUGE, 1, true, messageType, messageID, messageData);
+}
+
+int __cdecl SG_MessageQueueSize(char const * serialNo) { return MessageQueueSize(serialNo, KSIM_STRAINGAUGE, 1); }
+void __cdecl SG_ClearMessageQueue(char const * serialNo) { ClearMessageQueue(serialNo, KSIM_STRAINGAUGE, 1); }
+
+//*******************************************************************************************
+// Benchtop stepper (SBC_*).
+
+short __cdecl SBC_Open(char const * serialNo) { return Open(serialNo, KSIM_STEPPER); }
+void __cdecl SBC_Close(char const * serialNo) { Close(serialNo, KSIM_STEPPER); }
+void __cdecl SBC_Identify(char const * serialNo, short channel) { Request(serialNo, KSIM_STEPPER, channel); }
+bool __cdecl SBC_StartPolling(char const * serialNo, short channel, int milliseconds) { return StartPolling(serialNo, KSIM_STEPPER, channel, milliseconds); }
+int __cdecl SBC_PollingDuration(char const * serialNo, short channel) { return PollingDuration(serialNo, KSIM_STEPPER, channel); }
+void __cdecl SBC_StopPolling(char const * serialNo, short channel) { StopPolling(serialNo, KSIM_STEPPER, channel); }
+short __cdecl SBC_RequestStatusBits(char const * serialNo, short channel) { return Request(serialNo, KSIM_STEPPER, channel); }
+DWORD __cdecl SBC_GetStatusBits(char const * serialNo, short channel) { return StatusBits(serialNo, KSIM_STEPPER, channel); }
+short __cdecl SBC_RequestPosition(char const * serialNo, short channel) { return Request(serialNo, KSIM_STEPPER, channel); }
+
+short __cdecl SBC_EnableChannel(char const * serialNo, short channel)
+{
+	return WithDevice(serialNo, KSIM_STEPPER, true, (short)KSIM_FT_DEVICENOTOPENED, [&](Device & dev, double) {
+		if (!ValidChannel(dev, channel))
+			return (short)KSIM_TL_INVALID_CHANNEL;
+		dev.channels[channel - 1].enabled = true;
+		return (short)KSIM_OK;
+	});
+}
+
+short __cdecl SBC_DisableChannel(char const * serialNo, short channel)
+{
+	return WithDevice(serialNo, KSIM_STEPPER, true, (short)KSIM_FT_DEVICENOTOPENED, [&](Device & dev, double t) {
+		if (!ValidChannel(dev, channel))
+			return (short)KSIM_TL_INVALID_CHANNEL;
+		StepperStop(dev.channels[channel - 1], t);
+		dev.channels[channel - 1].enabled = false;
+		return (short)KSIM_OK;
+	});
+}
+
+int __cdecl SBC_GetPosition(char const * serialNo, short channel)
+{
+	return WithDevice(serialNo, KSIM_STEPPER, false, 0, [&](Device & dev, double) {
+		return ValidChannel(dev, channel) ? dev.channels[channel - 1].cachedPosition : 0;
+	});
+}
+
+short __cdecl SBC_Home(char const * serialNo, short channel)
+{
+	return StepperCommand(serialNo, channel, true, [](Channel &, double) { return 0.0; });
+}
+
+short __cdecl SBC_MoveToPosition(char const * serialNo, short channel, int index)
+{
+	return StepperCommand(serialNo, channel, false, [&](Channel &, double) { return (double)index; });
+}
+
+short __cdecl SBC_MoveRelative(char const * serialNo, short channel, int displacement)
+{
+	return StepperCommand(serialNo, channel, false, [&](Channel & ch, double t) {
+		return (ch.moving ? ch.moveTo : StepperPosition(ch, t)) + displacement;
+	});
+}
+
+short __cdecl SBC_MoveJog(char const * serialNo, short channel, MOT_TravelDirection jogDirection)
+{
+	if (jogDirection != MOT_Forwards && jogDirection != MOT_Reverse)
+		return KSIM_FT_INVALIDPARAMETER;
+	return StepperCommand(serialNo, channel, false, [&](Channel & ch, double t) {
+		double step = jogDirection == MOT_Forwards ? (double)ch.jogStep : -(double)ch.jogStep;
+		return (ch.moving ? ch.moveTo : StepperPosition(ch, t)) + step;
+	});
+}
+
+short __cdecl SBC_StopImmediate(char const * serialNo, short channel) { return StepperHalt(serialNo, channel); }
+short __cdecl SBC_StopProfiled(char const * serialNo, short channel) { return StepperHalt(serialNo, channel); }
+short __cdecl SBC_RequestJogParams(char const * serialNo, short channel) { return Request(serialNo, KSIM_STEPPER, channel); }
+
+short __cdecl SBC_SetJogStepSize(char const * serialNo, short channel, unsigned int stepSize)
+{
+	return WithDevice(serialNo, KSIM_STEPPER, true, (short)KSIM_FT_DEVICENOTOPENED, [&](Device & dev, double) {
+		if (!ValidChannel(dev, channel))
+			return (short)KSIM_TL_INVALID_CHANNEL;
+		dev.channels[channel - 1].jogStep = stepSize;
+		return (short)KSIM_OK;
+	});
+}
+
+unsigned int __cdecl SBC_GetJogStepSize(char const * serialNo, short channel)
+{
+	return WithDevice(serialNo, KSIM_STEPPER, false, 0u, [&](Device & dev, double) {
+		return ValidChannel(dev, channel) ? dev.channels[channel - 1].jogStep : 0u;
+	});
+}
+
+short __cdecl SBC_SetVelParams(char const * serialNo, short channel, int acceleration, int maxVelocity)
+{
+	return WithDevice(serialNo, KSIM_STEPPER, true, (short)KSIM_FT_DEVICENOTOPENED, [&](Device & dev, double) {
+		if (!ValidChannel(dev, channel))
+			return (short)KSIM_TL_INVALID_CHANNEL;
+		if (acceleration <= 0 || maxVelocity <= 0)
+			return (short)KSIM_FT_INVALIDPARAMETER;
+		dev.channels[channel - 1].acceleration = acceleration;
+		dev.channels[channel - 1].maxVelocity = maxVelocity;
+		return (short)KSIM_OK;
+	});
+}
+
+short __cdecl SBC_GetVelParams(char const * serialNo, short channel, int * acceleration, int * maxVelocity)
+{
+	return WithDevice(serialNo, KSIM_STEPPER, true, (short)KSIM_FT_DEVICENOTOPENED, [&](Device & dev, double) {
+		if (!ValidChannel(dev, channel))
+			return (short)KSIM_TL_INVALID_CHANNEL;
+		if (acceleration) *acceleration = dev.channels[channel - 1].acceleration;
+		if (maxVelocity) *maxVelocity = dev.channels[channel - 1].maxVelocity;
+		return (short)KSIM_OK;
+	});
+}
+
+bool __cdecl SBC_GetNextMessage(char const * serialNo, short channel, WORD * messageType, WORD * messageID, DWORD *messageData)
+{
+	return NextMessage(serialNo, KSIM_STEPPER, channel, false, messageType, messageID, messageData);
+}
+
+bool __cdecl SBC_WaitForMessage(char const * serialNo, short channel, WORD * messageType, WORD * messageID, DWORD *messageData)
+{
+	return NextMessage(serialNo, KSIM_STEPPER, channel, true, messageType, messageID, messageData);
+}
+
+int __cdecl SBC_MessageQueueSize(char const * serialNo, short channel) { return MessageQueueSize(serialNo, KSIM_STEPPER, channel); }
+void __cdecl SBC_ClearMessageQueue(char const * serialNo, short channel) { ClearMessageQueue(serialNo, KSIM_STEPPER, channel); }
+
+//*******************************************************************************************
+// Laser diode (LD_*).
+
+short __cdecl LD_Open(char const * serialNo) { return Open(serialNo, KSIM_LASERDIODE); }
+void __cdecl LD_Close(char const * serialNo) { Close(serialNo, KSIM_LASERDIODE); }
+void __cdecl LD_Identify(char const * serialNo) { Request(serialNo, KSIM_LASERDIODE, 1); }
+bool __cdecl LD_StartPolling(char const * serialNo, int milliseconds) { return StartPolling(serialNo, KSIM_LASERDIODE, 1, milliseconds); }
+int __cdecl LD_PollingDuration(char const * serialNo) { return PollingDuration(serialNo, KSIM_LASERDIODE, 1); }
+void __cdecl LD_StopPolling(char const * serialNo) { StopPolling(serialNo, KSIM_LASERDIODE, 1); }
+short __cdecl LD_Enable(char const * serialNo) { return SetEnabled(serialNo, KSIM_LASERDIODE, true); }
+short __cdecl LD_Disable(char const * serialNo) { return SetEnabled(serialNo, KSIM_LASERDIODE, false); }
+short __cdecl LD_RequestStatus(char const * serialNo) { return Request(serialNo, KSIM_LASERDIODE, 1); }
+DWORD __cdecl LD_GetStatusBits(char const * serialNo) { return StatusBits(serialNo, KSIM_LASERDIODE, 1); }
+
+short __cdecl LD_EnableOutput(char const * serialNo) { return LaserDiodeCommand(serialNo, [](Device & dev) { dev.output = true; }); }
+short __cdecl LD_DisableOutput(char const * serialNo) { return LaserDiodeCommand(serialNo, [](Device & dev) { dev.output = false; }); }
+short __cdecl LD_SetOpenLoopMode(char const * serialNo) { return LaserDiodeCommand(serialNo, [](Device & dev) { dev.closedLoop = false; }); }
+short __cdecl LD_SetClosedLoopMode(char const * serialNo) { return LaserDiodeCommand(serialNo, [](Device & dev) { dev.closedLoop = true; }); }
+
+short __cdecl LD_SetLaserSetPoint(char const * serialNo, WORD laserDiodeCurrent)
+{
+	return LaserDiodeCommand(serialNo, [&](Device & dev) { dev.setPoint = laserDiodeCurrent; });
+}
+
+WORD __cdecl LD_GetLaserSetPoint(char const * serialNo)
+{
+	return WithDevice(serialNo, KSIM_LASERDIODE, false, (WORD)0, [&](Device & dev, double) {
+		return dev.setPoint;
+	});
+}
+
+short __cdecl LD_GetLaserDiodeCurrentReading(char const * serialNo)
+{
+	return WithDevice(serialNo, KSIM_LASERDIODE, false, (short)0, [&](Device & dev, double) {
+		return (short)(dev.output && dev.enabled ? std::min(32767, (int)dev.setPoint) : 0);
+	});
+}
+
+short __cdecl LD_SetWACalibFactor(char const * serialNo, float calibFactor)
+{
+	if (!(calibFactor > 0))
+		return KSIM_FT_INVALIDPARAMETER;
+	return LaserDiodeCommand(serialNo, [&](Device & dev) { dev.calibFactor = calibFactor; });
+}
+
+float __cdecl LD_GetWACalibFactor(char const * serialNo)
+{
+	return WithDevice(serialNo, KSIM_LASERDIODE, false, 0.0f, [&](Device & dev, double) {
+		return dev.calibFactor;
+	});
+}
+
+bool __cdecl LD_GetNextMessage(char const * serialNo, WORD * messageType, WORD * messageID, DWORD *messageData)
+{
+	return NextMessage(serialNo, KSIM_LASERDIODE, 1, false, messageType, messageID, messageData);
+}
+
+bool __cdecl LD_WaitForMessage(char const * serialNo, WORD * messageType, WORD * messageID, DWORD *messageData)
+{
+	return NextMessage(serialNo, KSIM_LASERDIODE, 1, true, messageType, messageID, messageData);
+}
+
+int __cdecl LD_MessageQueueSize(char const * serialNo) { return MessageQueueSize(serialNo, KSIM_LASERDIODE, 1); }
+void __cdecl LD_ClearMessageQueue(char const * serialNo) { ClearMessageQueue(serialNo, KSIM_LASERDIODE, 1); }
+
+} // extern "C"
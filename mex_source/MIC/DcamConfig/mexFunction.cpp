@@ -1,4 +1,5 @@
 #include "stdafx.h"
+#include "DcamHandle.h"
 
 #define NUMBER_OF_FRAMES						4			// The number of frames to be captured.
 #define USE_DCAM_BASIC_EXPOSURETIME_SET			TRUE		// If set to FALSE, this program will use the dcam_extended() function to control exposure time.
@@ -16,15 +17,10 @@ void mexFunction(int nlhs, mxArray *plhs[],	int	nrhs, const	mxArray	*prhs[]) {
 	char	CameraID[64];
 	long	i;
 	HDCAM	hDCAM = NULL;
-	long   Handle;
 	
 	
 	// input handle from Matlab
-	
-	Handle=(long)mxGetScalar(prhs[0]);
-	if (!mxIsInt32(prhs[0]))
-		mexErrMsgTxt("handle must be type INT 32.");
-	hDCAM=(HDCAM)Handle;
+	hDCAM=DcamGetHandle(prhs[0]);
 	//mexErrMsgTxt("Serial number must be a string.");
 	
 	if (dcam_getstring(hDCAM,DCAM_IDSTR_MODEL,CameraName,sizeof(CameraName)))
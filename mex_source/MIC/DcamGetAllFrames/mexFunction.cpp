@@ -1,93 +1,173 @@
+#include <condition_variable>	// before stdafx.h, which defines min and max
+#include <mutex>
+#include <thread>
+#include <vector>
 #include "stdafx.h"
+#include "DcamFrameCopy.h"
+#include "DcamHandle.h"
 
 #define USE_DCAM_BASIC_EXPOSURETIME_SET			TRUE		// If set to FALSE, this program will use the dcam_extended() function to control exposure time.
 #define USE_DCAM_API_MEMORY_MANAGEMENT			TRUE		// If set to FALSE, this program owns the recording memory buffer.
 
+#define DEFAULT_TIMEOUT_MS	10000
+#define MAX_COPY_THREADS	8
+#define MIN_THREAD_BYTES	(1 << 20)	// smaller frames are copied on one thread
 
+// [Frames] = DcamGetAllFrames(CameraHandle, FrameCount, TimeoutMs)
+// Waits up to TimeoutMs (default 10000) for the end of the capture and
+// returns the first FrameCount frames as an X by Y by FrameCount array of the
+// camera data type (uint8 or uint16).  RGB frames are returned as
+// X by Y by FrameCount by 3.
+
+// DCAM-API 3 allows one locked frame at a time, so the frames are locked in
+// turn and each frame is split by rows across one set of threads started
+// for the whole call.
+class FrameCopyWorkers
+{
+public:
+	FrameCopyWorkers(const DcamPixelFormat& Format, SIZE ImageSize, size_t FrameBytes, size_t PlaneStride)
+		: m_Format(Format), m_ImageSize(ImageSize), m_PlaneStride(PlaneStride), m_NThreads(1),
+		m_Generation(0), m_Pending(0), m_Stop(false), m_Out(NULL), m_pTop(NULL), m_pRowBytes(0)
+	{
+		int NThreads = (int)std::thread::hardware_concurrency();
+		if (NThreads > MAX_COPY_THREADS)
+			NThreads = MAX_COPY_THREADS;
+		if (NThreads >= 2 && FrameBytes >= MIN_THREAD_BYTES)
+			m_NThreads = NThreads;
+		for (int tt = 1; tt < m_NThreads; tt++)
+			m_Threads.push_back(std::thread(&FrameCopyWorkers::Run, this, tt));
+	}
+	~FrameCopyWorkers()
+	{
+		{
+			std::lock_guard<std::mutex> lk(m_Lock);
+			m_Stop = true;
+		}
+		m_Start.notify_all();
+		for (size_t tt = 0; tt < m_Threads.size(); tt++)
+			m_Threads[tt].join();
+	}
+
+	// Copies one locked frame; returns once every row block is done.
+	void Copy(void* Out, const void* pTop, long pRowBytes)
+	{
+		if (m_Threads.empty())
+		{
+			m_Format.CopyRows(Out, pTop, pRowBytes, m_ImageSize.cx, 0, m_ImageSize.cy, m_PlaneStride);
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lk(m_Lock);
+			m_Out = Out;
+			m_pTop = pTop;
+			m_pRowBytes = pRowBytes;
+			m_Pending = (int)m_Threads.size();
+			m_Generation++;
+		}
+		m_Start.notify_all();
+		CopyBlock(0);
+		std::unique_lock<std::mutex> lk(m_Lock);
+		m_Done.wait(lk, [this] { return m_Pending == 0; });
+	}
+
+private:
+	void CopyBlock(int tt)
+	{
+		long Rows = m_ImageSize.cy;
+		m_Format.CopyRows(m_Out, m_pTop, m_pRowBytes, m_ImageSize.cx,
+			Rows*tt / m_NThreads, Rows*(tt + 1) / m_NThreads, m_PlaneStride);
+	}
+	void Run(int tt)
+	{
+		unsigned long Seen = 0;
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lk(m_Lock);
+				m_Start.wait(lk, [this, Seen] { return m_Stop || m_Generation != Seen; });
+				if (m_Stop)
+					return;
+				Seen = m_Generation;
+			}
+			CopyBlock(tt);
+			{
+				std::lock_guard<std::mutex> lk(m_Lock);
+				m_Pending--;
+			}
+			m_Done.notify_one();
+		}
+	}
+
+	const DcamPixelFormat& m_Format;
+	SIZE	m_ImageSize;
+	size_t	m_PlaneStride;
+	int		m_NThreads;
+	std::vector<std::thread> m_Threads;
+	std::mutex	m_Lock;
+	std::condition_variable	m_Start, m_Done;
+	unsigned long	m_Generation;
+	int		m_Pending;
+	bool	m_Stop;
+	void*	m_Out;
+	const void*	m_pTop;
+	long	m_pRowBytes;
+};
 
 //*******************************************************************************************
 void mexFunction(int nlhs, mxArray *plhs[],	int	nrhs, const	mxArray	*prhs[]) {
 
 	long	CameraIndex = 0;	
 	HDCAM	hDCAM = NULL;
-	long	Handle;
 	long	FrameCount;
 	SIZE    ImageSize;
 	long	NewestFrameIndex = -1;
 	long	TotalFrames = 0;
 	void*	pTop=0;
 	long	pRowBytes=0;
-	unsigned short* OutImage=0;
-	DCAM_DATATYPE DataType;
-	long BytesPerPixel;
-	mwSize	outsize[1];
+	char*	OutImage=0;
+	DcamPixelFormat Format;
+	mwSize	outsize[4];
+	int32	TimeoutMs = DEFAULT_TIMEOUT_MS;
+
+	if (nrhs < 2 || nrhs > 3)
+		mexErrMsgTxt("Proper Usage: [Frames]=DcamGetAllFrames(CameraHandle,FrameCount,TimeoutMs)");
 	// input handle from Matlab
-	Handle=(long)mxGetScalar(prhs[0]);
 	FrameCount=(long)mxGetScalar(prhs[1]);
-	if (!mxIsInt32(prhs[0]))
-		mexErrMsgTxt("handle must be type INT 32.");
+	if (nrhs > 2)
+		TimeoutMs = (int32)mxGetScalar(prhs[2]);
 
-	hDCAM=(HDCAM)Handle;
+	hDCAM=DcamGetHandle(prhs[0]);
     // output image
-	if (dcam_getdatasize(hDCAM,&ImageSize)==FALSE)
-		mexPrintf("Error = 0x%08lX\nCould not get the data size of the camera.\n",(_DWORD)dcam_getlasterror(hDCAM,NULL,0));
+	if (!DcamGetFrameFormat(hDCAM,&ImageSize,&Format))
+		mexErrMsgTxt("Could not get the frame format of the camera.");
 	mexPrintf("\nImage size is %ld by %ld\n",ImageSize.cx,ImageSize.cy);
 
-	if (dcam_getdatatype(hDCAM,&DataType))
-	{
-		switch (DataType) {
-		case DCAM_DATATYPE_UINT8:
-		case DCAM_DATATYPE_INT8:
-			BytesPerPixel = 1;
-			break;
-		case DCAM_DATATYPE_UINT16:
-		case DCAM_DATATYPE_INT16:
-			BytesPerPixel = 2;
-			break;
-		case DCAM_DATATYPE_RGB24:
-		case DCAM_DATATYPE_BGR24:
-			BytesPerPixel = 3;
-			break;
-		case DCAM_DATATYPE_RGB48:
-		case DCAM_DATATYPE_BGR48:
-			BytesPerPixel = 6;
-		}
-		//mexPrintf("\n %ld Bytes per pixel\n",BytesPerPixel);
-	}
-	else
-		mexPrintf("Error = 0x%08lX\nCould not get the data type of the camera.\n\n",(_DWORD)dcam_getlasterror(hDCAM,NULL,0));
-	
-	if (DataType!=DCAM_DATATYPE_UINT16)
-		mexErrMsgTxt("\nData type has to be Uint 16\n");
 	// creat output
-	outsize[0]=ImageSize.cx*ImageSize.cy*FrameCount;
-	plhs[0]=mxCreateNumericArray(1,outsize,mxUINT16_CLASS,mxREAL);
-	OutImage=(unsigned short*)mxGetData(plhs[0]);
-	//mexErrMsgTxt("handle must be type INT 32.");
+	outsize[0]=ImageSize.cx;
+	outsize[1]=ImageSize.cy;
+	outsize[2]=FrameCount;
+	outsize[3]=Format.Channels;
+	plhs[0]=mxCreateNumericArray(Format.Channels > 1 ? 4 : 3,outsize,Format.ClassID,mxREAL);
+	OutImage=(char*)mxGetData(plhs[0]);
+	size_t FramePixels=(size_t)ImageSize.cx*ImageSize.cy;
+	size_t FrameBytes=FramePixels*Format.BytesPerSample;
 
-	
 	mexPrintf("Starting to wait for capture end\n");
 	_DWORD	Event=DCAM_EVENT_CAPTUREEND;
-	//if(dcam_wait(hDCAM,&Event,DCAM_WAIT_INFINITE,NULL))
-	if (dcam_wait(hDCAM, &Event, 10000, NULL))
+	if (dcam_wait(hDCAM, &Event, TimeoutMs, NULL))
 	{
 		if (dcam_gettransferinfo(hDCAM,&NewestFrameIndex,&TotalFrames))
 			mexPrintf("\nrecorded total frame numbers is %ld\n",TotalFrames);
+		FrameCopyWorkers Workers(Format,ImageSize,FrameBytes*Format.Channels,FramePixels*FrameCount);
 		for (long kk=0;kk<FrameCount;kk++)
 		{
 			if (dcam_lockdata(hDCAM,&pTop,&pRowBytes,kk) && pTop)
 			{
-				//mexPrintf("\n %ld Bytes in each row\n",pRowBytes);
-				for (int ii=0;ii < ImageSize.cy;ii++)
-				{
-					memcpy(OutImage,pTop,ImageSize.cx*BytesPerPixel);
-					pTop=(void*)((char*)pTop+pRowBytes);
-					OutImage=(unsigned short*)((char*)OutImage+ImageSize.cx*BytesPerPixel);
-				}
+				Workers.Copy(OutImage+kk*FrameBytes,pTop,pRowBytes);
 				dcam_unlockdata(hDCAM);
 			}
 			else
-				mexPrintf("Error = 0x%08lX\ndcam_lockdata on frame index %ld failed.\n\n",(_DWORD)dcam_getlasterror(hDCAM,NULL,0),NewestFrameIndex);
+				mexPrintf("Error = 0x%08lX\ndcam_lockdata on frame index %ld failed.\n\n",(_DWORD)dcam_getlasterror(hDCAM,NULL,0),kk);
 		}
 	}
 	else
@@ -1,4 +1,6 @@
 #include "stdafx.h"
+#include "DcamFrameCopy.h"
+#include "DcamHandle.h"
 
 #define USE_DCAM_BASIC_EXPOSURETIME_SET			TRUE		// If set to FALSE, this program will use the dcam_extended() function to control exposure time.
 #define USE_DCAM_API_MEMORY_MANAGEMENT			TRUE		// If set to FALSE, this program owns the recording memory buffer.
@@ -10,65 +12,31 @@ void mexFunction(int nlhs, mxArray *plhs[],	int	nrhs, const	mxArray	*prhs[]) {
 
 	long	CameraIndex = 0;	
 	HDCAM	hDCAM = NULL;
-	long	Handle;
 	long	FrameCount;
 	SIZE    ImageSize;
 	long	NewestFrameIndex = -1;
 	long	TotalFrames = 0;
 	void*	pTop=0;
 	long	pRowBytes=0;
-	unsigned short* OutImage=0;
-	DCAM_DATATYPE DataType;
-	long BytesPerPixel;
+	void*	OutImage=0;
+	DcamPixelFormat Format;
 	mwSize	outsize[1];
 	int32	Signal=0;
 	// input handle from Matlab
-	Handle=(long)mxGetScalar(prhs[0]);
-	if (!mxIsInt32(prhs[0]))
-		mexErrMsgTxt("handle must be type INT 32.");
-	
-	hDCAM=(HDCAM)Handle;
+	hDCAM=DcamGetHandle(prhs[0]);
     // output image
 
 
 	//mexPrintf("Getting Data Size\n");
 
-	if (dcam_getdatasize(hDCAM,&ImageSize)==FALSE)
-		mexPrintf("Error = 0x%08lX\nCould not get the data size of the camera.\n",(_DWORD)dcam_getlasterror(hDCAM,NULL,0));
-	//mexPrintf("\nImage size is %ld by %ld\n",ImageSize.cx,ImageSize.cy);
-
-	//mexPrintf("Getting Data Type\n");
-	if (dcam_getdatatype(hDCAM,&DataType))
-	{
-		switch (DataType) {
-		case DCAM_DATATYPE_UINT8:
-		case DCAM_DATATYPE_INT8:
-			BytesPerPixel = 1;
-			break;
-		case DCAM_DATATYPE_UINT16:
-		case DCAM_DATATYPE_INT16:
-			BytesPerPixel = 2;
-			break;
-		case DCAM_DATATYPE_RGB24:
-		case DCAM_DATATYPE_BGR24:
-			BytesPerPixel = 3;
-			break;
-		case DCAM_DATATYPE_RGB48:
-		case DCAM_DATATYPE_BGR48:
-			BytesPerPixel = 6;
-		}
-		//mexPrintf("\n%ld Bytes per pixel\n",BytesPerPixel);
-	}
-	else
-		mexPrintf("Error = 0x%08lX\nCould not get the data type of the camera.\n\n",(_DWORD)dcam_getlasterror(hDCAM,NULL,0));
-	
-	if (DataType!=DCAM_DATATYPE_UINT16)
-		mexErrMsgTxt("\nData type has to be Uint 16\n");
+	if (!DcamGetFrameFormat(hDCAM,&ImageSize,&Format))
+		mexErrMsgTxt("Could not get the frame format of the camera.");
 
 	// create output
-	outsize[0]=ImageSize.cx*ImageSize.cy;
-	plhs[0]=mxCreateNumericArray(1,outsize,mxUINT16_CLASS,mxREAL);
-	OutImage=(unsigned short*)mxGetData(plhs[0]);
+	size_t	Pixels=(size_t)ImageSize.cx*ImageSize.cy;
+	outsize[0]=Pixels*Format.Channels;
+	plhs[0]=mxCreateNumericArray(1,outsize,Format.ClassID,mxREAL);
+	OutImage=mxGetData(plhs[0]);
 	//mexErrMsgTxt("handle must be type INT 32.");
 
 	if (dcam_gettransferinfo(hDCAM, &NewestFrameIndex, &TotalFrames))
@@ -78,12 +46,7 @@ void mexFunction(int nlhs, mxArray *plhs[],	int	nrhs, const	mxArray	*prhs[]) {
 
 			if (dcam_lockdata(hDCAM, &pTop, &pRowBytes, NewestFrameIndex) && pTop)
 			{
-				for (int ii = 0; ii < ImageSize.cy; ii++)
-				{
-					memcpy(OutImage, pTop, ImageSize.cx*BytesPerPixel);
-					pTop = (void*)((char*)pTop + pRowBytes);
-					OutImage = (unsigned short*)((char*)OutImage + ImageSize.cx*BytesPerPixel);
-				}
+				Format.CopyRows(OutImage, pTop, pRowBytes, ImageSize.cx, 0, ImageSize.cy, Pixels);
 				dcam_unlockdata(hDCAM);
 			}
 			else
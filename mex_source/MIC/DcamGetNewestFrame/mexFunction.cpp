@@ -1,176 +1,115 @@
+#include <chrono>		// before stdafx.h, which defines min and max
 #include "stdafx.h"
+#include "DcamFrameCopy.h"
+#include "DcamHandle.h"
 
 #define USE_DCAM_BASIC_EXPOSURETIME_SET			TRUE		// If set to FALSE, this program will use the dcam_extended() function to control exposure time.
 #define USE_DCAM_API_MEMORY_MANAGEMENT			TRUE		// If set to FALSE, this program owns the recording memory buffer.
 
-void dcam_test_dcamwait(int32 *Signals, HDCAM hdcam, int nTimes );
+#define DEFAULT_TIMEOUT_MS	1000
+
+// [Image, FrameIndex, WaitTime, IsNew] = DcamGetNewestFrame(CameraHandle, TimeoutMs)
+// Returns the newest frame of a running capture.  If no frame has arrived
+// since the previous call, waits for the next DCAM_EVENT_FRAMEEND for at most
+// TimeoutMs (default 1000).  FrameIndex is the buffer index of the frame and
+// WaitTime the time spent waiting (s).  Image is a vector of the camera data
+// type (uint8 or uint16), holding three colour planes in RGB modes.  If no
+// new frame arrives before the timeout, the newest frame in the buffer is
+// returned again and IsNew is false; Image is empty and FrameIndex -1 only
+// if the buffer holds no frame yet.
+
+// Frames transferred when the last frame was returned, so a frame that
+// arrived between calls is returned without waiting.  A lower count on the
+// same camera belongs to a new capture.
+static HDCAM	s_LastCamera = NULL;
+static long		s_LastTotalFrames = -1;
 
 //*******************************************************************************************
 void mexFunction(int nlhs, mxArray *plhs[],	int	nrhs, const	mxArray	*prhs[]) {
 
-	long	CameraIndex = 0;	
 	HDCAM	hDCAM = NULL;
-	long	Handle;
-	long	FrameCount;
 	SIZE    ImageSize;
 	long	NewestFrameIndex = -1;
 	long	TotalFrames = 0;
 	void*	pTop=0;
 	long	pRowBytes=0;
-	unsigned short* OutImage=0;
-	DCAM_DATATYPE DataType;
-	long BytesPerPixel;
+	void*	OutImage=0;
+	DcamPixelFormat Format;
 	mwSize	outsize[1];
-	int32	Signal=0;
+	int32	TimeoutMs = DEFAULT_TIMEOUT_MS;
+
+	if (nrhs < 1 || nrhs > 2)
+		mexErrMsgTxt("Proper Usage: [Image,FrameIndex,WaitTime,IsNew]=DcamGetNewestFrame(CameraHandle,TimeoutMs)");
+
 	// input handle from Matlab
-	Handle=(long)mxGetScalar(prhs[0]);
-	if (!mxIsInt32(prhs[0]))
-		mexErrMsgTxt("handle must be type INT 32.");
-	
-	hDCAM=(HDCAM)Handle;
-    // output image
+	if (nrhs > 1)
+		TimeoutMs = (int32)mxGetScalar(prhs[1]);
 
+	hDCAM=DcamGetHandle(prhs[0]);
 
+	if (!DcamGetFrameFormat(hDCAM,&ImageSize,&Format))
+		mexErrMsgTxt("Could not get the frame format of the camera.");
 
-	if (dcam_getdatasize(hDCAM,&ImageSize)==FALSE)
-		mexPrintf("Error = 0x%08lX\nCould not get the data size of the camera.\n",(_DWORD)dcam_getlasterror(hDCAM,NULL,0));
+	if (!dcam_gettransferinfo(hDCAM,&NewestFrameIndex,&TotalFrames))
+		mexErrMsgTxt("dcam_gettransferinfo failed.");
 
-	if (dcam_getdatatype(hDCAM,&DataType))
+	// Wait for the end of the next frame unless one arrived since the last call.
+	if (hDCAM != s_LastCamera || TotalFrames < s_LastTotalFrames)
 	{
-		switch (DataType) {
-		case DCAM_DATATYPE_UINT8:
-		case DCAM_DATATYPE_INT8:
-			BytesPerPixel = 1;
-			break;
-		case DCAM_DATATYPE_UINT16:
-		case DCAM_DATATYPE_INT16:
-			BytesPerPixel = 2;
-			break;
-		case DCAM_DATATYPE_RGB24:
-		case DCAM_DATATYPE_BGR24:
-			BytesPerPixel = 3;
-			break;
-		case DCAM_DATATYPE_RGB48:
-		case DCAM_DATATYPE_BGR48:
-			BytesPerPixel = 6;
+		s_LastCamera = hDCAM;
+		s_LastTotalFrames = -1;
+	}
+	std::chrono::steady_clock::time_point T1 = std::chrono::steady_clock::now();
+	bool NewFrame = NewestFrameIndex >= 0 && TotalFrames > s_LastTotalFrames;
+	if (!NewFrame)
+	{
+		_DWORD	dw = DCAM_EVENT_FRAMEEND;
+		if (dcam_wait(hDCAM,&dw,TimeoutMs,NULL))
+		{
+			if (!dcam_gettransferinfo(hDCAM,&NewestFrameIndex,&TotalFrames))
+				mexErrMsgTxt("dcam_gettransferinfo failed.");
+			NewFrame = NewestFrameIndex >= 0 && TotalFrames > s_LastTotalFrames;
 		}
-		//mexPrintf("\n%ld Bytes per pixel\n",BytesPerPixel);
+		else if (dcam_getlasterror(hDCAM,NULL,0) != DCAMERR_TIMEOUT)
+			mexPrintf("Error = 0x%08lX\ndcam_wait failed.\n\n",(_DWORD)dcam_getlasterror(hDCAM,NULL,0));
 	}
-	else
-		mexPrintf("Error = 0x%08lX\nCould not get the data type of the camera.\n\n",(_DWORD)dcam_getlasterror(hDCAM,NULL,0));
-	
-	if (DataType!=DCAM_DATATYPE_UINT16)
-		mexErrMsgTxt("\nData type has to be Uint 16\n");
+	double WaitTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - T1).count();
+
+	// Nothing was captured yet.
+	if (NewestFrameIndex < 0)
+	{
+		plhs[0] = mxCreateNumericMatrix(0,0,Format.ClassID,mxREAL);
+		if (nlhs > 1)
+			plhs[1] = mxCreateDoubleScalar(-1);
+		if (nlhs > 2)
+			plhs[2] = mxCreateDoubleScalar(WaitTime);
+		if (nlhs > 3)
+			plhs[3] = mxCreateLogicalScalar(false);
+		return;
+	}
+	if (NewFrame)
+		s_LastTotalFrames = TotalFrames;
 
 	// create output
-	outsize[0]=ImageSize.cx*ImageSize.cy;
-	plhs[0]=mxCreateNumericArray(1,outsize,mxUINT16_CLASS,mxREAL);
-	OutImage=(unsigned short*)mxGetData(plhs[0]);
-	//mexErrMsgTxt("handle must be type INT 32.");
-
-	dcam_test_dcamwait(&Signal,hDCAM,4);
-	//mexPrintf("Signal: %d\n",Signal);
-	if(Signal>0)
-		dcam_test_dcamwait(&Signal,hDCAM,4);
-	if (dcam_gettransferinfo(hDCAM,&NewestFrameIndex,&TotalFrames))
+	size_t	Pixels=(size_t)ImageSize.cx*ImageSize.cy;
+	outsize[0]=Pixels*Format.Channels;
+	plhs[0]=mxCreateNumericArray(1,outsize,Format.ClassID,mxREAL);
+	OutImage=mxGetData(plhs[0]);
+
+	if (dcam_lockdata(hDCAM,&pTop,&pRowBytes,NewestFrameIndex) && pTop)
 	{
-		while (NewestFrameIndex<0)
-		{
-			dcam_test_dcamwait(&Signal,hDCAM,4);
-			if (dcam_gettransferinfo(hDCAM,&NewestFrameIndex,&TotalFrames)==FALSE)
-				mexPrintf("Error = 0x%08lX\ndcam_gettransferinfo Failed.\n\n",(_DWORD)dcam_getlasterror(hDCAM,NULL,0));
-		}
-		//mexPrintf("Newest Frame index: %d\n",NewestFrameIndex);
-		//dcam_test_dcamwait(hDCAM,4);
-		if (dcam_lockdata(hDCAM,&pTop,&pRowBytes,NewestFrameIndex) && pTop)
-		{
-			//mexPrintf("\n %ld Bytes in each row\n",pRowBytes);
-			for (int ii=0;ii < ImageSize.cy;ii++)
-			{
-				memcpy(OutImage,pTop,ImageSize.cx*BytesPerPixel);
-				pTop=(void*)((char*)pTop+pRowBytes);
-				OutImage=(unsigned short*)((char*)OutImage+ImageSize.cx*BytesPerPixel);
-			}
-			dcam_unlockdata(hDCAM);
-		}
-		else
-			mexPrintf("Error = 0x%08lX\ndcam_lockdata on frame index %ld failed.\n\n",(_DWORD)dcam_getlasterror(hDCAM,NULL,0),NewestFrameIndex);
+		Format.CopyRows(OutImage,pTop,pRowBytes,ImageSize.cx,0,ImageSize.cy,Pixels);
+		dcam_unlockdata(hDCAM);
 	}
 	else
-		mexPrintf("Error = 0x%08lX\ndcam_gettransferinfo failed.\n\n",(_DWORD)dcam_getlasterror(hDCAM,NULL,0));
+		mexPrintf("Error = 0x%08lX\ndcam_lockdata on frame index %ld failed.\n\n",(_DWORD)dcam_getlasterror(hDCAM,NULL,0),NewestFrameIndex);
+
+	if (nlhs > 1)
+		plhs[1] = mxCreateDoubleScalar((double)NewestFrameIndex);
+	if (nlhs > 2)
+		plhs[2] = mxCreateDoubleScalar(WaitTime);
+	if (nlhs > 3)
+		plhs[3] = mxCreateLogicalScalar(NewFrame);
 
 	return;
 }
-
-void dcam_test_dcamwait( int32 *Signals, HDCAM hdcam, int nTimes )
-{
-	int	i;
-	int32	timeout = 100;	// 100 msec
-	int32	nFRAMESTART = 0;
-	int32	nFRAMEEND	= 0;
-	int32	nCYCLEEND	= 0;
-	int32	nVVALIDBEGIN= 0;
-	int32	nUNKNOWNEVENT = 0;
-	int32	nTIMEOUT	= 0;
-	int32	nERROR		= 0;
-	for( i = 0; i < nTimes; i++ )
-	{
-		char	c;
-		_DWORD	dw = 0
-					| DCAM_EVENT_FRAMESTART
-					| DCAM_EVENT_FRAMEEND
-					| DCAM_EVENT_CYCLEEND
-					| DCAM_EVENT_VVALIDBEGIN
-					;
-		/*_DWORD	dw = 0
-					| DCAM_EVENT_FRAMESTART
-					;*/
-		if( dcam_wait( hdcam, &dw, timeout, NULL ) )
-		{
-			switch( dw )
-			{
-			case DCAM_EVENT_FRAMESTART:		c = 'S';	nFRAMESTART++;	break;
-			case DCAM_EVENT_FRAMEEND:		c = 'F';	nFRAMEEND++;	break;
-			case DCAM_EVENT_CYCLEEND:		c = 'C';	nCYCLEEND++;	break;
-			case DCAM_EVENT_VVALIDBEGIN:	c = 'V';	nVVALIDBEGIN++;	break;
-			default:						c = 'n';	nUNKNOWNEVENT++;break;	// never happen
-			}
-		}
-		else
-		{
-			int32	err;
-			err = dcam_getlasterror( hdcam );
-			if( err == DCAMERR_TIMEOUT )
-			{
-				// event did not happened
-				c = '.';
-				nTIMEOUT++;
-			}
-			else
-			{
-				// unexpected error happened.
-				c = 'e';
-				nERROR++;
-			}
-		}
-
-		putchar( c );
-	}
-	Signals[0]=nCYCLEEND;
-	/*mexPrintf( "\n" );
-	if(nFRAMESTART != 0)
-		mexPrintf( "FRAMESTART:"	"\t%d\n", nFRAMESTART	);
-	if(nFRAMEEND != 0) 
-		mexPrintf( "FRAMEEND:"		"\t%d\n", nFRAMEEND		);
-	if(nCYCLEEND !=0 )
-		mexPrintf( "CYCLEEND:"		"\t%d\n", nCYCLEEND		);
-	if(nVVALIDBEGIN != 0)
-		mexPrintf( "VVALIDBEGIN:"	"\t%d\n", nVVALIDBEGIN	);
-	if( nUNKNOWNEVENT != 0 )
-		mexPrintf( "UNKNOWNEVENT:"	"\t%d\n", nUNKNOWNEVENT	);
-	if(nTIMEOUT !=0)
-		mexPrintf( "TIMEOUT:"		"\t%d\n", nTIMEOUT		);
-	if( nERROR != 0 )
-		mexPrintf( "ERROR: dcam_wait"		"\t%d\n", nERROR		);
-	*/	
-}
\ No newline at end of file
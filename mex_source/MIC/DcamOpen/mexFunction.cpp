@@ -1,4 +1,5 @@
 #include "stdafx.h"
+#include "DcamHandle.h"
 
 #define NUMBER_OF_FRAMES						4			// The number of frames to be captured.
 #define USE_DCAM_BASIC_EXPOSURETIME_SET			TRUE		// If set to FALSE, this program will use the dcam_extended() function to control exposure time.
@@ -22,20 +23,17 @@ void mexFunction(int nlhs, mxArray *plhs[],	int	nrhs, const	mxArray	*prhs[]) {
 	char	ApiVersion[64];
 	long	i;
 	HDCAM	hDCAM = NULL;
-	long    *Handle= 0;
-	mwSize  outsize[1];
 
 	CameraIndex=(long)mxGetScalar(prhs[0]);
-	// out put handle to Matlab
-	outsize[0]=1;
-	plhs[0]=mxCreateNumericArray(1,outsize,mxINT32_CLASS,mxREAL);
-	Handle=(long*)mxGetData(plhs[0]);
 
 
 	// initialize camera
-	if (dcam_open( &hDCAM, CameraIndex, NULL) && hDCAM)
+	if (!dcam_open( &hDCAM, CameraIndex, NULL))
+		hDCAM = NULL;
+	// out put handle to Matlab (UINT64, 0 if the camera could not be opened)
+	plhs[0]=DcamCreateHandle(hDCAM);
+	if (hDCAM)
 	{
-		Handle[0]=(long)hDCAM;
 		//mexPrintf("%ld",hDCAM);
 		mexPrintf("-----Camera information:----\n");
 		//mexErrMsgTxt("Serial number must be a string.");
@@ -1,4 +1,5 @@
 #include "stdafx.h"
+#include "DcamHandle.h"
 
 #define NUMBER_OF_FRAMES						4			// The number of frames to be captured.
 #define USE_DCAM_BASIC_EXPOSURETIME_SET			TRUE		// If set to FALSE, this program will use the dcam_extended() function to control exposure time.
@@ -15,19 +16,15 @@ void mexFunction(int nlhs, mxArray *plhs[],	int	nrhs, const	mxArray	*prhs[]) {
 	long	Binning;
 	long	i;
 	HDCAM	hDCAM = NULL;
-	long	Handle;
 	long	CurrentBinning;
 	_DWORD CameraCapability = 0;
 	// input handle from Matlab
 	
-	Handle=(long)mxGetScalar(prhs[0]);
 	Binning=(long)mxGetScalar(prhs[1]);
-	if (!mxIsInt32(prhs[0]))
-		mexErrMsgTxt("handle must be type INT 32.");
 	//if (!mxIsInt32(prhs[1]))
 		//mexErrMsgTxt("Binning  must be type INT 32.");
 
-	hDCAM=(HDCAM)Handle;
+	hDCAM=DcamGetHandle(prhs[0]);
 	//mexErrMsgTxt("Serial number must be a string.");
 
 	/*if (dcam_getcapability(hDCAM,&CameraCapability,DCAM_QUERYCAPABILITY_FUNCTIONS))
@@ -1,4 +1,5 @@
 #include "stdafx.h"
+#include "DcamHandle.h"
 #include "dcamprop.h"
 
 #define NUMBER_OF_FRAMES						4			// The number of frames to be captured.
@@ -14,18 +15,14 @@ void mexFunction(int nlhs, mxArray *plhs[],	int	nrhs, const	mxArray	*prhs[]) {
 
 	long	CameraIndex = 0;	
 	HDCAM	hDCAM = NULL;
-	long	Handle;
 	
 	_DWORD CameraCapability = 0;
 	double	DefectCorrectionMode;
 	// input handle from Matlab
 	
-	Handle=(long)mxGetScalar(prhs[0]);
 	DefectCorrectionMode=(double)mxGetScalar(prhs[1]);
-	if (!mxIsInt32(prhs[0]))
-		mexErrMsgTxt("handle must be type INT 32.");
 	
-	hDCAM=(HDCAM)Handle;
+	hDCAM=DcamGetHandle(prhs[0]);
 	
 	int32 iProp=DCAM_IDPROP_DEFECTCORRECT_MODE;
 	DCAM_PROPERTYATTR attr;
@@ -1,4 +1,5 @@
 #include "stdafx.h"
+#include "DcamHandle.h"
 
 #define NUMBER_OF_FRAMES						4			// The number of frames to be captured.
 #define USE_DCAM_BASIC_EXPOSURETIME_SET			TRUE		// If set to FALSE, this program will use the dcam_extended() function to control exposure time.
@@ -9,7 +10,6 @@ void mexFunction(int nlhs, mxArray *plhs[],	int	nrhs, const	mxArray	*prhs[]) {
 
 	long	CameraIndex = 0;	
 	HDCAM	hDCAM = NULL;
-	long	Handle;
 	
 	long FeatureMin;
 	long FeatureMax;
@@ -21,12 +21,9 @@ void mexFunction(int nlhs, mxArray *plhs[],	int	nrhs, const	mxArray	*prhs[]) {
 	mwSize outsize[1];
 	// input handle from Matlab
 	
-	Handle=(long)mxGetScalar(prhs[0]);
 	fNewExposureTimeValue=(float)mxGetScalar(prhs[1]);
-	if (!mxIsInt32(prhs[0]))
-		mexErrMsgTxt("handle must be type INT 32.");
 	
-	hDCAM=(HDCAM)Handle;
+	hDCAM=DcamGetHandle(prhs[0]);
 
 	// out put current exposure time
 	outsize[0]=1;
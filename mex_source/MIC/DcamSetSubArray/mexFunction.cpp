@@ -1,4 +1,5 @@
 #include "stdafx.h"
+#include "DcamHandle.h"
 
 #define NUMBER_OF_FRAMES						4			// The number of frames to be captured.
 #define USE_DCAM_BASIC_EXPOSURETIME_SET			TRUE		// If set to FALSE, this program will use the dcam_extended() function to control exposure time.
@@ -11,7 +12,6 @@ void mexFunction(int nlhs, mxArray *plhs[],	int	nrhs, const	mxArray	*prhs[]) {
 
 	long	CameraIndex = 0;	
 	HDCAM	hDCAM = NULL;
-	long	Handle;
 	long	HorizOff;
 	long	HorizWidth;
 	long	VertOff;
@@ -19,15 +19,12 @@ void mexFunction(int nlhs, mxArray *plhs[],	int	nrhs, const	mxArray	*prhs[]) {
 	
 	// input handle from Matlab
 	
-	Handle=(long)mxGetScalar(prhs[0]);
 	HorizOff=(long)mxGetScalar(prhs[1]);
 	HorizWidth=(long)mxGetScalar(prhs[2]);
 	VertOff=(long)mxGetScalar(prhs[3]);
 	VertHeight=(long)mxGetScalar(prhs[4]);
-	if (!mxIsInt32(prhs[0]))
-		mexErrMsgTxt("handle must be type INT 32.");
 	
-	hDCAM=(HDCAM)Handle;
+	hDCAM=DcamGetHandle(prhs[0]);
 	//mexErrMsgTxt("Serial number must be a string.");
 
 	// SubArray Inquiry Structure
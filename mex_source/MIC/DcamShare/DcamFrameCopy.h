@@ -0,0 +1,144 @@
+// DcamFrameCopy.h : frame copy kernels for the legacy (DCAM-API 3) Dcam mex
+// functions, specialized for each DCAM_DATATYPE.
+//
+// Include after stdafx.h.  Monochrome frames are returned as uint8, int8,
+// uint16 or int16 in camera order.  RGB and BGR frames are split into three
+// planes in R, G, B order, so a frame reshapes in MATLAB to X by Y by 3.
+
+#pragma once
+
+typedef void (*DcamCopyRowsFcn)(void* Out, const void* pTop, long pRowBytes,
+	long Width, long Row0, long Row1, size_t PlaneStride);
+
+// MATLAB class, channel count and copy kernel for one camera data type.
+struct DcamPixelFormat
+{
+	mxClassID		ClassID;
+	int				Channels;
+	int				BytesPerSample;		// bytes per channel in the output
+	DcamCopyRowsFcn	CopyRows;
+};
+
+template <DCAM_DATATYPE T> struct DcamPixel;
+
+#define DCAM_PIXEL(T, TYPE, CLASSID, CHANNELS, REVERSED) \
+	template <> struct DcamPixel<T> { \
+		typedef TYPE Type; \
+		static const mxClassID ClassID = CLASSID; \
+		static const int Channels = CHANNELS; \
+		static const bool Reversed = REVERSED; \
+	};
+
+DCAM_PIXEL(DCAM_DATATYPE_UINT8, unsigned char, mxUINT8_CLASS, 1, false)
+DCAM_PIXEL(DCAM_DATATYPE_INT8, signed char, mxINT8_CLASS, 1, false)
+DCAM_PIXEL(DCAM_DATATYPE_UINT16, unsigned short, mxUINT16_CLASS, 1, false)
+DCAM_PIXEL(DCAM_DATATYPE_INT16, short, mxINT16_CLASS, 1, false)
+DCAM_PIXEL(DCAM_DATATYPE_RGB24, unsigned char, mxUINT8_CLASS, 3, false)
+DCAM_PIXEL(DCAM_DATATYPE_BGR24, unsigned char, mxUINT8_CLASS, 3, true)
+DCAM_PIXEL(DCAM_DATATYPE_RGB48, unsigned short, mxUINT16_CLASS, 3, false)
+DCAM_PIXEL(DCAM_DATATYPE_BGR48, unsigned short, mxUINT16_CLASS, 3, true)
+
+#undef DCAM_PIXEL
+
+// Copies rows [Row0, Row1) of a locked frame to Out, which holds the whole
+// frame.  Colour planes are PlaneStride samples apart.  Monochrome frames
+// without row padding are copied in one block.
+template <DCAM_DATATYPE T>
+void DcamCopyRows(void* Out, const void* pTop, long pRowBytes,
+	long Width, long Row0, long Row1, size_t PlaneStride)
+{
+	typedef typename DcamPixel<T>::Type Sample;
+	const int Channels = DcamPixel<T>::Channels;
+	const size_t RowBytes = (size_t)Width*Channels*sizeof(Sample);
+
+	Sample* Dst = (Sample*)Out + (size_t)Row0*Width;
+	const char* Src = (const char*)pTop + (size_t)Row0*pRowBytes;
+
+	if (Channels == 1)
+	{
+		if ((size_t)pRowBytes == RowBytes)
+		{
+			memcpy(Dst, Src, (size_t)(Row1 - Row0)*RowBytes);
+			return;
+		}
+		for (long ii = Row0; ii < Row1; ii++)
+		{
+			memcpy(Dst, Src, RowBytes);
+			Src += pRowBytes;
+			Dst += Width;
+		}
+		return;
+	}
+
+	Sample* R = Dst;
+	Sample* G = Dst + PlaneStride;
+	Sample* B = Dst + 2*PlaneStride;
+	const int iR = DcamPixel<T>::Reversed ? 2 : 0;
+	const int iB = DcamPixel<T>::Reversed ? 0 : 2;
+	for (long ii = Row0; ii < Row1; ii++)
+	{
+		const Sample* s = (const Sample*)Src;
+		for (long jj = 0; jj < Width; jj++, s += 3)
+		{
+			R[jj] = s[iR];
+			G[jj] = s[1];
+			B[jj] = s[iB];
+		}
+		Src += pRowBytes;
+		R += Width;
+		G += Width;
+		B += Width;
+	}
+}
+
+template <DCAM_DATATYPE T>
+DcamPixelFormat DcamMakePixelFormat()
+{
+	DcamPixelFormat Format;
+	Format.ClassID = DcamPixel<T>::ClassID;
+	Format.Channels = DcamPixel<T>::Channels;
+	Format.BytesPerSample = (int)sizeof(typename DcamPixel<T>::Type);
+	Format.CopyRows = DcamCopyRows<T>;
+	return Format;
+}
+
+// Looks up the format of a camera data type.  Returns false for data types
+// without a copy kernel.
+inline bool DcamGetPixelFormat(DCAM_DATATYPE DataType, DcamPixelFormat* Format)
+{
+	switch (DataType) {
+	case DCAM_DATATYPE_UINT8:	*Format = DcamMakePixelFormat<DCAM_DATATYPE_UINT8>(); return true;
+	case DCAM_DATATYPE_INT8:	*Format = DcamMakePixelFormat<DCAM_DATATYPE_INT8>(); return true;
+	case DCAM_DATATYPE_UINT16:	*Format = DcamMakePixelFormat<DCAM_DATATYPE_UINT16>(); return true;
+	case DCAM_DATATYPE_INT16:	*Format = DcamMakePixelFormat<DCAM_DATATYPE_INT16>(); return true;
+	case DCAM_DATATYPE_RGB24:	*Format = DcamMakePixelFormat<DCAM_DATATYPE_RGB24>(); return true;
+	case DCAM_DATATYPE_BGR24:	*Format = DcamMakePixelFormat<DCAM_DATATYPE_BGR24>(); return true;
+	case DCAM_DATATYPE_RGB48:	*Format = DcamMakePixelFormat<DCAM_DATATYPE_RGB48>(); return true;
+	case DCAM_DATATYPE_BGR48:	*Format = DcamMakePixelFormat<DCAM_DATATYPE_BGR48>(); return true;
+	default:
+		return false;
+	}
+}
+
+// Gets the data size and pixel format of the camera, printing the DCAM
+// error and returning false on failure.
+inline bool DcamGetFrameFormat(HDCAM hDCAM, SIZE* ImageSize, DcamPixelFormat* Format)
+{
+	DCAM_DATATYPE DataType;
+	if (dcam_getdatasize(hDCAM,ImageSize)==FALSE)
+	{
+		mexPrintf("Error = 0x%08lX\nCould not get the data size of the camera.\n",(_DWORD)dcam_getlasterror(hDCAM,NULL,0));
+		return false;
+	}
+	if (!dcam_getdatatype(hDCAM,&DataType))
+	{
+		mexPrintf("Error = 0x%08lX\nCould not get the data type of the camera.\n\n",(_DWORD)dcam_getlasterror(hDCAM,NULL,0));
+		return false;
+	}
+	if (!DcamGetPixelFormat(DataType,Format))
+	{
+		mexPrintf("Data type 0x%08lX is not supported.\n",(_DWORD)DataType);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,29 @@
+// DcamHandle.h : camera handles passed between MATLAB and the legacy
+// (DCAM-API 3) Dcam mex functions.
+//
+// Include after stdafx.h.  DcamOpen returns the HDCAM as a uint64 so that
+// 64-bit pointers are not truncated.  INT32 handles saved by older scripts
+// are still accepted; they only hold the low 32 bits of the pointer.
+
+#pragma once
+
+// Returns the handle created by DcamOpen.
+inline mxArray* DcamCreateHandle(HDCAM hDCAM)
+{
+	mxArray* Handle = mxCreateNumericMatrix(1,1,mxUINT64_CLASS,mxREAL);
+	*(unsigned long long*)mxGetData(Handle) = (unsigned long long)(size_t)hDCAM;
+	return Handle;
+}
+
+// Converts a handle from MATLAB back to the HDCAM.
+inline HDCAM DcamGetHandle(const mxArray* Handle)
+{
+	if (mxGetNumberOfElements(Handle) != 1)
+		mexErrMsgTxt("handle must be a scalar.");
+	if (mxIsUint64(Handle))
+		return (HDCAM)(size_t)*(unsigned long long*)mxGetData(Handle);
+	if (mxIsInt32(Handle))
+		return (HDCAM)(ptrdiff_t)*(int32*)mxGetData(Handle);
+	mexErrMsgTxt("handle must be type UINT 64 (or INT 32).");
+	return NULL;
+}
@@ -1,4 +1,5 @@
 #include "stdafx.h"
+#include "DcamHandle.h"
 #include "dcamprop.h"
 
 #define NUMBER_OF_FRAMES						4			// The number of frames to be captured.
@@ -13,17 +14,13 @@ void mexFunction(int nlhs, mxArray *plhs[],	int	nrhs, const	mxArray	*prhs[]) {
 
 	long	CameraIndex = 0;	
 	HDCAM	hDCAM = NULL;
-	long	Handle;
 	long	ScanSpeed;
 	_DWORD CameraCapability = 0;
 	// input handle from Matlab
 	
-	Handle=(long)mxGetScalar(prhs[0]);
 	ScanSpeed=(long)mxGetScalar(prhs[1]);
-	if (!mxIsInt32(prhs[0]))
-		mexErrMsgTxt("handle must be type INT 32.");
 	
-	hDCAM=(HDCAM)Handle;
+	hDCAM=DcamGetHandle(prhs[0]);
 	
 	int32	iProp = DCAM_IDPROP_INTERNAL_FRAMEINTERVAL; 
 	double	CurValue;
@@ -1,3 +1,6 @@
+#include <mutex>
+#include <new>
+#include <chrono>		// before windows.h, which defines min and max
 #include <windows.h>
 #pragma comment(lib, "kernel32.lib")
 
@@ -8,6 +11,8 @@
 #include <mex.h>
 #include "hdf5.h"
 #include <process.h>
+#include "../../share/threadctl.h"
+#include "../../share/bufferpool.h"
 
 #ifndef max
 //! not defined in the C standard used by visual studio
@@ -30,10 +35,13 @@ unsigned short * dataMATLAB;
 double IsSaving = 0;
 int CompressionLevel = 5;
 int IsCopied = 0;    
+int CopyFailed = 0;	//the writer thread could not borrow a buffer for the data
+thread_policy Policy;	//placement of the writer thread (see threadctl.h)
 
 void Save(void *p){
 
 	//mexPrintf("Entering Save...\n");
+	apply_thread_policy(Policy);
 
 	unsigned short * data;
 	int elemsize = 2;
@@ -60,8 +68,17 @@ void Save(void *p){
 	for (int n = 1; n < NDims; n++)
 		chunk_dims[n] = (const hsize_t)Size[NDims - n - 1];
 
-	//copy data to local heap
-	data = (unsigned short *)calloc(Nelem, sizeof(unsigned short));
+	//copy data to a pooled buffer, which is kept for the next call of the
+	//same size (see bufferpool.h)
+	data = (unsigned short *)pool_borrow(Nelem*sizeof(unsigned short));
+	if (data == NULL) {
+		//reported by mexFunction(), which waits for the copy
+		CopyFailed = 1;
+		IsSaving = 0;
+		IsCopied = 1;
+		return;
+	}
+	bool Locked = lock_buffer(Policy, data, Nelem*sizeof(unsigned short));
 	memcpy(data, dataMATLAB, Nelem*sizeof(unsigned short));
 	IsCopied = 1;
 
@@ -120,7 +137,9 @@ void Save(void *p){
 	status = H5Sclose(space);
 	status = H5Fclose(file);
 
-	free(data);
+	if (Locked)
+		unlock_buffer(Policy, data, Nelem*sizeof(unsigned short));
+	pool_return(data);
 	IsSaving = 0;
 	return;
 }
@@ -141,30 +160,43 @@ void mexFunction(int nlhs, mxArray *plhs[],	int	nrhs, const	mxArray	*prhs[]) {
 	//check for required inputs, correct types, and dimensions
 	//1D vectors still return 2D
 
+	//H5Write_Async('release') frees the copies kept for the next call
+	if ((nrhs == 1) && mxIsChar(prhs[0])) {
+		char command[8];
+		mxGetString(prhs[0], command, sizeof(command));
+		if (strcmp(command, "release"))
+			mexErrMsgTxt("Proper Usage: H5Write_Async('release')");
+		plhs[0] = mxCreateDoubleScalar((double)pool_release());
+		return;
+	}
+
 	if ((nrhs == 0) || (IsSaving)) {
 		plhs[0] = mxCreateDoubleScalar(IsSaving);
 		return;
 	}
 
 	if (nrhs < 4)
-		mexErrMsgTxt("Proper Usage: [Err]=H5Write_Async(File,Group,DatSetName,Data,CompressionLevel)");
+		mexErrMsgTxt("Proper Usage: [Err]=H5Write_Async(File,Group,DatSetName,Data,CompressionLevel,ThreadOptions)");
 
 	//validate input values(this section better not be blank!)
 
 	if (!mxIsClass(prhs[0], "char"))
-		mexErrMsgTxt("Proper Usage: [Err]=H5Write_Async(File,Group,DatSetName,Data,CompressionLevel).  First input must be character array.");
+		mexErrMsgTxt("Proper Usage: [Err]=H5Write_Async(File,Group,DatSetName,Data,CompressionLevel,ThreadOptions).  First input must be character array.");
 
 	if (!mxIsClass(prhs[1], "char"))
-		mexErrMsgTxt("Proper Usage: [Err]=H5Write_Async(File,Group,DatSetName,Data,CompressionLevel).  Second input must be character array.");
+		mexErrMsgTxt("Proper Usage: [Err]=H5Write_Async(File,Group,DatSetName,Data,CompressionLevel,ThreadOptions).  Second input must be character array.");
 
 	if (!mxIsClass(prhs[2], "char"))
-		mexErrMsgTxt("Proper Usage: [Err]=H5Write_Async(File,Group,DatSetName,Data,CompressionLevel).  Third input must be character array.");
+		mexErrMsgTxt("Proper Usage: [Err]=H5Write_Async(File,Group,DatSetName,Data,CompressionLevel,ThreadOptions).  Third input must be character array.");
 
 	if (!mxIsClass(prhs[3], "uint16"))
-		mexErrMsgTxt("Proper Usage: [Err]=H5Write_Async(File,Group,DatSetName,Data,CompressionLevel).  Fourth input must be uint16.");
+		mexErrMsgTxt("Proper Usage: [Err]=H5Write_Async(File,Group,DatSetName,Data,CompressionLevel,ThreadOptions).  Fourth input must be uint16.");
+
+	if ((nrhs >= 5)) if (!mxIsScalar(prhs[4]))
+		mexErrMsgTxt("Proper Usage: [Err]=H5Write_Async(File,Group,DatSetName,Data,CompressionLevel,ThreadOptions).  Fifth input must be a scalar 0-9.");
 
-	if ((nrhs == 5)) if (!mxIsScalar(prhs[4]))
-		mexErrMsgTxt("Proper Usage: [Err]=H5Write_Async(File,Group,DatSetName,Data,CompressionLevel).  Fifth input must be a scalar 0-9.");
+	//CPUs, Priority and LockMemory of the writer thread (see threadctl.h)
+	get_thread_policy(nrhs > 5 ? prhs[5] : NULL, Policy);
 
 	//declare all vars
 
@@ -200,7 +232,7 @@ void mexFunction(int nlhs, mxArray *plhs[],	int	nrhs, const	mxArray	*prhs[]) {
 
 	dataMATLAB = (unsigned short *)mxGetData(prhs[3]);
 
-	if ((nrhs ==5))
+	if ((nrhs >= 5))
 		CompressionLevel = (int)mxGetScalar(prhs[4]);
 	
 	for (i = 0; i < NDims; i++) Size[i] = Dims[i];
@@ -225,6 +257,7 @@ void mexFunction(int nlhs, mxArray *plhs[],	int	nrhs, const	mxArray	*prhs[]) {
 	mexPrintf("Starting Save...\n", status);
 
 	IsCopied = 0;
+	CopyFailed = 0;
 	//Save(NULL); //run single threaded. 
 	_beginthread(Save, 0, NULL); //use this line for new thread
 
@@ -236,6 +269,9 @@ void mexFunction(int nlhs, mxArray *plhs[],	int	nrhs, const	mxArray	*prhs[]) {
 		Sleep(10);
 	}
 
+	if (CopyFailed)
+		mexErrMsgTxt("Not enough memory to copy the data; nothing was written.");
+
 
 	plhs[0] = mxCreateDoubleScalar(0);
 
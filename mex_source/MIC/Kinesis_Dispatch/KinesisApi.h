@@ -0,0 +1,401 @@
+// KinesisApi.h : run-time bindings to the Thorlabs Kinesis C-API.
+//
+// The TCube and KCube piezo (and strain gauge) libraries export the same
+// PCC_ (SG_) function names, so one mex file cannot link against both.
+// Instead each device family's library is loaded on first use and the
+// functions Kinesis_Dispatch needs are bound into a table.  DeviceTraits<F>
+// describes a family at compile time: its library, function table and
+// number of channels.
+
+#pragma once
+
+#ifdef LINUX
+#include <dlfcn.h>
+#include "KinesisCompat.h"
+#else
+#include <windows.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+namespace kinesis {
+
+enum Family {
+	TCubePiezo,
+	KCubePiezo,
+	TCubeStrainGauge,
+	KCubeStrainGauge,
+	BenchtopStepper,
+	TCubeLaserDiode,
+	NumFamilies
+};
+
+enum Kind { Piezo, StrainGauge, Stepper, LaserDiode, AnyKind };
+
+// Same layout as TLI_DeviceInfo.
+struct DeviceInfo
+{
+	DWORD typeID;
+	char description[65];
+	char serialNo[9];
+	DWORD PID;
+	bool isKnownType;
+	int motorType;
+	bool isPiezoDevice;
+	bool isLaser;
+	bool isCustomType;
+	bool isRack;
+	short maxChannels;
+};
+
+//*******************************************************************************************
+#define KINESIS_INSTALL_DIR "C:\\Program Files\\Thorlabs\\Kinesis\\"
+
+class Library
+{
+public:
+	Library() : mHandle(NULL) {}
+
+	// Loads e.g. "Thorlabs.MotionControl.TCube.Piezo" from the Kinesis install
+	// directory, else from the folder of this mex file (e.g. mex64) and
+	// then from the DLL search path (PATH).  On Linux every family is
+	// served by libKinesisSim.so.
+	bool Load(char const * name)
+	{
+		if (mHandle)
+			return true;
+#ifdef LINUX
+		(void)name;
+		mHandle = dlopen("libKinesisSim.so", RTLD_NOW);
+#else
+		std::string dll = std::string(name) + ".dll";
+		std::string path = KINESIS_INSTALL_DIR + dll;
+		mHandle = LoadLibraryExA(path.c_str(), NULL, LOAD_WITH_ALTERED_SEARCH_PATH);
+		HMODULE mex;
+		char folder[MAX_PATH];
+		if (!mHandle && GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS
+				| GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, (LPCSTR)&Library::Folder, &mex)
+			&& Folder(mex, folder, sizeof(folder))) {
+			path = std::string(folder) + dll;
+			mHandle = LoadLibraryExA(path.c_str(), NULL, LOAD_WITH_ALTERED_SEARCH_PATH);
+		}
+		if (!mHandle)
+			mHandle = LoadLibraryA(dll.c_str());
+#endif
+		return mHandle != NULL;
+	}
+
+	void Free()
+	{
+		if (!mHandle)
+			return;
+#ifdef LINUX
+		dlclose(mHandle);
+#else
+		FreeLibrary((HMODULE)mHandle);
+#endif
+		mHandle = NULL;
+	}
+
+	void * Symbol(char const * name) const
+	{
+#ifdef LINUX
+		return dlsym(mHandle, name);
+#else
+		return (void *)GetProcAddress((HMODULE)mHandle, name);
+#endif
+	}
+
+	template <typename Fn>
+	bool Bind(Fn & fn, char const * prefix, char const * name) const
+	{
+		char symbol[64];
+		snprintf(symbol, sizeof(symbol), "%s_%s", prefix, name);
+		fn = (Fn)Symbol(symbol);
+		return fn != NULL;
+	}
+
+private:
+#ifndef LINUX
+	// Folder of a module, with a trailing backslash.
+	static bool Folder(HMODULE module, char * folder, DWORD size)
+	{
+		DWORD n = GetModuleFileNameA(module, folder, size);
+		if (n == 0 || n >= size)
+			return false;
+		char * slash = strrchr(folder, '\\');
+		if (!slash)
+			return false;
+		slash[1] = '\0';
+		return true;
+	}
+#endif
+
+	void * mHandle;
+};
+
+//*******************************************************************************************
+// Function tables.  Enumerated arguments (PZ_ControlModeTypes,
+// MOT_TravelDirection) are passed as int.
+
+struct DeviceListApi
+{
+	short (__cdecl *BuildDeviceList)(void);
+	short (__cdecl *GetDeviceListSize)(void);
+	short (__cdecl *GetDeviceInfo)(char const * serialNo, DeviceInfo * info);
+
+	bool Bind(Library const & lib)
+	{
+		return lib.Bind(BuildDeviceList, "TLI", "BuildDeviceList")
+			&& lib.Bind(GetDeviceListSize, "TLI", "GetDeviceListSize")
+			&& lib.Bind(GetDeviceInfo, "TLI", "GetDeviceInfo");
+	}
+};
+
+struct PiezoApi
+{
+	DeviceListApi List;
+	short (__cdecl *Open)(char const * serialNo);
+	void (__cdecl *Close)(char const * serialNo);
+	void (__cdecl *Identify)(char const * serialNo);
+	bool (__cdecl *StartPolling)(char const * serialNo, int milliseconds);
+	void (__cdecl *StopPolling)(char const * serialNo);
+	short (__cdecl *RequestStatus)(char const * serialNo);
+	DWORD (__cdecl *GetStatusBits)(char const * serialNo);
+	short (__cdecl *Enable)(char const * serialNo);
+	short (__cdecl *SetPositionControlMode)(char const * serialNo, int mode);
+	int (__cdecl *GetPositionControlMode)(char const * serialNo);
+	short (__cdecl *SetPosition)(char const * serialNo, WORD position);
+	WORD (__cdecl *GetPosition)(char const * serialNo);
+	short (__cdecl *SetOutputVoltage)(char const * serialNo, short volts);
+	short (__cdecl *GetOutputVoltage)(char const * serialNo);
+
+	bool Bind(Library const & lib)
+	{
+		return List.Bind(lib)
+			&& lib.Bind(Open, "PCC", "Open")
+			&& lib.Bind(Close, "PCC", "Close")
+			&& lib.Bind(Identify, "PCC", "Identify")
+			&& lib.Bind(StartPolling, "PCC", "StartPolling")
+			&& lib.Bind(StopPolling, "PCC", "StopPolling")
+			&& lib.Bind(RequestStatus, "PCC", "RequestStatus")
+			&& lib.Bind(GetStatusBits, "PCC", "GetStatusBits")
+			&& lib.Bind(Enable, "PCC", "Enable")
+			&& lib.Bind(SetPositionControlMode, "PCC", "SetPositionControlMode")
+			&& lib.Bind(GetPositionControlMode, "PCC", "GetPositionControlMode")
+			&& lib.Bind(SetPosition, "PCC", "SetPosition")
+			&& lib.Bind(GetPosition, "PCC", "GetPosition")
+			&& lib.Bind(SetOutputVoltage, "PCC", "SetOutputVoltage")
+			&& lib.Bind(GetOutputVoltage, "PCC", "GetOutputVoltage");
+	}
+};
+
+struct StrainGaugeApi
+{
+	DeviceListApi List;
+	short (__cdecl *Open)(char const * serialNo);
+	void (__cdecl *Close)(char const * serialNo);
+	void (__cdecl *Identify)(char const * serialNo);
+	bool (__cdecl *StartPolling)(char const * serialNo, int milliseconds);
+	void (__cdecl *StopPolling)(char const * serialNo);
+	short (__cdecl *RequestStatus)(char const * serialNo);
+	DWORD (__cdecl *GetStatusBits)(char const * serialNo);
+	int (__cdecl *GetReadingExt)(char const * serialNo, bool clipReading, bool * overrange);
+	short (__cdecl *SetZero)(char const * serialNo);
+
+	bool Bind(Library const & lib)
+	{
+		return List.Bind(lib)
+			&& lib.Bind(Open, "SG", "Open")
+			&& lib.Bind(Close, "SG", "Close")
+			&& lib.Bind(Identify, "SG", "Identify")
+			&& lib.Bind(StartPolling, "SG", "StartPolling")
+			&& lib.Bind(StopPolling, "SG", "StopPolling")
+			&& lib.Bind(RequestStatus, "SG", "RequestStatus")
+			&& lib.Bind(GetStatusBits, "SG", "GetStatusBits")
+			&& lib.Bind(GetReadingExt, "SG", "GetReadingExt")
+			&& lib.Bind(SetZero, "SG", "SetZero");
+	}
+};
+
+struct StepperApi
+{
+	DeviceListApi List;
+	short (__cdecl *Open)(char const * serialNo);
+	void (__cdecl *Close)(char const * serialNo);
+	void (__cdecl *Identify)(char const * serialNo, short channel);
+	bool (__cdecl *StartPolling)(char const * serialNo, short channel, int milliseconds);
+	void (__cdecl *StopPolling)(char const * serialNo, short channel);
+	short (__cdecl *RequestStatus)(char const * serialNo, short channel);
+	DWORD (__cdecl *GetStatusBits)(char const * serialNo, short channel);
+	short (__cdecl *RequestPosition)(char const * serialNo, short channel);
+	int (__cdecl *GetPosition)(char const * serialNo, short channel);
+	short (__cdecl *Home)(char const * serialNo, short channel);
+	short (__cdecl *MoveToPosition)(char const * serialNo, short channel, int index);
+	short (__cdecl *MoveJog)(char const * serialNo, short channel, int jogDirection);
+	short (__cdecl *StopImmediate)(char const * serialNo, short channel);
+	short (__cdecl *RequestJogParams)(char const * serialNo, short channel);
+	short (__cdecl *SetJogStepSize)(char const * serialNo, short channel, unsigned int stepSize);
+	unsigned int (__cdecl *GetJogStepSize)(char const * serialNo, short channel);
+	bool (__cdecl *GetNextMessage)(char const * serialNo, short channel, WORD * messageType, WORD * messageID, DWORD * messageData);
+	int (__cdecl *MessageQueueSize)(char const * serialNo, short channel);
+	void (__cdecl *ClearMessageQueue)(char const * serialNo, short channel);
+
+	bool Bind(Library const & lib)
+	{
+		return List.Bind(lib)
+			&& lib.Bind(Open, "SBC", "Open")
+			&& lib.Bind(Close, "SBC", "Close")
+			&& lib.Bind(Identify, "SBC", "Identify")
+			&& lib.Bind(StartPolling, "SBC", "StartPolling")
+			&& lib.Bind(StopPolling, "SBC", "StopPolling")
+			&& lib.Bind(RequestStatus, "SBC", "RequestStatusBits")
+			&& lib.Bind(GetStatusBits, "SBC", "GetStatusBits")
+			&& lib.Bind(RequestPosition, "SBC", "RequestPosition")
+			&& lib.Bind(GetPosition, "SBC", "GetPosition")
+			&& lib.Bind(Home, "SBC", "Home")
+			&& lib.Bind(MoveToPosition, "SBC", "MoveToPosition")
+			&& lib.Bind(MoveJog, "SBC", "MoveJog")
+			&& lib.Bind(StopImmediate, "SBC", "StopImmediate")
+			&& lib.Bind(RequestJogParams, "SBC", "RequestJogParams")
+			&& lib.Bind(SetJogStepSize, "SBC", "SetJogStepSize")
+			&& lib.Bind(GetJogStepSize, "SBC", "GetJogStepSize")
+			&& lib.Bind(GetNextMessage, "SBC", "GetNextMessage")
+			&& lib.Bind(MessageQueueSize, "SBC", "MessageQueueSize")
+			&& lib.Bind(ClearMessageQueue, "SBC", "ClearMessageQueue");
+	}
+};
+
+struct LaserDiodeApi
+{
+	DeviceListApi List;
+	short (__cdecl *Open)(char const * serialNo);
+	void (__cdecl *Close)(char const * serialNo);
+	void (__cdecl *Identify)(char const * serialNo);
+	bool (__cdecl *StartPolling)(char const * serialNo, int milliseconds);
+	void (__cdecl *StopPolling)(char const * serialNo);
+	short (__cdecl *RequestStatus)(char const * serialNo);
+	DWORD (__cdecl *GetStatusBits)(char const * serialNo);
+	short (__cdecl *Enable)(char const * serialNo);
+	short (__cdecl *EnableOutput)(char const * serialNo);
+	short (__cdecl *DisableOutput)(char const * serialNo);
+	short (__cdecl *SetLaserSetPoint)(char const * serialNo, WORD laserDiodeCurrent);
+	WORD (__cdecl *GetLaserSetPoint)(char const * serialNo);
+	short (__cdecl *SetOpenLoopMode)(char const * serialNo);
+	short (__cdecl *SetClosedLoopMode)(char const * serialNo);
+	short (__cdecl *SetWACalibFactor)(char const * serialNo, float calibFactor);
+
+	bool Bind(Library const & lib)
+	{
+		return List.Bind(lib)
+			&& lib.Bind(Open, "LD", "Open")
+			&& lib.Bind(Close, "LD", "Close")
+			&& lib.Bind(Identify, "LD", "Identify")
+			&& lib.Bind(StartPolling, "LD", "StartPolling")
+			&& lib.Bind(StopPolling, "LD", "StopPolling")
+			&& lib.Bind(RequestStatus, "LD", "RequestStatus")
+			&& lib.Bind(GetStatusBits, "LD", "GetStatusBits")
+			&& lib.Bind(Enable, "LD", "Enable")
+			&& lib.Bind(EnableOutput, "LD", "EnableOutput")
+			&& lib.Bind(DisableOutput, "LD", "DisableOutput")
+			&& lib.Bind(SetLaserSetPoint, "LD", "SetLaserSetPoint")
+			&& lib.Bind(GetLaserSetPoint, "LD", "GetLaserSetPoint")
+			&& lib.Bind(SetOpenLoopMode, "LD", "SetOpenLoopMode")
+			&& lib.Bind(SetClosedLoopMode, "LD", "SetClosedLoopMode")
+			&& lib.Bind(SetWACalibFactor, "LD", "SetWACalibFactor");
+	}
+};
+
+//*******************************************************************************************
+// Compile-time description of each family.
+
+template <Family F> struct DeviceTraits;
+
+template <> struct DeviceTraits<TCubePiezo>
+{
+	typedef PiezoApi Api;
+	static const Kind kind = Piezo;
+	static const short Channels = 1;
+	static char const * Library() { return "Thorlabs.MotionControl.TCube.Piezo"; }
+};
+
+template <> struct DeviceTraits<KCubePiezo>
+{
+	typedef PiezoApi Api;
+	static const Kind kind = Piezo;
+	static const short Channels = 1;
+	static char const * Library() { return "Thorlabs.MotionControl.KCube.Piezo"; }
+};
+
+template <> struct DeviceTraits<TCubeStrainGauge>
+{
+	typedef StrainGaugeApi Api;
+	static const Kind kind = StrainGauge;
+	static const short Channels = 1;
+	static char const * Library() { return "Thorlabs.MotionControl.TCube.StrainGauge"; }
+};
+
+template <> struct DeviceTraits<KCubeStrainGauge>
+{
+	typedef StrainGaugeApi Api;
+	static const Kind kind = StrainGauge;
+	static const short Channels = 1;
+	static char const * Library() { return "Thorlabs.MotionControl.KCube.StrainGauge"; }
+};
+
+template <> struct DeviceTraits<BenchtopStepper>
+{
+	typedef StepperApi Api;
+	static const Kind kind = Stepper;
+	static const short Channels = 3;
+	static char const * Library() { return "Thorlabs.MotionControl.Benchtop.StepperMotor"; }
+};
+
+template <> struct DeviceTraits<TCubeLaserDiode>
+{
+	typedef LaserDiodeApi Api;
+	static const Kind kind = LaserDiode;
+	static const short Channels = 1;
+	static char const * Library() { return "Thorlabs.MotionControl.TCube.LaserDiode"; }
+};
+
+// The first two digits of a serial number are the Thorlabs device type.
+inline bool FamilyFromSerial(char const * serialNo, Family & family)
+{
+	if (strlen(serialNo) != 8)
+		return false;
+	switch ((serialNo[0] - '0') * 10 + (serialNo[1] - '0')) {
+	case 81: family = TCubePiezo; return true;			// TPZ001
+	case 29: family = KCubePiezo; return true;			// KPZ101
+	case 84: family = TCubeStrainGauge; return true;	// TSG001
+	case 59: family = KCubeStrainGauge; return true;	// KSG101
+	case 40: case 70: family = BenchtopStepper; return true;	// BSC20x, BSC10x
+	case 64: family = TCubeLaserDiode; return true;		// TLD001
+	}
+	return false;
+}
+
+// Per-channel calls.  The PCC_, SG_ and LD_ functions take no channel.
+template <typename Api>
+struct ChannelCalls
+{
+	static void Identify(Api const & api, char const * serialNo, short) { api.Identify(serialNo); }
+	static bool StartPolling(Api const & api, char const * serialNo, short, int ms) { return api.StartPolling(serialNo, ms); }
+	static void StopPolling(Api const & api, char const * serialNo, short) { api.StopPolling(serialNo); }
+	static short RequestStatus(Api const & api, char const * serialNo, short) { return api.RequestStatus(serialNo); }
+	static DWORD GetStatusBits(Api const & api, char const * serialNo, short) { return api.GetStatusBits(serialNo); }
+};
+
+template <>
+struct ChannelCalls<StepperApi>
+{
+	static void Identify(StepperApi const & api, char const * serialNo, short ch) { api.Identify(serialNo, ch); }
+	static bool StartPolling(StepperApi const & api, char const * serialNo, short ch, int ms) { return api.StartPolling(serialNo, ch, ms); }
+	static void StopPolling(StepperApi const & api, char const * serialNo, short ch) { api.StopPolling(serialNo, ch); }
+	static short RequestStatus(StepperApi const & api, char const * serialNo, short ch) { return api.RequestStatus(serialNo, ch); }
+	static DWORD GetStatusBits(StepperApi const & api, char const * serialNo, short ch) { return api.GetStatusBits(serialNo, ch); }
+};
+
+} // namespace kinesis
@@ -0,0 +1,1154 @@
+#ifdef LINUX
+#include "KinesisCompat.h"
+#else
+#include <windows.h>
+#pragma comment(lib, "kernel32.lib")
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <mex.h>
+#include <string>
+#include <unordered_map>
+#include <memory>
+#include <vector>
+#include <limits>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+#include "KinesisApi.h"
+
+using namespace kinesis;
+
+// [...] = Kinesis_Dispatch(Command, SerialNo, ...)
+// Single entry point for the Kinesis piezo, strain gauge, stepper and laser
+// diode controllers.  'Command' is a command name (e.g. 'PCC_SetPosition')
+// or the numeric ID returned by Kinesis_Dispatch('Commands').  The device
+// family (TCube/KCube, ...) is taken from the serial number prefix.
+//
+// The mex file stays loaded (mexLock) so the vendor libraries are loaded and
+// the device list is built once; Kinesis_Dispatch('Unload') closes all
+// devices and allows 'clear Kinesis_Dispatch'.
+//
+//	Cmd = Kinesis_Dispatch('Commands')			struct of command IDs
+//	N = Kinesis_Dispatch('BuildDeviceList')
+//	Kinesis_Dispatch('CloseAll'), Kinesis_Dispatch('Unload')
+//	Err = Kinesis_Dispatch('Open', SN)			open, identify and poll every 200 ms
+//	Kinesis_Dispatch('Close', SN)
+//	Err = Kinesis_Dispatch('Identify', SN)		opens and closes SN if needed
+//	Status = Kinesis_Dispatch('GetStatusBits', SN [,Channel])
+//	Err = Kinesis_Dispatch('PCC_SetPositionControlMode', SN, Mode)	1 open, 2 closed loop
+//	Err = Kinesis_Dispatch('PCC_SetPosition', SN, Position)			0-65535
+//	Position = Kinesis_Dispatch('PCC_GetPosition', SN)
+//	[Err,Readings,Seconds] = Kinesis_Dispatch('PCC_SetPositions', {SN,...}, Positions
+//								[,{SGSN,...} [,Tolerance [,TimeoutSeconds]]])
+//								Sets several piezos at once and waits until all strain
+//								gauges have moved at least half of the setpoint change
+//								(in gauge counts) and then read steady to within
+//								Tolerance counts.  TimeoutSeconds (default 2) is extended
+//								by 5 s per full travel moved; an axis that has not
+//								settled by then reports Err = -1.
+//	Reading = Kinesis_Dispatch('SG_GetReading', SN)				2^15 = full travel
+//	Timeout = Kinesis_Dispatch('SG_SetZero', SN [,TimeoutSeconds])
+//	Err = Kinesis_Dispatch('SBC_Home', SN, Channel)
+//	Err = Kinesis_Dispatch('SBC_MoveToPosition', SN, Channel, Position)	mm
+//	Err = Kinesis_Dispatch('SBC_MoveJog', SN, Channel, Direction)		1 or -1
+//	Position = Kinesis_Dispatch('SBC_GetPosition', SN, Channel)			mm
+//	Err = Kinesis_Dispatch('SBC_SetJogStepSize', SN, Channel, Step)		mm
+//	Step = Kinesis_Dispatch('SBC_GetJogStepSize', SN, Channel)			mm
+//	[Ticket,Err] = Kinesis_Dispatch('SBC_HomeAsync', SN, Channel)
+//	[Ticket,Err] = Kinesis_Dispatch('SBC_MoveToPositionAsync', SN, Channel, Position)
+//	[Done,Seconds,Position] = Kinesis_Dispatch('SBC_IsDone', Ticket)
+//	[Done,Seconds,Position] = Kinesis_Dispatch('SBC_Wait', Ticket [,TimeoutSeconds])
+//								Seconds from the command to the completion message,
+//								Position (mm) reported with it; NaN if not done.
+//	[Err,SetPoint] = Kinesis_Dispatch('LD_EnableOutput', SN)
+//	Err = Kinesis_Dispatch('LD_DisableOutput', SN)
+//	[Err,SetPoint] = Kinesis_Dispatch('LD_SetLaserSetPoint', SN, Current)
+//	Err = Kinesis_Dispatch('LD_SetOpenLoopMode', SN)
+//	Err = Kinesis_Dispatch('LD_SetClosedLoopMode', SN)
+//	Err = Kinesis_Dispatch('LD_SetWACalibFactor', SN, WperA)
+//	Kinesis_Dispatch('LD_LoadSequence', SN, Times, SetPoints)	Times (s) from the start of each
+//								step; empty Times: one step per LD_Advance (frame list)
+//	Err = Kinesis_Dispatch('LD_StartSequence', SN)
+//	Kinesis_Dispatch('LD_Advance', SN [,Step])	next step, or Step (1-based), in frame mode
+//	Kinesis_Dispatch('LD_StopSequence', SN)
+//	[Running,Step,Stats] = Kinesis_Dispatch('LD_SequenceStatus', SN)
+//								Stats.Late is the time (s) each step was applied after
+//								its schedule (after its LD_Advance in frame mode).
+
+#define POLLING_MS		200
+#define STEPS_PER_MM	819200		// each mm corresponds to 2 pitches = 819200 microsteps
+#define MAX_TRAVEL_MM	4
+#define MAX_TICKETS		1024		// completed tickets kept for SBC_IsDone/SBC_Wait
+#define MAX_AXES		8			// piezos in one PCC_SetPositions call
+#define SETTLE_MS		5			// strain gauge sampling while settling
+#define SETTLE_SAMPLES	3			// consecutive steady samples to call it settled
+#define SETTLE_S_PER_TRAVEL	5.0		// added to the settle timeout per full travel moved
+#define PIEZO_FULLSCALE	65535.0		// PCC_SetPosition counts over the full travel
+#define SG_FULLSCALE	32767.0		// strain gauge counts over the full travel
+#define ERR_NOT_SETTLED	-1			// PCC_SetPositions axis that timed out
+#define SPIN_US			1500		// laser sequence steps sleep until this close, then spin
+#define MESSAGE_POLL_MS	10			// stepper waiters check the message queue this often
+
+//*******************************************************************************************
+// Per-family operations, generated from DeviceTraits.
+
+struct FamilyOps
+{
+	Kind kind;
+	short channels;
+	bool (*Load)();
+	void (*Unload)();
+	DeviceListApi const & (*List)();
+	void const * (*Api)();
+	short (*Open)(char const * serialNo);
+	void (*Close)(char const * serialNo);
+	void (*Identify)(char const * serialNo, short channel);
+	short (*RequestStatus)(char const * serialNo, short channel);
+	DWORD (*GetStatusBits)(char const * serialNo, short channel);
+};
+
+template <Family F>
+struct Family_
+{
+	typedef DeviceTraits<F> Traits;
+	typedef typename Traits::Api Api;
+	typedef ChannelCalls<Api> Calls;
+
+	static Library sLibrary;
+	static Api sApi;
+	static bool sBound;
+
+	static bool Load()
+	{
+		if (!sBound)
+			sBound = sLibrary.Load(Traits::Library()) && sApi.Bind(sLibrary);
+		return sBound;
+	}
+
+	static void Unload()
+	{
+		sLibrary.Free();
+		sBound = false;
+	}
+
+	static DeviceListApi const & List() { return sApi.List; }
+	static void const * GetApi() { return &sApi; }
+
+	static short Open(char const * serialNo)
+	{
+		short Err = sApi.Open(serialNo);
+		if (!Err) {
+			for (short ch = 1; ch <= Traits::Channels; ch++) {
+				Calls::Identify(sApi, serialNo, ch);
+				Calls::StartPolling(sApi, serialNo, ch, POLLING_MS);
+			}
+		}
+		return Err;
+	}
+
+	static void Close(char const * serialNo)
+	{
+		for (short ch = 1; ch <= Traits::Channels; ch++)
+			Calls::StopPolling(sApi, serialNo, ch);
+		sApi.Close(serialNo);
+	}
+
+	static void Identify(char const * serialNo, short ch) { Calls::Identify(sApi, serialNo, ch); }
+	static short RequestStatus(char const * serialNo, short ch) { return Calls::RequestStatus(sApi, serialNo, ch); }
+	static DWORD GetStatusBits(char const * serialNo, short ch) { return Calls::GetStatusBits(sApi, serialNo, ch); }
+
+	static FamilyOps Ops()
+	{
+		FamilyOps ops = { Traits::kind, Traits::Channels, &Load, &Unload, &List, &GetApi,
+			&Open, &Close, &Identify, &RequestStatus, &GetStatusBits };
+		return ops;
+	}
+};
+
+template <Family F> Library Family_<F>::sLibrary;
+template <Family F> typename Family_<F>::Api Family_<F>::sApi;
+template <Family F> bool Family_<F>::sBound = false;
+
+static const FamilyOps g_Families[NumFamilies] = {
+	Family_<TCubePiezo>::Ops(),
+	Family_<KCubePiezo>::Ops(),
+	Family_<TCubeStrainGauge>::Ops(),
+	Family_<KCubeStrainGauge>::Ops(),
+	Family_<BenchtopStepper>::Ops(),
+	Family_<TCubeLaserDiode>::Ops(),
+};
+
+static bool g_Listed[NumFamilies];
+
+//*******************************************************************************************
+// Device table.  Serial numbers are looked up once and then cached with the
+// state of the device.
+
+struct Device
+{
+	char serial[9];
+	Family family;
+	FamilyOps const * ops;
+	bool open;
+
+	template <typename Api> Api const & Get() const { return *(Api const *)ops->Api(); }
+};
+
+static std::unordered_map<std::string, Device> g_Devices;
+static bool g_Locked = false;
+
+//*******************************************************************************************
+// Stepper move tickets.  SBC_HomeAsync and SBC_MoveToPositionAsync return at
+// once with a ticket; a waiter thread per channel polls the message queue
+// (SBC_WaitForMessage has no timeout, so a blocked waiter could not be
+// stopped) and completes the pending tickets of its channel when the homed,
+// moved or stopped message arrives.  The waiter ends when its stop flag is
+// set before the device is closed.
+
+typedef std::chrono::steady_clock Clock;
+
+#define MSG_GENERICMOTOR	2
+#define MSG_MOTOR_HOMED		0
+#define MSG_MOTOR_MOVED		1
+#define MSG_MOTOR_STOPPED	2
+
+struct MoveTicket
+{
+	std::string key;		// serial number and channel
+	WORD expect;			// MSG_MOTOR_HOMED or MSG_MOTOR_MOVED
+	Clock::time_point issued;
+	bool done;
+	double seconds;
+	double position;		// mm
+};
+
+struct Waiter
+{
+	std::thread thread;
+	bool running;
+	bool stop;				// set under g_MoveMutex by StopWaiters
+};
+
+static std::mutex g_MoveMutex;
+static std::condition_variable g_MoveDone;
+static std::unordered_map<unsigned int, MoveTicket> g_Tickets;
+static std::unordered_map<std::string, std::unique_ptr<Waiter>> g_Waiters;
+static unsigned int g_NextTicket = 1;
+static const double NaN = std::numeric_limits<double>::quiet_NaN();
+
+static std::string WaiterKey(char const * serialNo, short channel)
+{
+	return std::string(serialNo) + ":" + std::to_string(channel);
+}
+
+static void CompleteTickets(std::string const & key, bool aborted, WORD id, DWORD data)
+{
+	Clock::time_point now = Clock::now();
+	for (auto & entry : g_Tickets) {
+		MoveTicket & t = entry.second;
+		if (t.done || t.key != key)
+			continue;
+		if (!aborted && id != t.expect && id != MSG_MOTOR_STOPPED)
+			continue;
+		t.done = true;
+		t.seconds = aborted ? NaN : std::chrono::duration<double>(now - t.issued).count();
+		t.position = aborted ? NaN : (double)(int)data / STEPS_PER_MM;
+	}
+}
+
+static void WaitForMoves(StepperApi const * api, std::string serial, short channel, Waiter * waiter)
+{
+	std::string key = WaiterKey(serial.c_str(), channel);
+	WORD type, id;
+	DWORD data;
+	for (;;) {
+		int queued = api->MessageQueueSize(serial.c_str(), channel);
+		if (queued < 0)
+			break;			// the device is no longer open
+		while (queued-- > 0 && api->GetNextMessage(serial.c_str(), channel, &type, &id, &data)) {
+			if (type != MSG_GENERICMOTOR)
+				continue;
+			std::lock_guard<std::mutex> lock(g_MoveMutex);
+			CompleteTickets(key, false, id, data);
+			g_MoveDone.notify_all();
+		}
+		std::unique_lock<std::mutex> lock(g_MoveMutex);
+		if (g_MoveDone.wait_for(lock, std::chrono::milliseconds(MESSAGE_POLL_MS), [waiter] { return waiter->stop; }))
+			break;
+	}
+	std::lock_guard<std::mutex> lock(g_MoveMutex);
+	CompleteTickets(key, true, 0, 0);
+	waiter->running = false;
+	g_MoveDone.notify_all();
+}
+
+static void StartWaiter(Device const & dev, short channel)
+{
+	std::string key = WaiterKey(dev.serial, channel);
+	std::unique_ptr<Waiter> & waiter = g_Waiters[key];
+	{
+		std::lock_guard<std::mutex> lock(g_MoveMutex);
+		if (waiter && waiter->running)
+			return;
+	}
+	if (waiter && waiter->thread.joinable())
+		waiter->thread.join();
+	StepperApi const & api = dev.Get<StepperApi>();
+	api.ClearMessageQueue(dev.serial, channel);		// completions of earlier blocking moves
+	waiter.reset(new Waiter);
+	waiter->running = true;
+	waiter->stop = false;
+	waiter->thread = std::thread(WaitForMoves, &api, std::string(dev.serial), channel, waiter.get());
+}
+
+// Called before the device is closed; open tickets are marked as aborted.
+static void StopWaiters(char const * serialNo)
+{
+	std::string prefix = std::string(serialNo) + ":";
+	{
+		std::lock_guard<std::mutex> lock(g_MoveMutex);
+		for (auto & entry : g_Waiters)
+			if (entry.first.compare(0, prefix.size(), prefix) == 0)
+				entry.second->stop = true;
+		g_MoveDone.notify_all();
+	}
+	for (auto it = g_Waiters.begin(); it != g_Waiters.end(); ) {
+		if (it->first.compare(0, prefix.size(), prefix) == 0) {
+			if (it->second->thread.joinable())
+				it->second->thread.join();
+			it = g_Waiters.erase(it);
+		}
+		else
+			++it;
+	}
+}
+
+static unsigned int NewTicket(Device const & dev, short channel, WORD expect)
+{
+	std::lock_guard<std::mutex> lock(g_MoveMutex);
+	if (g_Tickets.size() >= MAX_TICKETS) {
+		for (auto it = g_Tickets.begin(); it != g_Tickets.end(); ) {
+			if (it->second.done && it->first + MAX_TICKETS / 2 < g_NextTicket)
+				it = g_Tickets.erase(it);
+			else
+				++it;
+		}
+	}
+	unsigned int ticket = g_NextTicket++;
+	MoveTicket t = { WaiterKey(dev.serial, channel), expect, Clock::now(), false, NaN, NaN };
+	g_Tickets[ticket] = t;
+	return ticket;
+}
+
+//*******************************************************************************************
+// Laser diode sequencer.  A thread per device plays a list of setpoints,
+// either at given times from LD_StartSequence or one step per LD_Advance so
+// the list can follow camera frames.  Each step records how late it was.
+
+struct Sequencer
+{
+	std::vector<double> times;		// empty in frame mode
+	std::vector<WORD> setPoints;
+	std::vector<double> late;		// s, one per step played
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool running;
+	bool stop;
+	size_t step;					// next step
+	std::vector<std::pair<size_t, Clock::time_point>> advances;	// frame mode requests
+};
+
+static std::unordered_map<std::string, std::unique_ptr<Sequencer>> g_Sequencers;
+
+static void PlayStep(LaserDiodeApi const & api, char const * serial, Sequencer * seq, size_t step,
+	Clock::time_point due)
+{
+	api.SetLaserSetPoint(serial, seq->setPoints[step]);
+	double late = std::chrono::duration<double>(Clock::now() - due).count();
+	std::lock_guard<std::mutex> lock(seq->mutex);
+	seq->late.push_back(late);
+	seq->step = step + 1;
+}
+
+static void PlaySequence(LaserDiodeApi const * api, std::string serial, Sequencer * seq)
+{
+	api->Enable(serial.c_str());
+	if (!seq->times.empty()) {
+		Clock::time_point start = Clock::now();
+		for (size_t ii = 0; ii < seq->times.size(); ii++) {
+			Clock::time_point due = start + std::chrono::duration_cast<Clock::duration>(
+				std::chrono::duration<double>(seq->times[ii]));
+			{
+				// Sleep until just before the step, then spin for the last bit.
+				std::unique_lock<std::mutex> lock(seq->mutex);
+				if (seq->wake.wait_until(lock, due - std::chrono::microseconds(SPIN_US), [seq]() { return seq->stop; }))
+					break;
+			}
+			while (Clock::now() < due)
+				std::this_thread::yield();
+			PlayStep(*api, serial.c_str(), seq, ii, due);
+		}
+	}
+	else {
+		for (;;) {
+			std::pair<size_t, Clock::time_point> advance;
+			{
+				std::unique_lock<std::mutex> lock(seq->mutex);
+				seq->wake.wait(lock, [seq]() { return seq->stop || !seq->advances.empty(); });
+				if (seq->stop)
+					break;
+				advance = seq->advances.front();
+				seq->advances.erase(seq->advances.begin());
+			}
+			if (advance.first < seq->setPoints.size())
+				PlayStep(*api, serial.c_str(), seq, advance.first, advance.second);
+		}
+	}
+	std::lock_guard<std::mutex> lock(seq->mutex);
+	seq->running = false;
+}
+
+static void StopSequencer(char const * serialNo)
+{
+	auto it = g_Sequencers.find(serialNo);
+	if (it == g_Sequencers.end())
+		return;
+	Sequencer & seq = *it->second;
+	{
+		std::lock_guard<std::mutex> lock(seq.mutex);
+		seq.stop = true;
+	}
+	seq.wake.notify_all();
+	if (seq.thread.joinable())
+		seq.thread.join();
+}
+
+static void CloseAll()
+{
+	for (auto & entry : g_Devices) {
+		Device & dev = entry.second;
+		StopSequencer(dev.serial);
+		StopWaiters(dev.serial);
+		if (dev.open)
+			dev.ops->Close(dev.serial);
+		dev.open = false;
+	}
+}
+
+static void Cleanup()
+{
+	CloseAll();
+	g_Devices.clear();
+	g_Tickets.clear();
+	g_Sequencers.clear();
+	for (int f = 0; f < NumFamilies; f++) {
+		g_Families[f].Unload();
+		g_Listed[f] = false;
+	}
+}
+
+static Device & GetDevice(const mxArray * serialArray)
+{
+	char serial[16];
+	if (!mxIsChar(serialArray) || mxGetString(serialArray, serial, sizeof(serial)))
+		mexErrMsgTxt("Serial number must be a character array, e.g. '81850186'.");
+
+	auto it = g_Devices.find(serial);
+	if (it != g_Devices.end())
+		return it->second;
+
+	Device dev;
+	if (!FamilyFromSerial(serial, dev.family))
+		mexErrMsgTxt("Unknown Kinesis device type.  Serial number must start with 81, 29, 84, 59, 40, 70 or 64.");
+	dev.ops = &g_Families[dev.family];
+	if (!dev.ops->Load())
+		mexErrMsgTxt("Could not load the Thorlabs Kinesis library for this device from " KINESIS_INSTALL_DIR
+			", the folder of Kinesis_Dispatch or the DLL search path (PATH).");
+	strncpy(dev.serial, serial, 8);
+	dev.serial[8] = '\0';
+	dev.open = false;
+	return g_Devices.emplace(serial, dev).first->second;
+}
+
+// Builds the device list once per family, and again if the device has been
+// connected since.
+static bool FindDevice(Device const & dev)
+{
+	DeviceListApi const & list = dev.ops->List();
+	DeviceInfo info;
+	if (g_Listed[dev.family] && list.GetDeviceInfo(dev.serial, &info))
+		return true;
+	g_Listed[dev.family] = list.BuildDeviceList() == 0;
+	if (list.GetDeviceListSize() == 0)
+		mexErrMsgTxt("Can't find any Kinesis Instruments.  Try running Kinesis_Dispatch('BuildDeviceList')");
+	return list.GetDeviceInfo(dev.serial, &info) != 0;
+}
+
+static short GetChannel(Device const & dev, int nargs, const mxArray * args[], int index)
+{
+	short channel = nargs > index ? (short)mxGetScalar(args[index]) : 1;
+	if (channel < 1 || channel > dev.ops->channels)
+		mexErrMsgTxt("Channel is out of range for this device.");
+	return channel;
+}
+
+static void RequireOpen(Device const & dev)
+{
+	if (!dev.open)
+		mexErrMsgTxt("Device is not open.  Call Kinesis_Dispatch('Open', SerialNo) first.");
+}
+
+//*******************************************************************************************
+// Commands.  'args' are the inputs following the serial number.
+
+typedef void (*Handler)(Device * dev, int nlhs, mxArray * plhs[], int nargs, const mxArray * args[]);
+
+static void Commands(Device *, int, mxArray * plhs[], int, const mxArray *[]);
+
+static void BuildDeviceList(Device *, int, mxArray * plhs[], int, const mxArray *[])
+{
+	int N = 0;
+	for (int f = 0; f < NumFamilies && N == 0; f++) {
+		if (!g_Families[f].Load())
+			continue;
+		DeviceListApi const & list = g_Families[f].List();
+		g_Listed[f] = list.BuildDeviceList() == 0;
+		ULONGLONG T1 = GetTickCount64();
+		N = list.GetDeviceListSize();
+		while (N == 0 && GetTickCount64() - T1 < 10000) {
+			Sleep(100);
+			N = list.GetDeviceListSize();
+		}
+	}
+	plhs[0] = mxCreateDoubleScalar(N);
+}
+
+static void CloseAllDevices(Device *, int, mxArray *[], int, const mxArray *[])
+{
+	CloseAll();
+}
+
+static void Unload(Device *, int, mxArray *[], int, const mxArray *[])
+{
+	Cleanup();
+	if (g_Locked) {
+		mexUnlock();
+		g_Locked = false;
+	}
+}
+
+static void Open(Device * dev, int, mxArray * plhs[], int, const mxArray *[])
+{
+	short Err = 2;	// FT_DEVICENOTFOUND
+	if (dev->open)
+		Err = 0;
+	else if (FindDevice(*dev))
+		Err = dev->ops->Open(dev->serial);
+	dev->open = Err == 0;
+	plhs[0] = mxCreateDoubleScalar(Err);
+}
+
+static void Close(Device * dev, int, mxArray *[], int, const mxArray *[])
+{
+	StopSequencer(dev->serial);
+	StopWaiters(dev->serial);
+	if (dev->open)
+		dev->ops->Close(dev->serial);
+	dev->open = false;
+}
+
+static void Identify(Device * dev, int, mxArray * plhs[], int nargs, const mxArray * args[])
+{
+	short channel = GetChannel(*dev, nargs, args, 0);
+	short Err = 0;
+	if (dev->open) {
+		dev->ops->Identify(dev->serial, channel);
+	}
+	else {
+		Err = FindDevice(*dev) ? dev->ops->Open(dev->serial) : 2;
+		if (!Err) {
+			dev->ops->Identify(dev->serial, channel);
+			dev->ops->Close(dev->serial);
+		}
+	}
+	plhs[0] = mxCreateDoubleScalar(Err);
+}
+
+static void GetStatusBits(Device * dev, int, mxArray * plhs[], int nargs, const mxArray * args[])
+{
+	RequireOpen(*dev);
+	short channel = GetChannel(*dev, nargs, args, 0);
+	dev->ops->RequestStatus(dev->serial, channel);
+	plhs[0] = mxCreateDoubleScalar(dev->ops->GetStatusBits(dev->serial, channel));
+}
+
+static void PCC_SetPositionControlMode(Device * dev, int, mxArray * plhs[], int, const mxArray * args[])
+{
+	PiezoApi const & api = dev->Get<PiezoApi>();
+	int Mode = (int)mxGetScalar(args[0]);
+	short Err = -1;
+	if (Mode == 1 || Mode == 2)		// PZ_OpenLoop, PZ_CloseLoop
+		Err = api.SetPositionControlMode(dev->serial, Mode);
+	plhs[0] = mxCreateDoubleScalar(Err);
+}
+
+static void PCC_SetPosition(Device * dev, int, mxArray * plhs[], int, const mxArray * args[])
+{
+	PiezoApi const & api = dev->Get<PiezoApi>();
+	double Position = mxGetScalar(args[0]);
+	WORD Current = (WORD)(Position < 0 ? 0 : (Position > 65535 ? 65535 : Position));
+	plhs[0] = mxCreateDoubleScalar(api.SetPosition(dev->serial, Current));
+}
+
+static void PCC_GetPosition(Device * dev, int, mxArray * plhs[], int, const mxArray *[])
+{
+	PiezoApi const & api = dev->Get<PiezoApi>();
+	api.RequestStatus(dev->serial);
+	plhs[0] = mxCreateDoubleScalar(api.GetPosition(dev->serial));
+}
+
+// One axis of PCC_SetPositions.  Runs on its own thread so the USB round
+// trips and the settle waits of the axes overlap.
+struct Axis
+{
+	Device const * piezo;
+	Device const * gauge;		// NULL to skip the settle wait
+	WORD position;
+	double tolerance;
+	double timeoutSeconds;
+	short err;
+	double reading;
+	double seconds;
+};
+
+// The status request is asynchronous, so a reading can be older than the
+// setpoint; readings only count as settled once the gauge has been seen to
+// move half of the setpoint change.  The change is taken from the previous
+// setpoint rather than from an absolute target, since the offset and slope
+// of the strain gauge calibration are not known here.
+static void MoveAxis(Axis * axis)
+{
+	axis->reading = NaN;
+	axis->seconds = 0;
+	PiezoApi const & piezo = axis->piezo->Get<PiezoApi>();
+	StrainGaugeApi const * sg = axis->gauge ? &axis->gauge->Get<StrainGaugeApi>() : NULL;
+	char const * serial = axis->gauge ? axis->gauge->serial : NULL;
+	bool IsClipped;
+	double from = 0, distance = 0;
+	if (sg) {
+		piezo.RequestStatus(axis->piezo->serial);
+		double previous = piezo.GetPosition(axis->piezo->serial);
+		distance = fabs(axis->position - previous) * SG_FULLSCALE / PIEZO_FULLSCALE;
+		sg->RequestStatus(serial);
+		from = sg->GetReadingExt(serial, true, &IsClipped);
+	}
+	double timeoutSeconds = axis->timeoutSeconds + SETTLE_S_PER_TRAVEL * distance / SG_FULLSCALE;
+	bool moved = distance <= axis->tolerance;
+
+	Clock::time_point start = Clock::now();
+	axis->err = piezo.SetPosition(axis->piezo->serial, axis->position);
+	if (axis->err || !sg)
+		return;
+
+	double last = NaN;
+	int steady = 0;
+	while (steady < SETTLE_SAMPLES) {
+		Sleep(SETTLE_MS);
+		sg->RequestStatus(serial);
+		double reading = sg->GetReadingExt(serial, true, &IsClipped);
+		moved = moved || fabs(reading - from) >= distance / 2;
+		steady = moved && fabs(reading - last) <= axis->tolerance ? steady + 1 : 0;
+		last = reading;
+		axis->seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		if (steady < SETTLE_SAMPLES && axis->seconds > timeoutSeconds) {
+			axis->err = ERR_NOT_SETTLED;
+			break;
+		}
+	}
+	axis->reading = last;
+}
+
+static Device * GetOpenDevice(const mxArray * serialArray, Kind kind)
+{
+	Device * dev = &GetDevice(serialArray);
+	if (dev->ops->kind != kind) {
+		char msg[128];
+		snprintf(msg, sizeof(msg), "Kinesis_Dispatch('PCC_SetPositions',...) does not apply to device %s.", dev->serial);
+		mexErrMsgTxt(msg);
+	}
+	RequireOpen(*dev);
+	return dev;
+}
+
+static void PCC_SetPositions(Device *, int nlhs, mxArray * plhs[], int nargs, const mxArray * args[])
+{
+	if (!mxIsCell(args[0]) || mxGetNumberOfElements(args[0]) > MAX_AXES
+		|| mxGetNumberOfElements(args[1]) != mxGetNumberOfElements(args[0]) || !mxIsDouble(args[1]))
+		mexErrMsgTxt("Proper Usage: Kinesis_Dispatch('PCC_SetPositions',{SN,...},Positions,...).  Positions must be a double array with one value per piezo.");
+	size_t N = mxGetNumberOfElements(args[0]);
+	bool settle = nargs > 2 && !mxIsEmpty(args[2]);
+	if (settle && (!mxIsCell(args[2]) || mxGetNumberOfElements(args[2]) != N))
+		mexErrMsgTxt("Proper Usage: Kinesis_Dispatch('PCC_SetPositions',{SN,...},Positions,{SGSN,...}).  Give one strain gauge per piezo.");
+	double Tolerance = nargs > 3 ? mxGetScalar(args[3]) : 10;
+	double TimeoutSeconds = nargs > 4 ? mxGetScalar(args[4]) : 2;
+
+	Axis axes[MAX_AXES];
+	double * Positions = mxGetPr(args[1]);
+	for (size_t ii = 0; ii < N; ii++) {
+		axes[ii].piezo = GetOpenDevice(mxGetCell(args[0], ii), Piezo);
+		axes[ii].gauge = settle ? GetOpenDevice(mxGetCell(args[2], ii), StrainGauge) : NULL;
+		axes[ii].position = (WORD)(Positions[ii] < 0 ? 0 : (Positions[ii] > 65535 ? 65535 : Positions[ii]));
+		axes[ii].tolerance = Tolerance;
+		axes[ii].timeoutSeconds = TimeoutSeconds;
+	}
+
+	std::thread threads[MAX_AXES];
+	for (size_t ii = 1; ii < N; ii++)
+		threads[ii] = std::thread(MoveAxis, &axes[ii]);
+	if (N > 0)
+		MoveAxis(&axes[0]);
+	for (size_t ii = 1; ii < N; ii++)
+		threads[ii].join();
+
+	plhs[0] = mxCreateDoubleMatrix(1, N, mxREAL);
+	for (size_t ii = 0; ii < N; ii++)
+		mxGetPr(plhs[0])[ii] = axes[ii].err;
+	if (nlhs > 1) {
+		plhs[1] = mxCreateDoubleMatrix(1, N, mxREAL);
+		for (size_t ii = 0; ii < N; ii++)
+			mxGetPr(plhs[1])[ii] = axes[ii].reading;
+	}
+	if (nlhs > 2) {
+		plhs[2] = mxCreateDoubleMatrix(1, N, mxREAL);
+		for (size_t ii = 0; ii < N; ii++)
+			mxGetPr(plhs[2])[ii] = axes[ii].seconds;
+	}
+}
+
+static void SG_GetReading(Device * dev, int, mxArray * plhs[], int, const mxArray *[])
+{
+	StrainGaugeApi const & api = dev->Get<StrainGaugeApi>();
+	bool IsClipped;
+	api.RequestStatus(dev->serial);
+	plhs[0] = mxCreateDoubleScalar(api.GetReadingExt(dev->serial, true, &IsClipped));
+}
+
+static void SG_SetZero(Device * dev, int, mxArray * plhs[], int nargs, const mxArray * args[])
+{
+	StrainGaugeApi const & api = dev->Get<StrainGaugeApi>();
+	double TimeoutSeconds = nargs > 0 ? mxGetScalar(args[0]) : 30;
+
+	api.RequestStatus(dev->serial);
+	api.SetZero(dev->serial);
+
+	//wait until zeroing finishes
+	ULONGLONG T1 = GetTickCount64();
+	bool Timeout = 1;
+	Sleep(200);
+	api.RequestStatus(dev->serial);
+	DWORD Status = api.GetStatusBits(dev->serial);
+	while (Timeout && (0x00000020 & Status)) {
+		Sleep(100);
+		Status = api.GetStatusBits(dev->serial);
+		Timeout = double(GetTickCount64() - T1) < TimeoutSeconds * 1000;
+	}
+	plhs[0] = mxCreateDoubleScalar(!Timeout);
+}
+
+static void SBC_Home(Device * dev, int, mxArray * plhs[], int nargs, const mxArray * args[])
+{
+	short channel = GetChannel(*dev, nargs, args, 0);
+	plhs[0] = mxCreateDoubleScalar(dev->Get<StepperApi>().Home(dev->serial, channel));
+}
+
+static int PositionSteps(const mxArray * position)
+{
+	double Position = mxGetScalar(position);
+	if (Position > MAX_TRAVEL_MM)
+		mexErrMsgTxt("The stage cannot go further than 4 mm.");
+	if (Position < -MAX_TRAVEL_MM)
+		mexErrMsgTxt("The stage cannot go further than -4 mm.");
+	return (int)(Position * STEPS_PER_MM);
+}
+
+static void SBC_MoveToPosition(Device * dev, int, mxArray * plhs[], int nargs, const mxArray * args[])
+{
+	short channel = GetChannel(*dev, nargs, args, 0);
+	int Steps = PositionSteps(args[1]);
+	plhs[0] = mxCreateDoubleScalar(dev->Get<StepperApi>().MoveToPosition(dev->serial, channel, Steps));
+}
+
+static void SBC_MoveJog(Device * dev, int, mxArray * plhs[], int nargs, const mxArray * args[])
+{
+	short channel = GetChannel(*dev, nargs, args, 0);
+	double Direction = mxGetScalar(args[1]);
+	if (Direction != 1 && Direction != -1)
+		mexErrMsgTxt("Direction must either be 1 (Forward) or -1 (Backward).");
+	int Travel = Direction == 1 ? 1 : 2;	// MOT_Forwards, MOT_Reverse
+	plhs[0] = mxCreateDoubleScalar(dev->Get<StepperApi>().MoveJog(dev->serial, channel, Travel));
+}
+
+static void SBC_GetPosition(Device * dev, int, mxArray * plhs[], int nargs, const mxArray * args[])
+{
+	StepperApi const & api = dev->Get<StepperApi>();
+	short channel = GetChannel(*dev, nargs, args, 0);
+	api.RequestPosition(dev->serial, channel);
+	plhs[0] = mxCreateDoubleScalar((double)api.GetPosition(dev->serial, channel) / STEPS_PER_MM);
+}
+
+static void SBC_SetJogStepSize(Device * dev, int, mxArray * plhs[], int nargs, const mxArray * args[])
+{
+	short channel = GetChannel(*dev, nargs, args, 0);
+	unsigned int Steps = (unsigned int)(mxGetScalar(args[1]) * STEPS_PER_MM);
+	plhs[0] = mxCreateDoubleScalar(dev->Get<StepperApi>().SetJogStepSize(dev->serial, channel, Steps));
+}
+
+static void SBC_GetJogStepSize(Device * dev, int, mxArray * plhs[], int nargs, const mxArray * args[])
+{
+	StepperApi const & api = dev->Get<StepperApi>();
+	short channel = GetChannel(*dev, nargs, args, 0);
+	api.RequestJogParams(dev->serial, channel);
+	plhs[0] = mxCreateDoubleScalar((double)api.GetJogStepSize(dev->serial, channel) / STEPS_PER_MM);
+}
+
+// The ticket is created before the command so a fast completion is not missed.
+static void SBC_HomeAsync(Device * dev, int nlhs, mxArray * plhs[], int nargs, const mxArray * args[])
+{
+	short channel = GetChannel(*dev, nargs, args, 0);
+	StartWaiter(*dev, channel);
+	unsigned int ticket = NewTicket(*dev, channel, MSG_MOTOR_HOMED);
+	short Err = dev->Get<StepperApi>().Home(dev->serial, channel);
+	if (Err) {
+		std::lock_guard<std::mutex> lock(g_MoveMutex);
+		g_Tickets.erase(ticket);
+		ticket = 0;
+	}
+	plhs[0] = mxCreateDoubleScalar(ticket);
+	if (nlhs > 1)
+		plhs[1] = mxCreateDoubleScalar(Err);
+}
+
+static void SBC_MoveToPositionAsync(Device * dev, int nlhs, mxArray * plhs[], int nargs, const mxArray * args[])
+{
+	short channel = GetChannel(*dev, nargs, args, 0);
+	int Steps = PositionSteps(args[1]);
+	StartWaiter(*dev, channel);
+	unsigned int ticket = NewTicket(*dev, channel, MSG_MOTOR_MOVED);
+	short Err = dev->Get<StepperApi>().MoveToPosition(dev->serial, channel, Steps);
+	if (Err) {
+		std::lock_guard<std::mutex> lock(g_MoveMutex);
+		g_Tickets.erase(ticket);
+		ticket = 0;
+	}
+	plhs[0] = mxCreateDoubleScalar(ticket);
+	if (nlhs > 1)
+		plhs[1] = mxCreateDoubleScalar(Err);
+}
+
+static void ReturnTicket(MoveTicket const & t, int nlhs, mxArray * plhs[])
+{
+	plhs[0] = mxCreateLogicalScalar(t.done);
+	if (nlhs > 1)
+		plhs[1] = mxCreateDoubleScalar(t.seconds);
+	if (nlhs > 2)
+		plhs[2] = mxCreateDoubleScalar(t.position);
+}
+
+// Tickets are only added and removed on the MATLAB thread, so the reference
+// stays valid while SBC_Wait sleeps.
+static MoveTicket * FindTicket(const mxArray * ticket)
+{
+	std::lock_guard<std::mutex> lock(g_MoveMutex);
+	auto it = g_Tickets.find((unsigned int)mxGetScalar(ticket));
+	return it == g_Tickets.end() ? NULL : &it->second;
+}
+
+static void SBC_IsDone(Device *, int nlhs, mxArray * plhs[], int, const mxArray * args[])
+{
+	MoveTicket * t = FindTicket(args[0]);
+	if (!t)
+		mexErrMsgTxt("Unknown move ticket.");
+	std::unique_lock<std::mutex> lock(g_MoveMutex);
+	MoveTicket copy = *t;
+	lock.unlock();
+	ReturnTicket(copy, nlhs, plhs);
+}
+
+static void SBC_Wait(Device *, int nlhs, mxArray * plhs[], int nargs, const mxArray * args[])
+{
+	double TimeoutSeconds = nargs > 1 ? mxGetScalar(args[1]) : 60;
+	MoveTicket * t = FindTicket(args[0]);
+	if (!t)
+		mexErrMsgTxt("Unknown move ticket.");
+	std::unique_lock<std::mutex> lock(g_MoveMutex);
+	g_MoveDone.wait_for(lock, std::chrono::duration<double>(TimeoutSeconds > 0 ? TimeoutSeconds : 0),
+		[t]() { return t->done; });
+	MoveTicket copy = *t;
+	lock.unlock();
+	ReturnTicket(copy, nlhs, plhs);
+}
+
+static void LD_EnableOutput(Device * dev, int nlhs, mxArray * plhs[], int, const mxArray *[])
+{
+	LaserDiodeApi const & api = dev->Get<LaserDiodeApi>();
+	plhs[0] = mxCreateDoubleScalar(api.EnableOutput(dev->serial));
+	if (nlhs > 1)
+		plhs[1] = mxCreateDoubleScalar(api.GetLaserSetPoint(dev->serial));
+}
+
+static void LD_DisableOutput(Device * dev, int, mxArray * plhs[], int, const mxArray *[])
+{
+	plhs[0] = mxCreateDoubleScalar(dev->Get<LaserDiodeApi>().DisableOutput(dev->serial));
+}
+
+static void LD_SetLaserSetPoint(Device * dev, int nlhs, mxArray * plhs[], int, const mxArray * args[])
+{
+	LaserDiodeApi const & api = dev->Get<LaserDiodeApi>();
+	double Current = mxGetScalar(args[0]);
+	api.Enable(dev->serial);
+	plhs[0] = mxCreateDoubleScalar(api.SetLaserSetPoint(dev->serial, (WORD)(Current < 0 ? 0 : (Current > 65535 ? 65535 : Current))));
+	if (nlhs > 1)
+		plhs[1] = mxCreateDoubleScalar(api.GetLaserSetPoint(dev->serial));
+}
+
+static void LD_SetOpenLoopMode(Device * dev, int, mxArray * plhs[], int, const mxArray *[])
+{
+	plhs[0] = mxCreateDoubleScalar(dev->Get<LaserDiodeApi>().SetOpenLoopMode(dev->serial));
+}
+
+static void LD_SetClosedLoopMode(Device * dev, int, mxArray * plhs[], int, const mxArray *[])
+{
+	plhs[0] = mxCreateDoubleScalar(dev->Get<LaserDiodeApi>().SetClosedLoopMode(dev->serial));
+}
+
+static void LD_SetWACalibFactor(Device * dev, int, mxArray * plhs[], int, const mxArray * args[])
+{
+	float WperA = (float)mxGetScalar(args[0]);
+	plhs[0] = mxCreateDoubleScalar(dev->Get<LaserDiodeApi>().SetWACalibFactor(dev->serial, WperA));
+}
+
+static Sequencer * GetSequencer(Device const & dev)
+{
+	auto it = g_Sequencers.find(dev.serial);
+	if (it == g_Sequencers.end())
+		mexErrMsgTxt("No sequence loaded.  Call Kinesis_Dispatch('LD_LoadSequence', SN, Times, SetPoints) first.");
+	return it->second.get();
+}
+
+static void LD_LoadSequence(Device * dev, int, mxArray *[], int, const mxArray * args[])
+{
+	size_t N = mxGetNumberOfElements(args[1]);
+	if (!mxIsDouble(args[0]) || !mxIsDouble(args[1]) || N == 0
+		|| (!mxIsEmpty(args[0]) && mxGetNumberOfElements(args[0]) != N))
+		mexErrMsgTxt("Proper Usage: Kinesis_Dispatch('LD_LoadSequence',SN,Times,SetPoints).  Times and SetPoints must be double arrays of the same length, or Times empty.");
+	double * Times = mxGetPr(args[0]);
+	for (size_t ii = 0; ii < mxGetNumberOfElements(args[0]); ii++)
+		if (Times[ii] < 0 || (ii > 0 && Times[ii] < Times[ii - 1]))
+			mexErrMsgTxt("Sequence times must be increasing and not negative.");
+
+	StopSequencer(dev->serial);
+	std::unique_ptr<Sequencer> & seq = g_Sequencers[dev->serial];
+	seq.reset(new Sequencer);
+	seq->times.assign(Times, Times + mxGetNumberOfElements(args[0]));
+	double * SetPoints = mxGetPr(args[1]);
+	for (size_t ii = 0; ii < N; ii++)
+		seq->setPoints.push_back((WORD)(SetPoints[ii] < 0 ? 0 : (SetPoints[ii] > 65535 ? 65535 : SetPoints[ii])));
+	seq->running = false;
+	seq->stop = false;
+	seq->step = 0;
+}
+
+static void LD_StartSequence(Device * dev, int, mxArray * plhs[], int, const mxArray *[])
+{
+	Sequencer * seq = GetSequencer(*dev);
+	StopSequencer(dev->serial);
+	seq->late.clear();
+	seq->advances.clear();
+	seq->step = 0;
+	seq->stop = false;
+	seq->running = true;
+	seq->thread = std::thread(PlaySequence, &dev->Get<LaserDiodeApi>(), std::string(dev->serial), seq);
+	plhs[0] = mxCreateDoubleScalar(0);
+}
+
+static void LD_Advance(Device * dev, int, mxArray *[], int nargs, const mxArray * args[])
+{
+	Clock::time_point now = Clock::now();
+	Sequencer * seq = GetSequencer(*dev);
+	if (!seq->times.empty())
+		mexErrMsgTxt("LD_Advance applies to sequences loaded without times.");
+	{
+		std::lock_guard<std::mutex> lock(seq->mutex);
+		size_t next = seq->advances.empty() ? seq->step : seq->advances.back().first + 1;
+		size_t step = nargs > 0 ? (size_t)(mxGetScalar(args[0]) - 1) : next;
+		seq->advances.push_back(std::make_pair(step, now));
+	}
+	seq->wake.notify_all();
+}
+
+static void LD_StopSequence(Device * dev, int, mxArray *[], int, const mxArray *[])
+{
+	StopSequencer(dev->serial);
+}
+
+static void LD_SequenceStatus(Device * dev, int nlhs, mxArray * plhs[], int, const mxArray *[])
+{
+	Sequencer * seq = GetSequencer(*dev);
+	std::unique_lock<std::mutex> lock(seq->mutex);
+	bool Running = seq->running;
+	size_t Step = seq->step;
+	std::vector<double> late = seq->late;
+	lock.unlock();
+
+	plhs[0] = mxCreateLogicalScalar(Running);
+	if (nlhs > 1)
+		plhs[1] = mxCreateDoubleScalar((double)Step);
+	if (nlhs > 2) {
+		const char * fields[] = { "Steps", "Late", "MeanLate", "RmsJitter", "MaxLate" };
+		plhs[2] = mxCreateStructMatrix(1, 1, 5, fields);
+		mxArray * Late = mxCreateDoubleMatrix(late.size(), 1, mxREAL);
+		double Sum = 0, Sum2 = 0, Max = 0;
+		for (size_t ii = 0; ii < late.size(); ii++) {
+			mxGetPr(Late)[ii] = late[ii];
+			Sum += late[ii];
+			Max = late[ii] > Max ? late[ii] : Max;
+		}
+		double Mean = late.empty() ? 0 : Sum / late.size();
+		for (size_t ii = 0; ii < late.size(); ii++)
+			Sum2 += (late[ii] - Mean) * (late[ii] - Mean);
+		mxSetFieldByNumber(plhs[2], 0, 0, mxCreateDoubleScalar((double)late.size()));
+		mxSetFieldByNumber(plhs[2], 0, 1, Late);
+		mxSetFieldByNumber(plhs[2], 0, 2, mxCreateDoubleScalar(Mean));
+		mxSetFieldByNumber(plhs[2], 0, 3, mxCreateDoubleScalar(late.empty() ? 0 : sqrt(Sum2 / late.size())));
+		mxSetFieldByNumber(plhs[2], 0, 4, mxCreateDoubleScalar(Max));
+	}
+}
+
+//*******************************************************************************************
+// Command table.  The index in the table is the command ID.
+
+struct Command
+{
+	char const * name;
+	bool device;		// takes a serial number
+	Kind kind;			// device kind required
+	bool open;			// device must be open
+	int minArgs;		// inputs after the serial number
+	int maxArgs;
+	Handler handler;
+};
+
+static const Command g_Commands[] = {
+	{ "Commands", false, AnyKind, false, 0, 0, Commands },
+	{ "BuildDeviceList", false, AnyKind, false, 0, 0, BuildDeviceList },
+	{ "CloseAll", false, AnyKind, false, 0, 0, CloseAllDevices },
+	{ "Unload", false, AnyKind, false, 0, 0, Unload },
+	{ "Open", true, AnyKind, false, 0, 0, Open },
+	{ "Close", true, AnyKind, false, 0, 0, Close },
+	{ "Identify", true, AnyKind, false, 0, 1, Identify },
+	{ "GetStatusBits", true, AnyKind, true, 0, 1, GetStatusBits },
+	{ "PCC_SetPositionControlMode", true, Piezo, true, 1, 1, PCC_SetPositionControlMode },
+	{ "PCC_SetPosition", true, Piezo, true, 1, 1, PCC_SetPosition },
+	{ "PCC_GetPosition", true, Piezo, true, 0, 0, PCC_GetPosition },
+	{ "PCC_SetPositions", false, AnyKind, false, 2, 5, PCC_SetPositions },
+	{ "SG_GetReading", true, StrainGauge, true, 0, 0, SG_GetReading },
+	{ "SG_SetZero", true, StrainGauge, true, 0, 1, SG_SetZero },
+	{ "SBC_Home", true, Stepper, true, 1, 1, SBC_Home },
+	{ "SBC_MoveToPosition", true, Stepper, true, 2, 2, SBC_MoveToPosition },
+	{ "SBC_MoveJog", true, Stepper, true, 2, 2, SBC_MoveJog },
+	{ "SBC_GetPosition", true, Stepper, true, 1, 1, SBC_GetPosition },
+	{ "SBC_SetJogStepSize", true, Stepper, true, 2, 2, SBC_SetJogStepSize },
+	{ "SBC_GetJogStepSize", true, Stepper, true, 1, 1, SBC_GetJogStepSize },
+	{ "SBC_HomeAsync", true, Stepper, true, 1, 1, SBC_HomeAsync },
+	{ "SBC_MoveToPositionAsync", true, Stepper, true, 2, 2, SBC_MoveToPositionAsync },
+	{ "SBC_IsDone", false, AnyKind, false, 1, 1, SBC_IsDone },
+	{ "SBC_Wait", false, AnyKind, false, 1, 2, SBC_Wait },
+	{ "LD_EnableOutput", true, LaserDiode, true, 0, 0, LD_EnableOutput },
+	{ "LD_DisableOutput", true, LaserDiode, true, 0, 0, LD_DisableOutput },
+	{ "LD_SetLaserSetPoint", true, LaserDiode, true, 1, 1, LD_SetLaserSetPoint },
+	{ "LD_SetOpenLoopMode", true, LaserDiode, true, 0, 0, LD_SetOpenLoopMode },
+	{ "LD_SetClosedLoopMode", true, LaserDiode, true, 0, 0, LD_SetClosedLoopMode },
+	{ "LD_SetWACalibFactor", true, LaserDiode, true, 1, 1, LD_SetWACalibFactor },
+	{ "LD_LoadSequence", true, LaserDiode, true, 2, 2, LD_LoadSequence },
+	{ "LD_StartSequence", true, LaserDiode, true, 0, 0, LD_StartSequence },
+	{ "LD_Advance", true, LaserDiode, true, 0, 1, LD_Advance },
+	{ "LD_StopSequence", true, LaserDiode, false, 0, 0, LD_StopSequence },
+	{ "LD_SequenceStatus", true, LaserDiode, false, 0, 0, LD_SequenceStatus },
+};
+
+static const int g_NCommands = sizeof(g_Commands) / sizeof(g_Commands[0]);
+
+static void Commands(Device *, int, mxArray * plhs[], int, const mxArray *[])
+{
+	const char * names[g_NCommands];
+	for (int i = 0; i < g_NCommands; i++)
+		names[i] = g_Commands[i].name;
+	plhs[0] = mxCreateStructMatrix(1, 1, g_NCommands, names);
+	for (int i = 0; i < g_NCommands; i++)
+		mxSetFieldByNumber(plhs[0], 0, i, mxCreateDoubleScalar(i));
+}
+
+static int CommandID(const mxArray * command)
+{
+	if (!mxIsChar(command)) {
+		if (mxGetNumberOfElements(command) != 1)
+			mexErrMsgTxt("Proper Usage: [...]=Kinesis_Dispatch(Command,SerialNo,...).  Command must be a name or an ID.");
+		return (int)mxGetScalar(command);
+	}
+	static std::unordered_map<std::string, int> ids;
+	if (ids.empty())
+		for (int i = 0; i < g_NCommands; i++)
+			ids[g_Commands[i].name] = i;
+	char name[64];
+	if (mxGetString(command, name, sizeof(name)))
+		return -1;
+	auto it = ids.find(name);
+	return it == ids.end() ? -1 : it->second;
+}
+
+//*******************************************************************************************
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+
+	if (nrhs < 1)
+		mexErrMsgTxt("Proper Usage: [...]=Kinesis_Dispatch(Command,SerialNo,...).  See Kinesis_Dispatch('Commands').");
+
+	if (!g_Locked) {
+		mexLock();
+		mexAtExit(Cleanup);
+		g_Locked = true;
+	}
+
+	int id = CommandID(prhs[0]);
+	if (id < 0 || id >= g_NCommands)
+		mexErrMsgTxt("Unknown command.  See Kinesis_Dispatch('Commands').");
+	Command const & cmd = g_Commands[id];
+
+	int first = cmd.device ? 2 : 1;
+	int nargs = nrhs - first;
+	if (nargs < cmd.minArgs || nargs > cmd.maxArgs || (cmd.device && nrhs < 2)) {
+		char msg[128];
+		snprintf(msg, sizeof(msg), "Wrong number of inputs for Kinesis_Dispatch('%s',...).", cmd.name);
+		mexErrMsgTxt(msg);
+	}
+
+	Device * dev = NULL;
+	if (cmd.device) {
+		dev = &GetDevice(prhs[1]);
+		if (cmd.kind != AnyKind && cmd.kind != dev->ops->kind) {
+			char msg[128];
+			snprintf(msg, sizeof(msg), "Kinesis_Dispatch('%s',...) does not apply to device %s.", cmd.name, dev->serial);
+			mexErrMsgTxt(msg);
+		}
+		if (cmd.open)
+			RequireOpen(*dev);
+	}
+
+	cmd.handler(dev, nlhs, plhs, nargs, prhs + first);
+	return;
+}
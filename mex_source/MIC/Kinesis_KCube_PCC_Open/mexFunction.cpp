@@ -1,13 +1,19 @@
+#ifdef LINUX
+#include "KinesisCompat.h"
+#else
 #include <windows.h>
 #pragma comment(lib, "kernel32.lib")
+#endif
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include <mex.h>
+#ifndef LINUX
 #include <conio.h>
-#include "C:\Program Files\Thorlabs\Kinesis\Thorlabs.MotionControl.KCube.Piezo.h"
+#endif
+#include "Thorlabs.MotionControl.KCube.Piezo.h"
 
 #ifndef max
 //! not defined in the C standard used by visual studio
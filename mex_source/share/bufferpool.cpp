@@ -0,0 +1,287 @@
+#include <map>
+#include <mutex>
+#include <new>
+#include <chrono>
+#include <string.h>
+#ifdef LINUX
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#include <windows.h>
+#pragma comment(lib, "advapi32.lib")	// AdjustTokenPrivileges()
+#endif
+#include <mex.h>
+#include "bufferpool.h"
+
+// Buffers smaller than a large page are rounded up to this size.
+#define POOL_GRANULE ((size_t)64 * 1024)
+// Limit of the cached buffers if the physical memory is unknown.
+#define POOL_DEFAULT_LIMIT ((size_t)1024 * 1024 * 1024)
+
+struct pool_block
+{
+	size_t bytes;
+	bool large, borrowed;
+};
+
+struct buffer_pool
+{
+	std::mutex lock;
+	std::map<void*, pool_block> blocks;			// all buffers of the pool
+	std::multimap<size_t, void*> cached;		// returned buffers by size
+	size_t cachedBytes, limit;
+	double hits, misses, allocTime;
+
+	buffer_pool();
+	~buffer_pool();
+};
+
+static buffer_pool g_pool;
+
+static size_t large_page_size()
+{
+#ifdef LINUX
+	return (size_t)2 * 1024 * 1024;
+#else
+	return GetLargePageMinimum();
+#endif
+}
+
+// The cached buffers may hold up to a quarter of the physical memory.
+static size_t cache_limit()
+{
+#ifdef LINUX
+	long pages = sysconf(_SC_PHYS_PAGES), pageSize = sysconf(_SC_PAGESIZE);
+	if (pages <= 0 || pageSize <= 0)
+		return POOL_DEFAULT_LIMIT;
+	return (size_t)pages * (size_t)pageSize / 4;
+#else
+	MEMORYSTATUSEX status;
+	status.dwLength = sizeof(status);
+	if (!GlobalMemoryStatusEx(&status))
+		return POOL_DEFAULT_LIMIT;
+	return (size_t)(status.ullTotalPhys / 4);
+#endif
+}
+
+#ifndef LINUX
+// Large pages need SE_LOCK_MEMORY_NAME, which an account that has the
+// "Lock pages in memory" right must still enable for the process.
+static bool g_largePages = false;
+static std::once_flag g_largePagesOnce;
+
+static void enable_large_pages()
+{
+	HANDLE token;
+	if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+		return;
+	TOKEN_PRIVILEGES privileges;
+	memset(&privileges, 0, sizeof(privileges));
+	privileges.PrivilegeCount = 1;
+	privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+	if (LookupPrivilegeValue(NULL, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid)
+		&& AdjustTokenPrivileges(token, FALSE, &privileges, 0, NULL, NULL))
+		g_largePages = GetLastError() == ERROR_SUCCESS;
+	CloseHandle(token);
+}
+#endif
+
+// Allocates 'bytes' (a multiple of the page size) and faults its pages in.
+static void* allocate_block(size_t bytes, bool& large)
+{
+	size_t largePage = large_page_size();
+	void* buffer = NULL;
+	large = false;
+#ifdef LINUX
+	if (largePage > 0 && bytes % largePage == 0)
+	{
+		buffer = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+		large = buffer != MAP_FAILED;
+	}
+	if (!large)
+	{
+		buffer = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (buffer == MAP_FAILED)
+			return NULL;
+		// Transparent huge pages, where they are enabled.
+		madvise(buffer, bytes, MADV_HUGEPAGE);
+	}
+#else
+	std::call_once(g_largePagesOnce, enable_large_pages);
+	if (largePage > 0 && bytes % largePage == 0 && g_largePages)
+	{
+		// Large pages are resident as soon as they are committed.
+		buffer = VirtualAlloc(NULL, bytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+		large = buffer != NULL;
+	}
+	if (!large)
+		buffer = VirtualAlloc(NULL, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	if (buffer == NULL)
+		return NULL;
+#endif
+	if (!large)
+	{
+		// One write per small page commits it now instead of on first use.
+		volatile char* page = (volatile char*)buffer;
+		for (size_t offset = 0; offset < bytes; offset += 4096)
+			page[offset] = 0;
+	}
+	return buffer;
+}
+
+static void free_block(void* buffer, size_t bytes)
+{
+#ifdef LINUX
+	munmap(buffer, bytes);
+#else
+	VirtualFree(buffer, 0, MEM_RELEASE);
+#endif
+}
+
+// Frees the cached buffers; called with the pool locked.
+static size_t release_cached(buffer_pool& pool)
+{
+	size_t freed = 0;
+	for (std::multimap<size_t, void*>::iterator it = pool.cached.begin(); it != pool.cached.end(); ++it)
+	{
+		free_block(it->second, it->first);
+		pool.blocks.erase(it->second);
+		freed += it->first;
+	}
+	pool.cached.clear();
+	pool.cachedBytes = 0;
+	return freed;
+}
+
+buffer_pool::buffer_pool() : cachedBytes(0), limit(cache_limit()), hits(0), misses(0), allocTime(0)
+{
+}
+
+buffer_pool::~buffer_pool()
+{
+	release_cached(*this);
+}
+
+void* pool_borrow(size_t bytes)
+{
+	if (bytes == 0)
+		return NULL;
+	size_t largePage = large_page_size();
+	size_t granule = largePage > 0 && bytes >= largePage ? largePage : POOL_GRANULE;
+	bytes = (bytes + granule - 1) / granule * granule;
+
+	{
+		std::lock_guard<std::mutex> lk(g_pool.lock);
+		std::multimap<size_t, void*>::iterator it = g_pool.cached.find(bytes);
+		if (it != g_pool.cached.end())
+		{
+			void* buffer = it->second;
+			g_pool.cached.erase(it);
+			g_pool.cachedBytes -= bytes;
+			g_pool.blocks[buffer].borrowed = true;
+			g_pool.hits++;
+			return buffer;
+		}
+	}
+
+	// New buffers are allocated and touched outside the lock.
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	bool large;
+	void* buffer = allocate_block(bytes, large);
+	if (buffer == NULL)
+	{
+		// Buffers of other sizes are not needed as much as this one.
+		{
+			std::lock_guard<std::mutex> lk(g_pool.lock);
+			release_cached(g_pool);
+		}
+		buffer = allocate_block(bytes, large);
+		if (buffer == NULL)
+			return NULL;
+	}
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::lock_guard<std::mutex> lk(g_pool.lock);
+	pool_block& block = g_pool.blocks[buffer];
+	block.bytes = bytes;
+	block.large = large;
+	block.borrowed = true;
+	g_pool.misses++;
+	g_pool.allocTime += elapsed;
+	return buffer;
+}
+
+void pool_return(void* buffer)
+{
+	if (buffer == NULL)
+		return;
+	std::lock_guard<std::mutex> lk(g_pool.lock);
+	std::map<void*, pool_block>::iterator it = g_pool.blocks.find(buffer);
+	if (it == g_pool.blocks.end() || !it->second.borrowed)
+		return;
+	it->second.borrowed = false;
+	size_t bytes = it->second.bytes;
+
+	// Keep the cache under its limit.  Buffers of other sizes go first, as
+	// a capture borrows the same size again.
+	std::multimap<size_t, void*>::iterator cached = g_pool.cached.begin();
+	while (bytes <= g_pool.limit && g_pool.cachedBytes + bytes > g_pool.limit
+		&& cached != g_pool.cached.end())
+	{
+		if (cached->first == bytes)
+		{
+			++cached;
+			continue;
+		}
+		free_block(cached->second, cached->first);
+		g_pool.blocks.erase(cached->second);
+		g_pool.cachedBytes -= cached->first;
+		cached = g_pool.cached.erase(cached);
+	}
+	if (g_pool.cachedBytes + bytes > g_pool.limit)
+	{
+		free_block(buffer, bytes);
+		g_pool.blocks.erase(it);
+		return;
+	}
+	g_pool.cached.insert(std::make_pair(bytes, buffer));
+	g_pool.cachedBytes += bytes;
+}
+
+size_t pool_release()
+{
+	std::lock_guard<std::mutex> lk(g_pool.lock);
+	return release_cached(g_pool);
+}
+
+mxArray* create_pool_output()
+{
+	std::lock_guard<std::mutex> lk(g_pool.lock);
+	double borrowed = 0, bytesBorrowed = 0, bytesCached = 0, large = 0;
+	for (std::map<void*, pool_block>::const_iterator it = g_pool.blocks.begin(); it != g_pool.blocks.end(); ++it)
+	{
+		if (it->second.borrowed)
+		{
+			borrowed++;
+			bytesBorrowed += (double)it->second.bytes;
+		}
+		else
+			bytesCached += (double)it->second.bytes;
+		if (it->second.large)
+			large++;
+	}
+
+	const char* fields[] = { "Buffers", "Borrowed", "BytesBorrowed", "BytesCached",
+		"LargePages", "Hits", "Misses", "AllocTime" };
+	mxArray* out = mxCreateStructMatrix(1, 1, 8, fields);
+	mxSetFieldByNumber(out, 0, 0, mxCreateDoubleScalar((double)g_pool.blocks.size()));
+	mxSetFieldByNumber(out, 0, 1, mxCreateDoubleScalar(borrowed));
+	mxSetFieldByNumber(out, 0, 2, mxCreateDoubleScalar(bytesBorrowed));
+	mxSetFieldByNumber(out, 0, 3, mxCreateDoubleScalar(bytesCached));
+	mxSetFieldByNumber(out, 0, 4, mxCreateDoubleScalar(large));
+	mxSetFieldByNumber(out, 0, 5, mxCreateDoubleScalar(g_pool.hits));
+	mxSetFieldByNumber(out, 0, 6, mxCreateDoubleScalar(g_pool.misses));
+	mxSetFieldByNumber(out, 0, 7, mxCreateDoubleScalar(1e3 * g_pool.allocTime));
+	return out;
+}
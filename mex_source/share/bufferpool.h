@@ -0,0 +1,95 @@
+#pragma once
+// Pool of the large buffers of the native frame queues (staging frames,
+// datacube slabs, copies of MATLAB data).  New buffers use large pages when
+// the process may (Windows: the "Lock pages in memory" right; Linux: reserved
+// huge pages, else transparent huge pages) and are touched once when they
+// are allocated, so the page faults are paid before a capture rather than
+// on its first frames.  Returned buffers are kept for the next borrower of
+// the same size until pool_release() or until the mex file is cleared; the
+// contents of a borrowed buffer are undefined.  The kept buffers are capped
+// at a quarter of the physical memory; buffers of other sizes than the one
+// returned are freed first.
+// Include after <mutex> and <new>.  Shared by the mex functions of DCAM4
+// and MIC (e.g. H5Write_Async), so stdafx.h is not needed.  Each mex file
+// has its own pool; all of its buffers must be returned before the mex file
+// is cleared (i.e. by its mexAtExit() cleanup).
+
+//borrow a buffer of at least 'bytes' bytes
+//result is NULL if it could not be allocated
+void* pool_borrow(size_t bytes);
+
+//return a buffer from pool_borrow() to the pool
+//the buffer is freed instead if the pool is full
+void pool_return(void* buffer);
+
+//free the buffers that are not borrowed
+//result is the number of bytes freed
+size_t pool_release();
+
+//get the statistics as a struct with the fields Buffers, Borrowed,
+//BytesBorrowed, BytesCached, LargePages, Hits, Misses and AllocTime (ms
+//spent allocating and touching new buffers)
+mxArray* create_pool_output();
+
+// Array of 'T' in a pooled buffer, for the frame queues that swap buffers
+// like std::vector<T>.  Unlike std::vector, resize() does not keep or
+// initialize the contents.
+template <class T> class pool_array
+{
+public:
+	pool_array() : m_data(NULL), m_size(0) {}
+	pool_array(pool_array&& other) noexcept : m_data(other.m_data), m_size(other.m_size)
+	{
+		other.m_data = NULL;
+		other.m_size = 0;
+	}
+	pool_array& operator=(pool_array&& other) noexcept
+	{
+		swap(other);
+		return *this;
+	}
+	~pool_array() { clear(); }
+
+	//borrow room for 'n' elements; throws std::bad_alloc if there is none
+	void resize(size_t n)
+	{
+		if (n == m_size)
+			return;
+		clear();
+		if (n == 0)
+			return;
+		m_data = (T*)pool_borrow(n * sizeof(T));
+		if (m_data == NULL)
+			throw std::bad_alloc();
+		m_size = n;
+	}
+	void clear()
+	{
+		if (m_data != NULL)
+			pool_return(m_data);
+		m_data = NULL;
+		m_size = 0;
+	}
+	void swap(pool_array& other)
+	{
+		T* data = m_data;
+		size_t size = m_size;
+		m_data = other.m_data;
+		m_size = other.m_size;
+		other.m_data = data;
+		other.m_size = size;
+	}
+
+	size_t size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+	T* data() { return m_data; }
+	T& operator[](size_t ii) { return m_data[ii]; }
+	const T& operator[](size_t ii) const { return m_data[ii]; }
+
+private:
+	pool_array(const pool_array&);
+	pool_array& operator=(const pool_array&);
+
+	T* m_data;
+	size_t m_size;
+};
@@ -0,0 +1,176 @@
+#include <mutex>
+#include <chrono>
+#include <math.h>
+#include <string.h>
+#ifdef LINUX
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#else
+#include <windows.h>
+#endif
+#include <mex.h>
+#include "threadctl.h"
+
+void get_thread_policy(const mxArray* options, thread_policy& policy)
+{
+	policy.cpus = 0;
+	policy.priority = THREAD_PRIORITY_LEVEL_NORMAL;
+	policy.lockMemory = false;
+	if (options == NULL || mxIsEmpty(options))
+		return;
+	if (!mxIsStruct(options))
+		mexErrMsgTxt("the thread options must be a struct with the fields CPUs, Priority and LockMemory.");
+
+	const mxArray* cpus = mxGetField(options, 0, "CPUs");
+	if (cpus != NULL && !mxIsEmpty(cpus))
+	{
+		if (!mxIsDouble(cpus))
+			mexErrMsgTxt("CPUs must be a double vector of processor indices.");
+		const double* index = mxGetPr(cpus);
+		for (size_t ii = 0; ii < mxGetNumberOfElements(cpus); ii++)
+		{
+			if (index[ii] < 0 || index[ii] > 63 || index[ii] != floor(index[ii]))
+				mexErrMsgTxt("CPUs must be processor indices from 0 to 63.");
+			policy.cpus |= 1ULL << (int)index[ii];
+		}
+	}
+
+	const mxArray* priority = mxGetField(options, 0, "Priority");
+	if (priority != NULL && !mxIsEmpty(priority))
+	{
+		char name[16];
+		if (!mxIsChar(priority) || mxGetString(priority, name, sizeof(name)) != 0)
+			mexErrMsgTxt("Priority must be 'normal', 'high' or 'realtime'.");
+		if (strcmp(name, "normal") == 0)
+			policy.priority = THREAD_PRIORITY_LEVEL_NORMAL;
+		else if (strcmp(name, "high") == 0)
+			policy.priority = THREAD_PRIORITY_LEVEL_HIGH;
+		else if (strcmp(name, "realtime") == 0)
+			policy.priority = THREAD_PRIORITY_LEVEL_REALTIME;
+		else
+			mexErrMsgTxt("Priority must be 'normal', 'high' or 'realtime'.");
+	}
+
+	const mxArray* lockMemory = mxGetField(options, 0, "LockMemory");
+	if (lockMemory != NULL && !mxIsEmpty(lockMemory))
+		policy.lockMemory = mxGetScalar(lockMemory) != 0;
+}
+
+bool apply_thread_policy(const thread_policy& policy)
+{
+	bool ok = true;
+#ifdef LINUX
+	if (policy.cpus != 0)
+	{
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (int cpu = 0; cpu < 64; cpu++)
+			if (policy.cpus & (1ULL << cpu))
+				CPU_SET(cpu, &set);
+		ok = pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+	}
+	if (policy.priority == THREAD_PRIORITY_LEVEL_REALTIME)
+	{
+		sched_param param;
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = sched_get_priority_max(SCHED_FIFO) / 2;
+		ok = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0 && ok;
+	}
+	else if (policy.priority == THREAD_PRIORITY_LEVEL_HIGH)
+		ok = setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), -10) == 0 && ok;
+#else
+	HANDLE thread = GetCurrentThread();
+	if (policy.cpus != 0)
+		ok = SetThreadAffinityMask(thread, (DWORD_PTR)policy.cpus) != 0;
+	if (policy.priority == THREAD_PRIORITY_LEVEL_REALTIME)
+		ok = SetThreadPriority(thread, THREAD_PRIORITY_TIME_CRITICAL) != 0 && ok;
+	else if (policy.priority == THREAD_PRIORITY_LEVEL_HIGH)
+		ok = SetThreadPriority(thread, THREAD_PRIORITY_HIGHEST) != 0 && ok;
+#endif
+	return ok;
+}
+
+#ifndef LINUX
+// The working set is grown by the threads of all cameras.
+static std::mutex g_workingSetLock;
+#endif
+
+bool lock_buffer(const thread_policy& policy, void* buffer, size_t bytes)
+{
+	if (!policy.lockMemory || buffer == NULL || bytes == 0)
+		return true;
+#ifdef LINUX
+	return mlock(buffer, bytes) == 0;
+#else
+	// VirtualLock() fails once the locked pages exceed the minimum working
+	// set, so it is grown by the size of the buffer first.
+	std::lock_guard<std::mutex> lk(g_workingSetLock);
+	HANDLE process = GetCurrentProcess();
+	SIZE_T minimum, maximum;
+	if (GetProcessWorkingSetSize(process, &minimum, &maximum))
+		SetProcessWorkingSetSize(process, minimum + bytes, maximum + bytes);
+	return VirtualLock(buffer, bytes) != 0;
+#endif
+}
+
+void unlock_buffer(const thread_policy& policy, void* buffer, size_t bytes)
+{
+	if (!policy.lockMemory || buffer == NULL || bytes == 0)
+		return;
+#ifdef LINUX
+	munlock(buffer, bytes);
+#else
+	std::lock_guard<std::mutex> lk(g_workingSetLock);
+	if (!VirtualUnlock(buffer, bytes))
+		return;
+	HANDLE process = GetCurrentProcess();
+	SIZE_T minimum, maximum;
+	if (GetProcessWorkingSetSize(process, &minimum, &maximum) && minimum > bytes)
+		SetProcessWorkingSetSize(process, minimum - bytes, maximum - bytes);
+#endif
+}
+
+void jitter_reset(thread_jitter& jitter, bool placed)
+{
+	std::lock_guard<std::mutex> lk(jitter.lock);
+	jitter.last = std::chrono::steady_clock::time_point();
+	jitter.count = jitter.sum = jitter.sumsq = jitter.max = 0;
+	jitter.placed = placed;
+}
+
+void jitter_tick(thread_jitter& jitter)
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	std::lock_guard<std::mutex> lk(jitter.lock);
+	if (jitter.last != std::chrono::steady_clock::time_point())
+	{
+		double interval = std::chrono::duration<double>(now - jitter.last).count();
+		jitter.count++;
+		jitter.sum += interval;
+		jitter.sumsq += interval * interval;
+		if (interval > jitter.max)
+			jitter.max = interval;
+	}
+	jitter.last = now;
+}
+
+mxArray* create_jitter_output(thread_jitter& jitter)
+{
+	std::lock_guard<std::mutex> lk(jitter.lock);
+	double mean = jitter.count > 0 ? jitter.sum / jitter.count : 0;
+	double variance = jitter.count > 1
+		? (jitter.sumsq - jitter.count * mean * mean) / (jitter.count - 1) : 0;
+
+	const char* fields[] = { "Placed", "Iterations", "MeanInterval", "StdInterval", "MaxInterval" };
+	mxArray* out = mxCreateStructMatrix(1, 1, 5, fields);
+	mxSetFieldByNumber(out, 0, 0, mxCreateLogicalScalar(jitter.placed));
+	mxSetFieldByNumber(out, 0, 1, mxCreateDoubleScalar(jitter.count));
+	mxSetFieldByNumber(out, 0, 2, mxCreateDoubleScalar(1e3 * mean));
+	mxSetFieldByNumber(out, 0, 3, mxCreateDoubleScalar(1e3 * sqrt(variance > 0 ? variance : 0)));
+	mxSetFieldByNumber(out, 0, 4, mxCreateDoubleScalar(1e3 * jitter.max));
+	return out;
+}
@@ -0,0 +1,58 @@
+#pragma once
+// Placement of the native worker threads (frame readers, compressors and
+// writers), so that long recordings are not held up by MATLAB's own threads.
+// Include after <mutex> and <chrono>.  Shared by the mex functions of DCAM4
+// and MIC (e.g. H5Write_Async), so stdafx.h is not needed.
+// The thread options are a MATLAB struct with the optional fields
+//   CPUs:			logical processors (0-based) the threads run on; [] for any
+//   Priority:		'normal', 'high' or 'realtime'
+//   LockMemory:	keep the buffers of the threads in RAM (VirtualLock/mlock)
+// Elevated priorities may need privileges; a refused request leaves the
+// thread as it was and is reported by apply_thread_policy().
+
+#define THREAD_PRIORITY_LEVEL_NORMAL	0
+#define THREAD_PRIORITY_LEVEL_HIGH		1
+#define THREAD_PRIORITY_LEVEL_REALTIME	2
+
+struct thread_policy
+{
+	unsigned long long cpus;	// affinity mask, 0 for any
+	int priority;				// THREAD_PRIORITY_LEVEL_*
+	bool lockMemory;
+};
+
+// Intervals between the iterations of a worker loop; a thread that is
+// descheduled shows up as a long interval.
+struct thread_jitter
+{
+	std::mutex lock;
+	std::chrono::steady_clock::time_point last;
+	double count, sum, sumsq, max;		// intervals in seconds
+	bool placed;						// the policy was applied
+};
+
+//parse the thread options
+//options:				struct with the fields above, or NULL or empty for the defaults
+//policy:				receives the policy
+//calls mexErrMsgTxt() if the options are invalid
+void get_thread_policy(const mxArray* options, thread_policy& policy);
+
+//apply the affinity and priority of a policy to the calling thread
+//result is false if the system refused either of them
+bool apply_thread_policy(const thread_policy& policy);
+
+//lock a buffer in RAM if policy.lockMemory is set, growing the working set
+//as needed; unlock_buffer() undoes it
+//result is false if the buffer could not be locked
+bool lock_buffer(const thread_policy& policy, void* buffer, size_t bytes);
+void unlock_buffer(const thread_policy& policy, void* buffer, size_t bytes);
+
+//start the interval statistics; 'placed' is the result of apply_thread_policy()
+void jitter_reset(thread_jitter& jitter, bool placed);
+
+//mark one iteration of the worker loop
+void jitter_tick(thread_jitter& jitter);
+
+//get the statistics as a struct with the fields Placed, Iterations,
+//MeanInterval, StdInterval and MaxInterval (ms)
+mxArray* create_jitter_output(thread_jitter& jitter);
@@ -129,6 +129,65 @@ classdef DCAM4Camera < mic.camera.abstract
     % ### `Abortnow`
     % Flag for stopping the acquisition process (duplicated with `AbortNow`).
     %
+    % ### `PreviewBinning`
+    % Binning of the live view image. Empty bins large frames by a power of 2 to about 1024 pixels.
+    % **Default:** `[]`.
+    %
+    % ### `PreviewPercentiles`
+    % Percentiles of the frame used as the live view display range when `AutoScale` is on.
+    % **Default:** `[0 100]`.
+    %
+    % ### `PreviewTopK`
+    % Number of brightest pixels summed into `PreviewStats.TopKSum`.
+    % **Default:** `5`.
+    %
+    % ### `FrameStatistics`
+    % Names of the statistics computed for each frame of a sequence (see `getframestats()`).
+    % **Default:** `{}` (none).
+    %
+    % ### `FrameStats`
+    % Statistics of the frames of the last sequence, one 1 x N field per name in `FrameStatistics` (read only).
+    %
+    % ### `CalibrateData`
+    % Whether sequences are returned as photoelectrons (set by `setcalibration()`, read only).
+    % **Default:** `false`.
+    %
+    % ### `CalibrationVariance`
+    % Read noise variance map (e-^2) of the frames of the last calibrated sequence (read only).
+    %
+    % ### `CompressData`
+    % Stores sequences compressed in memory instead of in `Data` (see `start_sequenceCompressed()`).
+    % **Default:** `false`.
+    %
+    % ### `CompressBufferFrames`
+    % Number of frames of the camera buffer used with `CompressData`.
+    % **Default:** `200`.
+    %
+    % ### `ReuseBuffer`
+    % Keeps the camera buffer between acquisitions when the image geometry and number of frames are unchanged (see `prepareForCapture()`).
+    % **Default:** `true`.
+    %
+    % ### `PropertyCacheDir`
+    % Folder of the property attribute cache of `get_propertiesDcam()`; `''` disables the cache.
+    % **Default:** `fullfile(prefdir,'DCAM4PropertyCache')`.
+    %
+    % ### `ScanFile`
+    % File to which the datacube of `start_scan()` is written as uint16 `[y, x_scan, wave]` (`ImageSize(2)` x `SequenceLength` x `ImageSize(1)`); `''` returns the bundles from `getlastframebundle()` instead.
+    % **Default:** `''`.
+    %
+    % ### `ThreadOptions`
+    % Placement of the native reader and writer threads of `start_sequenceCompressed()` and `start_scan()` and of the event counter thread of the acquisition loops, a struct with the optional fields `CPUs` (0-based processors, `[]` for any), `Priority` (`'normal'`, `'high'` or `'realtime'`) and `LockMemory` (lock the thread buffers in RAM); `[]` keeps the defaults.
+    % **Default:** `[]`.
+    %
+    % ### `WorkerJitter`
+    % `Placed`, `Iterations`, `MeanInterval`, `StdInterval` and `MaxInterval` (ms) of the reader thread of the last compressed sequence or scan (read only). Long intervals show when the reader was held up.
+    %
+    % ### `BufferPool`
+    % Statistics (`ScanCube`, `FrameStore`) of the pools of pre-faulted buffers that hold the slabs of the scans and the staging frames of the compressed sequences (read only): `Buffers`, `Borrowed`, `BytesBorrowed`, `BytesCached`, `LargePages`, `Hits`, `Misses` and `AllocTime` (ms). Large pages need the "Lock pages in memory" right. The buffers are kept for the next acquisition (up to a quarter of the physical memory, other sizes freed first) and freed by `shutdown()`.
+    %
+    % ### `PreviewStats`
+    % `Min`, `Max`, `Percentiles`, `TopKSum` and `Binning` of the last live view frame (read only).
+    %
     % ## Methods
     %
     % ### `DCAM4Camera()`
@@ -145,13 +204,37 @@ classdef DCAM4Camera < mic.camera.abstract
     % - Stops capture with `DCAM4StopCapture`.
     % - Releases memory with `DCAM4ReleaseMemory`.
     %
-    % ### `getlastimage()`
+    % ### `getlastimage(ROIs, Binning)`
     % Returns the last image captured by the camera.
     % - Reshapes and returns the image data.
+    % - Optional `ROIs` and `Binning` crop and bin the frame during the copy.
     %
-    % ### `getoneframe()`
+    % ### `getoneframe(ROIs, Binning)`
     % Returns a specific frame from the camera.
     % - Retrieves and reshapes a specified frame.
+    % - `ROIs` and `Binning` are optional, as in `getlastimage()`.
+    %
+    % ### `setcalibration(Offset, Gain, Variance)`
+    % Sets the sCMOS offset (ADU), gain (ADU/e-) and optional variance (ADU^2) maps of the sensor or ROI.
+    % - Sequences are then returned as single precision photoelectrons, converted while they are copied.
+    % - An empty `Offset` clears the calibration.
+    %
+    % ### `getframestats(Frames, Names)`
+    % Returns statistics of frames in the camera buffer without copying the images.
+    % - `Frames` are 1-based buffer frames; empty waits for the next new frame.
+    % - `Names` selects from `Sum`, `Max`, `CentroidX`, `CentroidY`, `Brenner`, `Variance` and `Saturated` (default all).
+    %
+    % ### `displaylastimage()`
+    % Shows the last image in the live window.
+    % - With an output, the raw frame is returned and shown as for other cameras.
+    % - Without an output, only the preview of `displaypreview()` is copied.
+    %
+    % ### `Preview = displaypreview(Timeout)`
+    % Shows the binned 8-bit preview of the last image in the live window.
+    % - Waits up to `Timeout` ms (default `Timeout`) for the next frame; 0 shows the newest frame without waiting. `Preview` is empty if there is no frame.
+    % - Binning, scaling to 8 bits and the frame statistics are done in `DCAM4CopyPreview`.
+    % - Uses `PreviewBinning`, `PreviewPercentiles` (with `AutoScale`) or `LUTScale`, and `PreviewTopK`.
+    % - The statistics of the frame are kept in `PreviewStats`.
     %
     % ### `getdata()`
     % Grabs data from the camera based on acquisition type (`focus`, `capture`, `sequence`).
@@ -174,6 +257,10 @@ classdef DCAM4Camera < mic.camera.abstract
     % ### `prepareForCapture(NImages)`
     % Prepares the camera for capturing `NImages`.
     % - Releases and allocates memory buffers.
+    % - With `ReuseBuffer`, `DCAM4AllocMemory` keeps the current buffer if the image size, pixel type and `NImages` are unchanged.
+    %
+    % ### `stopcapture()`
+    % Stops the current capture but keeps the camera buffer for the next acquisition (unlike `abort()`).
     %
     % ### `start_capture()`
     % Starts image capture mode.
@@ -183,16 +270,27 @@ classdef DCAM4Camera < mic.camera.abstract
     %
     % ### `start_focusWithFeedback()`
     % Starts focus mode with feedback display.
+    % - The feedback is the sum of the `PreviewTopK` brightest pixels of each frame.
     %
     % ### `start_sequence(CaptureMode)`
     % Starts sequence acquisition mode.
     % - CaptureMode can be either `0` (snap) or `-1` (sequence).
     %
+    % ### `start_sequenceCompressed()`
+    % Captures `SequenceLength` frames into the compressed frame store (used by `start_sequence` when `CompressData` is true).
+    % - Frames are compressed losslessly on worker threads as they arrive; the camera buffer holds only `CompressBufferFrames`.
+    % - Returns `[]`; read the frames with `getframes()`.
+    %
+    % ### `getframes(First, Count)`
+    % Returns frames `First` to `First+Count-1` (default all) of the last compressed sequence.
+    %
     % ### `start_scan()`
     % Begins a scanning acquisition sequence.
     %
     % ### `getlastframebundle(Nframe)`
-    % Retrieves a bundle of frames during acquisition.
+    % Retrieves a bundle of frames during acquisition as a `[y, x_scan, wave]` datacube slab.
+    % - `DCAM4ScanCube` transposes each frame into the slab on a background thread as soon as it arrives; the first call sets the bundle size `Nframe`.
+    % - With `ScanFile`, the slabs are written to that file instead and `[]` is returned.
     %
     % ### `triggeredCapture()`
     % Performs a capture triggered by an external signal.
@@ -200,6 +298,12 @@ classdef DCAM4Camera < mic.camera.abstract
     % ### `fireTrigger()`
     % Fires a trigger signal.
     %
+    % ### `fireTriggers(NTriggers)`
+    % Fires `NTriggers` software triggers at the minimum trigger interval in a single `DCAM4FireTriggers` call.
+    % - Each frame is waited for (and copied if the frames are requested) before the next trigger.
+    % - A failed trigger, frame wait or copy raises an error instead of returning partial frames.
+    % - Returns `[Frames, Period]`, where `Period` is the achieved trigger period (s).
+    %
     % ### `finishTriggeredCapture(numFrames)`
     % Finishes a triggered capture and retrieves the captured frames.
     %
@@ -212,12 +316,15 @@ classdef DCAM4Camera < mic.camera.abstract
     % ### `HtsuGetStatus()`
     % Retrieves the current status of the camera.
     % - Returns a status string (`'Error'`, `'Busy'`, `'Ready'`, etc.).
+    % - The acquisition loops (`start_focus`, `start_sequence`, `start_sequenceCompressed`, `take_sequence`) don't poll it; they sleep in `DCAM4EventCounter` `'wait'` until the next frame (the counters are kept by a background thread that waits for frame ready, cycle end and stopped events) and then show it with `displaypreview(0)`.
     %
     % ### `call_temperature()`
     % Calls the temperature measurement function.
     %
-    % ### `get_propertiesDcam()`
+    % ### `get_propertiesDcam(Refresh)`
     % Retrieves properties and attributes from the camera.
+    % - `DCAM4GetPropMetadata` returns all of them in one call. The attributes, ranges and mode texts are kept in `PropertyCacheDir` per camera model, serial number and firmware version, so only the values are read from the camera after the first start-up.
+    % - `Refresh` (default `false`) queries the attributes again and rewrites the cache.
     %
     % ### `get_propAttr(idprop)`
     % Retrieves the attributes of a specified property.
@@ -230,9 +337,11 @@ classdef DCAM4Camera < mic.camera.abstract
     %
     % ### `setgetProperty(idprop, value)`
     % Sets and retrieves the value of a specified property.
+    % - The property is only set if it changed since the last call (`DCAM4ApplyProfile`).
     %
     % ### `setCamProperties(Infield)`
     % Applies camera properties from an input field.
+    % - All writable properties are passed to `DCAM4ApplyProfile` in one call, which sets only the changed values in an order the camera accepts and reads them back.
     %
     % ### `build_guiDialog(GuiCurSel)`
     % Builds a GUI dialog based on camera settings.
@@ -280,6 +389,18 @@ classdef DCAM4Camera < mic.camera.abstract
     % ### `camSet2GuiSel(CameraSetting)`
     % Converts current camera settings to GUI selections.
     %
+    % ### `startMultiCapture(Cameras, BufferFrames, MatchBy, Tolerance)`
+    % Starts continuous sequences on an array of cameras with `DCAM4MultiCapture`.
+    % - Each camera is drained by its own thread into a ring buffer of `BufferFrames` (default 200) frames.
+    % - Frames are paired across cameras by `MatchBy`, `'framestamp'` (default) or `'timestamp'` within `Tolerance` seconds.
+    % - The drain threads are placed by the `ThreadOptions` of the first camera.
+    %
+    % ### `readMultiCapture(Cameras, MaxSets)`
+    % Returns `[Frames, Timestamps, Framestamps]` of up to `MaxSets` (default all) matched frame sets; `Frames` has one array per camera.
+    %
+    % ### `stopMultiCapture(Cameras)`
+    % Stops the cameras and returns the frame sets that were not read yet. Reports the unmatched frames per camera.
+    %
     
     properties(Access = protected)
         AbortNow;
@@ -288,6 +409,7 @@ classdef DCAM4Camera < mic.camera.abstract
         FigureHandle;
         ImageHandle;
         ReadyForAcq=0;      %If not, call setup_acquisition
+        ScanCubeStarted=false; % DCAM4ScanCube assembles the current scan
         TextHandle;
         
     end
@@ -330,6 +452,25 @@ classdef DCAM4Camera < mic.camera.abstract
         Timeout = 10000;        % timeout sent to several DCAM functions (milliseconds)
         %EventMaskString = 'DCAMWAIT_CAPEVENT_CYCLEEND'; % wait event mask used in DCAM functions (see dcamprop.h DCAMWAIT_EVENT)
         Abortnow;
+        PreviewBinning=[];  %   live view binning; [] bins large frames to about 1024 pixels
+        PreviewPercentiles=[0 100]; % live view display range with AutoScale (percent)
+        PreviewTopK=5;      %   number of brightest pixels summed in PreviewStats.TopKSum
+        FrameStatistics={}; %   statistics computed for each frame of a sequence (see getframestats)
+        CompressData=false; %   store sequences compressed in memory (see getframes)
+        CompressBufferFrames=200; % camera buffer (frames) used with CompressData
+        ReuseBuffer=true;   % keep the camera buffer if its geometry is unchanged
+        PropertyCacheDir=fullfile(prefdir,'DCAM4PropertyCache'); % property attribute cache; '' disables it
+        ScanFile='';        %   file receiving the scan datacube; '' returns it from getlastframebundle
+        ThreadOptions=[];   %   CPUs, Priority and LockMemory of the native acquisition threads
+    end
+
+    properties(SetAccess = protected)
+        PreviewStats;       %   Min, Max, Percentiles and TopKSum of the last live view frame
+        FrameStats;         %   FrameStatistics of the frames of the last sequence
+        CalibrateData=false; %  sequences are returned in photoelectrons (see setcalibration)
+        CalibrationVariance; %  read noise variance (e-^2) of the last calibrated sequence
+        WorkerJitter;       %   loop intervals of the native reader thread of the last acquisition
+        BufferPool=struct('ScanCube',[],'FrameStore',[]); % statistics of the native buffer pools
     end
     
 %     properties (Hidden)
@@ -354,22 +495,178 @@ classdef DCAM4Camera < mic.camera.abstract
         function abort(obj)
             % Abort the current capture by attempting to stop the capture
             % and then freeing the camera memory buffer.
+            if obj.ScanCubeStarted
+                DCAM4ScanCube(obj.CameraHandle, 'clear');
+                obj.ScanCubeStarted=false;
+            end
             DCAM4StopCapture(obj.CameraHandle)
             DCAM4ReleaseMemory(obj.CameraHandle)
         end
         
-        function Image = getlastimage(obj)
+        function Image = getlastimage(obj, ROIs, Binning)
             % Return the last image taken by the camera.
+            % The optional ROIs (N x 4 [Xstart Xend Ystart Yend] within the
+            % image) and Binning are applied during the copy without
+            % changing the camera settings; several ROIs give a cell array.
+            if nargin > 1
+                if nargin < 3
+                    Binning = [];
+                end
+                Image = DCAM4CopyLastFrame(obj.CameraHandle, obj.Timeout, ...
+                    ROIs, Binning);
+                return
+            end
             Image = DCAM4CopyLastFrame(obj.CameraHandle, obj.Timeout);
             Image = reshape(Image, obj.ImageSize(1), obj.ImageSize(2));
         end
 
-        function out = getoneframe(obj)
+        function out = getoneframe(obj, ROIs, Binning)
             % Return the frame at frameId.
+            % ROIs and Binning are as in getlastimage().
+            if nargin > 1
+                if nargin < 3
+                    Binning = [];
+                end
+                out = DCAM4CopyOneFrame(obj.CameraHandle, ...
+                    obj.CameraFrameIndex, obj.Timeout, ROIs, Binning);
+                return
+            end
             Image = DCAM4CopyOneFrame(obj.CameraHandle, obj.CameraFrameIndex,obj.Timeout);
             out = reshape(Image, obj.ImageSize(1), obj.ImageSize(2));
 
         end
+
+        function setcalibration(obj, Offset, Gain, Variance)
+            % Set the sCMOS calibration used when CalibrateData is true.
+            % Offset (ADU), Gain (ADU/e-) and the optional read noise
+            % Variance (ADU^2) are maps of the full sensor or of the ROI;
+            % ROI maps are tied to the ROI set when they are given.
+            % Sequences are then returned as single precision
+            % photoelectrons, (raw - Offset) ./ Gain, converted while they
+            % are copied from the camera buffer.  An empty Offset clears
+            % the calibration.
+            if nargin < 2 || isempty(Offset)
+                DCAM4CopyFramesCalibrated(obj.CameraHandle, 'clear');
+                obj.CalibrateData = false;
+                obj.CalibrationVariance = [];
+                return
+            end
+            if nargin < 4
+                Variance = [];
+            end
+            DCAM4CopyFramesCalibrated(obj.CameraHandle, 'set', ...
+                Offset, Gain, Variance);
+            obj.CalibrateData = true;
+        end
+
+        function Stats = getframestats(obj, Frames, Names)
+            % Return statistics of frames in the camera buffer.
+            % Frames are the (1-based) buffer frames, or empty for the next
+            % new frame.  Names is a cell array from 'Sum', 'Max',
+            % 'CentroidX', 'CentroidY', 'Brenner', 'Variance' and
+            % 'Saturated' (default all).  Only the statistics are copied to
+            % MATLAB, not the images.
+            if nargin < 2
+                Frames = [];
+            end
+            if nargin < 3
+                Names = {};
+            end
+            Stats = DCAM4FrameStats(obj.CameraHandle, obj.Timeout, ...
+                Frames, Names);
+        end
+
+        function Data = displaylastimage(obj)
+            % Show the last image in the live window.
+            % Data is the raw frame, as for the other cameras.  When no
+            % output is requested only the preview is copied (see
+            % displaypreview).
+            if nargout == 0
+                obj.displaypreview();
+                return
+            end
+            Data = displaylastimage@mic.camera.abstract(obj);
+            if ~isempty(obj.ImageHandle) && ishandle(obj.ImageHandle)
+                % the window may have last shown a binned preview
+                set(obj.ImageHandle.Parent,'xlim',[0.5,size(Data,1)+0.5], ...
+                    'ylim',[0.5,size(Data,2)+0.5])
+            end
+        end
+
+        function Preview = displaypreview(obj, Timeout)
+            % Show the preview of the last image in the live window.
+            % The 8-bit preview is binned and scaled by DCAM4CopyPreview,
+            % so only the small display image is copied to MATLAB.  The
+            % frame statistics are kept in PreviewStats.  Timeout (ms,
+            % default obj.Timeout) is the wait for the next frame; 0 shows
+            % the newest frame at once.  Preview is empty if there is none.
+            if nargin < 2
+                Timeout = obj.Timeout;
+            end
+            Binning = obj.PreviewBinning;
+            if isempty(Binning)
+                Binning = 2^max(0, ceil(log2(max(obj.ImageSize)/1024)));
+            end
+            if obj.AutoScale
+                LUT = [];
+            else
+                LUT = obj.LUTScale;
+            end
+            [Preview, Stats] = DCAM4CopyPreview(obj.CameraHandle, ...
+                Timeout, Binning, obj.PreviewPercentiles, ...
+                obj.PreviewTopK, LUT);
+            if isempty(Preview)
+                return;
+            end
+            obj.PreviewStats = Stats;
+            if obj.AbortNow
+                return;
+            end
+            %open window if necessary
+            if isempty(obj.FigureHandle)||~ishandle(obj.FigureHandle)
+                obj.FigureHandle=figure;
+                obj.ImageHandle=image(Preview');
+                set(obj.FigureHandle,'Name','CameraLive');
+                set(obj.FigureHandle,'DeleteFcn',@(h,e)obj.abortnow())
+                set(obj.FigureHandle,'colormap',gray(256))
+                set(obj.FigureHandle,'Renderer','OpenGL','Toolbar','none','menubar','none')
+                set(gca,'Visible','off')
+                set(gca,'Position',[0 0 1 1])
+                set(obj.ImageHandle,'CDataMapping','scaled')
+                %set position of the figure
+                if ~isempty(obj.FigurePos)
+                    set(obj.FigureHandle,'position',obj.FigurePos);
+                else
+                    scrsz=get(0,'ScreenSize');
+                    imsz_display=[obj.ImageSize(1) obj.ImageSize(2)]*obj.DisplayZoom;
+                    ypos=scrsz(4)-imsz_display(2)-75;
+                    xpos=max([scrsz(3)-imsz_display(1)-200 50]);
+                    set(obj.FigureHandle,'position',[xpos ypos imsz_display(1) imsz_display(2)])
+                end
+            end
+            % the window may have last shown a raw frame
+            set(obj.ImageHandle.Parent,'CLim',[0 255], ...
+                'xlim',[0.5,size(Preview,1)+0.5], ...
+                'ylim',[0.5,size(Preview,2)+0.5])
+
+            %update data
+            set(obj.ImageHandle,'cdata',Preview');
+
+            %range display
+            if obj.RangeDisplay && ~isempty(obj.FigureHandle)
+                s=sprintf('[%d %d]',obj.PreviewStats.Min,obj.PreviewStats.Max);
+                if isempty(obj.TextHandle)||~ishandle(obj.TextHandle)
+                    obj.TextHandle=text(50/obj.DisplayZoom/Binning, ...
+                        50/obj.DisplayZoom/Binning,s);
+                    set(obj.TextHandle,'Color','g')
+                    set(obj.TextHandle,'FontSize',16)
+                else
+                    set(obj.TextHandle,'String',s)
+                end
+            end
+
+            drawnow limitrate ;
+        end
         
         function Data = getdata(obj)
             % Grab data from the camera.
@@ -379,8 +676,22 @@ classdef DCAM4Camera < mic.camera.abstract
                 case 'capture'
                     Data = obj.getlastimage();
                 case 'sequence'
-                    Data = DCAM4CopyFrames(obj.CameraHandle, ...
-                        obj.SequenceLength, obj.Timeout);
+                    if obj.CompressData
+                        Data = obj.getframes();
+                        return
+                    end
+                    if obj.CalibrateData
+                        [Data, obj.CalibrationVariance] = ...
+                            DCAM4CopyFramesCalibrated(obj.CameraHandle, ...
+                            obj.SequenceLength, obj.Timeout);
+                    elseif isempty(obj.FrameStatistics)
+                        Data = DCAM4CopyFrames(obj.CameraHandle, ...
+                            obj.SequenceLength, obj.Timeout);
+                    else
+                        [Data, obj.FrameStats] = DCAM4CopyFrames( ...
+                            obj.CameraHandle, obj.SequenceLength, ...
+                            obj.Timeout, [], [], [], obj.FrameStatistics);
+                    end
                     Data = reshape(Data, ...
                         obj.ImageSize(1), obj.ImageSize(2), ...
                         obj.SequenceLength);
@@ -421,7 +732,7 @@ classdef DCAM4Camera < mic.camera.abstract
         function setup_acquisition(obj)
             status=obj.HtsuGetStatus();
             if strcmp(status,'Ready')||strcmp(status,'Busy')
-                obj.abort();
+                obj.stopcapture();
             end
             idprop = obj.CameraSetting.EXPOSURE_TIME.idprop;
             switch obj.AcquisitionType
@@ -436,7 +747,13 @@ classdef DCAM4Camera < mic.camera.abstract
                     obj.prepareForCapture(TotalFrame);
                 case 'sequence'     %Kinetic Series
                     obj.ExpTime_Sequence = obj.setgetProperty(idprop, obj.ExpTime_Sequence);
-                    obj.prepareForCapture(obj.SequenceLength);
+                    if obj.CompressData
+                        % frames are moved to the frame store as they arrive
+                        obj.prepareForCapture(min(obj.CompressBufferFrames, ...
+                            obj.SequenceLength));
+                    else
+                        obj.prepareForCapture(obj.SequenceLength);
+                    end
             end
             
             % Update the sequence period to reflect duration of exposure +
@@ -487,20 +804,50 @@ classdef DCAM4Camera < mic.camera.abstract
         end
         
         function shutdown(obj)
+            DCAM4EventCounter(obj.CameraHandle, 'clear');
+            if obj.ScanCubeStarted
+                DCAM4ScanCube(obj.CameraHandle, 'clear');
+                obj.ScanCubeStarted=false;
+            end
+            DCAM4ApplyProfile(obj.CameraHandle, 'clear');
+            if obj.CompressData
+                DCAM4FrameStore(obj.CameraHandle, 'clear');
+            end
+            if ~isempty(obj.BufferPool.ScanCube)
+                DCAM4ScanCube(obj.CameraHandle, 'release');
+            end
+            if ~isempty(obj.BufferPool.FrameStore)
+                DCAM4FrameStore(obj.CameraHandle, 'release');
+            end
+            if obj.CalibrateData
+                DCAM4CopyFramesCalibrated(obj.CameraHandle, 'clear');
+            end
             DCAM4Close(obj.CameraHandle);
             DCAM4UnInit();
             clear obj.CameraHandle;
         end
         function prepareForCapture(obj, NImages)
+            if obj.ReuseBuffer
+                % Keep the buffer if the image geometry and NImages are
+                % unchanged, otherwise release it and allocate a new one.
+                DCAM4AllocMemory(obj.CameraHandle, NImages, true);
+                return;
+            end
             % Release the existing memory buffer.
             DCAM4ReleaseMemory(obj.CameraHandle)
             % Allocate a new memory buffer.
             DCAM4AllocMemory(obj.CameraHandle, NImages)
 
         end
+
+        function stopcapture(obj)
+            % Stop the current capture but keep the camera buffer, so that
+            % prepareForCapture() can reuse it (see abort()).
+            DCAM4StopCapture(obj.CameraHandle)
+        end
         function out=start_capture(obj)
             %obj.AcquisitionType='capture';
-            obj.abort;
+            obj.stopcapture;
             obj.AcquisitionType='capture';
             %             status=obj.HtsuGetStatus;
             %             if strcmp(status,'Ready')||strcmp(status,'Busy')
@@ -517,7 +864,7 @@ classdef DCAM4Camera < mic.camera.abstract
             %pause(1) % pause briefly before proceeding
             out=obj.getdata();
             %             obj.displaylastimage();
-            obj.abort();
+            obj.stopcapture();
             obj.AbortNow=0;
             
             if obj.KeepData
@@ -533,7 +880,7 @@ classdef DCAM4Camera < mic.camera.abstract
         
         
         function out=start_focus(obj)
-            obj.abort;
+            obj.stopcapture;
             obj.AcquisitionType='focus';
             
             obj.setup_acquisition();
@@ -549,17 +896,24 @@ classdef DCAM4Camera < mic.camera.abstract
             DCAM4StartCapture(obj.CameraHandle, -1);
             %pause(1) % pause briefly before proceeding
             
-            Camstatus=obj.HtsuGetStatus;
-            while strcmp(Camstatus,'Busy')
+            DCAM4EventCounter(obj.CameraHandle, 'start', [], obj.ThreadOptions);
+            % Sleep until the next frame (at most 0.1 s, so that AbortNow
+            % is still seen) and show each new frame once.
+            Events=DCAM4EventCounter(obj.CameraHandle, 'status');
+            Shown=0;
+            while Events.Busy
                 if obj.AbortNow
                     obj.AbortNow=0;
                     out=[];
                     break;
+                end
+                if Events.Frames > Shown
+                    Shown=Events.Frames;
+                    obj.displaypreview(0);
                 else
-                    out=obj.getdata;
+                    drawnow limitrate ;
                 end
-                obj.displaylastimage;
-                Camstatus=obj.HtsuGetStatus;
+                Events=DCAM4EventCounter(obj.CameraHandle, 'wait', Shown+1, 100);
             end
             
             if obj.AbortNow
@@ -602,20 +956,27 @@ classdef DCAM4Camera < mic.camera.abstract
             DCAM4StartCapture(obj.CameraHandle, -1);
             pause(1) % pause briefly before proceeding
             
-            Camstatus=obj.HtsuGetStatus;
-            while strcmp(Camstatus,'Busy')
+            DCAM4EventCounter(obj.CameraHandle, 'start', [], obj.ThreadOptions);
+            % Sleep until the next frame (at most 0.1 s, so that AbortNow
+            % is still seen) and show each new frame once.
+            Events=DCAM4EventCounter(obj.CameraHandle, 'status');
+            Shown=0;
+            while Events.Busy
                 if obj.AbortNow
                     obj.AbortNow=0;
                     out=[];
                     break;
+                end
+                if Events.Frames > Shown
+                    Shown=Events.Frames;
+                    Preview=obj.displaypreview(0);
+                    if ~isempty(Preview)
+                        ItextHandle.String = num2str(obj.PreviewStats.TopKSum);
+                    end
                 else
-                    out=obj.getdata;
+                    drawnow limitrate ;
                 end
-                Isort = sort(out(:));
-                Imax = sum(Isort(end-4:end));
-                ItextHandle.String = num2str(Imax);
-                obj.displaylastimage;
-                Camstatus=obj.HtsuGetStatus;
+                Events=DCAM4EventCounter(obj.CameraHandle, 'wait', Shown+1, 100);
             end
             
             if obj.AbortNow
@@ -655,20 +1016,33 @@ classdef DCAM4Camera < mic.camera.abstract
             %                 obj.abort;
             %             end
             obj.setup_acquisition();
+            if obj.CompressData
+                out=obj.start_sequenceCompressed();
+                return;
+            end
             
             obj.AbortNow=0;
             DCAM4StartCapture(obj.CameraHandle, CaptureMode); % what we call sequence needs snap mode
             %pause(1) % pause briefly before proceeding
             
-            Camstatus=obj.HtsuGetStatus;
-            while strcmp(Camstatus,'Busy')
+            DCAM4EventCounter(obj.CameraHandle, 'start', [], obj.ThreadOptions);
+            % Sleep until the next frame (at most 0.1 s, so that AbortNow
+            % is still seen) and show each new frame once.
+            Events=DCAM4EventCounter(obj.CameraHandle, 'status');
+            Shown=0;
+            while Events.Busy
                 if obj.AbortNow
                     obj.AbortNow=0;
                     out=[];
                     break;
                 end
-                obj.displaylastimage;
-                Camstatus=obj.HtsuGetStatus;
+                if Events.Frames > Shown
+                    Shown=Events.Frames;
+                    obj.displaypreview(0);
+                else
+                    drawnow limitrate ;
+                end
+                Events=DCAM4EventCounter(obj.CameraHandle, 'wait', Shown+1, 100);
             end
             
             if obj.AbortNow
@@ -686,12 +1060,76 @@ classdef DCAM4Camera < mic.camera.abstract
             
             switch obj.ReturnType
                 case 'dipimage'
-                    out=dip_image(out,'uint16');
+                    if obj.CalibrateData
+                        out=dip_image(out,'sfloat');
+                    else
+                        out=dip_image(out,'uint16');
+                    end
                 case 'matlab'
-                    %already in uint16
+                    %already in uint16 (single photoelectrons if CalibrateData)
             end
         end
         
+        function out=start_sequenceCompressed(obj)
+            % Capture SequenceLength frames into the compressed frame store.
+            % The frames are compressed on worker threads as they arrive,
+            % so the sequence is limited by the compressed size instead of
+            % by the camera buffer.  Read the frames with getframes().
+            NBuffer = min(obj.CompressBufferFrames, obj.SequenceLength);
+            DCAM4FrameStore(obj.CameraHandle, 'start', obj.SequenceLength, ...
+                NBuffer, obj.Timeout, [], obj.ThreadOptions);
+            obj.AbortNow=0;
+            DCAM4StartCapture(obj.CameraHandle, -1);
+
+            DCAM4EventCounter(obj.CameraHandle, 'start', [], obj.ThreadOptions);
+            % Sleep until the next frame (at most 0.1 s, so that AbortNow
+            % is still seen) and show each new frame once.  The workers
+            % may still be compressing after the capture has stopped.
+            [~, ~, Running] = DCAM4FrameStore(obj.CameraHandle, 'status');
+            Shown=0;
+            while Running && ~obj.AbortNow
+                Events=DCAM4EventCounter(obj.CameraHandle, 'wait', Shown+1, 100);
+                if Events.Frames > Shown
+                    Shown=Events.Frames;
+                    obj.displaypreview(0);
+                elseif Events.Busy
+                    drawnow limitrate ;
+                else
+                    pause(0.01);
+                end
+                [~, ~, Running] = DCAM4FrameStore(obj.CameraHandle, 'status');
+            end
+            DCAM4FrameStore(obj.CameraHandle, 'stop');
+            DCAM4StopCapture(obj.CameraHandle);
+            out=[];
+            if obj.AbortNow
+                obj.AbortNow=0;
+                return;
+            end
+
+            [Stored, Bytes, ~, Err, obj.WorkerJitter] = ...
+                DCAM4FrameStore(obj.CameraHandle, 'status');
+            obj.BufferPool.FrameStore = DCAM4FrameStore(obj.CameraHandle, 'pool');
+            if ~isempty(Err)
+                error('DCAM4Camera: frame store stopped after %d frames: %s', ...
+                    Stored, Err)
+            end
+            fprintf('%d frames stored, compressed %.1f times\n', Stored, ...
+                2*Stored*prod(obj.ImageSize)/Bytes);
+        end
+
+        function out=getframes(obj, First, Count)
+            % Return frames First to First+Count-1 (default all) of the
+            % last compressed sequence as a uint16 X x Y x Count array.
+            if nargin < 2
+                First = 1;
+            end
+            if nargin < 3
+                Count = [];
+            end
+            out = DCAM4FrameStore(obj.CameraHandle, 'read', First, Count);
+        end
+
         function start_scan(obj)
             obj.abort;
             obj.AcquisitionType='sequence';
@@ -702,39 +1140,61 @@ classdef DCAM4Camera < mic.camera.abstract
             obj.Abortnow=0;
             obj.IsRunning=1;
             obj.CameraFrameIndex=0;
-            obj.Data=zeros(obj.ImageSize(1), obj.ImageSize(2), ...
-                        obj.SequenceLength,'uint16');
+            obj.Data=[];
             DCAM4StartCapture(obj.CameraHandle, CaptureMode); % what we call sequence needs snap mode
 
         end
 
         function out = getlastframebundle(obj,Nframe)
-            Camstatus=obj.HtsuGetStatus;
+            % The snap buffer holds the whole scan, so the assembler can
+            % start after the first frames have arrived.
+            if ~obj.ScanCubeStarted
+                DCAM4ScanCube(obj.CameraHandle, 'start', obj.SequenceLength, ...
+                    Nframe, obj.SequenceLength, obj.Timeout, obj.ScanFile, ...
+                    obj.ThreadOptions);
+                obj.ScanCubeStarted=true;
+            end
 
-            while strcmp(Camstatus,'Busy')
+            out = [];
+            while true
                 if obj.AbortNow
                     obj.abort()
                     obj.AbortNow=0;
                     obj.IsRunning=0;
                     obj.Abortnow=1;
-                    break
+                    return
                 end
 
-                out = getoneframe(obj);
-                obj.CameraFrameIndex=obj.CameraFrameIndex+1;
-                obj.Data(:,:,obj.CameraFrameIndex)=out;
-                Camstatus=obj.HtsuGetStatus;
-                
-                if mod(obj.CameraFrameIndex,Nframe)==0
-                    break;
+                % Sleep until the next slab is done (at most 0.1 s, so
+                % that AbortNow is still seen).
+                [out, First] = DCAM4ScanCube(obj.CameraHandle, 'read', 100);
+                if First > 0
+                    break
                 end
+                [~, ~, Running, Error, obj.WorkerJitter] = ...
+                    DCAM4ScanCube(obj.CameraHandle, 'status');
+                if ~Running
+                    % The last slab may be done after the read above.
+                    [out, First] = DCAM4ScanCube(obj.CameraHandle, 'read', 0);
+                    if First > 0
+                        break
+                    end
+                    if ~isempty(Error)
+                        warning('DCAM4Camera: scan datacube: %s', Error)
+                    end
+                    obj.BufferPool.ScanCube = DCAM4ScanCube(obj.CameraHandle, 'pool');
+                    obj.IsRunning = 0;
+                    return
+                end
+            end
+            obj.CameraFrameIndex = min(First+Nframe-1, obj.SequenceLength);
+            if ~isempty(out)
+                obj.CameraFrameIndex = First+size(out,2)-1;
             end
-            if ~strcmp(Camstatus,'Busy')
-                %obj.abort;
+            if obj.CameraFrameIndex >= obj.SequenceLength
+                obj.BufferPool.ScanCube = DCAM4ScanCube(obj.CameraHandle, 'pool');
                 obj.IsRunning = 0;
             end
-            out = obj.Data(:,:,obj.CameraFrameIndex-Nframe+1:obj.CameraFrameIndex);
-            out = permute(out,[2,3,1]); % [y,x_scan,wave]
         end
 
         function triggeredCapture(obj)
@@ -749,6 +1209,20 @@ classdef DCAM4Camera < mic.camera.abstract
             DCAM4FireTrigger(obj.CameraHandle, obj.Timeout)
         end
         
+        function [out,Period]=fireTriggers(obj,NTriggers)
+            % Fire NTriggers software triggers at the minimum trigger
+            % interval of the camera and wait for each frame.  The frames
+            % are returned only if requested, otherwise they are left in
+            % the camera buffer for finishTriggeredCapture().  Period is
+            % the achieved time (s) between triggers.
+            [imgall,Period] = DCAM4FireTriggers(obj.CameraHandle, ...
+                NTriggers, obj.Timeout, nargout>0);
+            out = [];
+            if nargout>0 && ~isempty(imgall)
+                out=reshape(imgall,obj.ImageSize(1),obj.ImageSize(2),[]);
+            end
+        end
+        
         function out=finishTriggeredCapture(obj,numFrames)
 %             obj.abort();
             imgall = DCAM4CopyFrames(obj.CameraHandle, numFrames, ...
@@ -778,15 +1252,24 @@ classdef DCAM4Camera < mic.camera.abstract
             DCAM4StartCapture(obj.CameraHandle, 0); % what we call sequence needs snap mode
             pause(1) % pause briefly before proceeding
             
-            Camstatus=obj.HtsuGetStatus;
-            while strcmp(Camstatus,'Busy')
+            DCAM4EventCounter(obj.CameraHandle, 'start', [], obj.ThreadOptions);
+            % Sleep until the next frame (at most 0.1 s, so that AbortNow
+            % is still seen) and show each new frame once.
+            Events=DCAM4EventCounter(obj.CameraHandle, 'status');
+            Shown=0;
+            while Events.Busy
                 if obj.AbortNow
                     obj.AbortNow=0;
                     out=[];
                     break;
                 end
-                obj.displaylastimage;
-                Camstatus=obj.HtsuGetStatus;
+                if Events.Frames > Shown
+                    Shown=Events.Frames;
+                    obj.displaypreview(0);
+                else
+                    drawnow limitrate ;
+                end
+                Events=DCAM4EventCounter(obj.CameraHandle, 'wait', Shown+1, 100);
             end
             
             if obj.AbortNow
@@ -805,13 +1288,19 @@ classdef DCAM4Camera < mic.camera.abstract
             
             switch obj.ReturnType
                 case 'dipimage'
-                    out=dip_image(out,'uint16');
+                    if obj.CalibrateData
+                        out=dip_image(out,'sfloat');
+                    else
+                        out=dip_image(out,'uint16');
+                    end
                 case 'matlab'
-                    %already in uint16
+                    %already in uint16 (single photoelectrons if CalibrateData)
             end
         end
         
         function reset(obj)
+            DCAM4EventCounter(obj.CameraHandle, 'clear');
+            DCAM4ApplyProfile(obj.CameraHandle, 'clear');
             DCAM4Close(obj.CameraHandle)
             obj.CameraHandle=DCAM4Open(obj.CameraIndex);
             obj.setCamProperties(obj.CameraSetting);
@@ -837,26 +1326,45 @@ classdef DCAM4Camera < mic.camera.abstract
         end
 
 
-        function get_propertiesDcam(obj)
-            idprop = DCAM4GetPropNextID(obj.CameraHandle,int32(0));
-            while idprop ~= 0
-                pinfo = obj.get_propAttr(idprop);
-                obj.CameraSetting.(pinfo.Name).idprop = idprop;
-                obj.CameraSetting.(pinfo.Name).Type = pinfo.Type;
-                obj.CameraSetting.(pinfo.Name).Desc = pinfo.Option;
-                obj.CameraSetting.(pinfo.Name).Range = pinfo.Range;
-                obj.CameraSetting.(pinfo.Name).Readable = pinfo.Readable;
-                obj.CameraSetting.(pinfo.Name).Writable = pinfo.Writable;
-                switch pinfo.Type
+        function get_propertiesDcam(obj,Refresh)
+            if nargin < 2
+                Refresh = false;
+            end
+            CacheDir = obj.PropertyCacheDir;
+            if ~isempty(CacheDir) && ~isfolder(CacheDir) && ~mkdir(CacheDir)
+                CacheDir = '';
+            end
+            Props = DCAM4GetPropMetadata(obj.CameraHandle,CacheDir,Refresh);
+            for ii = 1:numel(Props)
+                pinfo = Props(ii);
+                propname = strrep(pinfo.name,' ','_');
+                propname = strrep(propname,'[','');
+                propname = strrep(propname,']','');
+                if pinfo.range(1)<0 % range is not available
+                    Range = [1,2,-1]; % 'OFF', 'ON'
+                else
+                    Range = pinfo.range;
+                end
+                if strcmp(pinfo.type,'MODE')
+                    Type = 'enum';
+                    Option = pinfo.text;
+                else
+                    Type = 'bounded';
+                    Option = 0;
+                end
+                obj.CameraSetting.(propname).idprop = pinfo.idprop;
+                obj.CameraSetting.(propname).Type = Type;
+                obj.CameraSetting.(propname).Desc = Option;
+                obj.CameraSetting.(propname).Range = Range;
+                obj.CameraSetting.(propname).Readable = pinfo.readable;
+                obj.CameraSetting.(propname).Writable = pinfo.writable;
+                switch Type
                     case 'bounded'
-                        obj.CameraSetting.(pinfo.Name).Value = pinfo.Value;
-                        
+                        obj.CameraSetting.(propname).Value = pinfo.value;
                     case 'enum'
-                        obj.CameraSetting.(pinfo.Name).Bit = pinfo.Option{pinfo.Value};
-                        obj.CameraSetting.(pinfo.Name).Ind = pinfo.Value;
+                        obj.CameraSetting.(propname).Bit = Option{pinfo.value};
+                        obj.CameraSetting.(propname).Ind = pinfo.value;
                 end
-
-                idprop = DCAM4GetPropNextID(obj.CameraHandle,idprop);
             end
 
         end
@@ -908,8 +1416,8 @@ classdef DCAM4Camera < mic.camera.abstract
         end
 
         function Value = setgetProperty(obj,idprop,value)
-            DCAM4SetProperty(obj.CameraHandle,idprop,value);
-            Value = DCAM4GetProperty(obj.CameraHandle,idprop);
+            % The property is only set if it changed since the last call.
+            Value = DCAM4ApplyProfile(obj.CameraHandle,idprop,value);
         end
 
         function setCamProperties(obj,Infield)
@@ -919,25 +1427,30 @@ classdef DCAM4Camera < mic.camera.abstract
   
             end            
 
-            % Set up properties
+            % Set up properties.  DCAM4ApplyProfile sets only the values
+            % that changed since the last profile, in an order the camera
+            % accepts, and reads them all back in one call.
             fieldp=fields(Infield);
+            IDs = zeros(length(fieldp),1);
+            Values = zeros(length(fieldp),1);
+            NProps = 0;
             for ii=1:length(fieldp)
-                idprop = Infield.(fieldp{ii}).idprop;
-
-                if Infield.(fieldp{ii}).Writable
-                    pinfo = obj.get_propAttr(idprop);
-                    switch pinfo.Type
-                        case 'enum'
-                            value = Infield.(fieldp{ii}).Ind;
-                        case 'bounded'
-                            value = Infield.(fieldp{ii}).Value;
-                    end
-                    if pinfo.Value ~= value
-                        obj.setProperty(idprop,value);
-                        
-                    end
+                if ~Infield.(fieldp{ii}).Writable
+                    continue;
+                end
+                switch Infield.(fieldp{ii}).Type
+                    case 'enum'
+                        value = Infield.(fieldp{ii}).Ind;
+                    case 'bounded'
+                        value = Infield.(fieldp{ii}).Value;
+                    otherwise
+                        continue;
                 end
+                NProps = NProps+1;
+                IDs(NProps) = Infield.(fieldp{ii}).idprop;
+                Values(NProps) = value;
             end
+            DCAM4ApplyProfile(obj.CameraHandle, IDs(1:NProps), Values(1:NProps));
 
         end
 
@@ -1135,6 +1648,71 @@ classdef DCAM4Camera < mic.camera.abstract
                 end
             end
         end
+        function startMultiCapture(Cameras, BufferFrames, MatchBy, Tolerance)
+            % Start continuous sequences on several cameras and pair their
+            % frames in DCAM4MultiCapture.  Cameras is an array of
+            % DCAM4Camera objects; each one is drained by its own thread
+            % into a ring buffer of BufferFrames (default 200) frames.
+            % MatchBy is 'framestamp' (default) or 'timestamp', with
+            % Tolerance in seconds.  The threads are placed by the
+            % ThreadOptions of the first camera.
+            if nargin < 2 || isempty(BufferFrames)
+                BufferFrames = 200;
+            end
+            if nargin < 3
+                MatchBy = 'framestamp';
+            end
+            if nargin < 4
+                Tolerance = [];
+            end
+            for ii = 1:numel(Cameras)
+                Cam = Cameras(ii);
+                Cam.abort;
+                Cam.AcquisitionType = 'sequence';
+                Cam.ExpTime_Sequence = Cam.setgetProperty( ...
+                    Cam.CameraSetting.EXPOSURE_TIME.idprop, Cam.ExpTime_Sequence);
+                Cam.prepareForCapture(BufferFrames);
+            end
+            Timeout = max([Cameras.Timeout]);
+            DCAM4MultiCapture([Cameras.CameraHandle], 'start', BufferFrames, ...
+                Timeout, MatchBy, Tolerance, [], Cameras(1).ThreadOptions);
+            for ii = 1:numel(Cameras)
+                DCAM4StartCapture(Cameras(ii).CameraHandle, -1);
+            end
+        end
+
+        function [Frames, Timestamps, Framestamps] = readMultiCapture(Cameras, MaxSets)
+            % Return up to MaxSets (default all) of the frame sets matched
+            % since the last read: a cell array with an X x Y x N uint16
+            % array per camera, and N x NCameras timestamps (s) and
+            % framestamps.
+            if nargin < 2
+                MaxSets = [];
+            end
+            [Frames, Timestamps, Framestamps] = DCAM4MultiCapture( ...
+                [Cameras.CameraHandle], 'read', MaxSets);
+        end
+
+        function [Frames, Timestamps, Framestamps] = stopMultiCapture(Cameras)
+            % Stop the cameras started by startMultiCapture() and return
+            % the frame sets that were not read yet.
+            Handles = [Cameras.CameraHandle];
+            DCAM4MultiCapture(Handles, 'stop');
+            for ii = 1:numel(Cameras)
+                DCAM4StopCapture(Cameras(ii).CameraHandle);
+            end
+            [Matched, Unmatched, ~, Err] = DCAM4MultiCapture(Handles, 'status');
+            [Frames, Timestamps, Framestamps] = DCAM4MultiCapture(Handles, 'read');
+            DCAM4MultiCapture(Handles, 'clear');
+            if ~isempty(Err)
+                warning('DCAM4Camera: multi-camera capture stopped: %s', Err)
+            end
+            if any(Unmatched)
+                fprintf('%d frame sets matched, unmatched frames per camera: %s\n', ...
+                    Matched, mat2str(Unmatched));
+            end
+        end
+
         %[HexString] = propertyToHex(PropertyString, APIFilePath);
         %[PropertyString] = hexToProperty(HexString, Prefix, APIFilePath);
         %setProperty(CameraHandle, Property, Value, APIFilePath);
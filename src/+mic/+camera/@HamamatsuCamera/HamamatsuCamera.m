@@ -38,6 +38,8 @@ classdef HamamatsuCamera < mic.camera.abstract
 % 
 % ### `CameraHandle`
 % Handle for the camera object.
+% Returned by `DcamOpen` as a `uint64`, so 64-bit pointers are not truncated.
+% Older `int32` handles are still accepted.
 % 
 % ### `CameraIndex`
 % Index used when more than one camera is present.
@@ -198,9 +200,24 @@ classdef HamamatsuCamera < mic.camera.abstract
                 pause(0.1);
                 [img]=DcamGetLastImageFast(obj.CameraHandle);
             else
-                [img]=DcamGetNewestFrame(obj.CameraHandle);
+                % wait at most two exposures (plus readout) for a new
+                % frame; the newest frame is returned again after that
+                switch obj.AcquisitionType
+                    case 'focus'
+                        ExpTime=obj.ExpTime_Focus;
+                    otherwise
+                        ExpTime=obj.ExpTime_Capture;
+                end
+                TimeoutMs=ceil(1000*(2*double(ExpTime)+0.5));
+                [img]=DcamGetNewestFrame(obj.CameraHandle,TimeoutMs);
+                if isempty(img)
+                    % nothing captured yet
+                    out=[];
+                    return
+                end
             end
-            out=reshape(img,obj.ImageSize(1),obj.ImageSize(2));
+            % colour data types hold three planes, giving X by Y by 3
+            out=reshape(img,obj.ImageSize(1),obj.ImageSize(2),[]);
         end
 
         function out=getdata(obj) 
@@ -210,8 +227,11 @@ classdef HamamatsuCamera < mic.camera.abstract
                 case 'capture'
                     out=obj.getlastimage;
                 case 'sequence'
-                    [imgall]=DcamGetAllFrames(obj.CameraHandle,obj.SequenceLength);
-                    out=reshape(imgall,obj.ImageSize(1),obj.ImageSize(2),obj.SequenceLength);
+                    % allow for the whole sequence rather than a fixed 10 s
+                    TimeoutMs=max(10000,ceil(1000*(1.5*obj.SequenceLength* ...
+                        double(obj.ExpTime_Sequence)+5)));
+                    [imgall]=DcamGetAllFrames(obj.CameraHandle,obj.SequenceLength,TimeoutMs);
+                    out=reshape(imgall,obj.ImageSize(1),obj.ImageSize(2),obj.SequenceLength,[]);
             end
         end
         
@@ -566,10 +586,15 @@ classdef HamamatsuCamera < mic.camera.abstract
             obj.displaylastimage;
         end
         
-        function out=FinishTriggeredCapture(obj,numFrames)
+        function out=FinishTriggeredCapture(obj,numFrames,TimeoutMs)
+            %FinishTriggeredCapture waits up to TimeoutMs (default 10000)
+            %for the end of the capture and returns numFrames frames.
             %obj.abort;
-            [imgall]=DcamGetAllFrames(obj.CameraHandle,numFrames);
-            out=reshape(imgall,obj.ImageSize(1),obj.ImageSize(2),numFrames);
+            if nargin<3
+                TimeoutMs=10000;
+            end
+            [imgall]=DcamGetAllFrames(obj.CameraHandle,numFrames,TimeoutMs);
+            out=reshape(imgall,obj.ImageSize(1),obj.ImageSize(2),numFrames,[]);
             obj.abort;            
             % set Trigger mode back to Internal so data can be captured
             TriggerModeIdx = 1; % Internal mode
@@ -290,7 +290,7 @@ classdef abstract < mic.abstract
             
             Data=obj.getlastimage();
             im=Data;
-            if obj.AbortNow
+            if obj.AbortNow || isempty(im)
                 return;
             end
             %open window if necessary
@@ -66,12 +66,22 @@ classdef TCubeLaserDiode < mic.lightsource.abstract
     %
     % ## Key Functions: 
     % on, off, delete, shutdown, setPower, exportState, funcTest
+    % loadSequence, startSequence, advanceSequence, stopSequence,
+    % sequenceStatus, rampSequence
+    %
+    % ## Power Sequences:
+    % A list of powers is played by a thread in the mex file, either at
+    % given times or one step per advanceSequence call (per frame), so the
+    % timing does not depend on MATLAB and MATLAB is not blocked.
+    %   [T,P]=mic.lightsource.TCubeLaserDiode.rampSequence(0,10,5,0.01);
+    %   TLD.loadSequence(T,P); TLD.startSequence();
+    %   [Running,Step,Stats]=TLD.sequenceStatus();
     %
     % ## REQUIREMENT:
     %   mic.abstract.m
     %   mic.lightsource.abstract.m
     %   Kinesis Control Software Intalled: https://www.thorlabs.com/software_pages/ViewSoftwarePage.cfm?Code=Motion_Control
-    %   Pre-compiled Kinesis_LD_*.mex64 files in path (typically in ../../mex64);
+    %   Pre-compiled Kinesis_Dispatch.mex64 (LD_* commands) in path (typically in ../../mex64);
     %   Thorlabs.MotionControl.DeviceManager.dll and Thorlabs.MotionControl.TCube.LaserDiode
     %    must be in system path or in same folder as *.mex64 files.
     %
@@ -120,21 +130,21 @@ classdef TCubeLaserDiode < mic.lightsource.abstract
             %Save properties to object
             
             %Identify and Intialize Device
-            Kinesis_LD_Identify(SerialNo);
+            Kinesis_Dispatch('Identify',SerialNo);
             
-            Err=Kinesis_LD_Open(SerialNo);
+            Err=Kinesis_Dispatch('Open',SerialNo);
             if Err
                 error('mic.lightsource.TCubeLaserDiode:: Could not open device')
             end
             switch Mode
                 case 'Current'
                     obj.Mode=Mode;
-                    Kinesis_LD_SetOpenLoopMode(SerialNo);
+                    Kinesis_Dispatch('LD_SetOpenLoopMode',SerialNo);
                     obj.PowerUnit='mA';
                 case 'Power'
                     obj.Mode=Mode;
-                    Kinesis_LD_SetWACalibFactor(SerialNo,single(WperA));
-                    Kinesis_LD_SetClosedLoopMode(SerialNo);
+                    Kinesis_Dispatch('LD_SetWACalibFactor',SerialNo,single(WperA));
+                    Kinesis_Dispatch('LD_SetClosedLoopMode',SerialNo);
                     obj.PowerUnit='mW';
                 otherwise
                     error('mic.lightsource.RebelStarLED::Unknown Mode')
@@ -161,25 +171,72 @@ classdef TCubeLaserDiode < mic.lightsource.abstract
             obj.Power=min(obj.MaxPower,obj.Power);
             
             %Set Power
-            switch obj.Mode
-                case 'Current'
-                    SetPoint=Power_in/220*32767;
-                case 'Power'
-                    SetPoint=Power_in/obj.WperA/obj.TIARange*32767;
-            end
+            SetPoint=obj.powerToSetPoint(Power_in);
             
             if obj.IsOn
-                [Err,SetP]=Kinesis_LD_SetLaserSetPoint(obj.SerialNo,uint32(SetPoint));
+                [Err,SetP]=Kinesis_Dispatch('LD_SetLaserSetPoint',obj.SerialNo,uint32(SetPoint));
             else
                 obj.PowerSet=0;
             end
                 
         end
         
+        function SetPoint=powerToSetPoint(obj,Power)
+            % Converts power in Mode dependent unit to the TLD001 set point
+            switch obj.Mode
+                case 'Current'
+                    SetPoint=Power/220*32767;
+                case 'Power'
+                    SetPoint=Power/obj.WperA/obj.TIARange*32767;
+            end
+        end
+        
+        function loadSequence(obj,Times,Powers)
+            % Loads a power sequence that is played by the mex file.
+            % Times (s) gives the start of each step from startSequence.
+            % With Times empty, each call to advanceSequence moves to the
+            % next step, e.g. once per camera frame.  Powers are clipped
+            % to [MinPower, MaxPower].  See also rampSequence.
+            Powers=min(obj.MaxPower,max(obj.MinPower,Powers));
+            SetPoints=arrayfun(@(P)obj.powerToSetPoint(P),Powers);
+            Kinesis_Dispatch('LD_LoadSequence',obj.SerialNo, ...
+                double(Times(:)'),double(SetPoints(:)'));
+        end
+        
+        function startSequence(obj)
+            % Turns the laser on and starts the loaded power sequence.
+            % Returns at once; the steps are timed in the mex file.
+            obj.IsOn=1;
+            Kinesis_Dispatch('LD_EnableOutput',obj.SerialNo);
+            Kinesis_Dispatch('LD_StartSequence',obj.SerialNo);
+        end
+        
+        function advanceSequence(obj,Step)
+            % Moves a sequence loaded without times to the next step, or to
+            % Step (1-based) if given.
+            if nargin<2
+                Kinesis_Dispatch('LD_Advance',obj.SerialNo);
+            else
+                Kinesis_Dispatch('LD_Advance',obj.SerialNo,Step);
+            end
+        end
+        
+        function stopSequence(obj)
+            % Stops the power sequence.  The laser stays at the last step.
+            Kinesis_Dispatch('LD_StopSequence',obj.SerialNo);
+        end
+        
+        function [Running,Step,Stats]=sequenceStatus(obj)
+            % Running is true while the sequence plays and Step the number
+            % of steps done.  Stats.Late gives how late (s) each step was
+            % set, with Stats.MeanLate, Stats.RmsJitter and Stats.MaxLate.
+            [Running,Step,Stats]=Kinesis_Dispatch('LD_SequenceStatus',obj.SerialNo);
+        end
+        
         function on(obj)
             % Turn on LED to currently set power.
             obj.IsOn=1;
-            Kinesis_LD_EnableOutput(obj.SerialNo);
+            Kinesis_Dispatch('LD_EnableOutput',obj.SerialNo);
             %Set Power again if it has changed
             if ~obj.PowerSet
                 obj.setPower(obj.Power); %Set Power if changed while off 
@@ -190,7 +247,7 @@ classdef TCubeLaserDiode < mic.lightsource.abstract
         
         function off(obj)
             % Turn off LED.
-            Kinesis_LD_DisableOutput(obj.SerialNo);
+            Kinesis_Dispatch('LD_DisableOutput',obj.SerialNo);
             obj.IsOn=0;
         end
         
@@ -210,11 +267,19 @@ classdef TCubeLaserDiode < mic.lightsource.abstract
             % Set power to zero and turn off.
             obj.setPower(0);
             obj.off();
-            Kinesis_LD_Close(obj.SerialNo);
+            Kinesis_Dispatch('Close',obj.SerialNo);
         end
         
     end
     methods (Static=true)
+        function [Times,Powers]=rampSequence(P0,P1,Duration,StepTime)
+            % Times and powers of a linear ramp from P0 to P1 over
+            % Duration (s) in steps of StepTime (s), for loadSequence.
+            % Example: [T,P]=mic.lightsource.TCubeLaserDiode.rampSequence(0,10,5,0.01)
+            Times=0:StepTime:Duration;
+            Powers=P0+(P1-P0)*Times/Duration;
+        end
+        
         function Success=funcTest(SerialNo,Mode,MaxPower,WperA,TIARange)
             % Unit test of object functionality
             % Example:
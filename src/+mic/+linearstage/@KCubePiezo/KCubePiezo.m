@@ -105,6 +105,7 @@ classdef KCubePiezo < mic.linearstage.abstract
     % - **`zeroStrainGauge()`:** Sets the strain gauge to zero to ensure accurate position feedback, essential for precise operations.
     % - **`calibrateStrainGauge()`:** Performs a calibration of the strain gauge by measuring known positions to determine the scale and offset required for accurate positioning.
     % - **`setPosition(Position)`:** Moves the piezo stage to the specified position, with input validated against the stage's configured minimum and maximum range.
+    % - **`positionSetpoint(Position)`:** Clamps the position, records it as the current position and returns the piezo setpoint with the controller and strain gauge serial numbers, for grouped moves with `mic.linearstage.abstract.setPositions`.
     % - **`getPosition()`:** Retrieves the current position of the piezo stage, providing feedback on the stage's location in its operational range.
     % - **`shutdown()`:** Completes the session by turning off the devices and ensuring all settings are reset to prevent damage or misconfiguration for future operations.
     % - **`exportState()`:** Exports the current operational state, including position, calibration data, and system settings, useful for session logging or debugging.
@@ -124,7 +125,7 @@ classdef KCubePiezo < mic.linearstage.abstract
     % ## REQUIRES: 
     %   mic.Abstract.m
     %   mic.linearstage,abstract.m
-    %   Precompiled set of mex files Kinesis_KCube_PCC_*.mex64 and Kinesis_KCube_SG_*.mex64
+    %   Precompiled mex file Kinesis_Dispatch.mex64 (PCC_* and SG_* commands)
     %   The following dll must be in system path or same directory as mex files: 
     %   Thorlabs.MotionControl.KCube.Piezo.dll
     %   Thorlabs.MotionControl.KCube.StrainGauge.dll
@@ -195,10 +196,10 @@ classdef KCubePiezo < mic.linearstage.abstract
         function Err=openDevices(obj)
             % Opens communications to PZ and SG with Kinesis C-API via mex
             
-            Kinesis_TLI_BuildDeviceList(); 
+            Kinesis_Dispatch('BuildDeviceList');
             pause(1);  %Try to prevent crash
             
-            ErrSG=Kinesis_KCube_SG_Open(obj.SerialNoKSG001);
+            ErrSG=Kinesis_Dispatch('Open',obj.SerialNoKSG001);
             
             % Determine if there were errors opening the strain gauge and
             % output an appropriate warning.
@@ -210,7 +211,7 @@ classdef KCubePiezo < mic.linearstage.abstract
                     ErrorMessage], ErrSG, obj.SerialNoKSG001)
             end
             
-            ErrPZ=Kinesis_KCube_PCC_Open(obj.SerialNoKPZ001);
+            ErrPZ=Kinesis_Dispatch('Open',obj.SerialNoKPZ001);
             % Determine if there were errors opening the piezo controller
             % and output an appropriate warning.
             if ErrPZ ~= 0 % ErrPZ == 0 suggests a succesful connection
@@ -230,8 +231,8 @@ classdef KCubePiezo < mic.linearstage.abstract
             % Closes communications to PZ and SG with Kinesis C-API via mex
             % This must be done before using Kinesis or creating new
             % objects. 
-            Kinesis_KCube_PCC_Close(obj.SerialNoKPZ001)
-            Kinesis_KCube_SG_Close(obj.SerialNoKSG001)
+            Kinesis_Dispatch('Close',obj.SerialNoKPZ001)
+            Kinesis_Dispatch('Close',obj.SerialNoKSG001)
         end
         
         function resetDevices(obj)
@@ -246,18 +247,18 @@ classdef KCubePiezo < mic.linearstage.abstract
             SNSG=obj.SerialNoKSG001;
             
             %Set to open loop and voltage to zero
-            Kinesis_KCube_PCC_SetPositionControlMode(SN,2);
-            Kinesis_KCube_PCC_SetPosition(SN,uint32(0));
+            Kinesis_Dispatch('PCC_SetPositionControlMode',SN,2);
+            Kinesis_Dispatch('PCC_SetPosition',SN,uint32(0));
             beep
             pause(4)
-            Kinesis_KCube_PCC_SetPositionControlMode(SN,1);
-            Kinesis_KCube_PCC_SetPosition(SN,uint32(0));
+            Kinesis_Dispatch('PCC_SetPositionControlMode',SN,1);
+            Kinesis_Dispatch('PCC_SetPosition',SN,uint32(0));
             
             %Zero strain gauge
-            Kinesis_KCube_SG_SetZero(SNSG); % This needs wait till finished inside mex.
+            Kinesis_Dispatch('SG_SetZero',SNSG); % This needs wait till finished inside mex.
             
             %Set to closed loop and voltage to zero
-            Kinesis_KCube_PCC_SetPositionControlMode(SN,2);
+            Kinesis_Dispatch('PCC_SetPositionControlMode',SN,2);
         end
         
         function calibrateStrainGauge(obj)
@@ -266,13 +267,13 @@ classdef KCubePiezo < mic.linearstage.abstract
             SNSG=obj.SerialNoKSG001;
             
             %Calibration
-            Kinesis_KCube_PCC_SetPosition(SN,uint32(0.2*2^16));
+            Kinesis_Dispatch('PCC_SetPosition',SN,uint32(0.2*2^16));
             pause(5)
-            PZ20=Kinesis_KCube_SG_GetReading(SNSG)/2^15*20;
+            PZ20=Kinesis_Dispatch('SG_GetReading',SNSG)/2^15*20;
             
-            Kinesis_KCube_PCC_SetPosition(SN,uint32(0.8*2^16));
+            Kinesis_Dispatch('PCC_SetPosition',SN,uint32(0.8*2^16));
             pause(5)
-            PZ80=Kinesis_KCube_SG_GetReading(SNSG)/2^15*20;
+            PZ80=Kinesis_Dispatch('SG_GetReading',SNSG)/2^15*20;
             
             obj.Slope=0.6*2^16/(PZ80-PZ20);
             obj.Offset=0.2*2^16/obj.Slope-PZ20;  
@@ -281,15 +282,23 @@ classdef KCubePiezo < mic.linearstage.abstract
         
         function setPosition(obj,Position)
             % Sets Piezo Stage Position in microns. 
-            obj.CurrentPosition=max(obj.MinPosition,Position);
-            obj.CurrentPosition=min(obj.MaxPosition,obj.CurrentPosition);
-            
-            Kinesis_KCube_PCC_SetPosition(obj.SerialNoKPZ001,uint32((obj.CurrentPosition+obj.Offset)*obj.Slope)); 
+            Kinesis_Dispatch('PCC_SetPosition',obj.SerialNoKPZ001,obj.positionSetpoint(Position)); 
             pause(obj.WaitTime);
             obj.updateGui();
             
         end
         
+        function [Setpoint,SerialNoPZ,SerialNoSG]=positionSetpoint(obj,Position)
+            % Clamps Position (microns) to the stage range, records it as
+            % the current position and returns the piezo setpoint for it.
+            % Used by setPosition and mic.linearstage.abstract.setPositions.
+            obj.CurrentPosition=max(obj.MinPosition,Position);
+            obj.CurrentPosition=min(obj.MaxPosition,obj.CurrentPosition);
+            Setpoint=uint32((obj.CurrentPosition+obj.Offset)*obj.Slope);
+            SerialNoPZ=obj.SerialNoKPZ001;
+            SerialNoSG=obj.SerialNoKSG001;
+        end
+        
         function Position=getPosition(obj)
             %Returns the currently set position
             Position=obj.CurrentPosition;
@@ -59,7 +59,7 @@ classdef TCubePiezo < mic.linearstage.abstract
     %
     % ### `openDevices()`
     % Opens communication with the piezo (`PZ`) and strain gauge (`SG`) using the Kinesis C-API via MEX files.
-    % - Calls `Kinesis_TLI_BuildDeviceList()` and attempts to establish connections.
+    % - Calls `Kinesis_Dispatch('BuildDeviceList')` and attempts to establish connections.
     % - Handles errors during connection with appropriate warnings.
     %
     % ### `closeDevices()`
@@ -81,6 +81,9 @@ classdef TCubePiezo < mic.linearstage.abstract
     % - Ensures the position is within the specified limits.
     % - Sends the new position to the piezo controller and updates the GUI.
     %
+    % ### `positionSetpoint(Position)`
+    % Clamps the position, records it as the current position and returns the piezo setpoint with the controller and strain gauge serial numbers, for grouped moves with `mic.linearstage.abstract.setPositions`.
+    %
     % ### `getPosition()`
     % Returns the currently set position of the device.
     %
@@ -107,7 +110,7 @@ classdef TCubePiezo < mic.linearstage.abstract
     % ## REQUIRMENT: 
     %   mic.Abstract.m
     %   mic.linearstage.abstract.m
-    %   Precompiled set of mex files Kinesis_PCC_*.mex64 and Kinesis_SG_*.mex64
+    %   Precompiled mex file Kinesis_Dispatch.mex64 (PCC_* and SG_* commands)
     %   The following dll must be in system path or same directory as mex files: 
     %   Thorlabs.MotionControl.TCube.Piezo.dll
     %   Thorlabs.MotionControl.TCube.StrainGauge.dll
@@ -171,10 +174,10 @@ classdef TCubePiezo < mic.linearstage.abstract
         function Err=openDevices(obj)
             % Opens communications to PZ and SG with Kinesis C-API via mex
             
-            Kinesis_TLI_BuildDeviceList(); 
+            Kinesis_Dispatch('BuildDeviceList');
             pause(1);  %Try to prevent crash
             
-            ErrSG=Kinesis_SG_Open(obj.SerialNoTSG001);
+            ErrSG=Kinesis_Dispatch('Open',obj.SerialNoTSG001);
             
             % Determine if there were errors opening the strain gauge and
             % output an appropriate warning.
@@ -186,7 +189,7 @@ classdef TCubePiezo < mic.linearstage.abstract
                     ErrorMessage], ErrSG, obj.SerialNoTSG001)
             end
             
-            ErrPZ=Kinesis_PCC_Open(obj.SerialNoTPZ001);
+            ErrPZ=Kinesis_Dispatch('Open',obj.SerialNoTPZ001);
             % Determine if there were errors opening the piezo controller
             % and output an appropriate warning.
             if ErrPZ ~= 0 % ErrPZ == 0 suggests a succesful connection
@@ -206,8 +209,8 @@ classdef TCubePiezo < mic.linearstage.abstract
             % Closes communications to PZ and SG with Kinesis C-API via mex
             % This must be done before using Kinesis or creating new
             % objects. 
-            Kinesis_PCC_Close(obj.SerialNoTPZ001)
-            Kinesis_SG_Close(obj.SerialNoTSG001)
+            Kinesis_Dispatch('Close',obj.SerialNoTPZ001)
+            Kinesis_Dispatch('Close',obj.SerialNoTSG001)
         end
         
         function resetDevices(obj)
@@ -222,17 +225,17 @@ classdef TCubePiezo < mic.linearstage.abstract
             SNSG=obj.SerialNoTSG001;
             
             %Set to open loop and voltage to zero
-            Kinesis_PCC_SetPositionControlMode(SN,uint16(2));
-            Kinesis_PCC_SetPosition(SN,uint32(0));
+            Kinesis_Dispatch('PCC_SetPositionControlMode',SN,uint16(2));
+            Kinesis_Dispatch('PCC_SetPosition',SN,uint32(0));
             pause(4)
-            Kinesis_PCC_SetPositionControlMode(SN,uint16(1));
-            Kinesis_PCC_SetPosition(SN,uint32(0));
+            Kinesis_Dispatch('PCC_SetPositionControlMode',SN,uint16(1));
+            Kinesis_Dispatch('PCC_SetPosition',SN,uint32(0));
             
             %Zero strain gauge
-            Kinesis_SG_SetZero(SNSG); % This needs wait till finished inside mex.
+            Kinesis_Dispatch('SG_SetZero',SNSG); % This needs wait till finished inside mex.
             
             %Set to closed loop and voltage to zero
-            Kinesis_PCC_SetPositionControlMode(SN,uint16(2));
+            Kinesis_Dispatch('PCC_SetPositionControlMode',SN,uint16(2));
         end
         
         function calibrateStrainGauge(obj)
@@ -241,13 +244,13 @@ classdef TCubePiezo < mic.linearstage.abstract
             SNSG=obj.SerialNoTSG001;
             
             %Calibration
-            Kinesis_PCC_SetPosition(SN,uint32(0.2*2^16));
+            Kinesis_Dispatch('PCC_SetPosition',SN,uint32(0.2*2^16));
             pause(5)
-            PZ20=Kinesis_SG_GetReading(SNSG)/2^15*20;
+            PZ20=Kinesis_Dispatch('SG_GetReading',SNSG)/2^15*20;
             
-            Kinesis_PCC_SetPosition(SN,uint32(0.8*2^16));
+            Kinesis_Dispatch('PCC_SetPosition',SN,uint32(0.8*2^16));
             pause(5)
-            PZ80=Kinesis_SG_GetReading(SNSG)/2^15*20;
+            PZ80=Kinesis_Dispatch('SG_GetReading',SNSG)/2^15*20;
             
             obj.Slope=0.6*2^16/(PZ80-PZ20);
             obj.Offset=0.2*2^16/obj.Slope-PZ20;  
@@ -256,15 +259,23 @@ classdef TCubePiezo < mic.linearstage.abstract
         
         function setPosition(obj,Position)
             % Sets Piezo Stage Position in microns. 
-            obj.CurrentPosition=max(obj.MinPosition,Position);
-            obj.CurrentPosition=min(obj.MaxPosition,obj.CurrentPosition);
-            
-            Kinesis_PCC_SetPosition(obj.SerialNoTPZ001,uint32((obj.CurrentPosition+obj.Offset)*obj.Slope)); 
+            Kinesis_Dispatch('PCC_SetPosition',obj.SerialNoTPZ001,obj.positionSetpoint(Position)); 
             pause(obj.WaitTime);
             obj.updateGui();
             
         end
         
+        function [Setpoint,SerialNoPZ,SerialNoSG]=positionSetpoint(obj,Position)
+            % Clamps Position (microns) to the stage range, records it as
+            % the current position and returns the piezo setpoint for it.
+            % Used by setPosition and mic.linearstage.abstract.setPositions.
+            obj.CurrentPosition=max(obj.MinPosition,Position);
+            obj.CurrentPosition=min(obj.MaxPosition,obj.CurrentPosition);
+            Setpoint=uint32((obj.CurrentPosition+obj.Offset)*obj.Slope);
+            SerialNoPZ=obj.SerialNoTPZ001;
+            SerialNoSG=obj.SerialNoTSG001;
+        end
+        
         function Position=getPosition(obj)
             %Returns the currently set position
             Position=obj.CurrentPosition;
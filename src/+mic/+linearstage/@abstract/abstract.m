@@ -26,6 +26,7 @@ classdef abstract < mic.abstract
 % - **Constructor (`mic.linearstage.abstract(AutoName)`):** Initializes a new instance of a subclass, incorporating auto-naming functionality inherited from `mic.abstract`.
 % - **`center()`:** Moves the stage to its center position, calculated as the midpoint between `MinPosition` and `MaxPosition`.
 % - **`updateGui()`:** Refreshes the GUI elements to reflect current Properties like position, ensuring the display is up-to-date with the stage's status.
+% - **`setPositions(Stages, Positions)` (static):** Moves several stages at once. Kinesis piezos are set together and their strain gauges waited on together; other stages are moved one after the other.
 %
 % ### Citation: Marjolein Meddens, Lidke Lab, 2017.
     
@@ -69,6 +70,55 @@ classdef abstract < mic.abstract
     
    
         
+    methods (Static)
+        function Seconds=setPositions(Stages,Positions)
+            % mic.linearstage.abstract.setPositions Moves several stages at once
+            % Stages is a cell array of stages and Positions a vector with
+            % one position per stage.  Stages with a positionSetpoint
+            % method (TCubePiezo, KCubePiezo) are set by a single
+            % Kinesis_Dispatch('PCC_SetPositions') call, which sends the
+            % setpoints concurrently and returns when all strain gauges
+            % have moved to their setpoints and read steady (with a
+            % warning if one times out).  Seconds is the time the slowest
+            % of them took.
+            % Other stages are moved with setPosition.
+            Seconds=0;
+            IsPiezo=cellfun(@(S)ismethod(S,'positionSetpoint'),Stages);
+            for ii=find(~IsPiezo(:)')
+                Stages{ii}.setPosition(Positions(ii));
+            end
+            Piezos=find(IsPiezo(:)');
+            if isempty(Piezos)
+                return
+            end
+            SerialNoPZ=cell(1,numel(Piezos));
+            SerialNoSG=cell(1,numel(Piezos));
+            Setpoints=zeros(1,numel(Piezos));
+            for ii=1:numel(Piezos)
+                [Setpoint,SerialNoPZ{ii},SerialNoSG{ii}]= ...
+                    Stages{Piezos(ii)}.positionSetpoint(Positions(Piezos(ii)));
+                Setpoints(ii)=double(Setpoint);
+            end
+            [Err,~,Settle]=Kinesis_Dispatch('PCC_SetPositions', ...
+                SerialNoPZ,Setpoints,SerialNoSG);
+            % Err is -1 for a piezo whose strain gauge did not settle.
+            if any(Err==-1)
+                warning('mic:linearstage:setPositions', ...
+                    'Piezo %s did not settle within the timeout.', ...
+                    SerialNoPZ{find(Err==-1,1)});
+            end
+            if any(Err>0)
+                warning('mic:linearstage:setPositions', ...
+                    'Error %i setting piezo %s.',Err(find(Err>0,1)), ...
+                    SerialNoPZ{find(Err>0,1)});
+            end
+            Seconds=max(Settle);
+            for ii=Piezos
+                Stages{ii}.updateGui();
+            end
+        end
+    end
+    
     methods (Abstract)
         setPosition(obj,position);  % Move stage to position
         pos = getPosition(obj); % Get current position by querying the stage
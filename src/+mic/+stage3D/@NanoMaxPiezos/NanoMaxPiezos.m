@@ -78,7 +78,7 @@ classdef NanoMaxPiezos < mic.stage3D.abstract
     % Centers all three piezo stages.
     %
     % ### `setPosition([x, y, z])`
-    % Sets the position of the piezo stages to specified x, y, and z coordinates.
+    % Sets the position of the piezo stages to specified x, y, and z coordinates. The three axes are moved together and the call returns once all strain gauges have settled.
     %
     % ### `exportState()`
     % Exports the current state of all piezo stages, providing detailed attributes for each stage.
@@ -219,10 +219,10 @@ classdef NanoMaxPiezos < mic.stage3D.abstract
                     switch DeviceVersionTagArray.(cc)
                         case '29' %Kcube
                             PiezoPosition = (20 / 2^15) ...
-                                * Kinesis_KCube_SG_GetReading(StrainGaugeSN);
+                                * Kinesis_Dispatch('SG_GetReading',StrainGaugeSN);
                         case '81' %TCube
                             PiezoPosition = (20 / 2^15) ...
-                                * Kinesis_SG_GetReading(StrainGaugeSN);
+                                * Kinesis_Dispatch('SG_GetReading',StrainGaugeSN);
                     end
                     
                     if round(PiezoPosition, 1) == TestPosition
@@ -302,10 +302,11 @@ classdef NanoMaxPiezos < mic.stage3D.abstract
         end
         
         function setPosition(obj, Position)
-            % Move the piezos to position given by Position.
-            obj.StagePiezoX.setPosition(Position(1));
-            obj.StagePiezoY.setPosition(Position(2));
-            obj.StagePiezoZ.setPosition(Position(3));
+            % Move the piezos to position given by Position.  The three
+            % axes are set together and return once all have settled.
+            mic.linearstage.abstract.setPositions( ...
+                {obj.StagePiezoX, obj.StagePiezoY, obj.StagePiezoZ}, ...
+                Position);
             
             % Update the position property to the appropriate value.
             if size(Position, 1) < size(Position, 2)
@@ -346,7 +347,7 @@ classdef NanoMaxPiezos < mic.stage3D.abstract
                     % position, and determine if it matches the test
                     % position.
                     PiezoPosition = (20 / 2^15) ...
-                        * Kinesis_SG_GetReading(StrainGaugeSN);
+                        * Kinesis_Dispatch('SG_GetReading',StrainGaugeSN);
                     if round(PiezoPosition, 1) == TestPosition
                         % Position matches TestPosition to the nearest
                         % 1/10um: re-center piezo and break the loop.
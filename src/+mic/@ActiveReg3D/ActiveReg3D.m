@@ -29,6 +29,7 @@ classdef ActiveReg3D < handle
 % - `start`, `stop`: Methods to start and stop periodic alignment.
 % - `align2imageFit`: Function called periodically to align the current image to a reference image.
 % - `findZPos`, `findXYShift`: Methods to find the optimal Z position and XY shifts based on image correlation.
+% - `setXYZ`: Moves the three piezos together with `mic.linearstage.abstract.setPositions` and waits for all strain gauges to settle.
 % 
 % ## Usage Example
 % Here's a brief example on how to use `mic.ActiveReg3D`:
@@ -143,14 +144,11 @@ classdef ActiveReg3D < handle
                 %X(2)=Xstart(2)+deltaX(ii);
                 XYZ(2)=Xstart(2)+deltaX(ii); %new
                 %obj.StageObj.set_position(X); old
-                obj.Stage_Piezo_X.setPosition(XYZ(1)); %new
-                obj.Stage_Piezo_Y.setPosition(XYZ(2)); %new
+                obj.setXYZ(XYZ);
                 pause(.5);
                 ImageStack(:,:,ii)=obj.capture_single;
             end
-             obj.Stage_Piezo_X.setPosition(Xstart(1)); %new
-             obj.Stage_Piezo_Y.setPosition(Xstart(2)); %new
-             obj.Stage_Piezo_Z.setPosition(Xstart(3)); %new
+             obj.setXYZ(Xstart);
             dipshow(ImageStack);
             
             svec=zeros(N,2);
@@ -215,9 +213,7 @@ classdef ActiveReg3D < handle
             N=length(obj.ZStack_Pos);
             zstack=[];
             for nn=1:N
-                obj.Stage_Piezo_X.setPosition(obj.X_Current); %new
-                obj.Stage_Piezo_Y.setPosition(obj.Y_Current); %new
-                obj.Stage_Piezo_Z.setPosition(obj.ZStack_Pos(nn)); %new
+                obj.setXYZ([obj.X_Current,obj.Y_Current,obj.ZStack_Pos(nn)]);
                 if nn==1
                     pause(0.2);
                 end
@@ -228,9 +224,7 @@ classdef ActiveReg3D < handle
             ind=find(obj.ZStack_Pos==obj.Z_Current);
             obj.Image_ReferenceInfocus=squeeze(zstack(:,:,ind(1)));
             %obj.StageObj.set_position(XYZ); old
-            obj.Stage_Piezo_X.setPosition(obj.X_Current); %new
-            obj.Stage_Piezo_Y.setPosition(obj.Y_Current); %new
-            obj.Stage_Piezo_Z.setPosition(obj.Z_Current); %new
+            obj.setXYZ([obj.X_Current,obj.Y_Current,obj.Z_Current]);
             
             obj.IndexFocus=ind;
             pause(0.2);
@@ -268,9 +262,7 @@ classdef ActiveReg3D < handle
             %This restricts movement to obj.MaxZShift
             obj.Correction(3)=sign(obj.ErrorSignal(3))*min(obj.MaxZShift,abs(obj.ErrorSignal(3)));
             XYZ(3)=XYZ(3)+obj.Correction(3); %new
-            obj.Stage_Piezo_X.setPosition(XYZ(1)); %new
-            obj.Stage_Piezo_Y.setPosition(XYZ(2)); %new
-            obj.Stage_Piezo_Z.setPosition(XYZ(3)); %new
+            obj.setXYZ(XYZ);
             
             %Take new image, find XY position and adjust
             [Xshift,Yshift]=findXYShift(obj);
@@ -286,9 +278,7 @@ classdef ActiveReg3D < handle
             obj.PosPostCorrect_History=cat(1,obj.PosPostCorrect_History,obj.PosPostCorrect);
             
             %Image after all corrections
-            obj.Stage_Piezo_X.setPosition(XYZ(1)); %new
-            obj.Stage_Piezo_Y.setPosition(XYZ(2)); %new
-            obj.Stage_Piezo_Z.setPosition(XYZ(3)); %new
+            obj.setXYZ(XYZ);
             obj.Image_Current=cat(3,obj.Image_Current,obj.capture_single());
 
         end
@@ -353,6 +343,12 @@ classdef ActiveReg3D < handle
             img=obj.CameraObj.start_capture;
             out=single(img);
         end
+        
+        function setXYZ(obj,XYZ)
+            %Move the three piezos together, returning once all have settled
+            mic.linearstage.abstract.setPositions( ...
+                {obj.Stage_Piezo_X,obj.Stage_Piezo_Y,obj.Stage_Piezo_Z},XYZ);
+        end
     end
     
     
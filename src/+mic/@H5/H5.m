@@ -32,7 +32,8 @@ classdef H5
 % ## Key Functions
 % - **`createFile(File)`:** Creates an empty HDF5 file. If the file already exists, it issues a warning rather than overwriting the existing file.
 % - **`createGroup(File, Group)`:** Adds a new group to an existing HDF5 file. If the group already exists, the creation process is skipped to avoid duplication.
-% - **`writeAsync_uint16(File, Group, DataName, Data)`:** Initiates an asynchronous data writing process to a specified group within an HDF5 file. This method allows MATLAB to continue executing other commands while data is being written in the background.
+% - **`writeAsync_uint16(File, Group, DataName, Data, CompressionLevel, ThreadOptions)`:** Initiates an asynchronous data writing process to a specified group within an HDF5 file. This method allows MATLAB to continue executing other commands while data is being written in the background. The optional `ThreadOptions` (`CPUs`, `Priority`, `LockMemory`) place the writer thread. The copy of `Data` is kept for the next call of the same size; `releaseAsync()` frees it.
+% - **`releaseAsync()`:** Frees the copies of `Data` that `writeAsync_uint16` keeps for the next call, once the data are written.
 % - **`readH5File(FilePath, GroupName)`:** Retrieves data from a specified group within an HDF5 file. This function would be implemented to allow reading of complex datasets stored within the file system.
 % ### CITATION: David James Schodt (LidkeLab, 2018)
     
@@ -55,16 +56,22 @@ classdef H5
             end
         end
         
-        function writeAsync_uint16(File,Group,DataName,Data,CompressionLevel)
+        function writeAsync_uint16(File,Group,DataName,Data,CompressionLevel,ThreadOptions)
             %Async write to an existing group in an existing H5 file. 
             %Returns immediately to MATLAB
+            %ThreadOptions (optional) places the writer thread: a struct
+            %with the fields CPUs, Priority and LockMemory (see
+            %mex_source/share/threadctl.h)
             if nargin<5
                 CompressionLevel=5;
             end
-            IsBusy=H5Write_Async(File,Group,DataName,Data,CompressionLevel);
+            if nargin<6
+                ThreadOptions=[];
+            end
+            IsBusy=H5Write_Async(File,Group,DataName,Data,CompressionLevel,ThreadOptions);
             while IsBusy
                 pause(0.05);
-                IsBusy=H5Write_Async(File,Group,DataName,Data,CompressionLevel);
+                IsBusy=H5Write_Async(File,Group,DataName,Data,CompressionLevel,ThreadOptions);
             end
         end
         
@@ -80,6 +87,13 @@ classdef H5
             fprintf('H5 Save Time: %.2f s \n', t1)
         end
         
+        function Bytes=releaseAsync()
+            %Free the copies of Data kept by writeAsync_uint16 for the
+            %next call of the same size. A copy that is still being
+            %written is kept.
+            Bytes=H5Write_Async('release');
+        end
+        
         function createGroup(File,Group)
             %Create a new group in an existing H5 file. 
             plist = 'H5P_DEFAULT';
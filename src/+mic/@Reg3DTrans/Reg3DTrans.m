@@ -863,9 +863,13 @@ classdef Reg3DTrans < mic.abstract
                     % When TriggerMode is 'software', we're doing a
                     % triggered capture sequence and must fire the trigger
                     % and collect the stack at the end.
-                    for ii = 1:NMean
-                        obj.CameraObj.fireTrigger();
-                        pause(obj.CameraObj.TriggerPause)
+                    if ismethod(obj.CameraObj, 'fireTriggers')
+                        obj.CameraObj.fireTriggers(NMean);
+                    else
+                        for ii = 1:NMean
+                            obj.CameraObj.fireTrigger();
+                            pause(obj.CameraObj.TriggerPause)
+                        end
                     end
                 else
                     % Capture the image as usual.
@@ -39,12 +39,20 @@ classdef StepperMotor < mic.abstract
     % constructor(), goHome(), getPosition(), getStatus(), 
     % getStatus(), moveJog(), moveToPosition(), setJogStep()
     % getJogStep(), closeSBC(), delete(), exportState()
+    % goHomeAsync(), moveToPositionAsync(), isMoveDone(), waitForMove()
+    %
+    % The Async functions return a ticket at once; isMoveDone() and
+    % waitForMove() report when the controller signalled the end of the
+    % move, e.g.
+    %   Ticket = M.moveToPositionAsync(1,2);
+    %   ... set up the camera ...
+    %   [Done,Seconds,Pos] = M.waitForMove(Ticket,10);
     %
     % ## REQUIREMENTS:
     %   MATLAB 2014 or higher
     %   Kinesis software from thorlabs
     %   Abstract class.
-    %   Access to the mexfunctions for this device. (kinesis_SBC_function).
+    %   Access to the mexfunctions for this device. (Kinesis_Dispatch, SBC_* commands).
     %
     % ### CITATION: Mohamadreza Fazel, Lidkelab, 2017.
     
@@ -64,19 +72,19 @@ classdef StepperMotor < mic.abstract
             addpath('C:\Users\lidkelab\Documents\MATLAB\matlab-instrument-control\mex64');
             obj=obj@mic.abstract(~nargout);
             obj.SerialN = SerialNum;
-            Kinesis_SBC_Open(obj.SerialN);
+            Kinesis_Dispatch('Open',obj.SerialN);
         end
         function goHome(obj,Channel)
             %the stage goes to the origin for the given channel (axis).
-            Kinesis_SBC_Home(obj.SerialN,Channel);
+            Kinesis_Dispatch('SBC_Home',obj.SerialN,Channel);
         end
         function Position = getPosition(obj,Channel)
             %gives the current position of the stage for the given channel
             %(axis).
-            Position = Kinesis_SBC_GetPosition(obj.SerialN,Channel);
+            Position = Kinesis_Dispatch('SBC_GetPosition',obj.SerialN,Channel);
         end
         function Status = getStatus(obj,Channel)
-           Status = Kinesis_SBC_GetStatusBits(obj.SerialN,Channel); 
+           Status = Kinesis_Dispatch('GetStatusBits',obj.SerialN,Channel); 
         end
         function moveJog(obj,Channel,Direction)
             %move by the given step size in the given direction
@@ -87,11 +95,41 @@ classdef StepperMotor < mic.abstract
             if Pos < -4
                error('It cannot go further than -4mm.'); 
             end
-            Kinesis_SBC_MoveJog(obj.SerialN,Channel,Direction);
+            Kinesis_Dispatch('SBC_MoveJog',obj.SerialN,Channel,Direction);
         end
         function moveToPosition(obj,Channel,Pos)
            %move to the given position. Note that the range of position is [-4 mm, 4 mm]. 
-           Kinesis_SBC_MoveToPosition(obj.SerialN,Channel,Pos); 
+           Kinesis_Dispatch('SBC_MoveToPosition',obj.SerialN,Channel,Pos); 
+        end
+        function Ticket = goHomeAsync(obj,Channel)
+            %starts homing the given channel and returns a ticket for
+            %isMoveDone() and waitForMove().
+            [Ticket,Err] = Kinesis_Dispatch('SBC_HomeAsync',obj.SerialN,Channel);
+            if Err
+                error('StepperMotor:goHomeAsync','Homing failed with error %d.',Err);
+            end
+        end
+        function Ticket = moveToPositionAsync(obj,Channel,Pos)
+            %starts a move to the given position (mm) and returns a ticket
+            %for isMoveDone() and waitForMove().
+            [Ticket,Err] = Kinesis_Dispatch('SBC_MoveToPositionAsync',obj.SerialN,Channel,Pos);
+            if Err
+                error('StepperMotor:moveToPositionAsync','Move failed with error %d.',Err);
+            end
+        end
+        function [Done,Seconds,Pos] = isMoveDone(obj,Ticket)
+            %Done is true once the move has ended. Seconds is the time
+            %from the command to the end of the move and Pos the position
+            %(mm) at the end; both are NaN while moving.
+            [Done,Seconds,Pos] = Kinesis_Dispatch('SBC_IsDone',Ticket);
+        end
+        function [Done,Seconds,Pos] = waitForMove(obj,Ticket,Timeout)
+            %waits up to Timeout seconds (default 60) for the move to end.
+            %See isMoveDone() for the outputs.
+            if nargin < 3
+                Timeout = 60;
+            end
+            [Done,Seconds,Pos] = Kinesis_Dispatch('SBC_Wait',Ticket,Timeout);
         end
         function setJogStep(obj,Channel,Step)
             %setting the step size that you wish to have when you call
@@ -102,15 +140,15 @@ classdef StepperMotor < mic.abstract
             if Step < 0
                error('JogStep cannot be negative.') 
             end
-            Kinesis_SBC_SetJogStepSize(obj.SerialN,Channel,Step);
+            Kinesis_Dispatch('SBC_SetJogStepSize',obj.SerialN,Channel,Step);
         end
         function Step = getJogStep(obj,Channel)
             %gives the current jog step size in mm.
-            Step = Kinesis_SBC_GetJogStepSize(obj.SerialN,Channel);
+            Step = Kinesis_Dispatch('SBC_GetJogStepSize',obj.SerialN,Channel);
         end
         function closeSBC(obj)
             %called inside the delete function to close the communication ports for all the motors.
-            Kinesis_SBC_Close(obj.SerialN);
+            Kinesis_Dispatch('Close',obj.SerialN);
             
         end
         function delete(obj)
@@ -22,7 +22,7 @@ function guiFig=gui(obj)
 %   MATLAB 2014 or higher
 %   Kinesis software from thorlabs
 %   Abstract class.
-%   Access to the mexfunctions for this device. (kinesis_SBC_function).
+%   Access to the mexfunctions for this device. (Kinesis_Dispatch, SBC_* commands).
 %
 % CITATION: Mohamadreza Fazel, Lidkelab, 2017.
 